@@ -17,6 +17,7 @@
 #include "mpslib.h"
 
 #include <stdio.h> /* fflush, printf, putchar */
+#include <stdlib.h> /* free, malloc */
 
 
 /* These values have been tuned in the hope of getting one dynamic collection. */
@@ -30,6 +31,13 @@
 #define collectionsCOUNT  37
 #define rampSIZE          9
 #define initTestFREQ      6000
+#define batchCOUNT        8
+#define batchFREQ         16
+#define rootsALIGN        ((size_t)65536) /* at least the page size */
+#define rootsCARDS        16    /* enough pages for the MPS to use cards */
+#define coCOUNT           8     /* number of simulated coroutines */
+#define coDEPTH           64    /* words in each coroutine stack */
+#define coFREQ            509   /* one in coFREQ ambiguous writes switches */
 
 /* testChain -- generation parameters for the test */
 
@@ -43,8 +51,11 @@ static mps_gen_param_s testChain[genCOUNT] = {
 
 static mps_arena_t arena;
 static mps_ap_t ap;
-static mps_addr_t exactRoots[exactRootsCOUNT];
+static mps_addr_t *exactRoots;  /* on pages of their own, see main */
+static size_t exactRootsWords;  /* size of protected table, see main */
 static mps_addr_t ambigRoots[ambigRootsCOUNT];
+static mps_addr_t coStacks[coCOUNT][coDEPTH]; /* coroutine stacks */
+static size_t coHot[coCOUNT];   /* hot end of each suspended stack */
 static size_t scale;            /* Overall scale factor. */
 static unsigned long nCollsStart;
 static unsigned long nCollsDone;
@@ -100,6 +111,7 @@ static mps_addr_t make(size_t rootsCount)
   size_t size = (length+2) * sizeof(mps_word_t);
   mps_addr_t p;
   mps_res_t res;
+  size_t i;
   ++ calls;
 
   do {
@@ -108,6 +120,9 @@ static mps_addr_t make(size_t rootsCount)
       ArenaDescribe(arena, mps_lib_get_stderr(), 4);
       die(res, "MPS_RESERVE_BLOCK");
     }
+    /* ap is zeroed: see test. */
+    for (i = 0; i < size; ++i)
+      Insist(((unsigned char *)p)[i] == 0);
     res = dylan_init(p, size, exactRoots, rootsCount);
     if (res)
       die(res, "dylan_init");
@@ -117,6 +132,67 @@ static mps_addr_t make(size_t rootsCount)
 }
 
 
+/* make_batch -- create several objects of the same size at once */
+
+static void make_batch(mps_addr_t *p, size_t rootsCount)
+{
+  size_t length = rnd() % (scale * avLEN);
+  size_t size = (length+2) * sizeof(mps_word_t);
+  mps_res_t res;
+  size_t i, j;
+
+  do {
+    res = mps_reserve_many(p, ap, batchCOUNT, size);
+    if (res)
+      die(res, "mps_reserve_many");
+    for (i = 0; i < batchCOUNT; ++i) {
+      Insist((char *)p[i] == (char *)p[0] + i * size);
+      /* ap is zeroed: see test. */
+      for (j = 0; j < size; ++j)
+        Insist(((unsigned char *)p[i])[j] == 0);
+      res = dylan_init(p[i], size, exactRoots, rootsCount);
+      if (res)
+        die(res, "dylan_init");
+    }
+  } while (!mps_commit_many(ap, p, batchCOUNT, size));
+}
+
+
+/* retry_zeroed -- check that a zeroed ap zeroes a retried reservation
+ *
+ * Scribble on a reservation, then collect, so that the commit fails
+ * and the same memory is reserved again. There must be an object in
+ * the pool already, or the collection has nothing to condemn. Buffers
+ * for leaf objects aren't trapped by the flip, so this only applies to
+ * AMC.
+ */
+
+static void retry_zeroed(void)
+{
+  size_t size = 4 * sizeof(mps_word_t);
+  mps_addr_t p, q;
+  mps_res_t res;
+  size_t i;
+
+  (void)make(0);
+  die(mps_reserve(&p, ap, size), "mps_reserve (retry)");
+  for (i = 0; i < size; ++i)
+    ((unsigned char *)p)[i] = 0xA5;
+  die(mps_arena_collect(arena), "mps_arena_collect (retry)");
+  cdie(!mps_commit(ap, p, size), "commit after collect");
+
+  do {
+    die(mps_reserve(&q, ap, size), "mps_reserve (retry again)");
+    for (i = 0; i < size; ++i)
+      Insist(((unsigned char *)q)[i] == 0);
+    res = dylan_init(q, size, exactRoots, 0);
+    if (res)
+      die(res, "dylan_init");
+  } while (!mps_commit(ap, q, size));
+  mps_arena_release(arena);
+}
+
+
 /* test_stepper -- stepping function for walk */
 
 static void test_stepper(mps_addr_t object, mps_fmt_t fmt, mps_pool_t pool,
@@ -130,11 +206,12 @@ static void test_stepper(mps_addr_t object, mps_fmt_t fmt, mps_pool_t pool,
 
 /* test -- the body of the test */
 
-static void test(mps_pool_class_t pool_class, size_t roots_count)
+static void test(mps_pool_class_t pool_class, size_t roots_count,
+                 mps_rm_t roots_mode)
 {
   mps_fmt_t format;
   mps_chain_t chain;
-  mps_root_t exactRoot, ambigRoot;
+  mps_root_t exactRoot, ambigRoot, coRoots[coCOUNT];
   unsigned long objs; size_t i;
   mps_word_t collections, rampSwitch;
   mps_alloc_pattern_t ramp = mps_alloc_pattern_ramp();
@@ -143,6 +220,7 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   mps_addr_t busy_init;
   mps_pool_t pool;
   int described = 0; 
+  size_t roots_words;
 
   die(dylan_fmt(&format, arena), "fmt_create");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
@@ -150,23 +228,43 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   die(mps_pool_create(&pool, arena, pool_class, format, chain),
       "pool_create(amc)");
 
-  die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_RANK, mps_rank_exact());
+    MPS_ARGS_ADD(args, MPS_KEY_AP_ZEROED, TRUE);
+    die(mps_ap_create_k(&ap, pool, args), "BufferCreate");
+  } MPS_ARGS_END(args);
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
+  if (pool_class == mps_class_amc())
+    retry_zeroed();
 
-  for(i = 0; i < exactRootsCOUNT; ++i)
+  /* A protected table extends over many pages, most of which are
+     never written, so that the MPS can skip them when scanning. */
+  roots_words = (roots_mode & MPS_RM_PROT) ? exactRootsWords : exactRootsCOUNT;
+  for(i = 0; i < roots_words; ++i)
     exactRoots[i] = objNULL;
   for(i = 0; i < ambigRootsCOUNT; ++i)
     ambigRoots[i] = rnd_addr();
 
   die(mps_root_create_table_masked(&exactRoot, arena,
-                                   mps_rank_exact(), (mps_rm_t)0,
-                                   &exactRoots[0], exactRootsCOUNT,
+                                   mps_rank_exact(), roots_mode,
+                                   &exactRoots[0], roots_words,
                                    (mps_word_t)1),
       "root_create_table(exact)");
   die(mps_root_create_table(&ambigRoot, arena,
                             mps_rank_ambig(), (mps_rm_t)0,
                             &ambigRoots[0], ambigRootsCOUNT),
       "root_create_table(ambig)");
+  for (i = 0; i < coCOUNT; ++i) {
+    size_t j;
+    for (j = 0; j < coDEPTH; ++j)
+      coStacks[i][j] = objNULL;
+    die(mps_root_create_stack(&coRoots[i], arena,
+                              mps_rank_ambig(), (mps_rm_t)0,
+                              mps_scan_area, NULL, &coStacks[i][coDEPTH]),
+        "root_create_stack");
+    coHot[i] = 0;
+    mps_root_stack_suspend(coRoots[i], &coStacks[i][coHot[i]]);
+  }
 
   /* create an ap, and leave it busy */
   die(mps_reserve(&busy_init, busy_ap, 64), "mps_reserve busy");
@@ -221,6 +319,12 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
              || (dylan_check(exactRoots[i])
                  && mps_arena_has_addr(arena, exactRoots[i])),
              "all roots check");
+      for (i = 0; i < coCOUNT; ++i) {
+        size_t j;
+        for (j = coHot[i]; j < coDEPTH; ++j)
+          cdie(coStacks[i][j] == objNULL || dylan_check(coStacks[i][j]),
+               "coroutine stack check");
+      }
       cdie(!mps_arena_has_addr(arena, NULL),
            "NULL in arena");
 
@@ -263,7 +367,15 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
       i = (r >> 1) % exactRootsCOUNT;
       if (exactRoots[i] != objNULL)
         cdie(dylan_check(exactRoots[i]), "dying root check");
-      exactRoots[i] = make(roots_count);
+      if ((r >> 1) % batchFREQ == 0) {
+        mps_addr_t batch[batchCOUNT];
+        size_t j;
+        make_batch(batch, roots_count);
+        for (j = 0; j < batchCOUNT; ++j)
+          exactRoots[(i + j) % exactRootsCOUNT] = batch[j];
+      } else {
+        exactRoots[i] = make(roots_count);
+      }
       if (exactRoots[(exactRootsCOUNT-1) - i] != objNULL)
         dylan_write(exactRoots[(exactRootsCOUNT-1) - i],
                     exactRoots, exactRootsCOUNT);
@@ -272,6 +384,22 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
       ambigRoots[(ambigRootsCOUNT-1) - i] = make(roots_count);
       /* Create random interior pointers */
       ambigRoots[i] = (mps_addr_t)((char *)(ambigRoots[i/2]) + 1);
+      if ((r >> 1) % coFREQ == 0) {
+        /* Run a coroutine: it pushes and pops some frames, and writes
+           an object into some of them. The object is kept alive by
+           this thread's stack until the coroutine is suspended. The
+           "stack" isn't the thread's stack, so the coroutine isn't
+           resumed on the thread, but nothing is allocated while it
+           runs. Real stacks are tested by corotest. */
+        size_t c = (r >> 1) / coFREQ % coCOUNT, hot, j;
+        mps_addr_t obj = make(roots_count);
+        hot = (size_t)rnd() % coDEPTH;
+        for (j = hot; j < coDEPTH; ++j)
+          if (j < coHot[c] || rnd() % 4 == 0)
+            coStacks[c][j] = (rnd() & 1) ? obj : objNULL;
+        coHot[c] = hot;
+        mps_root_stack_suspend(coRoots[c], &coStacks[c][hot]);
+      }
     }
 
     if (r % initTestFREQ == 0)
@@ -292,6 +420,8 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   mps_ap_destroy(ap);
   mps_root_destroy(exactRoot);
   mps_root_destroy(ambigRoot);
+  for (i = 0; i < coCOUNT; ++i)
+    mps_root_destroy(coRoots[i]);
   mps_pool_destroy(pool);
   mps_chain_destroy(chain);
   mps_fmt_destroy(format);
@@ -300,8 +430,9 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
 
 int main(int argc, char *argv[])
 {
-  size_t i, grainSize;
+  size_t i, grainSize, rootsAlign;
   mps_thr_t thread;
+  void *rootsBlock;
 
   testlib_init(argc, argv);
 
@@ -310,6 +441,15 @@ int main(int argc, char *argv[])
   grainSize = rnd_grain(scale * testArenaSIZE);
   printf("Picked scale=%lu grainSize=%lu\n", (unsigned long)scale, (unsigned long)grainSize);
 
+  /* The exact roots must have pages to themselves, so that they can
+     be protected by the incremental test. */
+  rootsAlign = grainSize > rootsALIGN ? grainSize : rootsALIGN;
+  rootsBlock = malloc((rootsCARDS + 1) * rootsAlign);
+  cdie(rootsBlock != NULL, "malloc");
+  exactRoots = (mps_addr_t *)(((mps_word_t)rootsBlock + rootsAlign - 1)
+                              & ~(mps_word_t)(rootsAlign - 1));
+  exactRootsWords = rootsCARDS * rootsAlign / sizeof exactRoots[0];
+
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, scale * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, grainSize);
@@ -318,11 +458,22 @@ int main(int argc, char *argv[])
   mps_message_type_enable(arena, mps_message_type_gc());
   mps_message_type_enable(arena, mps_message_type_gc_start());
   die(mps_thread_reg(&thread, arena), "thread_reg");
-  test(mps_class_amc(), exactRootsCOUNT);
-  test(mps_class_amcz(), 0);
+  test(mps_class_amc(), exactRootsCOUNT, (mps_rm_t)0);
+  /* Recycle the arena between tests. */
+  mps_thread_dereg(thread);
+  report();
+  die(mps_arena_reset(arena), "arena_reset");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+  test(mps_class_amcz(), 0, (mps_rm_t)0);
+  mps_thread_dereg(thread);
+  report();
+  die(mps_arena_reset(arena), "arena_reset");
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+  test(mps_class_amc(), exactRootsCOUNT, MPS_RM_PROT | MPS_RM_INCREMENTAL);
   mps_thread_dereg(thread);
   report();
   mps_arena_destroy(arena);
+  free(rootsBlock);
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
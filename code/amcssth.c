@@ -115,8 +115,15 @@ static void churn(mps_ap_t ap, size_t roots_count)
 typedef struct closure_s {
   mps_pool_t pool;
   size_t roots_count;
+  mps_bool_t thread_local;   /* allocate on a thread-local AP? */
 } closure_s, *closure_t;
 
+static void *native(void *p, size_t s)
+{
+  testlib_unused(s);
+  return p;
+}
+
 static void *kid_thread(void *arg)
 {
   void *marker = &marker;
@@ -126,18 +133,54 @@ static void *kid_thread(void *arg)
   closure_t cl = arg;
 
   /* Register the thread twice to check this is supported -- see
-   * <design/thread-manager#.req.register.multi>
+   * <design/thread-manager#.req.register.multi> -- once to be stopped
+   * at safepoints, where the platform supports that, and once to be
+   * suspended.
    */
-  die(mps_thread_reg(&thread1, arena), "thread_reg");
+  MPS_ARGS_BEGIN(args) {
+    mps_res_t res;
+    MPS_ARGS_ADD(args, MPS_KEY_THREAD_SAFEPOINT, TRUE);
+    res = mps_thread_reg_k(&thread1, arena, args);
+    if (res == MPS_RES_UNIMPL)
+      res = mps_thread_reg(&thread1, arena);
+    die(res, "thread_reg_k");
+  } MPS_ARGS_END(args);
   die(mps_thread_reg(&thread2, arena), "thread_reg");
   die(mps_root_create_thread(&reg_root, arena, thread1, marker),
       "root_create");
 
-  die(mps_ap_create(&ap, cl->pool, mps_rank_exact()), "BufferCreate(fooey)");
+  if (cl->thread_local) {
+    /* Allocate through the thread's own allocation point, which the
+     * MPS creates on demand and destroys when the thread deregisters. */
+    mps_addr_t p;
+    size_t size = 2 * sizeof(mps_word_t);
+    mps_res_t res;
+    do {
+      die(mps_tl_reserve(&p, cl->pool, size), "mps_tl_reserve");
+      res = dylan_init(p, size, exactRoots, cl->roots_count);
+      if (res)
+        die(res, "dylan_init");
+    } while (!mps_tl_commit(cl->pool, p, size));
+    die(mps_tl_ap(&ap, cl->pool), "mps_tl_ap");
+  } else {
+    die(mps_ap_create(&ap, cl->pool, mps_rank_exact()), "BufferCreate(fooey)");
+  }
   while(mps_collections(arena) < collectionsCOUNT) {
+    if (cl->thread_local) {
+      mps_ap_t tl_ap;
+      die(mps_tl_ap(&tl_ap, cl->pool), "mps_tl_ap");
+      Insist(tl_ap == ap);
+    }
     churn(ap, cl->roots_count);
+    mps_thread_safepoint(thread1);
+    if (rnd() % 16 == 0) {
+      void *r;
+      mps_thread_call_native(&r, thread1, native, &r, 0);
+      Insist(r == &r);
+    }
   }
-  mps_ap_destroy(ap);
+  if (!cl->thread_local)
+    mps_ap_destroy(ap);
 
   mps_root_destroy(reg_root);
   mps_thread_dereg(thread2);
@@ -158,17 +201,21 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
   mps_ap_t ap, busy_ap;
   mps_addr_t busy_init;
   testthr_t kids[10];
-  closure_s cl;
+  closure_s cl[2];
   int walked = FALSE, ramped = FALSE;
 
   printf("\n------ pool: %s-------\n", name);
 
-  cl.pool = pool;
-  cl.roots_count = roots_count;
+  /* Half the kids allocate on thread-local allocation points. */
+  for (i = 0; i < NELEMS(cl); ++i) {
+    cl[i].pool = pool;
+    cl[i].roots_count = roots_count;
+    cl[i].thread_local = i == 1;
+  }
   collections = 0;
 
   for (i = 0; i < NELEMS(kids); ++i)
-    testthr_create(&kids[i], kid_thread, &cl);
+    testthr_create(&kids[i], kid_thread, &cl[i % NELEMS(cl)]);
 
   die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
   die(mps_ap_create(&busy_ap, pool, mps_rank_exact()), "BufferCreate 2");
@@ -268,7 +315,7 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
     testthr_join(&kids[i], NULL);
 }
 
-static void test_arena(void)
+static void test_arena(mps_bool_t handshake)
 {
   size_t i;
   mps_fmt_t format;
@@ -276,11 +323,17 @@ static void test_arena(void)
   mps_thr_t thread;
   mps_root_t reg_root;
   mps_pool_t amc_pool, amcz_pool;
+  mps_ap_t tl_ap;
   void *marker = &marker;
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    /* Scan the kids' stacks in parallel: see <code/trace.c#.flip.par>. */
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SCAN_WORKERS, 2);
+    /* Flip the kids that are at safepoints by handshakes: see
+     * <code/trace.c#.flip.handshake>. */
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_HANDSHAKE, handshake);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_gc());
@@ -312,11 +365,18 @@ static void test_arena(void)
   die(mps_pool_create(&amcz_pool, arena, mps_class_amcz(), format, chain),
       "pool_create(amcz)");
 
+  /* Committing without a thread-local allocation point fails. */
+  Insist(!mps_tl_commit(amc_pool, &tl_ap, sizeof tl_ap));
+
   test_pool("AMC", amc_pool, exactRootsCOUNT);
   test_pool("AMCZ", amcz_pool, 0);
 
+  /* Destroying a pool destroys the thread-local allocation points in
+   * it, even the calling thread's. */
+  die(mps_tl_ap(&tl_ap, amc_pool), "mps_tl_ap(amc)");
   mps_arena_park(arena);
   mps_pool_destroy(amc_pool);
+  die(mps_tl_ap(&tl_ap, amcz_pool), "mps_tl_ap(amcz)");
   mps_pool_destroy(amcz_pool);
   mps_root_destroy(reg_root);
   mps_thread_dereg(thread);
@@ -330,7 +390,8 @@ static void test_arena(void)
 int main(int argc, char *argv[])
 {
   testlib_init(argc, argv);
-  test_arena();
+  test_arena(FALSE);
+  test_arena(TRUE);
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
@@ -17,6 +17,7 @@
 
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* malloc */
+#include <string.h> /* memset */
 
 
 #define testArenaSIZE   ((((size_t)3)<<24) - 4)
@@ -25,16 +26,27 @@
 #define MAX_ALIGN 64 /* TODO: Make this test work up to arena_grain_size? */
 
 
-/* make -- allocate one object */
+/* make -- allocate one object
+ *
+ * If the allocation point is zeroed, check that the object is zero,
+ * then scribble over it so that re-use of the memory is tested.
+ */
 
-static mps_res_t make(mps_addr_t *p, mps_ap_t ap, size_t size)
+static mps_res_t make(mps_addr_t *p, mps_ap_t ap, size_t size,
+                      mps_bool_t zeroed)
 {
   mps_res_t res;
+  size_t i;
 
   do {
     MPS_RESERVE_BLOCK(res, *p, ap, size);
     if(res != MPS_RES_OK)
       return res;
+    if (zeroed) {
+      for (i = 0; i < size; ++i)
+        Insist(((unsigned char *)*p)[i] == 0);
+      memset(*p, 0xA5, size);
+    }
   } while(!mps_commit(ap, *p, size));
 
   return MPS_RES_OK;
@@ -68,17 +80,21 @@ static mps_res_t stress(mps_arena_t arena, mps_pool_debug_option_s *options,
   size_t ss[testSetSIZE];
   size_t allocated = 0;         /* Total allocated memory */
   size_t debugOverhead = options ? 2 * alignUp(options->fence_size, align) : 0;
+  mps_bool_t zeroed = rnd() % 2;
 
-  printf("stress %s\n", name);
+  printf("stress %s%s\n", name, zeroed ? " (zeroed)" : "");
 
   die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create");
-  die(mps_ap_create(&ap, pool, mps_rank_exact()), "BufferCreate");
+  MPS_ARGS_BEGIN(apArgs) {
+    MPS_ARGS_ADD(apArgs, MPS_KEY_AP_ZEROED, zeroed);
+    die(mps_ap_create_k(&ap, pool, apArgs), "BufferCreate");
+  } MPS_ARGS_END(apArgs);
 
   /* allocate a load of objects */
   for (i=0; i<testSetSIZE; ++i) {
     mps_addr_t obj;
     ss[i] = (*size)(i, align);
-    res = make(&obj, ap, ss[i]);
+    res = make(&obj, ap, ss[i], zeroed);
     if (res != MPS_RES_OK)
       goto allocFail;
     ps[i] = obj;
@@ -123,7 +139,7 @@ static mps_res_t stress(mps_arena_t arena, mps_pool_debug_option_s *options,
     for (i=testSetSIZE/2; i<testSetSIZE; ++i) {
       mps_addr_t obj;
       ss[i] = (*size)(i, align);
-      res = make(&obj, ap, ss[i]);
+      res = make(&obj, ap, ss[i], zeroed);
       if (res != MPS_RES_OK)
         goto allocFail;
       ps[i] = obj;
@@ -124,6 +124,7 @@ DEFINE_CLASS(Arena, AbstractArena, klass)
   klass->create = ArenaNoCreate;
   klass->destroy = ArenaNoDestroy;
   klass->purgeSpare = ArenaNoPurgeSpare;
+  klass->prefaultSpare = ArenaNoPrefaultSpare;
   klass->extend = ArenaNoExtend;
   klass->grow = ArenaNoGrow;
   klass->free = ArenaNoFree;
@@ -148,6 +149,7 @@ Bool ArenaClassCheck(ArenaClass klass)
   CHECKL(FUNCHECK(klass->create));
   CHECKL(FUNCHECK(klass->destroy));
   CHECKL(FUNCHECK(klass->purgeSpare));
+  CHECKL(FUNCHECK(klass->prefaultSpare));
   CHECKL(FUNCHECK(klass->extend));
   CHECKL(FUNCHECK(klass->grow));
   CHECKL(FUNCHECK(klass->free));
@@ -216,6 +218,7 @@ Bool ArenaCheck(Arena arena)
   CHECKL(TreeCheck(ArenaChunkTree(arena)));
   /* TODO: check that the chunkRing and chunkTree have identical members */
   /* nothing to check for chunkSerial */
+  /* nothing to check for evacuatingChunks */
   
   CHECKL(LocusCheck(arena));
 
@@ -238,6 +241,9 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   double spare = ARENA_SPARE_DEFAULT;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Size prefaultSize = ARENA_DEFAULT_PREFAULT_SIZE;
+  Count scanWorkerCount = ARENA_DEFAULT_SCAN_WORKERS;
+  Bool handshake = ARENA_DEFAULT_HANDSHAKE;
   mps_arg_s arg;
 
   AVER(arena != NULL);
@@ -258,6 +264,12 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     spare = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_PREFAULT_SIZE))
+    prefaultSize = arg.val.size;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_SCAN_WORKERS))
+    scanWorkerCount = arg.val.count;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_HANDSHAKE))
+    handshake = arg.val.b;
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -267,6 +279,7 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->commitLimit = commitLimit;
   arena->spareCommitted = (Size)0;
   arena->spare = spare;
+  arena->prefaultSize = prefaultSize;
   arena->pauseTime = pauseTime;
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
@@ -282,12 +295,15 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
   arena->chunkSerial = (Serial)0;
+  arena->evacuatingChunks = (Count)0;
   
   LocusInit(arena);
   
   res = GlobalsInit(ArenaGlobals(arena));
   if (res != ResOK)
     goto failGlobalsInit;
+  arena->scanWorkerCount = scanWorkerCount;
+  arena->handshake = handshake;
 
   SetClassOfPoly(arena, CLASS(AbstractArena));
   arena->sig = ArenaSig;
@@ -329,6 +345,7 @@ failGlobalsInit:
  * exist on all platforms. */
 
 ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
+ARG_DEFINE_KEY(ARENA_PREFAULT, Bool);
 
 
 /* ArenaCreate -- create the arena and call initializers */
@@ -339,6 +356,9 @@ ARG_DEFINE_KEY(ARENA_ZONED, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
+ARG_DEFINE_KEY(ARENA_PREFAULT_SIZE, Size);
+ARG_DEFINE_KEY(ARENA_SCAN_WORKERS, Count);
+ARG_DEFINE_KEY(ARENA_HANDSHAKE, Bool);
 
 static Res arenaFreeLandInit(Arena arena)
 {
@@ -502,6 +522,42 @@ void ArenaDestroy(Arena arena)
 }
 
 
+/* ArenaReset -- return an arena to its state after creation
+ *
+ * The client must already have destroyed everything it created in the
+ * arena, as for ArenaDestroy.  The chunks, their page tables and any
+ * spare committed memory are kept, so that the arena can be reused
+ * without the cost of mapping and unmapping address space.
+ */
+
+Res ArenaReset(Arena arena)
+{
+  Ring node, next;
+  ZoneSet inUse = ZoneSetEMPTY;
+  Res res;
+
+  AVERT(Arena, arena);
+
+  res = GlobalsReset(ArenaGlobals(arena));
+  if (res != ResOK)
+    return res;
+
+  /* Recompute the free zones, which ArenaAlloc only ever reduces,
+     from the pages still allocated to the system pools. */
+  RING_FOR(node, &arena->chunkRing, next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    Index i;
+    for (i = chunk->allocBase; i < chunk->pages; ++i)
+      if (BTGet(chunk->allocTable, i))
+        inUse = ZoneSetAddAddr(arena, inUse, PageIndexBase(chunk, i));
+  }
+  arena->freeZones = ZoneSetComp(inUse);
+
+  AVERT(Arena, arena);
+  return ResOK;
+}
+
+
 /* ControlInit -- initialize the control pool */
 
 Res ControlInit(Arena arena)
@@ -564,13 +620,14 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "commitLimit      $W\n", (WriteFW)arena->commitLimit,
                "spareCommitted   $W\n", (WriteFW)arena->spareCommitted,
                "spare            $D\n", (WriteFD)arena->spare,
+               "prefaultSize     $W\n", (WriteFW)arena->prefaultSize,
                "zoneShift        $U\n", (WriteFU)arena->zoneShift,
                "grainSize        $W\n", (WriteFW)arena->grainSize,
                "lastTract        $P\n", (WriteFP)arena->lastTract,
                "lastTractBase    $P\n", (WriteFP)arena->lastTractBase,
                "primary          $P\n", (WriteFP)arena->primary,
                "hasFreeLand      $S\n", WriteFYesNo(arena->hasFreeLand),
-               "freeZones        $B\n", (WriteFB)arena->freeZones,
+               "freeZones        " ZoneSetFORMAT "\n", ZoneSetWriteF(arena->freeZones),
                "zoned            $S\n", WriteFYesNo(arena->zoned),
                NULL);
   if (res != ResOK)
@@ -838,7 +895,9 @@ static Res arenaAllocPage(Addr *baseReturn, Arena arena, Pool pool)
     Ring node, next;
     RING_FOR(node, ArenaChunkRing(arena), next) {
       Chunk chunk = RING_ELT(Chunk, arenaRing, node);
-      if (chunk != arena->primary) {
+      /* Don't allocate in chunks being evacuated: see
+         ArenaChunkEvacuate. */
+      if (chunk != arena->primary && !chunk->evacuating) {
         res = arenaAllocPageInChunk(baseReturn, chunk, pool);
         if (res == ResOK)
           break;
@@ -1082,6 +1141,82 @@ failMark:
 }
 
 
+/* ArenaChunkEvacuate -- withhold a chunk's free pages from allocation
+ *
+ * Delete the free page ranges of a non-primary chunk from the arena's
+ * free land, so that no new tracts are allocated there while a
+ * compaction trace evacuates the chunk's moving segments (see
+ * TraceStartCompact). Tracts freed in the chunk meanwhile are not
+ * returned to the free land either. The free ranges are restored by
+ * ArenaCompact when the trace finishes, so that any chunk that was
+ * emptied can then be destroyed.
+ *
+ * Each maximal free page range in the chunk is exactly one block in
+ * the free land, because chunks never coalesce (see .chunk.no-coalesce)
+ * so deleting it can't need a new block.
+ */
+
+void ArenaChunkEvacuate(Chunk chunk)
+{
+  Arena arena;
+  Index base, limit;
+
+  AVERT(Chunk, chunk);
+  arena = ChunkArena(chunk);
+  AVER(arena->hasFreeLand);
+  AVER(chunk != arena->primary);
+  AVER(!chunk->evacuating);
+
+  limit = chunk->allocBase;
+  while (limit < chunk->pages
+         && BTFindLongResRange(&base, &limit, chunk->allocTable,
+                               limit, chunk->pages, 1))
+  {
+    ArenaFreeLandDelete(arena, PageIndexBase(chunk, base),
+                        PageIndexBase(chunk, limit));
+  }
+
+  chunk->evacuating = TRUE;
+  ++arena->evacuatingChunks;
+}
+
+
+/* arenaChunkEvacuateEnd -- return a chunk's free pages to the free land
+ *
+ * The evacuating flag is cleared first, so that if the free land needs
+ * a page for its block pool, arenaAllocPage may take it from the range
+ * being inserted (see .insert.exclude). Ranges are inserted in address
+ * order, so that page is never in a range that is yet to be inserted.
+ */
+
+static void arenaChunkEvacuateEnd(Chunk chunk)
+{
+  Arena arena;
+  Index base, limit;
+
+  AVERT(Chunk, chunk);
+  AVER(chunk->evacuating);
+  arena = ChunkArena(chunk);
+  AVER(arena->evacuatingChunks > 0);
+
+  chunk->evacuating = FALSE;
+  --arena->evacuatingChunks;
+
+  limit = chunk->allocBase;
+  while (limit < chunk->pages
+         && BTFindLongResRange(&base, &limit, chunk->allocTable,
+                               limit, chunk->pages, 1))
+  {
+    RangeStruct range, oldRange;
+    Res res;
+    RangeInit(&range, PageIndexBase(chunk, base), PageIndexBase(chunk, limit));
+    res = arenaFreeLandInsertExtend(&oldRange, arena, &range);
+    AVER(res == ResOK); /* a page for the block pool is free in range */
+    /* If the insert does fail, we lose some address space permanently. */
+  }
+}
+
+
 /* ArenaAlloc -- allocate some tracts from the arena */
 
 Res ArenaAlloc(Addr *baseReturn, LocusPref pref, Size size, Pool pool)
@@ -1121,6 +1256,32 @@ allocFail:
 }
 
 
+/* ArenaZeroed -- is newly allocated memory known to be zero?
+ *
+ * Returns TRUE if the memory from base to limit, which the caller has
+ * just allocated with ArenaAlloc and not yet written to, is known to
+ * contain only zeroes, because the arena class mapped it fresh from
+ * the operating system and nothing has used it since.
+ */
+
+Bool ArenaZeroed(Arena arena, Addr base, Addr limit)
+{
+  Chunk chunk = NULL; /* suppress "may be used uninitialized" */
+  Bool b;
+
+  AVERT(Arena, arena);
+  AVER(base < limit);
+  AVER(AddrIsArenaGrain(base, arena));
+  AVER(AddrIsArenaGrain(limit, arena));
+
+  b = ChunkOfAddr(&chunk, arena, base);
+  AVER(b);
+  AVER(limit <= chunk->limit);
+  return BTIsSetRange(chunk->zeroTable, INDEX_OF_ADDR(chunk, base),
+                      INDEX_OF_ADDR(chunk, limit));
+}
+
+
 /* ArenaFree -- free some tracts to the arena */
 
 void ArenaFree(Addr base, Size size, Pool pool)
@@ -1145,7 +1306,17 @@ void ArenaFree(Addr base, Size size, Pool pool)
     arena->lastTract = NULL;
     arena->lastTractBase = (Addr)0;
   }
-  
+
+  /* Tracts freed in a chunk that is being evacuated stay out of the
+     free land until the evacuation ends: see ArenaChunkEvacuate. */
+  if (arena->evacuatingChunks > 0) {
+    Chunk chunk;
+    Bool b = ChunkOfAddr(&chunk, arena, base);
+    AVER(b);
+    if (chunk->evacuating)
+      goto skipInsert;
+  }
+
   res = arenaFreeLandInsertExtend(&oldRange, arena, &range);
   if (res != ResOK) {
     Land land = ArenaFreeLand(arena);
@@ -1154,6 +1325,7 @@ void ArenaFree(Addr base, Size size, Pool pool)
     if (RangeIsEmpty(&range))
       goto done;
   }
+skipInsert:
   Method(Arena, arena, free)(RangeBase(&range), RangeSize(&range), pool);
 
 done:
@@ -1228,6 +1400,35 @@ Size ArenaNoPurgeSpare(Arena arena, Size size)
   return 0;
 }
 
+Size ArenaNoPrefaultSpare(Arena arena, Size size)
+{
+  AVERT(Arena, arena);
+  UNUSED(size);
+  return 0;
+}
+
+
+/* ArenaPrefault -- top up the spare committed memory
+ *
+ * Called in idle time (see ArenaStep) to map and touch free memory
+ * ahead of allocation, so that up to arena->prefaultSize of spare
+ * memory is ready for PolicyAlloc without a page fault or a call to
+ * the operating system.  Returns the amount of memory prefaulted.
+ */
+
+Size ArenaPrefault(Arena arena)
+{
+  Size spareCommitted;
+
+  AVERT(Arena, arena);
+
+  spareCommitted = ArenaSpareCommitted(arena);
+  if (spareCommitted >= arena->prefaultSize)
+    return 0;
+  return Method(Arena, arena, prefaultSpare)(arena, arena->prefaultSize
+                                             - spareCommitted);
+}
+
 
 Res ArenaNoGrow(Arena arena, LocusPref pref, Size size)
 {
@@ -1349,13 +1550,36 @@ Res ArenaNoExtend(Arena arena, Addr base, Size size)
 }
 
 
-/* ArenaCompact -- respond (or not) to trace reclaim */
+/* ArenaCompact -- respond (or not) to trace reclaim
+ *
+ * Any chunks that were being evacuated by the trace get their free
+ * pages back first, so that the arena class can destroy the ones that
+ * are now empty.
+ */
 
 void ArenaCompact(Arena arena, Trace trace)
 {
+  Bool evacuated;
+
   AVERT(Arena, arena);
   AVERT(Trace, trace);
+
+  evacuated = arena->evacuatingChunks > 0;
+  if (evacuated) {
+    Ring node, next;
+    RING_FOR(node, ArenaChunkRing(arena), next) {
+      Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+      if (chunk->evacuating)
+        arenaChunkEvacuateEnd(chunk);
+    }
+    AVER(arena->evacuatingChunks == 0);
+  }
+
   Method(Arena, arena, compact)(arena, trace);
+
+  /* <code/policy.c#compact.hysteresis> */
+  if (evacuated)
+    arena->compactReserved = ArenaReserved(arena);
 }
 
 static void ArenaTrivCompact(Arena arena, Trace trace)
@@ -211,7 +211,8 @@ static Bool clientChunkDestroy(Tree tree, void *closure)
 static void ClientChunkFinish(Chunk chunk)
 {
   /* Can't check chunk as it's not valid anymore. */
-  UNUSED(chunk);
+  /* The memory goes back to the client: <code/protsh.c#.unmap>. */
+  ProtShadowForget(chunk->base, chunk->limit);
 }
 
 
@@ -265,7 +266,7 @@ static Res ClientArenaCreate(Arena *arenaReturn, ArgList args)
   AVER(base != (Addr)0);
   AVERT(ArenaGrainSize, grainSize);
 
-  if (size < grainSize * MPS_WORD_WIDTH)
+  if (size < grainSize * ZoneCOUNT)
     /* Not enough room for a full complement of zones. */
     return ResMEMORY;
 
@@ -299,10 +300,10 @@ static Res ClientArenaCreate(Arena *arenaReturn, ArgList args)
   arena->primary = chunk;
 
   /* Set the zone shift to divide the initial chunk into the same */
-  /* number of zones as will fit into a reference set (the number of */
-  /* bits in a word). Note that some zones are discontiguous in the */
+  /* number of zones as will fit into a reference set (ZoneCOUNT). */
+  /* Note that some zones are discontiguous in the */
   /* arena if the size is not a power of 2. */
-  arena->zoneShift = SizeFloorLog2(size >> MPS_WORD_SHIFT);
+  arena->zoneShift = SizeFloorLog2(size >> ZoneSHIFT);
   AVER(ArenaGrainSize(arena) == ChunkPageSize(arena->primary));
 
   EVENT7(ArenaCreateCL, arena, size, base, grainSize,
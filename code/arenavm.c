@@ -512,6 +512,9 @@ static Res vmArenaChunkSize(Size *chunkSizeReturn, VMArena vmArena, Size size)
     pages = chunkSize >> grainShift;
     overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
 
+    /* See <code/tract.c#overhead.zero>. */
+    overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
+
     /* See .overhead.sa-mapped. */
     overhead += SizeAlignUp(BTSize(pages), MPS_PF_ALIGN);
 
@@ -572,10 +575,10 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
 
   if (ArgPick(&arg, args, MPS_KEY_ARENA_SIZE))
     size = arg.val.size;
-  if (size < grainSize * MPS_WORD_WIDTH)
+  if (size < grainSize * ZoneCOUNT)
     /* There has to be enough room in the chunk for a full complement of
        zones. Make it easier to write portable programs by rounding up. */
-    size = grainSize * MPS_WORD_WIDTH;
+    size = grainSize * ZoneCOUNT;
   
   /* Parse remaining arguments, if any, into VM parameters. We must do
      this into some stack-allocated memory for the moment, since we
@@ -650,12 +653,12 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
 #endif
 
   /* .zoneshift: Set the zone shift to divide the chunk into the same */
-  /* number of stripes as will fit into a reference set (the number of */
-  /* bits in a word).  Fail if the chunk is so small stripes are smaller */
+  /* number of stripes as will fit into a reference set (ZoneCOUNT). */
+  /* Fail if the chunk is so small stripes are smaller */
   /* than pages.  Note that some zones are discontiguous in the chunk if */
   /* the size is not a power of 2.  <design/arena#.class.fields>. */
   chunkSize = ChunkSize(chunk);
-  arena->zoneShift = SizeFloorLog2(chunkSize >> MPS_WORD_SHIFT);
+  arena->zoneShift = SizeFloorLog2(chunkSize >> ZoneSHIFT);
   AVER(ChunkPageSize(chunk) == ArenaGrainSize(arena));
 
   AVERT(VMArena, vmArena);
@@ -867,6 +870,8 @@ static Res pagesMarkAllocated(VMArena vmArena, VMChunk vmChunk,
                      PageIndexBase(chunk, j), PageIndexBase(chunk, k));
     if (res != ResOK)
       goto failVMMap;
+    /* Freshly mapped pages contain only zeroes: see ArenaZeroed. */
+    BTSetRange(chunk->zeroTable, j, k);
     for (i = j; i < k; ++i) {
       PageInit(chunk, i);
       PageAlloc(chunk, i, pool);
@@ -1060,6 +1065,76 @@ static void chunkUnmapSpare(Chunk chunk)
 }
 
 
+/* VMPrefaultSpare -- map and touch free pages as spare pages
+ *
+ * Maps up to size bytes of free, unmapped pages, lowest addresses
+ * first, touches them so that the operating system commits them now,
+ * and adds them to the spare ring, where pagesMarkAllocated finds
+ * them.  Freshly mapped pages are zero.  The amount is limited so that
+ * the spare committed invariant (see VMFree) still holds.  Returns the
+ * amount of memory prefaulted.
+ */
+
+static Size VMPrefaultSpare(Arena arena, Size size)
+{
+  VMArena vmArena = MustBeA(VMArena, arena);
+  Size spareLimit, prefaulted = 0;
+  Ring node, next;
+
+  spareLimit = ArenaSpareCommitLimit(arena);
+  if (ArenaSpareCommitted(arena) >= spareLimit)
+    return 0;
+  if (size > spareLimit - ArenaSpareCommitted(arena))
+    size = spareLimit - ArenaSpareCommitted(arena);
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    VMChunk vmChunk = Chunk2VMChunk(chunk);
+    Index basePI, limitPI, pi;
+    Index cursor = chunk->allocBase;
+    Count pages;
+
+    /* Free pages in an evacuating chunk won't be allocated. */
+    if (chunk->evacuating)
+      continue;
+
+    while ((pages = ChunkSizeToPages(chunk, size - prefaulted)) > 0
+           && cursor < chunk->pages
+           && BTFindLongResRange(&basePI, &limitPI, vmChunk->pages.mapped,
+                                 cursor, chunk->pages, 1))
+    {
+      if (limitPI - basePI > pages)
+        limitPI = basePI + pages;
+      if (pageDescMap(vmChunk, basePI, limitPI) != ResOK)
+        return prefaulted;
+      if (vmArenaMap(vmArena, VMChunkVM(vmChunk),
+                     PageIndexBase(chunk, basePI),
+                     PageIndexBase(chunk, limitPI)) != ResOK) {
+        pageDescUnmap(vmChunk, basePI, limitPI);
+        return prefaulted;
+      }
+      VMTouch(VMChunkVM(vmChunk), PageIndexBase(chunk, basePI),
+              PageIndexBase(chunk, limitPI));
+      BTSetRange(chunk->zeroTable, basePI, limitPI);
+      for (pi = basePI; pi < limitPI; ++pi) {
+        Page page = ChunkPage(chunk, pi);
+        AVER(!BTGet(chunk->allocTable, pi));
+        /* As VMFree, but the descriptor is newly mapped junk. */
+        PageSetPool(page, NULL);
+        PageSetType(page, PageStateSPARE);
+        RingInit(PageSpareRing(page));
+        RingAppend(&vmArena->spareRing, PageSpareRing(page));
+      }
+      arena->spareCommitted += ChunkPagesToSize(chunk, limitPI - basePI);
+      prefaulted += ChunkPagesToSize(chunk, limitPI - basePI);
+      cursor = limitPI;
+    }
+  }
+
+  return prefaulted;
+}
+
+
 /* VMFree -- free a region in the arena */
 
 static void VMFree(Addr base, Size size, Pool pool)
@@ -1109,6 +1184,8 @@ static void VMFree(Addr base, Size size, Pool pool)
   }
   arena->spareCommitted += ChunkPagesToSize(chunk, piLimit - piBase);
   BTResRange(chunk->allocTable, piBase, piLimit);
+  /* The pool may have written to the pages. */
+  BTResRange(chunk->zeroTable, piBase, piLimit);
 
   /* Consider returning memory to the OS. */
   /* Purging spare memory can cause page descriptors to be unmapped,
@@ -1232,6 +1309,7 @@ DEFINE_CLASS(Arena, VMArena, klass)
   klass->create = VMArenaCreate;
   klass->destroy = VMArenaDestroy;
   klass->purgeSpare = VMPurgeSpare;
+  klass->prefaultSpare = VMPrefaultSpare;
   klass->grow = VMArenaGrow;
   klass->free = VMFree;
   klass->chunkInit = VMChunkInit;
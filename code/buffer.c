@@ -28,6 +28,9 @@
 SRCID(buffer, "$Id$");
 
 
+ARG_DEFINE_KEY(AP_ZEROED, Bool);
+
+
 /* BufferCheck -- check consistency of a buffer
  *
  * See .ap.async.  */
@@ -41,6 +44,7 @@ Bool BufferCheck(Buffer buffer)
   CHECKU(Pool, buffer->pool);
   CHECKL(buffer->arena == buffer->pool->arena);
   CHECKD_NOSIG(Ring, &buffer->poolRing);
+  CHECKD_NOSIG(Ring, &buffer->flipRing);
   CHECKL(BoolCheck(buffer->isMutator));
   CHECKL(buffer->fillSize >= 0.0);
   CHECKL(buffer->emptySize >= 0.0);
@@ -66,6 +70,7 @@ Bool BufferCheck(Buffer buffer)
     CHECKL(buffer->ap_s.limit == (Addr)0);
     /* Nothing reliable to check for lightweight frame state */
     CHECKL(buffer->poolLimit == (Addr)0);
+    CHECKL(RingIsSingle(&buffer->flipRing)); /* .flip.ring */
   } else {
     /* The buffer is attached to a region of memory.   */
     /* Check consistency. */
@@ -104,6 +109,7 @@ Bool BufferCheck(Buffer buffer)
                || buffer->ap_s.init == buffer->ap_s.alloc);
         CHECKL(buffer->base <= buffer->initAtFlip);
         CHECKL(buffer->initAtFlip <= (Addr)buffer->ap_s.init);
+        CHECKL(RingIsSingle(&buffer->flipRing)); /* .flip.ring */
       }
       /* Nothing special to check in the logged mode. */
     } else {
@@ -138,7 +144,8 @@ static Res BufferAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                 "Arena $P\n",       (WriteFP)buffer->arena,
                 "Pool $P\n",        (WriteFP)buffer->pool,
                 buffer->isMutator ? "Mutator" : "Internal", " Buffer\n",
-                "mode $C$C$C$C (TRANSITION, LOGGED, FLIPPED, ATTACHED)\n",
+                "mode $C$C$C$C$C (ZEROED, TRANSITION, LOGGED, FLIPPED, ATTACHED)\n",
+                (WriteFC)((buffer->mode & BufferModeZEROED)     ? 'z' : '_'),
                 (WriteFC)((buffer->mode & BufferModeTRANSITION) ? 't' : '_'),
                 (WriteFC)((buffer->mode & BufferModeLOGGED)     ? 'l' : '_'),
                 (WriteFC)((buffer->mode & BufferModeFLIPPED)    ? 'f' : '_'),
@@ -154,6 +161,7 @@ static Res BufferAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                 "poolLimit $A\n",   (WriteFA)buffer->poolLimit,
                 "alignment $W\n",   (WriteFW)buffer->alignment,
                 "rampCount $U\n",   (WriteFU)buffer->rampCount,
+                "fillHint $W\n",    (WriteFW)buffer->fillHint,
                 NULL);
 }
 
@@ -168,6 +176,7 @@ Res BufferDescribe(Buffer buffer, mps_lib_FILE *stream, Count depth)
 static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
 {
   Arena arena;
+  ArgStruct arg;
 
   AVER(buffer != NULL);
   AVERT(Pool, pool);
@@ -184,12 +193,15 @@ static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
   buffer->arena = arena;
   buffer->pool = pool;
   RingInit(&buffer->poolRing);
+  RingInit(&buffer->flipRing);
   buffer->isMutator = isMutator;
   if (ArenaGlobals(arena)->bufferLogging) {
     buffer->mode = BufferModeLOGGED;
   } else {
     buffer->mode = 0;
   }
+  if (ArgPick(&arg, args, MPS_KEY_AP_ZEROED) && arg.val.b)
+    buffer->mode |= BufferModeZEROED;
   buffer->fillSize = 0.0;
   buffer->emptySize = 0.0;
   buffer->alignment = PoolAlignment(pool);
@@ -203,6 +215,8 @@ static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
   buffer->ap_s.limit = (mps_addr_t)0;
   buffer->poolLimit = (Addr)0;
   buffer->rampCount = 0;
+  buffer->fillHint = 0;
+  buffer->fillClock = 0;
 
   /* .init.sig-serial: Now the vanilla stuff is initialized, sign the
      buffer and give it a serial number. It can then be safely checked
@@ -284,7 +298,9 @@ void BufferDetach(Buffer buffer, Pool pool)
 
     /* Ask the owning pool to do whatever it needs to before the */
     /* buffer is detached (e.g. copy buffer state into pool state). */
+    PoolClaim(pool);
     Method(Pool, pool, bufferEmpty)(pool, buffer);
+    PoolRelease(pool);
 
     /* run any class-specific detachment method */
     Method(Buffer, buffer, detach)(buffer);
@@ -310,6 +326,8 @@ void BufferDetach(Buffer buffer, Pool pool)
     buffer->poolLimit = (Addr)0;
     buffer->mode &=
       ~(BufferModeATTACHED|BufferModeFLIPPED|BufferModeTRANSITION);
+    if (!RingIsSingle(&buffer->flipRing))
+      RingRemove(&buffer->flipRing);
 
     EVENT2(BufferEmpty, buffer, spare);
   }
@@ -347,6 +365,7 @@ static void BufferAbsFinish(Inst inst)
   buffer->sig = SigInvalid;
  
   /* Finish off the generic buffer fields. */
+  RingFinish(&buffer->flipRing);
   RingFinish(&buffer->poolRing);
 
   EVENT1(BufferFinish, buffer);
@@ -413,6 +432,8 @@ static void BufferSetUnflipped(Buffer buffer)
   AVERT(Buffer, buffer);
   AVER(buffer->mode & BufferModeFLIPPED);
   buffer->mode &= ~BufferModeFLIPPED;
+  AVER(RingIsSingle(&buffer->flipRing));
+  RingAppend(&ArenaGlobals(buffer->arena)->bufferRing, &buffer->flipRing);
   /* restore ap_s.limit if appropriate */
   if (!BufferIsTrapped(buffer)) {
     buffer->ap_s.limit = buffer->poolLimit;
@@ -438,6 +459,56 @@ void BufferSetAllocAddr(Buffer buffer, Addr addr)
 }
 
 
+/* bufferZero -- zero memory on behalf of a zeroed buffer
+ *
+ * The memory may be in a protected segment (for example, after a
+ * flip), so it must be exposed.  mps_lib_memset is expected to use
+ * the fastest available method for large sizes (glibc switches to
+ * non-temporal stores above a cache-size threshold, for example).
+ */
+
+static void bufferZero(Buffer buffer, Addr base, Addr limit)
+{
+  Arena arena = BufferArena(buffer);
+  Seg seg;
+
+  AVER(base < limit);
+
+  if (SegOfAddr(&seg, arena, base)) {
+    AVER(limit <= SegLimit(seg));
+    ShieldExpose(arena, seg);
+    (void)mps_lib_memset(base, 0, AddrOffset(base, limit));
+    ShieldCover(arena, seg);
+  } else {
+    (void)mps_lib_memset(base, 0, AddrOffset(base, limit));
+  }
+}
+
+
+/* bufferFillZeroed -- prepare freshly filled memory
+ *
+ * .fill.zero: A segment's memory is known to be zero until it is
+ * first handed to a buffer (see SegAlloc), so every fill clears the
+ * segment's zeroed flag.  A buffer created with MPS_KEY_AP_ZEROED must
+ * only hand out zeroes, so unless the memory is known to be zero it is
+ * zeroed here in bulk, rather than by the client object by object.
+ */
+
+static void bufferFillZeroed(Buffer buffer, Addr base, Addr limit)
+{
+  Arena arena = BufferArena(buffer);
+  Bool zeroed = FALSE;
+  Seg seg;
+
+  if (SegOfAddr(&seg, arena, base)) {
+    zeroed = SegZeroed(seg) && limit <= SegLimit(seg);
+    SegSetZeroed(seg, FALSE);
+  }
+  if ((buffer->mode & BufferModeZEROED) != 0 && !zeroed && base < limit)
+    bufferZero(buffer, base, limit);
+}
+
+
 /* BufferFramePush
  *
  * <design/alloc-frame>.
@@ -470,11 +541,17 @@ Res BufferFramePush(AllocFrame *frameReturn, Buffer buffer)
 Res BufferFramePop(Buffer buffer, AllocFrame frame)
 {
   Pool pool;
+  Res res;
   AVERT(Buffer, buffer);
   /* frame is of an abstract type & can't be checked */
   pool = BufferPool(buffer);
-  return Method(Pool, pool, framePop)(pool, buffer, frame);
- 
+  res = Method(Pool, pool, framePop)(pool, buffer, frame);
+  /* Popping may hand back memory that objects in the frame used. */
+  if (res == ResOK && (buffer->mode & BufferModeZEROED) != 0
+      && !BufferIsReset(buffer)
+      && (Addr)buffer->ap_s.alloc < buffer->poolLimit)
+    bufferZero(buffer, buffer->ap_s.alloc, buffer->poolLimit);
+  return res;
 }
 
 
@@ -539,6 +616,8 @@ void BufferAttach(Buffer buffer, Addr base, Addr limit,
   }
   AVER(buffer->initAtFlip == (Addr)0);
   buffer->poolLimit = limit;
+  if (BufferRankSet(buffer) != RankSetEMPTY) /* .flip.ring */
+    RingAppend(&ArenaGlobals(buffer->arena)->bufferRing, &buffer->flipRing);
 
   filled = AddrOffset(init, limit);
   buffer->fillSize += filled;
@@ -593,6 +672,12 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
     next = AddrAdd(buffer->ap_s.alloc, size);
     if (next > (Addr)buffer->ap_s.alloc &&
         next <= (Addr)buffer->poolLimit) {
+      /* .fill.retry: If a commit failed, BufferTrip set both init and
+         alloc back to the base of the reservation (see .trip.unflip).
+         The client may have written to it, and is about to be given
+         it again, so zero the new reservation. */
+      if ((buffer->mode & BufferModeZEROED) != 0)
+        bufferZero(buffer, buffer->ap_s.alloc, next);
       buffer->ap_s.alloc = next;
       if (buffer->mode & BufferModeLOGGED) {
         EVENT3(BufferReserve, buffer, buffer->ap_s.init, size);
@@ -609,9 +694,12 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
   BufferDetach(buffer, pool);
 
   /* Ask the pool for some memory. */
+  PoolClaim(pool);
   res = Method(Pool, pool, bufferFill)(&base, &limit, pool, buffer, size);
+  PoolRelease(pool);
   if (res != ResOK)
     return res;
+  bufferFillZeroed(buffer, base, limit);
 
   /* Set up the buffer to point at the memory given by the pool */
   /* and do the allocation that was requested by the client. */
@@ -626,6 +714,54 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
 }
 
 
+/* BufferFillSize -- choose how much memory to give a buffer
+ *
+ * .fill.adapt: A pool's bufferFill method may call this to choose
+ * how much memory to give the buffer, between min and max, if the
+ * request is smaller.  The size starts at min, doubles (up to max)
+ * when the buffer is refilled within BUFFER_FILL_FAST seconds of its
+ * previous fill, and halves (down to min) when it is refilled more
+ * than BUFFER_FILL_SLOW seconds afterwards.  So a buffer that
+ * allocates quickly comes back to the pool less often, and one that
+ * allocates slowly strands less memory when it is emptied, for
+ * example at a flip.  The time is measured between calls, so the
+ * pool should only call this when it is going to use the result.
+ */
+
+Size BufferFillSize(Buffer buffer, Size min, Size max)
+{
+  Clock now, elapsed;
+  Size size;
+
+  AVERT(Buffer, buffer);
+  AVER(min > 0);
+  AVER(min <= max);
+
+  now = ClockNow();
+  size = buffer->fillHint;
+  if (size == 0) {
+    size = min;
+  } else {
+    elapsed = now - buffer->fillClock;
+    if (elapsed < BUFFER_FILL_FAST * ClocksPerSec()) {
+      if (size <= max / 2)
+        size *= 2;
+      else
+        size = max;
+    } else if (elapsed > BUFFER_FILL_SLOW * ClocksPerSec()) {
+      size /= 2;
+    }
+    if (size < min)
+      size = min;
+    else if (size > max)
+      size = max;
+  }
+  buffer->fillHint = size;
+  buffer->fillClock = now;
+  return size;
+}
+
+
 
 /* BufferCommit -- commit memory previously reserved
  *
@@ -752,7 +888,17 @@ Bool BufferTrip(Buffer buffer, Addr p, Size size)
  * since the object is already invalid by a previous trace.  The buffer
  * becomes unflipped at the next reserve or commit operation (actually
  * reserve because commit is lazy).  This is handled by BufferFill
- * (.fill.unflip) or BufferTrip (.trip.unflip).  */
+ * (.fill.unflip) or BufferTrip (.trip.unflip).
+ *
+ * .flip.ring: Only attached buffers with a rank that are not already
+ * flipped need flipping, so the arena keeps those buffers on
+ * globals->bufferRing, and the tracer flips the buffers on that ring
+ * rather than every buffer of every pool.  A buffer joins the ring
+ * when it is attached (BufferAttach) or unflipped
+ * (BufferSetUnflipped), and leaves it when it is flipped or detached.
+ * So the cost of a flip is proportional to the number of buffers that
+ * have been used since the previous flip, not the number that exist.
+ */
 
 void BufferFlip(Buffer buffer)
 {
@@ -766,6 +912,7 @@ void BufferFlip(Buffer buffer)
     /* TODO: Is a memory barrier required here? */
     buffer->ap_s.limit = (Addr)0;
     buffer->mode |= BufferModeFLIPPED;
+    RingRemove(&buffer->flipRing);
   }
 }
 
@@ -805,6 +952,7 @@ void BufferSetRankSet(Buffer buffer, RankSet rankset)
 {
   AVERT(Buffer, buffer);
   AVERT(RankSet, rankset);
+  AVER(BufferIsReset(buffer)); /* .flip.ring */
   Method(Buffer, buffer, setRankSet)(buffer, rankset);
 }
 
@@ -15,6 +15,13 @@
  * these functions are on the critical paths via mps_alloc (and then
  * PoolAlloc, MVFFAlloc, failoverFind*, cbsFind*) and mps_free (and
  * then MVFFFree, failoverInsert, cbsInsert).
+ *
+ * .blockpool.direct: Blocks are allocated and freed by calling the
+ * block pool's methods directly rather than PoolAlloc and PoolFree.
+ * Those would advance the arena's allocation clock and emit events,
+ * which need the arena lock, but an MVFF pool updates its CBSs while
+ * holding only its pool lock (see <code/pool.c#.lock>).  Block
+ * structures are not mutator allocation in any case.
  */
 
 #include "cbs.h"
@@ -277,7 +284,9 @@ static void cbsBlockDestroy(CBS cbs, RangeTree block)
   cbs->size -= size;
 
   RangeTreeFinish(block);
-  PoolFree(cbsBlockPool(cbs), (Addr)block, cbs->blockStructSize);
+  /* .blockpool.direct */
+  Method(Pool, cbsBlockPool(cbs), free)(cbsBlockPool(cbs), (Addr)block,
+                                        cbs->blockStructSize);
 }
 
 
@@ -343,7 +352,9 @@ static Res cbsBlockAlloc(RangeTree *blockReturn, CBS cbs, Range range)
   AVERT(CBS, cbs);
   AVERT(Range, range);
 
-  res = PoolAlloc(&p, cbsBlockPool(cbs), cbs->blockStructSize);
+  /* .blockpool.direct */
+  res = Method(Pool, cbsBlockPool(cbs), alloc)(&p, cbsBlockPool(cbs),
+                                               cbs->blockStructSize);
   if (res != ResOK)
     goto failPoolAlloc;
   block = (RangeTree)p;
@@ -733,11 +744,11 @@ static Res cbsZonedBlockDescribe(CBSZonedBlock block, mps_lib_FILE *stream)
     return ResFAIL;
 
   res = WriteF(stream, 0,
-               "[$P,$P) {$U, $B}",
+               "[$P,$P) {$U, " ZoneSetFORMAT "}",
                (WriteFP)RangeTreeBase(cbsZonedBlockNode(block)),
                (WriteFP)RangeTreeLimit(cbsZonedBlockNode(block)),
                (WriteFU)block->cbsFastBlockStruct.maxSize,
-               (WriteFB)block->zones,
+               ZoneSetWriteF(block->zones),
                NULL);
   return res;
 }
@@ -0,0 +1,213 @@
+/* compacttest.c: ARENA COMPACTION TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Scatter a few survivors across many chunks by pinning them with
+ * ambiguous references during a collection, then unpin them and check
+ * that mps_arena_compact evacuates them and returns the chunks they
+ * occupied to the operating system.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)4 << 20)
+#define objSIZE           ((size_t)1024)
+#define objCOUNT          8192
+#define survivorFREQ      64
+#define rootsCOUNT        (objCOUNT / survivorFREQ)
+
+/* objNULL needs to be odd so that it's ignored in exactRoots. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+static mps_addr_t objs[objCOUNT];
+static mps_addr_t exactRoots[rootsCOUNT];
+static mps_addr_t ambigRoots[rootsCOUNT];
+
+
+/* make -- create one new object */
+
+static mps_addr_t make(mps_ap_t ap)
+{
+  mps_addr_t p;
+  mps_res_t res;
+
+  do {
+    MPS_RESERVE_BLOCK(res, p, ap, objSIZE);
+    if (res != MPS_RES_OK)
+      die(res, "MPS_RESERVE_BLOCK");
+    res = dylan_init(p, objSIZE, NULL, 0);
+    if (res != MPS_RES_OK)
+      die(res, "dylan_init");
+  } while (!mps_commit(ap, p, objSIZE));
+
+  return p;
+}
+
+
+/* check -- check that the survivors are intact */
+
+static void check(mps_arena_t arena)
+{
+  size_t i;
+  for (i = 0; i < rootsCOUNT; ++i) {
+    cdie(dylan_check(exactRoots[i]), "survivor check");
+    cdie(mps_arena_has_addr(arena, exactRoots[i]), "survivor in arena");
+  }
+}
+
+
+static void test(mps_arena_t arena)
+{
+  mps_fmt_t format;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t objsRoot, exactRoot, ambigRoot;
+  size_t i, reserved, reclaimed;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+
+  for (i = 0; i < objCOUNT; ++i)
+    objs[i] = objNULL;
+  for (i = 0; i < rootsCOUNT; ++i) {
+    exactRoots[i] = objNULL;
+    ambigRoots[i] = NULL;
+  }
+  die(mps_root_create_table_masked(&objsRoot, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, objs, objCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table(objs)");
+  die(mps_root_create_table_masked(&exactRoot, arena, mps_rank_exact(),
+                                   (mps_rm_t)0, exactRoots, rootsCOUNT,
+                                   (mps_word_t)1),
+      "root_create_table(exact)");
+
+  /* Nothing to evacuate in a fresh arena. */
+  die(mps_arena_compact(arena, &reclaimed), "compact (empty)");
+  Insist(reclaimed == 0);
+
+  /* Grow the arena to many chunks, and then collect, so that all the
+     objects are copied into densely occupied segments. */
+  mps_arena_park(arena);
+  for (i = 0; i < objCOUNT; ++i)
+    objs[i] = make(ap);
+  die(mps_arena_collect(arena), "collect (dense)");
+
+  /* Keep every survivorFREQ'th object, but pin the survivors with
+     ambiguous references, so that the collection leaves them
+     scattered across the chunks. */
+  for (i = 0; i < rootsCOUNT; ++i)
+    ambigRoots[i] = objs[i * survivorFREQ];
+  for (i = 0; i < objCOUNT; ++i)
+    objs[i] = objNULL;
+  die(mps_root_create_table(&ambigRoot, arena, mps_rank_ambig(),
+                            (mps_rm_t)0, ambigRoots, rootsCOUNT),
+      "root_create_table(ambig)");
+  die(mps_arena_collect(arena), "collect (pinned)");
+  reserved = mps_arena_reserved(arena);
+  printf("reserved after pinned collection: %lu\n", (unsigned long)reserved);
+
+  /* Unpin the survivors and compact. */
+  for (i = 0; i < rootsCOUNT; ++i)
+    exactRoots[i] = ambigRoots[i];
+  mps_root_destroy(ambigRoot);
+  check(arena);
+  die(mps_arena_compact(arena, &reclaimed), "compact");
+  printf("reclaimed by compaction: %lu\n", (unsigned long)reclaimed);
+  Insist(reclaimed > 0);
+  Insist(mps_arena_reserved(arena) == reserved - reclaimed);
+  check(arena);
+
+  /* Compacting again may find a little more to do, but survivors may
+     also be forwarded into a new chunk. */
+  reserved = mps_arena_reserved(arena);
+  die(mps_arena_compact(arena, &reclaimed), "compact (again)");
+  if (reclaimed > 0)
+    Insist(mps_arena_reserved(arena) == reserved - reclaimed);
+  else
+    Insist(mps_arena_reserved(arena) >= reserved);
+  check(arena);
+
+  mps_arena_park(arena);
+  mps_ap_destroy(ap);
+  mps_root_destroy(exactRoot);
+  mps_root_destroy(objsRoot);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  test(arena);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
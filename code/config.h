@@ -200,6 +200,22 @@
 #endif
 
 
+/* CONFIG_ZONES_128 -- use 128 zones
+ *
+ * This symbol causes the MPS to be built with two words' worth of
+ * zones (128 on a 64-bit platform) rather than one, so that each
+ * zone covers half as much address space, and reference sets and
+ * zone sets are more precise in large heaps.  It needs a compiler
+ * with a 128-bit integer type.  Client code must be compiled with the
+ * same setting, because the layout of the scan state in
+ * <code/mps.h> depends on it.  See <design/collection#.refsets>.
+ */
+
+#if defined(CONFIG_ZONES_128)
+#define ZONES_128
+#endif
+
+
 #define MPS_VARIETY_STRING \
   MPS_ASSERT_STRING "." MPS_LOG_STRING "." MPS_STATS_STRING
 
@@ -331,10 +347,42 @@
 #endif
 
 
+/* Pool Configuration -- see <code/pool.c> */
+
+/* POOL_FAST_FILL_LIMIT is the amount of memory that may be allocated
+ * under a pool lock, without entering the arena, before an allocation
+ * takes the slow path so that the allocation clock advances and the
+ * arena is polled.  It is coarser than ArenaPollALLOCTIME so that the
+ * slow path is rare for small objects.  See <code/pool.c#.lock.clock>. */
+
+#define POOL_FAST_FILL_LIMIT ((Size)1 << 20)
+
+
 /* Buffer Configuration -- see <code/buffer.c> */
 
 #define BUFFER_RANK_DEFAULT (mps_rank_exact())
 
+/* BUFFER_FILL_FAST and BUFFER_FILL_SLOW are the times, in seconds,
+ * between fills of a buffer below which a pool gives the buffer more
+ * memory at the next fill, and above which it gives it less.  See
+ * <code/buffer.c#.fill.adapt>. */
+
+#define BUFFER_FILL_FAST 1e-3
+#define BUFFER_FILL_SLOW 1e-1
+
+
+/* Segregated Allocation Cache Configuration -- see <code/sac.c> */
+
+/* An adaptive cache reconfigures its classes after SAC_ADAPT_PERIOD_MIN
+ * allocations, then after twice as many each time, up to
+ * SAC_ADAPT_PERIOD_MAX.  A size that accounts for less than
+ * 1/SAC_ADAPT_SHARE of the allocations in a period isn't cached.  See
+ * <code/sac.c#.adaptive>. */
+
+#define SAC_ADAPT_PERIOD_MIN ((Count)1 << 10)
+#define SAC_ADAPT_PERIOD_MAX ((Count)1 << 16)
+#define SAC_ADAPT_SHARE ((Count)64)
+
 
 /* Format defaults: see <code/format.c> */
 
@@ -354,12 +402,17 @@
 /* AMC treats objects larger than or equal to this as "Large" */
 #define AMC_LARGE_SIZE_DEFAULT ((Size)32768)
 #define AMC_EXTEND_BY_DEFAULT  ((Size)8192)
+/* AMC scans only the faulting grain of segments at least this large
+   on a read barrier hit <design/poolamc#.access.part> */
+#define AMC_ACCESS_PART_MIN    ((Size)8192)
 
 
 /* Pool AMS Configuration -- see <code/poolams.c> */
 
 #define AMS_SUPPORT_AMBIGUOUS_DEFAULT TRUE
 #define AMS_GEN_DEFAULT       0
+/* AMS gives a busy buffer a new segment of up to this size */
+#define AMS_FILL_MAX          ((Size)65536)
 
 
 /* Pool AWL Configuration -- see <code/poolawl.c> */
@@ -424,8 +477,26 @@
 
 #define ARENA_DEFAULT_PAUSE_TIME (0.1)
 
+/* ARENA_DEFAULT_SCAN_WORKERS is the number of worker threads that
+ * help to scan thread stacks at flip time.  See
+ * <code/trace.c#.flip.par>. */
+
+#define ARENA_DEFAULT_SCAN_WORKERS ((Count)0)
+
+/* ARENA_DEFAULT_HANDSHAKE says whether the flip leaves native
+ * safepoint threads to be scanned later.  See
+ * <code/trace.c#.flip.handshake>. */
+
+#define ARENA_DEFAULT_HANDSHAKE FALSE
+
 #define ARENA_DEFAULT_ZONED     TRUE
 
+/* ARENA_DEFAULT_PREFAULT_SIZE is the default amount of spare memory
+ * that the arena maps and touches in idle time, ahead of allocation.
+ * See ArenaPrefault in <code/arena.c>. */
+
+#define ARENA_DEFAULT_PREFAULT_SIZE ((Size)0)
+
 /* ARENA_MINIMUM_COLLECTABLE_SIZE is the minimum size (in bytes) of
  * collectable memory that might be considered worthwhile to run a
  * full garbage collection. */
@@ -450,13 +521,25 @@
 
 #define ARENA_MAX_COLLECT_FRACTION (0.1)
 
+/* ARENA_COMPACT_OCCUPANCY is the largest fraction of a chunk's
+ * allocatable pages that may be in use for the chunk to be worth
+ * evacuating in a compaction trace. See <code/policy.c>. */
+
+#define ARENA_COMPACT_OCCUPANCY (0.25)
+
+/* ARENA_COMPACT_CHECK_INTERVAL is the minimum time in seconds between
+ * checks by ArenaStep for chunks worth evacuating, which must look at
+ * every chunk's allocation table. See <code/policy.c#compact.rate>. */
+
+#define ARENA_COMPACT_CHECK_INTERVAL (1.0)
+
 /* ArenaDefaultZONESET is the zone set used by LocusPrefDEFAULT.
  *
  * TODO: This is left over from before branches 2014-01-29/mps-chain-zones
  * and 2014-01-17/cbs-tract-alloc reformed allocation, and may now be
  * doing more harm than good. Experiment with setting to ZoneSetUNIV. */
 
-#define ArenaDefaultZONESET (ZoneSetUNIV << (MPS_WORD_WIDTH / 2))
+#define ArenaDefaultZONESET (ZoneSetUNIV << (ZoneCOUNT / 2))
 
 /* LocusPrefDEFAULT is the allocation preference used by manual pool
  * classes (these don't care where they allocate). */
@@ -500,11 +583,24 @@
 #define ShieldDepthWIDTH     4  /* log2(max nested exposes + 1) */
 
 
+/* Protection Shadow Configuration -- see <code/protsh.c> */
+
+#define ProtShadowLENGTH  1024  /* slots in protection shadow (power of 2) */
+#define ProtShadowGRAIN   ((Size)4096) /* bytes per slot (power of 2) */
+
+
+/* Thread Manager Configuration -- see <code/thix.c> */
+
+/* How long ThreadRingSuspend waits for a safepoint thread before
+ * checking whether it still exists, in nanoseconds. */
+#define THREAD_SAFEPOINT_POLL_NS 10000000L
+
+
 /* VM Configuration -- see <code/vm*.c> */
 
 #define VMAN_PAGE_SIZE ((Align)4096)
 #define VMJunkBYTE ((unsigned char)0xA9)
-#define VMParamSize (sizeof(Word))
+#define VMParamSize (2 * sizeof(Word))
 
 
 /* .feature.li: Linux feature specification
@@ -626,6 +722,10 @@
 #define TraceLIMIT ((size_t)1)
 /* I count 4 function calls to scan, 10 to copy. */
 #define TraceCopyScanRATIO (1.5)
+/* Number of references that each thread stack can defer when it is
+ * scanned in parallel, before it has to be scanned again by the
+ * collector.  See <code/trace.c#.flip.par>. */
+#define TraceFlipDeferREFS ((Count)1024)
 
 /* Chosen so that the RememberedSummaryBlockStruct packs nicely into
    pages */
@@ -708,6 +808,39 @@
 #define WB_DEFER_HIT   1  /* boring scans after barrier hit */
 
 
+/* Read barrier avoidance
+ *
+ * <design/trace#.flip.eager>.
+ *
+ * TODO: As for write barrier deferral, these were picked by hand and
+ * should be based on measurement of the cost of a fault against the
+ * cost of scanning a segment.  <design/trace#.flip.eager.improv>.
+ */
+
+#define RB_EAGER_BITS  2  /* bitfield width for eager scan count */
+#define RB_EAGER_HIT   2  /* flips scanned eagerly after read barrier hit */
+
+
+/* Root cards
+ *
+ * A protectable area root covering at least this many arena grains
+ * keeps a summary for each grain, and rescans only the grains that
+ * were written or might refer to the white set <design/root#.card>.
+ */
+
+#define ROOT_CARDS_MIN ((Count)16)
+
+
+/* Sparse nailboards
+ *
+ * A nailboard records up to this many nails in a sorted array, and
+ * only allocates its bit tables when more nails are set
+ * <design/nailboard#.impl.sparse>.
+ */
+
+#define NAILBOARD_SPARSE_MAX 16
+
+
 #endif /* config_h */
 
 
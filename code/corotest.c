@@ -0,0 +1,336 @@
+/* corotest.c: COROUTINE STACK ROOT TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .overview: This test case checks that the stack of a coroutine
+ * registered with mps_root_create_stack is scanned, both while the
+ * coroutine is suspended and while it is running on its own stack,
+ * whether the collection happens on the thread running the coroutine
+ * or on another thread.  The thread's original stack is registered
+ * in the same way, as a coroutine that is running at the start.
+ *
+ * .ucontext: The coroutines are switched by swapcontext, so this test
+ * case is Unix-only.
+ *
+ * .format: This test case uses a trivial leaf object format in which
+ * each object contains a serial number.
+ */
+
+#include "mpstd.h"
+
+/* <ucontext.h> needs these: see .feature.li and .feature.xc in
+ * config.h.  swapcontext and friends are deprecated on macOS, but
+ * still work. */
+#if defined(MPS_OS_LI)
+#if !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 500
+#endif
+#elif defined(MPS_OS_XC)
+#if !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE
+#endif
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "mps.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "testlib.h"
+#include "testthr.h"
+
+#define coSTACK_SIZE ((size_t)1 << 18)  /* bytes in a coroutine stack */
+#define objCOUNT     64      /* objects referred to by the coroutine */
+#define churnCOUNT   5000    /* garbage objects per churn */
+#define roundCOUNT   40      /* switches to the coroutine */
+
+enum {
+  TYPE_SERIAL,
+  TYPE_FWD,
+  TYPE_PAD
+};
+
+typedef struct obj_s {
+  mps_word_t type;              /* One of the TYPE_ enums */
+  union {
+    mps_word_t serial;          /* TYPE_SERIAL */
+    mps_addr_t fwd;             /* TYPE_FWD */
+    size_t pad;                 /* TYPE_PAD */
+  } u;
+} obj_s, *obj_t;
+
+static mps_arena_t arena;
+static mps_thr_t thread;
+static mps_ap_t ap;
+static mps_word_t serial;
+
+static mps_root_t mainRoot, coRoot;
+static ucontext_t mainContext, coContext;
+static volatile int coDone;
+static volatile int collectorDone;
+
+
+static void obj_fwd(mps_addr_t old, mps_addr_t new)
+{
+  obj_t obj = old;
+  obj->type = TYPE_FWD;
+  obj->u.fwd = new;
+}
+
+static mps_addr_t obj_isfwd(mps_addr_t addr)
+{
+  obj_t obj = addr;
+  if (obj->type == TYPE_FWD) {
+    return obj->u.fwd;
+  } else {
+    return NULL;
+  }
+}
+
+static void obj_pad(mps_addr_t addr, size_t size)
+{
+  obj_t obj = addr;
+  obj->type = TYPE_PAD;
+  obj->u.pad = size;
+}
+
+static mps_addr_t obj_skip(mps_addr_t addr)
+{
+  obj_t obj = addr;
+  size_t size;
+  if (obj->type == TYPE_PAD) {
+    size = obj->u.pad;
+  } else {
+    size = sizeof(obj_s);
+  }
+  return (char *)addr + size;
+}
+
+
+/* make -- allocate an object with the next serial number */
+
+static obj_t make(void)
+{
+  size_t size = sizeof(obj_s);
+  mps_addr_t addr;
+  obj_t obj;
+  do {
+    die(mps_reserve(&addr, ap, size), "mps_reserve");
+    obj = addr;
+    obj->type = TYPE_SERIAL;
+    obj->u.serial = serial;
+  } while (!mps_commit(ap, addr, size));
+  ++serial;
+  return obj;
+}
+
+
+/* churn -- allocate garbage, so that the arena collects */
+
+static void churn(void)
+{
+  size_t i;
+  for (i = 0; i < churnCOUNT; ++i)
+    (void)make();
+}
+
+
+/* check -- check that the coroutine's objects are still there */
+
+static void check(obj_t *objs, mps_word_t first)
+{
+  size_t i;
+  for (i = 0; i < objCOUNT; ++i) {
+    Insist(objs[i]->type == TYPE_SERIAL);
+    Insist(objs[i]->u.serial == first + i);
+  }
+}
+
+
+/* coSwitch -- switch from one coroutine to another
+ *
+ * The registers are saved on the stack before it is suspended, and
+ * the root is only resumed once the thread is running on the stack
+ * again, so that there is no moment at which the thread's stack
+ * pointer is outside the stack of a running root.
+ */
+
+static void coSwitch(mps_root_t root, ucontext_t *from, ucontext_t *to)
+{
+  jmp_buf regs;
+  (void)setjmp(regs);
+  mps_root_stack_suspend(root, regs);
+  die(swapcontext(from, to) == 0 ? MPS_RES_OK : MPS_RES_FAIL,
+      "swapcontext");
+  mps_root_stack_resume(root, thread);
+}
+
+
+/* coroutine -- the body of the coroutine
+ *
+ * The objects are only referred to by the coroutine's stack.
+ */
+
+static void coroutine(void)
+{
+  obj_t objs[objCOUNT];
+  mps_word_t first;
+  size_t i;
+
+  mps_root_stack_resume(coRoot, thread);
+
+  first = serial;
+  for (i = 0; i < objCOUNT; ++i)
+    objs[i] = make();
+
+  while (!coDone) {
+    churn();
+    mps_arena_collect(arena);
+    mps_arena_release(arena);
+    check(objs, first);
+    coSwitch(coRoot, &coContext, &mainContext);
+    check(objs, first);
+  }
+
+  /* Finished: there's nothing more to scan. */
+  mps_root_stack_suspend(coRoot, (char *)coContext.uc_stack.ss_sp
+                         + coContext.uc_stack.ss_size);
+}
+
+
+/* collector -- collect from another thread until told to stop */
+
+static void *collector(void *arg)
+{
+  testlib_unused(arg);
+  while (!collectorDone) {
+    mps_arena_collect(arena);
+    mps_arena_release(arena);
+  }
+  return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+  void *marker = &marker;
+  mps_fmt_t fmt;
+  mps_pool_t pool;
+  testthr_t collectorThread;
+  void *coStack;
+  size_t i;
+
+  testlib_init(argc, argv);
+
+  die(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none),
+      "mps_arena_create");
+  die(mps_thread_reg(&thread, arena), "mps_thread_reg");
+
+  /* The thread's own stack is a coroutine too, and it's running. */
+  die(mps_root_create_stack(&mainRoot, arena, mps_rank_ambig(), 0,
+                            mps_scan_area, NULL, marker),
+      "mps_root_create_stack(main)");
+  mps_root_stack_resume(mainRoot, thread);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ALIGN, sizeof(obj_s));
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_SKIP, obj_skip);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_FWD, obj_fwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_ISFWD, obj_isfwd);
+    MPS_ARGS_ADD(args, MPS_KEY_FMT_PAD, obj_pad);
+    die(mps_fmt_create_k(&fmt, arena, args), "mps_fmt_create");
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    die(mps_pool_create_k(&pool, arena, mps_class_amcz(), args),
+        "mps_pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "mps_ap_create");
+
+  coStack = malloc(coSTACK_SIZE);
+  cdie(coStack != NULL, "malloc");
+  die(mps_root_create_stack(&coRoot, arena, mps_rank_ambig(), 0,
+                            mps_scan_area, NULL,
+                            (char *)coStack + coSTACK_SIZE),
+      "mps_root_create_stack(coroutine)");
+  die(getcontext(&coContext) == 0 ? MPS_RES_OK : MPS_RES_FAIL,
+      "getcontext");
+  coContext.uc_stack.ss_sp = coStack;
+  coContext.uc_stack.ss_size = coSTACK_SIZE;
+  coContext.uc_link = &mainContext;
+  makecontext(&coContext, coroutine, 0);
+
+  testthr_create(&collectorThread, collector, NULL);
+
+  for (i = 0; i < roundCOUNT; ++i) {
+    coSwitch(mainRoot, &mainContext, &coContext);
+    /* The coroutine is suspended now. */
+    churn();
+  }
+  coDone = 1;
+  coSwitch(mainRoot, &mainContext, &coContext);
+
+  collectorDone = 1;
+  testthr_join(&collectorThread, NULL);
+
+  mps_arena_park(arena);
+  mps_root_destroy(coRoot);
+  free(coStack);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(fmt);
+  mps_root_destroy(mainRoot);
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -780,6 +780,9 @@ void PoolClassMixInDebug(PoolClass klass)
   klass->init = DebugPoolInit;
   klass->alloc = DebugPoolAlloc;
   klass->free = DebugPoolFree;
+  /* Debug pools stay under the arena lock; see <code/pool.c#.lock>. */
+  klass->allocFast = PoolNoAllocFast;
+  klass->freeFast = PoolNoFreeFast;
 }
 
 
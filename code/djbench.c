@@ -57,8 +57,24 @@ static size_t arena_size = 256ul * 1024 * 1024; /* arena size */
 static size_t arena_grain_size = 1; /* arena grain size */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
 
+/* Size classes for the segregated allocation cache benchmark.  Each
+   thread has its own cache, which acts as a per-thread magazine in
+   front of the pool.  Larger blocks go straight to the pool. */
+
+static mps_sac_classes_s sac_classes[] = {
+  {MPS_PF_ALIGN << 1,  256, 1},
+  {MPS_PF_ALIGN << 3,  128, 1},
+  {MPS_PF_ALIGN << 5,   64, 1},
+  {MPS_PF_ALIGN << 7,   32, 1},
+  {MPS_PF_ALIGN << 9,   16, 1},
+  {MPS_PF_ALIGN << 11,   8, 1},
+  {MPS_PF_ALIGN << 13,   4, 1},
+  {MPS_PF_ALIGN << 15,   4, 1},
+};
+
 #define DJRUN(fname, alloc, free) \
-  static unsigned fname##_inner(mps_ap_t ap, unsigned depth, unsigned r) { \
+  static unsigned fname##_inner(mps_ap_t ap, mps_sac_t sac, \
+                                unsigned depth, unsigned r) { \
     struct {void *p; size_t s;} *blocks = alloca(sizeof(blocks[0]) * nblocks); \
     unsigned j, k; \
     \
@@ -85,7 +101,7 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
       } \
       if (rinter > 0 && depth > 0 && ++r % rinter == 0) { \
         /* putchar('>'); fflush(stdout); */ \
-        r = fname##_inner(ap, depth - 1, r); \
+        r = fname##_inner(ap, sac, depth - 1, r); \
         /* putchar('<'); fflush(stdout); */ \
       } \
     } \
@@ -102,10 +118,15 @@ static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
   static void *fname(void *p) { \
     unsigned i; \
     mps_ap_t ap = NULL; \
-    if (pool != NULL) \
+    mps_sac_t sac = NULL; \
+    if (pool != NULL) { \
       DJMUST(mps_ap_create_k(&ap, pool, mps_args_none)); \
+      DJMUST(mps_sac_create(&sac, pool, NELEMS(sac_classes), sac_classes)); \
+    } \
     for (i = 0; i < niter; ++i) \
-      (void)fname##_inner(ap, rmax, 0); \
+      (void)fname##_inner(ap, sac, rmax, 0); \
+    if (sac != NULL) \
+      mps_sac_destroy(sac); \
     if (ap != NULL) \
       mps_ap_destroy(ap); \
     return p; \
@@ -128,6 +149,19 @@ DJRUN(dj_malloc, MALLOC_ALLOC, MALLOC_FREE)
 DJRUN(dj_alloc, MPS_ALLOC, MPS_FREE)
 
 
+/* segregated allocation cache benchmark */
+
+#define SAC_ALLOC(p, s) \
+  do { \
+    mps_res_t _res; \
+    MPS_SAC_ALLOC_FAST(_res, p, sac, s, FALSE); \
+    (void)_res; \
+  } while(0)
+#define SAC_FREE(p, s)  do { MPS_SAC_FREE_FAST(sac, p, s); } while(0)
+
+DJRUN(dj_sac, SAC_ALLOC, SAC_FREE)
+
+
 /* reserve/free benchmark */
 
 #define ALIGN_UP(s, a) (((s) + ((a) - 1)) & ~((a) - 1))
@@ -171,6 +205,22 @@ static void watch(dj_t dj, const char *name)
 }
 
 
+/* Report how often the threads waited for the arena and pool locks.
+ * Comparing these across --nthreads shows how well a pool class
+ * scales.  See <code/pool.c#.lock>. */
+
+static void contention(const char *name)
+{
+  Globals globals = ArenaGlobals((Arena)arena);
+  Pool p = (Pool)pool;
+  printf("%s: arena lock contentions: %lu\n", name,
+         (unsigned long)LockContentions(globals->lock));
+  if (p->lock != NULL)
+    printf("%s: pool lock contentions: %lu\n", name,
+           (unsigned long)LockContentions(p->lock));
+}
+
+
 /* Wrap a call to dj benchmark that doesn't require MPS setup */
 
 static void wrap(dj_t dj, mps_pool_class_t dummy, const char *name)
@@ -194,6 +244,8 @@ static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
   } MPS_ARGS_END(args);
   DJMUST(mps_pool_create_k(&pool, arena, pool_class, mps_args_none));
   watch(dj, name);
+  if (nthreads > 1)
+    contention(name);
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
 }
@@ -236,6 +288,7 @@ static struct {
   {"mvt",   arena_wrap, dj_reserve, mps_class_mvt},
   {"mvff",  arena_wrap, dj_reserve, mps_class_mvff},
   {"mvffa", arena_wrap, dj_alloc,   mps_class_mvff}, /* mvff with alloc */
+  {"mvffs", arena_wrap, dj_sac,     mps_class_mvff}, /* mvff with sac */
   {"an",    wrap,       dj_malloc,  dummy_class},
 };
 
@@ -364,6 +417,7 @@ int main(int argc, char *argv[])
               "  mvt   pool class MVT\n"
               "  mvff  pool class MVFF (buffer interface)\n"
               "  mvffa pool class MVFF (alloc interface)\n"
+              "  mvffs pool class MVFF (per-thread allocation caches)\n"
               "  an    malloc\n");
       return EXIT_FAILURE;
     }
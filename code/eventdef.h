@@ -36,8 +36,8 @@
  */
 
 #define EVENT_VERSION_MAJOR  ((unsigned)2)
-#define EVENT_VERSION_MEDIAN ((unsigned)0)
-#define EVENT_VERSION_MINOR  ((unsigned)0)
+#define EVENT_VERSION_MEDIAN ((unsigned)1)
+#define EVENT_VERSION_MINOR  ((unsigned)1)
 
 
 /* EVENT_LIST -- list of event types and general properties
@@ -61,7 +61,7 @@
  */
 
 #define EventNameMAX ((size_t)19)
-#define EventCodeMAX ((EventCode)0x005c)
+#define EventCodeMAX ((EventCode)0x0060)
 
 #define EVENT_LIST(EVENT, X) \
   /*       0123456789012345678 <- don't exceed without changing EventNameMAX */ \
@@ -156,7 +156,11 @@
   EVENT(X, VMFinish           , 0x0059,  TRUE, Arena) \
   EVENT(X, VMInit             , 0x005a,  TRUE, Arena) \
   EVENT(X, VMMap              , 0x005b,  TRUE, Seg) \
-  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg)
+  EVENT(X, VMUnmap            , 0x005c,  TRUE, Seg) \
+  EVENT(X, TraceCompact       , 0x005d,  TRUE, Trace) \
+  EVENT(X, ThreadHandshake    , 0x005e,  TRUE, Arena) \
+  EVENT(X, TraceScanPart      , 0x005f,  TRUE, Seg) \
+  EVENT(X, TraceFlipEager     , 0x0060,  TRUE, Seg)
 
 
 /* Remember to update EventNameMAX and EventCodeMAX above!
@@ -504,6 +508,11 @@
   PARAM(X,  2, P, segHi, "new high segment") \
   PARAM(X,  3, A, at, "split address")
 
+#define EVENT_ThreadHandshake_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, P, thread, "the safepoint thread") \
+  PARAM(X,  2, W, latency, "time taken to stop, in mps_clock units")
+
 #define EVENT_TraceAccess_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, P, seg, "segment accessed") \
@@ -518,6 +527,11 @@
   PARAM(X,  0, P, arena, "trace's arena") \
   PARAM(X,  1, P, trace, "trace")
 
+#define EVENT_TraceCompact_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "trace's arena") \
+  PARAM(X,  1, P, trace, "trace that will evacuate chunks") \
+  PARAM(X,  2, W, chunks, "number of chunks being evacuated")
+
 #define EVENT_TraceCreate_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "trace that was created") \
   PARAM(X,  1, P, arena, "arena in which created") \
@@ -569,6 +583,10 @@
   PARAM(X,  0, P, trace, "the trace") \
   PARAM(X,  1, P, arena, "trace's arena")
 
+#define EVENT_TraceFlipEager_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, seg, "segment scanned instead of protected")
+
 #define EVENT_TraceFlipEnd_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
   PARAM(X,  1, P, arena, "trace's arena")
@@ -587,6 +605,13 @@
   PARAM(X,  1, P, base, "base of scanned area") \
   PARAM(X,  2, P, limit, "limit of scanned area")
 
+#define EVENT_TraceScanPart_PARAMS(PARAM, X) \
+  PARAM(X,  0, U, ts, "set of traces") \
+  PARAM(X,  1, U, rank, "current rank") \
+  PARAM(X,  2, P, seg, "segment") \
+  PARAM(X,  3, P, base, "base of scanned objects") \
+  PARAM(X,  4, P, limit, "limit of scanned objects")
+
 #define EVENT_TraceScanSingleRef_PARAMS(PARAM, X) \
   PARAM(X,  0, U, ts, "set of traces") \
   PARAM(X,  1, U, rank, "current rank") \
@@ -615,7 +640,8 @@
   PARAM(X,  7, W, forwardedCount, "objects preserved by moving") \
   PARAM(X,  8, W, forwardedSize, "bytes preserved by moving") \
   PARAM(X,  9, W, preservedInPlaceCount, "objects preserved in place") \
-  PARAM(X, 10, W, preservedInPlaceSize, "bytes preserved in place")
+  PARAM(X, 10, W, preservedInPlaceSize, "bytes preserved in place") \
+  PARAM(X, 11, W, pinCount, "pinned objects fixed at flip")
 
 #define EVENT_TraceStatReclaim_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
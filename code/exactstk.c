@@ -0,0 +1,355 @@
+/* exactstk.c: EXACT STACK SCANNING TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Simulate a language implementation that knows the layout of its
+ * stack frames, by keeping references in a chain of frames on the C
+ * stack, and scanning them with an exact stack scanner registered by
+ * mps_root_create_thread_exact.  Check that the objects referred to by
+ * the frames are moved by collections, and that they aren't when the
+ * stack is scanned ambiguously by mps_root_create_thread.  Check that
+ * the exact root is still scanned safely when another thread collects
+ * while this one is suspended with references in its registers.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "testthr.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define objSIZE           ((size_t)64)
+#define slotsCOUNT        8     /* references in each frame */
+#define depthCOUNT        16    /* frames on the stack */
+#define churnCOUNT        100000 /* objects allocated at the top */
+#define writeFREQ         64    /* one in writeFREQ objects is kept */
+#define checkFREQ         4096  /* frames checked after this many objects */
+#define genCOUNT          2
+
+/* objNULL needs to be odd so that it's ignored by scanFrames. */
+#define objNULL           ((mps_addr_t)MPS_WORD_CONST(0xDECEA5ED))
+
+
+/* frame_s -- a stack frame whose layout is known
+ *
+ * The frames are chained from topFrame, as a language implementation
+ * might chain them from its thread state.  The seen array remembers
+ * where each object was last seen, and isn't scanned exactly.
+ */
+
+typedef struct frame_s {
+  struct frame_s *link;
+  mps_addr_t slots[slotsCOUNT];
+  mps_word_t seen[slotsCOUNT];
+} frame_s;
+
+static mps_arena_t arena;
+static frame_s *topFrame;
+static unsigned long movedCount;
+static volatile int collectorDone;
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 128, 0.85 }, { 512, 0.45 } };
+
+
+/* scanFrames -- exact stack scanner */
+
+static mps_res_t scanFrames(mps_ss_t ss, void *hot, void *cold,
+                            void *closure)
+{
+  frame_s *frame;
+
+  testlib_unused(closure);
+  MPS_SCAN_BEGIN(ss) {
+    for (frame = topFrame; frame != NULL; frame = frame->link) {
+      size_t i;
+      Insist((void *)frame >= hot);
+      Insist((void *)frame < cold);
+      for (i = 0; i < slotsCOUNT; ++i) {
+        mps_addr_t p = frame->slots[i];
+        if (((mps_word_t)p & 1) == 0 && MPS_FIX1(ss, p)) {
+          mps_res_t res = MPS_FIX2(ss, &frame->slots[i]);
+          if (res != MPS_RES_OK)
+            return res;
+        }
+      }
+    }
+  } MPS_SCAN_END(ss);
+  return MPS_RES_OK;
+}
+
+
+/* make -- create one new object
+ *
+ * The caller must store the result in a frame before allocating again,
+ * because nothing else keeps the object alive when the stack is scanned
+ * exactly.
+ */
+
+static mps_addr_t make(mps_ap_t ap)
+{
+  mps_addr_t p;
+  mps_res_t res;
+
+  do {
+    MPS_RESERVE_BLOCK(res, p, ap, objSIZE);
+    if (res != MPS_RES_OK)
+      die(res, "MPS_RESERVE_BLOCK");
+    res = dylan_init(p, objSIZE, NULL, 0);
+    if (res != MPS_RES_OK)
+      die(res, "dylan_init");
+  } while (!mps_commit(ap, p, objSIZE));
+
+  return p;
+}
+
+
+/* store -- store a new object in a frame slot */
+
+static void store(frame_s *frame, size_t i, mps_ap_t ap)
+{
+  frame->slots[i] = make(ap);
+  frame->seen[i] = (mps_word_t)frame->slots[i];
+}
+
+
+/* check -- check the frames, and count the objects that have moved */
+
+static void check(void)
+{
+  frame_s *frame;
+  size_t i;
+
+  for (frame = topFrame; frame != NULL; frame = frame->link)
+    for (i = 0; i < slotsCOUNT; ++i) {
+      cdie(dylan_check(frame->slots[i]), "frame check");
+      cdie(mps_arena_has_addr(arena, frame->slots[i]), "frame in arena");
+      if ((mps_word_t)frame->slots[i] != frame->seen[i]) {
+        ++movedCount;
+        frame->seen[i] = (mps_word_t)frame->slots[i];
+      }
+    }
+}
+
+
+/* churn -- allocate garbage, occasionally keeping an object */
+
+static void churn(mps_ap_t ap)
+{
+  size_t n;
+
+  for (n = 1; n <= churnCOUNT; ++n) {
+    if (rnd() % writeFREQ == 0) {
+      frame_s *frame = topFrame;
+      size_t up = rnd() % depthCOUNT;
+      while (up > 0 && frame->link != NULL) {
+        frame = frame->link;
+        --up;
+      }
+      store(frame, rnd() % slotsCOUNT, ap);
+    } else {
+      (void)make(ap);
+    }
+    if (n % checkFREQ == 0)
+      check();
+  }
+  die(mps_arena_collect(arena), "collect");
+  mps_arena_release(arena);
+  check();
+}
+
+
+/* descend -- push frames, and churn at the top of the stack */
+
+static void descend(mps_ap_t ap, size_t depth)
+{
+  frame_s frame;
+  size_t i;
+
+  frame.link = topFrame;
+  for (i = 0; i < slotsCOUNT; ++i) {
+    frame.slots[i] = objNULL;
+    frame.seen[i] = (mps_word_t)objNULL;
+  }
+  topFrame = &frame;
+  for (i = 0; i < slotsCOUNT; ++i)
+    store(&frame, i, ap);
+
+  if (depth > 0)
+    descend(ap, depth - 1);
+  else
+    churn(ap);
+
+  topFrame = frame.link;
+}
+
+
+/* collector -- collect from another thread until told to stop */
+
+static void *collector(void *arg)
+{
+  testlib_unused(arg);
+  while (!collectorDone) {
+    (void)mps_arena_collect(arena); /* fails if there is nothing to collect */
+    mps_arena_release(arena);
+  }
+  return NULL;
+}
+
+
+static void test(mps_thr_t thread, void *cold, int exact, int other)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_word_t collections;
+  testthr_t collectorThread;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+
+  if (exact)
+    die(mps_root_create_thread_exact(&root, arena, thread, scanFrames,
+                                     NULL, cold),
+        "root_create_thread_exact");
+  else
+    die(mps_root_create_thread(&root, arena, thread, cold),
+        "root_create_thread");
+
+  movedCount = 0;
+  collections = mps_collections(arena);
+  if (other) {
+    collectorDone = 0;
+    testthr_create(&collectorThread, collector, NULL);
+  }
+  descend(ap, depthCOUNT - 1);
+  if (other) {
+    collectorDone = 1;
+    testthr_join(&collectorThread, NULL);
+  }
+  printf("%s stack%s: %lu objects moved, %lu collections\n",
+         exact ? "exact" : "ambiguous",
+         other ? ", other thread collecting" : "", movedCount,
+         (unsigned long)(mps_collections(arena) - collections));
+  if (exact)
+    Insist(movedCount > 0);
+  else
+    Insist(movedCount == 0);
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+/* otherThread -- try to scan another thread's stack exactly
+ *
+ * The thread wasn't registered with MPS_KEY_THREAD_SAFEPOINT, so it
+ * may have references in its registers when it is suspended.
+ */
+
+static void *otherThread(void *p)
+{
+  void *marker = &marker;
+  mps_thr_t thread = p;
+  mps_root_t root;
+
+  Insist(mps_root_create_thread_exact(&root, arena, thread, scanFrames,
+                                      NULL, marker)
+         == MPS_RES_PARAM);
+  return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+  void *marker = &marker;
+  mps_thr_t thread;
+  testthr_t other;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test(thread, marker, TRUE, FALSE);
+  test(thread, marker, FALSE, FALSE);
+  test(thread, marker, TRUE, TRUE);
+
+  testthr_create(&other, otherThread, thread);
+  testthr_join(&other, NULL);
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,370 @@
+/* flipbench.c -- Flip pause benchmark
+ *
+ * $Id$
+ * Copyright (c) 2014-2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This measures how long collections take when there are many
+ * registered threads with deep stacks, as the number of threads and
+ * the number of scan workers (MPS_KEY_ARENA_SCAN_WORKERS) vary.  The
+ * heap is small, so the time is dominated by the flip, which scans
+ * the thread stacks.  See <code/trace.c#.flip.par>.
+ *
+ * It can also register a large exact table root, optionally with
+ * MPS_RM_INCREMENTAL so that it is scanned after the flip rather than
+ * during it.  See <code/trace.c#.flip.defer>.  The time taken by
+ * mps_arena_start_collect is reported separately as the flip time.
+ *
+ * Times are measured with EVENT_CLOCK, in the units of the event
+ * clock (usually processor cycles), because mps_clock measures
+ * processor time, which doesn't go down when the work is spread over
+ * more threads.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "testthr.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpm.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#include <time.h> /* nanosleep */
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS, strtoul */
+
+#define RESMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+#define frameWORDS 32             /* words in each stack frame's array */
+
+static mps_arena_t arena;
+static mps_pool_t pool;
+static mps_fmt_t format;
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned maxthreads = 8;   /* maximum number of threads */
+static unsigned nworkers = 4;     /* scan workers */
+static unsigned depth = 500;      /* depth of each thread's stack */
+static unsigned ncollect = 20;    /* collections per measurement */
+static size_t arena_size = 64ul * 1024 * 1024; /* arena size */
+static size_t table_words = 0;    /* words in table root */
+static mps_bool_t incremental = FALSE; /* table root is incremental? */
+
+#define tableALIGN ((size_t)65536) /* at least the page size */
+#define tableOBJS  1024           /* distinct objects in table root */
+
+typedef struct flipthread_s *flipthread_t;
+
+struct flipthread_s {
+  testthr_t thread;
+  mps_thr_t mps_thread;
+  mps_root_t reg_root;
+  mps_ap_t ap;
+  volatile mps_bool_t ready;      /* stack has been built */
+};
+
+static volatile mps_bool_t stopping; /* threads should return */
+
+
+/* snooze -- let other threads run for a while */
+
+static void snooze(void)
+{
+#ifdef MPS_OS_W3
+  Sleep(1);
+#else
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = 1000000;
+  (void)nanosleep(&ts, NULL);
+#endif
+}
+
+
+/* deepen -- build a deep stack, one reference per frame
+ *
+ * The rest of each frame is random non-references, like the data on
+ * a real stack, which are rejected by the zone check or the segment
+ * lookup.  Returns a checksum of the frames so that they are live
+ * until the thread returns.
+ */
+
+static mps_word_t deepen(flipthread_t thread, unsigned d)
+{
+  volatile mps_word_t frame[frameWORDS];
+  mps_word_t obj, sum = 0;
+  size_t i;
+
+  for (i = 0; i < frameWORDS; ++i)
+    frame[i] = rnd() << 1;
+  RESMUST(make_dylan_vector(&obj, thread->ap, 2));
+  frame[rnd() % frameWORDS] = obj;
+
+  if (d > 1) {
+    sum = deepen(thread, d - 1);
+  } else {
+    thread->ready = TRUE;
+    while (!stopping)
+      snooze();
+  }
+
+  for (i = 0; i < frameWORDS; ++i)
+    sum += frame[i];
+  return sum;
+}
+
+
+/* start -- start routine for each thread */
+
+static void *start(void *p)
+{
+  flipthread_t thread = p;
+  void *marker;
+  RESMUST(mps_thread_reg(&thread->mps_thread, arena));
+  RESMUST(mps_root_create_thread(&thread->reg_root, arena,
+                                 thread->mps_thread, &marker));
+  RESMUST(mps_ap_create_k(&thread->ap, pool, mps_args_none));
+  (void)deepen(thread, depth);
+  mps_ap_destroy(thread->ap);
+  mps_root_destroy(thread->reg_root);
+  mps_thread_dereg(thread->mps_thread);
+  return NULL;
+}
+
+
+/* measure -- time collections with nthreads threads and workers scan
+ * workers */
+
+static void measure(unsigned nthreads, unsigned workers)
+{
+  flipthread_t threads = alloca(sizeof(threads[0]) * nthreads);
+  EventClock begin, flip, end, total = 0, longest = 0;
+  EventClock flipTotal = 0, flipLongest = 0;
+  unsigned t, i;
+  void *block = NULL;
+  mps_root_t table_root = NULL;
+  mps_ap_t ap;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, arena_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SCAN_WORKERS, workers);
+    RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
+  } MPS_ARGS_END(args);
+  RESMUST(dylan_fmt(&format, arena));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    RESMUST(mps_pool_create_k(&pool, arena, mps_class_amc(), args));
+  } MPS_ARGS_END(args);
+
+  if (table_words > 0) {
+    /* The table must have pages to itself so that it can be
+       protected. */
+    size_t size = table_words * sizeof(mps_word_t);
+    mps_word_t *table;
+    mps_rm_t mode = incremental ? MPS_RM_PROT | MPS_RM_INCREMENTAL : 0;
+    size_t w;
+    block = malloc(size + 2 * tableALIGN);
+    if (block == NULL) {
+      fprintf(stderr, "Couldn't allocate table root.\n");
+      exit(EXIT_FAILURE);
+    }
+    table = (mps_word_t *)(((mps_word_t)block + tableALIGN - 1)
+                           & ~(mps_word_t)(tableALIGN - 1));
+    for (w = 0; w < table_words; ++w)
+      table[w] = 0;
+    RESMUST(mps_root_create_area(&table_root, arena, mps_rank_exact(),
+                                 mode, table, table + table_words,
+                                 mps_scan_area, NULL));
+    RESMUST(mps_ap_create_k(&ap, pool, mps_args_none));
+    for (w = 0; w < table_words; ++w)
+      if (w < tableOBJS)
+        RESMUST(make_dylan_vector(&table[w], ap, 2));
+      else
+        table[w] = table[w % tableOBJS];
+    mps_ap_destroy(ap);
+  }
+
+  stopping = FALSE;
+  for (t = 0; t < nthreads; ++t) {
+    threads[t].ready = FALSE;
+    testthr_create(&threads[t].thread, start, &threads[t]);
+  }
+  for (t = 0; t < nthreads; ++t)
+    while (!threads[t].ready)
+      snooze();
+
+  for (i = 0; i < ncollect; ++i) {
+    EVENT_CLOCK(begin);
+    RESMUST(mps_arena_start_collect(arena));
+    EVENT_CLOCK(flip);
+    mps_arena_park(arena);
+    EVENT_CLOCK(end);
+    total += end - begin;
+    if (end - begin > longest)
+      longest = end - begin;
+    flipTotal += flip - begin;
+    if (flip - begin > flipLongest)
+      flipLongest = flip - begin;
+    mps_arena_release(arena);
+  }
+
+  stopping = TRUE;
+  for (t = 0; t < nthreads; ++t)
+    testthr_join(&threads[t].thread, NULL);
+
+  printf("threads %2u workers %2u: mean %10.0f max %10.0f"
+         " flip mean %10.0f max %10.0f\n",
+         nthreads, workers, (double)total / ncollect, (double)longest,
+         (double)flipTotal / ncollect, (double)flipLongest);
+  (void)fflush(stdout);
+
+  mps_arena_park(arena);
+  if (table_root != NULL)
+    mps_root_destroy(table_root);
+  free(block);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nthreads",         required_argument, NULL, 't'},
+  {"nworkers",         required_argument, NULL, 'w'},
+  {"depth",            required_argument, NULL, 'd'},
+  {"ncollect",         required_argument, NULL, 'c'},
+  {"table",            required_argument, NULL, 'r'},
+  {"incremental",      no_argument,       NULL, 'i'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned nthreads;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "ht:w:d:c:r:ix:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 't':
+      maxthreads = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'w':
+      nworkers = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      depth = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      ncollect = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      table_words = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'i':
+      incremental = TRUE;
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -t n, --nthreads=n\n"
+              "    Maximum number of threads (default %u)\n"
+              "  -w n, --nworkers=n\n"
+              "    Number of scan workers (default %u)\n"
+              "  -d n, --depth=n\n"
+              "    Depth of each thread's stack in frames (default %u)\n"
+              "  -c n, --ncollect=n\n"
+              "    Collections per measurement (default %u)\n"
+              "  -r n, --table=n\n"
+              "    Words in an exact table root (default %lu)\n"
+              "  -i, --incremental\n"
+              "    Register the table root with MPS_RM_INCREMENTAL\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0], maxthreads, nworkers, depth, ncollect,
+              (unsigned long)table_words);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  rnd_state_set(seed);
+  for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+    measure(nthreads, 0);
+    if (nworkers > 0)
+      measure(nthreads, nworkers);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2014-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
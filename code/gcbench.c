@@ -236,6 +236,28 @@ static void watch(gcthread_fn_t fn, const char *name)
 }
 
 
+/* Report the false positive rate of the zone check in MPS_FIX1: the
+ * proportion of references that were in a white zone but not in a
+ * white segment.  This depends on the number of zones (see
+ * CONFIG_ZONES_128) and the arena size, and the statistics are only
+ * collected in the cool variety. */
+
+static void report_zones(const char *name)
+{
+#if defined(STATISTICS)
+  Arena a = (Arena)arena;
+  Count passed = a->fixRefCount, white = a->whiteSegRefCount;
+  printf("%s: %lu zones, %lu fixes passed zone check, %lu white, "
+         "%.2f%% false positives\n",
+         name, (unsigned long)ZoneCOUNT, (unsigned long)passed,
+         (unsigned long)white,
+         passed == 0 ? 0.0 : 100.0 * (double)(passed - white) / (double)passed);
+#else
+  UNUSED(name);
+#endif
+}
+
+
 /* Setup MPS arena and call benchmark. */
 
 static void arena_setup(gcthread_fn_t fn,
@@ -264,6 +286,7 @@ static void arena_setup(gcthread_fn_t fn,
   } MPS_ARGS_END(args);
   watch(fn, name);
   mps_arena_park(arena);
+  report_zones(name);
   mps_pool_destroy(pool);
   mps_fmt_destroy(format);
   if (ngen > 0)
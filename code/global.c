@@ -29,12 +29,19 @@
 SRCID(global, "$Id$");
 
 
+/* Keyword argument for ThreadRegister, defined here because it's
+ * common to all the thread managers <code/th.h>. */
+
+ARG_DEFINE_KEY(THREAD_SAFEPOINT, Bool);
+
+
 /* All static data objects are declared here. See .static */
 
 /* <design/arena#.static.ring.init> */
 static Bool arenaRingInit = FALSE;
 static RingStruct arenaRing;       /* <design/arena#.static.ring> */
 static Serial arenaSerial;         /* <design/arena#.static.serial> */
+static Count arenaAccessSpurious;  /* <code/global.c#.access.shadow> */
 
 
 /* arenaClaimRingLock, arenaReleaseRingLock -- lock/release the arena ring
@@ -43,7 +50,16 @@ static Serial arenaSerial;         /* <design/arena#.static.serial> */
 
 static void arenaClaimRingLock(void)
 {
-  LockClaimGlobal();  /* claim the global lock to protect arenaRing */
+  Thread thread = ThreadSafepointCurrent();
+
+  /* See ArenaEnterLock. */
+  if (thread == NULL) {
+    LockClaimGlobal();  /* claim the global lock to protect arenaRing */
+  } else {
+    THREAD_NATIVE_BEGIN(thread) {
+      LockClaimGlobal();
+    } THREAD_NATIVE_END(thread);
+  }
 }
 
 static void arenaReleaseRingLock(void)
@@ -52,6 +68,33 @@ static void arenaReleaseRingLock(void)
 }
 
 
+/* arenaClaimAll, arenaReleaseAll -- claim and release the arena lock
+ * and the locks of its pools, in the order <code/pool.c#.lock.order>.
+ */
+
+static void arenaClaimAll(Arena arena)
+{
+  Ring node, nextNode;
+
+  ArenaEnter(arena);
+  RING_FOR(node, &ArenaGlobals(arena)->poolRing, nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    PoolClaim(pool);
+  }
+}
+
+static void arenaReleaseAll(Arena arena)
+{
+  Ring node, nextNode;
+
+  RING_FOR(node, &ArenaGlobals(arena)->poolRing, nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    PoolRelease(pool);
+  }
+  ArenaLeave(arena);
+}
+
+
 /* GlobalsClaimAll -- claim all MPS locks
  * <design/thread-safety#.sol.fork.lock>
  */
@@ -60,7 +103,7 @@ void GlobalsClaimAll(void)
 {
   LockClaimGlobalRecursive();
   arenaClaimRingLock();
-  GlobalsArenaMap(ArenaEnter);
+  GlobalsArenaMap(arenaClaimAll);
 }
 
 /* GlobalsReleaseAll -- release all MPS locks. GlobalsClaimAll must
@@ -68,18 +111,25 @@ void GlobalsClaimAll(void)
 
 void GlobalsReleaseAll(void)
 {
-  GlobalsArenaMap(ArenaLeave);
+  GlobalsArenaMap(arenaReleaseAll);
   arenaReleaseRingLock();
   LockReleaseGlobalRecursive();
 }
 
-/* arenaReinitLock -- reinitialize the lock for an arena */
+/* arenaReinitLock -- reinitialize the locks for an arena and its pools */
 
 static void arenaReinitLock(Arena arena)
 {
+  Ring node, nextNode;
+
   AVERT(Arena, arena);
   ShieldLeave(arena);
   LockInit(ArenaGlobals(arena)->lock);
+  RING_FOR(node, &ArenaGlobals(arena)->poolRing, nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    if (pool->lock != NULL)
+      LockInit(pool->lock);
+  }
 }
 
 /* GlobalsReinitializeAll -- reinitialize all MPS locks, and leave the
@@ -186,6 +236,7 @@ Bool GlobalsCheck(Globals arenaGlobals)
   CHECKL(arenaGlobals->emptyInternalSize >= 0.0);
 
   CHECKL(BoolCheck(arenaGlobals->bufferLogging));
+  CHECKD_NOSIG(Ring, &arenaGlobals->bufferRing);
   CHECKD_NOSIG(Ring, &arenaGlobals->poolRing);
   CHECKD_NOSIG(Ring, &arenaGlobals->rootRing);
   CHECKD_NOSIG(Ring, &arenaGlobals->rememberedSummaryRing);
@@ -206,6 +257,8 @@ Bool GlobalsCheck(Globals arenaGlobals)
 
   CHECKD_NOSIG(Ring, &arena->threadRing);
   CHECKD_NOSIG(Ring, &arena->deadRing);
+  CHECKL(BoolCheck(arena->handshake));
+  CHECKL(arena->accessCoalesced <= arena->accessCount);
 
   CHECKD(Shield, ArenaShield(arena));
 
@@ -232,6 +285,8 @@ Bool GlobalsCheck(Globals arenaGlobals)
   CHECKL(arena->tracedWork >= 0.0);
   CHECKL(arena->tracedTime >= 0.0);
   /* no check for arena->lastWorldCollect (Clock) */
+  /* no check for arena->compactReserved (Size) */
+  /* no check for arena->lastCompactCheck (Clock) */
 
   /* can't write a check for arena->epoch */
   CHECKD(History, ArenaHistory(arena));
@@ -252,6 +307,11 @@ Bool GlobalsCheck(Globals arenaGlobals)
 
   /* can't check arena->stackWarm */
 
+  if (arena->pinTable != NULL)
+    CHECKD(Table, arena->pinTable);
+  CHECKL(BoolCheck(arena->pinsGrey));
+  CHECKL(!arena->pinsGrey || arena->pinTable != NULL);
+
   return TRUE;
 }
 
@@ -306,6 +366,7 @@ Res GlobalsInit(Globals arenaGlobals)
 
   arenaGlobals->mpsVersionString = MPSVersion();
   arenaGlobals->bufferLogging = FALSE;
+  RingInit(&arenaGlobals->bufferRing);
   RingInit(&arenaGlobals->poolRing);
   arenaGlobals->poolSerial = (Serial)0;
   /* The system pools are:
@@ -321,6 +382,14 @@ Res GlobalsInit(Globals arenaGlobals)
   RingInit(&arena->threadRing);
   RingInit(&arena->deadRing);
   arena->threadSerial = (Serial)0;
+  arena->threadLocal = NULL;
+  arena->scanWorkerCount = 0;
+  arena->scanWorkers = NULL;
+  arena->handshake = FALSE;
+  arena->accessCount = 0;
+  arena->accessCoalesced = 0;
+  arena->accessAvoided = 0;
+  arena->accessLatencyMax = 0;
   RingInit(&arena->formatRing);
   arena->formatSerial = (Serial)0;
   RingInit(&arena->messageRing);
@@ -333,6 +402,10 @@ Res GlobalsInit(Globals arenaGlobals)
   arena->tracedWork = 0.0;
   arena->tracedTime = 0.0;
   arena->lastWorldCollect = ClockNow();
+  arena->compactReserved = (Size)0;
+  arena->lastCompactCheck = ClockNow();
+  STATISTIC(arena->fixRefCount = (Count)0);
+  STATISTIC(arena->whiteSegRefCount = (Count)0);
   ShieldInit(ArenaShield(arena));
 
   for (ti = 0; ti < TraceLIMIT; ++ti) {
@@ -354,6 +427,9 @@ Res GlobalsInit(Globals arenaGlobals)
   arena->emergency = FALSE;
 
   arena->stackWarm = NULL;
+
+  arena->pinTable = NULL;
+  arena->pinsGrey = FALSE;
   
   arenaGlobals->defaultChain = NULL;
 
@@ -363,6 +439,35 @@ Res GlobalsInit(Globals arenaGlobals)
 }
 
 
+/* defaultChainCreate -- create the arena's default generation chain */
+
+static Res defaultChainCreate(Chain *chainReturn, Arena arena)
+{
+  GenParamStruct params[] = ChainDEFAULT;
+  Chain chain;
+  Res res;
+
+  res = ChainCreate(&chain, arena, NELEMS(params), params);
+  if (res != ResOK)
+    return res;
+
+  /* Label generations in default generation chain, for telemetry. */
+  {
+    char label[] = "DefGen-0";
+    char *gen_index = &label[(sizeof label) - 2];
+    size_t i;
+    AVER(*gen_index == '0');
+    for (i = 0; i < chain->genCount; ++i) {
+      *gen_index = "0123456789ABCDEF"[i % 16];
+      EventLabelPointer(&chain->gens[i], EventInternString(label));
+    }
+  }
+
+  *chainReturn = chain;
+  return ResOK;
+}
+
+
 /* GlobalsCompleteCreate -- complete creating the globals of the arena
  *
  * This is like the final initializations in a Create method, except
@@ -403,32 +508,43 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
   arenaGlobals->lock = (Lock)p;
   LockInit(arenaGlobals->lock);
 
-  /* Create the arena's default generation chain. */
-  {
-    GenParamStruct params[] = ChainDEFAULT;
-    res = ChainCreate(&arenaGlobals->defaultChain, arena, NELEMS(params), params);
-    if (res != ResOK)
-      goto failChainCreate;
+  res = ControlAlloc(&p, arena, ThreadLocalSize());
+  if (res != ResOK)
+    return res;
+  res = ThreadLocalInit((ThreadLocal)p);
+  if (res != ResOK) {
+    ControlFree(arena, p, ThreadLocalSize());
+    return res;
   }
+  arena->threadLocal = (ThreadLocal)p;
 
-  /* Label generations in default generation chain, for telemetry. */
-  {
-    Chain chain = arenaGlobals->defaultChain;
-    char label[] = "DefGen-0";
-    char *gen_index = &label[(sizeof label) - 2];
-    size_t i;
-    AVER(*gen_index == '0');
-    for (i = 0; i < chain->genCount; ++i) {
-      *gen_index = "0123456789ABCDEF"[i % 16];
-      EventLabelPointer(&chain->gens[i], EventInternString(label));
-    }
+  res = defaultChainCreate(&arenaGlobals->defaultChain, arena);
+  if (res != ResOK)
+    goto failChainCreate;
+
+  /* Worker threads for scanning at flip time <code/trace.c#.flip.par>.
+   * If the platform doesn't have them, the flip just doesn't use
+   * them. */
+  if (arena->scanWorkerCount > 0) {
+    res = ThreadWorkersCreate(&arena->scanWorkers, arena,
+                              arena->scanWorkerCount);
+    if (res == ResUNIMPL)
+      arena->scanWorkers = NULL;
+    else if (res != ResOK)
+      goto failWorkersCreate;
   }
 
   arenaAnnounce(arena);
 
   return ResOK;
 
+failWorkersCreate:
+  ChainDestroy(arenaGlobals->defaultChain);
+  arenaGlobals->defaultChain = NULL;
 failChainCreate:
+  ThreadLocalFinish(arena->threadLocal);
+  ControlFree(arena, arena->threadLocal, ThreadLocalSize());
+  arena->threadLocal = NULL;
   return res;
 }
 
@@ -455,6 +571,7 @@ void GlobalsFinish(Globals arenaGlobals)
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     RingFinish(&arena->greyRing[rank]);
   RingFinish(&arenaGlobals->rootRing);
+  RingFinish(&arenaGlobals->bufferRing);
   RingFinish(&arenaGlobals->poolRing);
   RingFinish(&arenaGlobals->globalRing);
 }
@@ -493,6 +610,17 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
   LockFinish(arenaGlobals->lock);
   arenaGlobals->lock = NULL;
 
+  if (arena->threadLocal != NULL) {
+    ThreadLocalFinish(arena->threadLocal);
+    ControlFree(arena, arena->threadLocal, ThreadLocalSize());
+    arena->threadLocal = NULL;
+  }
+
+  if (arena->scanWorkers != NULL) {
+    ThreadWorkersDestroy(arena->scanWorkers);
+    arena->scanWorkers = NULL;
+  }
+
   TRACE_SET_ITER(ti, trace, TraceSetUNIV, arena)
     /* <design/message-gc#.lifecycle> */
     TraceIdMessagesDestroy(arena, ti);
@@ -518,6 +646,13 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
     arena->enabledMessageTypes = NULL;
   }
 
+  /* throw away the pin table <code/root.c#.pin.table> */
+  if (arena->pinTable != NULL) {
+    AVER(TableCount(arena->pinTable) == 0);
+    TableDestroy(arena->pinTable);
+    arena->pinTable = NULL;
+  }
+
   /* destroy the final pool <design/finalize> */
   if (arena->isFinalPool) {
     /* All this subtlety is because PoolDestroy will call */
@@ -553,6 +688,80 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
 }
 
 
+/* GlobalsReset -- return the globals to their state after creation
+ *
+ * The client must already have destroyed everything it created in the
+ * arena, as for GlobalsPrepareToDestroy.  Settings such as the enabled
+ * message types are kept, and so is the location dependency history,
+ * so that the client's location dependencies remain valid.
+ */
+
+Res GlobalsReset(Globals arenaGlobals)
+{
+  Arena arena;
+  Chain chain;
+  Rank rank;
+  Res res;
+
+  AVERT(Globals, arenaGlobals);
+  arena = GlobalsArena(arenaGlobals);
+
+  ArenaPark(arenaGlobals);
+
+  /* Create the new default chain first, so that on failure the arena
+     is still usable. */
+  res = defaultChainCreate(&chain, arena);
+  if (res != ResOK)
+    return res;
+
+  /* Messages may refer to objects in pools that have been destroyed.
+     See .message.queue.empty. */
+  MessageEmpty(arena);
+  arena->droppedMessages = 0;
+
+  if (arena->isFinalPool) {
+    Pool pool = arena->finalPool;
+    arena->isFinalPool = FALSE;
+    arena->finalPool = NULL;
+    PoolDestroy(pool);
+  }
+
+  /* Forget the zones and mortality learned by the generations. */
+  ChainDestroy(arenaGlobals->defaultChain);
+  arenaGlobals->defaultChain = chain;
+  LocusFinish(arena);
+  LocusInit(arena);
+
+  AVER(RingIsSingle(&arena->formatRing)); /* <design/check/#.common> */
+  AVER(RingLength(&arena->chainRing) == 1); /* just the default chain */
+  AVER(RingIsSingle(&arena->messageRing));
+  AVER(RingIsSingle(&arena->threadRing)); /* <design/check/#.common> */
+  AVER(RingIsSingle(&arena->deadRing));
+  AVER(RingIsSingle(&arenaGlobals->rootRing)); /* <design/check/#.common> */
+  AVER(ArenaPinCount(arena) == 0);
+  for(rank = RankMIN; rank < RankLIMIT; ++rank)
+    AVER(RingIsSingle(&arena->greyRing[rank]));
+  AVER(RingLength(&arenaGlobals->poolRing) == arenaGlobals->systemPools); /* <design/check/#.common> */
+
+  arenaGlobals->pollThreshold = 0.0;
+  arenaGlobals->fillMutatorSize = 0.0;
+  arenaGlobals->emptyMutatorSize = 0.0;
+  arenaGlobals->allocMutatorSize = 0.0;
+  arenaGlobals->fillInternalSize = 0.0;
+  arenaGlobals->emptyInternalSize = 0.0;
+  arena->tracedWork = 0.0;
+  arena->tracedTime = 0.0;
+  arena->lastWorldCollect = ClockNow();
+  arena->compactReserved = (Size)0;
+  arena->lastCompactCheck = ClockNow();
+  arena->emergency = FALSE;
+  arenaGlobals->clamped = FALSE; /* undo ArenaPark */
+
+  AVERT(Globals, arenaGlobals);
+  return ResOK;
+}
+
+
 Ring GlobalsRememberedSummaryRing(Globals global)
 {
   AVERT(Globals, global);
@@ -568,11 +777,21 @@ void ArenaEnter(Arena arena)
   ArenaEnterLock(arena, FALSE);
 }
 
+static void arenaClaimLock(Lock lock, Bool recursive)
+{
+  if(recursive) {
+    LockClaimRecursive(lock);
+  } else {
+    LockClaim(lock);
+  }
+}
+
 /*  The recursive argument specifies whether to claim the lock
     recursively or not. */
 void ArenaEnterLock(Arena arena, Bool recursive)
 {
   Lock lock;
+  Thread thread;
 
   /* This check is safe to do outside the lock.  Unless the client
      is also calling ArenaDestroy, but that's a protocol violation by
@@ -585,10 +804,16 @@ void ArenaEnterLock(Arena arena, Bool recursive)
    * the lock first then this would deadlock. */
   StackProbe(StackProbeDEPTH);
   lock = ArenaGlobals(arena)->lock;
-  if(recursive) {
-    LockClaimRecursive(lock);
+  /* A safepoint thread must be native while it waits for the lock,
+   * in case the holder is trying to stop it.  See
+   * <code/thix.c#.safepoint>. */
+  thread = ThreadSafepointCurrent();
+  if (thread == NULL) {
+    arenaClaimLock(lock, recursive);
   } else {
-    LockClaim(lock);
+    THREAD_NATIVE_BEGIN(thread) {
+      arenaClaimLock(lock, recursive);
+    } THREAD_NATIVE_END(thread);
   }
   AVERT(Arena, arena); /* can't AVERT it until we've got the lock */
   if(recursive) {
@@ -596,6 +821,24 @@ void ArenaEnterLock(Arena arena, Bool recursive)
   } else {
     ShieldEnter(arena);
   }
+
+  /* A thread that the flip left for later must scan its own roots */
+  /* before it can touch managed memory.  It can't have been in the */
+  /* arena already, so a recursive claim must enter the shield, and */
+  /* the entry point hasn't saved the stack context yet.  See */
+  /* <code/trace.c#.flip.handshake.self>. */
+  if (thread != NULL && ThreadArena(thread) == arena
+      && ThreadHandshake(thread) != TraceSetEMPTY) {
+    if (recursive)
+      ShieldEnter(arena);
+    STACK_CONTEXT_BEGIN(arena) {
+      TraceHandshake(thread);
+    } STACK_CONTEXT_END(arena);
+    if (recursive) {
+      ArenaBlackenPins(arena);
+      ShieldLeave(arena);
+    }
+  }
 }
 
 /* Same as ArenaEnter, but for the few functions that need to be
@@ -626,6 +869,7 @@ void ArenaLeaveLock(Arena arena, Bool recursive)
   if(recursive) {
     /* no need to leave shield */
   } else {
+    ArenaBlackenPins(arena);  /* <code/root.c#.pin.barrier> */
     ShieldLeave(arena);
   }
   ProtSync(arena);              /* <design/prot#.if.sync> */
@@ -651,17 +895,67 @@ Bool ArenaBusy(Arena arena)
  *
  * This is called when a protected address is accessed.  The mode
  * corresponds to which mode flags need to be cleared in order for the
- * access to continue.  */
+ * access to continue.
+ *
+ * .access.shadow: If the protection shadow knows that the address is
+ * no longer protected against the access, then another thread (or a
+ * nested handler) has already dealt with the fault, and the access
+ * can be retried without claiming any locks.  See <code/protsh.c>.
+ * It's worth looking again once the ring lock is held, because
+ * faulting threads queue for that lock.
+ * The count of these faults is shared by all arenas and isn't
+ * protected by any lock, so it's only approximate.
+ *
+ * .access.ring: The arena that handles a fault moves to the front of
+ * the arena ring, so that a program with several arenas usually looks
+ * in the right one first.
+ *
+ * .access.stats: Each arena counts the faults that it handles, and
+ * how many of those had already been dealt with by the time it had
+ * the lock, and records the longest time taken to handle a fault,
+ * including the time waiting for the locks, in units of the event
+ * clock (usually processor cycles).  See GlobalsDescribe.
+ */
+
+static void arenaAccessDone(Arena arena, EventClock start, Bool coalesced)
+{
+  EventClock now, latency;
+
+  EVENT_CLOCK(now);
+  latency = now - start;
+  ++arena->accessCount;
+  if (coalesced)
+    ++arena->accessCoalesced;
+  if (latency > arena->accessLatencyMax)
+    arena->accessLatencyMax = latency;
+  EVENT1(ArenaAccessEnd, arena);
+  ArenaLeave(arena);
+}
 
 Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
 {
   Seg seg;
   Ring node, nextNode;
   Res res;
+  EventClock start;
+
+  if (ProtShadowAllows(addr, mode)) {  /* .access.shadow */
+    ++arenaAccessSpurious;
+    return TRUE;
+  }
 
+  EVENT_CLOCK(start);
   arenaClaimRingLock();    /* <design/arena#.lock.ring> */
   AVERT(Ring, &arenaRing);
 
+  /* The fault may have been dealt with while this thread was waiting */
+  /* for the ring lock. */
+  if (ProtShadowAllows(addr, mode)) {  /* .access.shadow */
+    arenaReleaseRingLock();
+    ++arenaAccessSpurious;
+    return TRUE;
+  }
+
   RING_FOR(node, &arenaRing, nextNode) {
     Globals arenaGlobals = RING_ELT(Globals, globalRing, node);
     Arena arena = GlobalsArena(arenaGlobals);
@@ -675,6 +969,10 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
     /* protected root on a segment. */
     /* It is possible to overcome this restriction. */
     if (SegOfAddr(&seg, arena, addr)) {
+      if (RingNext(&arenaRing) != node) {  /* .access.ring */
+        RingRemove(node);
+        RingInsert(&arenaRing, node);
+      }
       arenaReleaseRingLock();
       /* An access in a different thread (or even in the same thread,
        * via a signal or exception handler) may have already caused
@@ -689,16 +987,18 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
         /* Protection was already cleared, for example by another thread
            or a fault in a nested exception handler: nothing to do now. */
       }
-      EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+      arenaAccessDone(arena, start, mode == AccessSetEMPTY);
       return TRUE;
     } else if (RootOfAddr(&root, arena, addr)) {
+      if (RingNext(&arenaRing) != node) {  /* .access.ring */
+        RingRemove(node);
+        RingInsert(&arenaRing, node);
+      }
       arenaReleaseRingLock();
       mode &= RootPM(root);
       if (mode != AccessSetEMPTY)
-        RootAccess(root, mode);
-      EVENT1(ArenaAccessEnd, arena);
-      ArenaLeave(arena);
+        RootAccess(root, addr, mode);
+      arenaAccessDone(arena, start, mode == AccessSetEMPTY);
       return TRUE;
     } else {
       /* No segment or root was found at the address: this must mean
@@ -812,11 +1112,21 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
         if (res != ResOK)
           break;
         arena->lastWorldCollect = now;
+      } else if (PolicyShouldCompact(arena, now, clocks_per_sec)) {
+        /* Idle time, and sparse chunks to release: evacuate them. */
+        Res res;
+        res = TraceStartCompact(&trace, arena, TraceStartWhyCOMPACTION);
+        if (res != ResOK)
+          break;
       } else {
         /* Not worth collecting the world; consider starting a trace. */
         Bool worldCollected;
-        if (!PolicyStartTrace(&trace, &worldCollected, arena, FALSE))
+        if (!PolicyStartTrace(&trace, &worldCollected, arena, FALSE)) {
+          /* Nothing to collect: get spare memory ready instead. */
+          if (ArenaPrefault(arena) > 0)
+            workWasDone = TRUE;
           break;
+        }
       }
     }
     TraceAdvance(trace);
@@ -1030,6 +1340,9 @@ Res GlobalsDescribe(Globals arenaGlobals, mps_lib_FILE *stream, Count depth)
   res = WriteF(stream, depth + 2,
                "mpsVersion $S\n", (WriteFS)arenaGlobals->mpsVersionString,
                "lock $P\n", (WriteFP)arenaGlobals->lock,
+               "lockContentions $U\n",
+               (WriteFU)(arenaGlobals->lock == NULL ? 0
+                         : LockContentions(arenaGlobals->lock)),
                "pollThreshold $U\n", (WriteFU)arenaGlobals->pollThreshold,
                arenaGlobals->insidePoll ? "inside" : "outside", " poll\n",
                arenaGlobals->clamped ? "clamped\n" : "released\n",
@@ -1044,7 +1357,18 @@ Res GlobalsDescribe(Globals arenaGlobals, mps_lib_FILE *stream, Count depth)
                "threadSerial $U\n", (WriteFU)arena->threadSerial,
                "busyTraces    $B\n", (WriteFB)arena->busyTraces,
                "flippedTraces $B\n", (WriteFB)arena->flippedTraces,
-               NULL);
+               "accessCount $U\n", (WriteFU)arena->accessCount,
+               "accessCoalesced $U\n", (WriteFU)arena->accessCoalesced,
+               "accessAvoided $U\n", (WriteFU)arena->accessAvoided,
+               "accessSpurious $U (all arenas)\n",
+               (WriteFU)arenaAccessSpurious,
+               "accessLatencyMax ", NULL);
+  if (res != ResOK)
+    return res;
+  res = EVENT_CLOCK_WRITE(stream, 0, arena->accessLatencyMax);
+  if (res != ResOK)
+    return res;
+  res = WriteF(stream, 0, "\n", NULL);
   if (res != ResOK)
     return res;
 
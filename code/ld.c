@@ -44,6 +44,11 @@
  * "wrapped" with an ShieldExpose/Cover pair if and only if the access
  * is taking place inside the arena.  Currently this is only the case for
  * LDReset.
+ *
+ * .fold: The reference set in the public ld structure is a word, but
+ * the arena may have more zones than that (see ZONES_128 in
+ * <code/config.h>), so reference sets are folded with ZoneSetFold
+ * before they are stored in or compared with it.
  */
 
 #include "mpm.h"
@@ -107,7 +112,8 @@ Res HistoryDescribe(History history, mps_lib_FILE *stream, Count depth)
   res = WriteF(stream, depth,
                "History $P {\n",      (WriteFP)history,
                "  epoch      = $U\n", (WriteFU)history->epoch,
-               "  prehistory = $B\n", (WriteFB)history->prehistory,
+               "  prehistory = " ZoneSetFORMAT "\n",
+               ZoneSetWriteF(history->prehistory),
                "  history {\n",
                "    [note: indices are raw, not rotated]\n",
                NULL);
@@ -116,7 +122,8 @@ Res HistoryDescribe(History history, mps_lib_FILE *stream, Count depth)
 
   for (i = 0; i < LDHistoryLENGTH; ++i) {
     res = WriteF(stream, depth + 4,
-                 "[$U] = $B\n", (WriteFU)i, (WriteFB)history->history[i],
+                 "[$U] = " ZoneSetFORMAT "\n", (WriteFU)i,
+                 ZoneSetWriteF(history->history[i]),
                  NULL);
     if (res != ResOK)
       return res;
@@ -151,7 +158,7 @@ void LDReset(mps_ld_t ld, Arena arena)
   if (b)
     ShieldExpose(arena, seg);   /* .ld.access */
   ld->_epoch = ArenaHistory(arena)->epoch;
-  ld->_rs = RefSetEMPTY;
+  ld->_rs = ZoneSetFold(RefSetEMPTY);
   if (b)
     ShieldCover(arena, seg);
 }
@@ -190,7 +197,8 @@ void LDAdd(mps_ld_t ld, Arena arena, Addr addr)
   AVER(TESTT(Arena, arena)); /* see .add.lock-free */
   AVER(ld->_epoch <= ArenaHistory(arena)->epoch);
 
-  ld->_rs = RefSetAdd(arena, ld->_rs, addr);
+  ld->_rs = RefSetUnion(ld->_rs,
+                       ZoneSetFold(RefSetAdd(arena, RefSetEMPTY, addr)));
 }
 
 
@@ -237,7 +245,7 @@ Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
     rs = history->prehistory;     /* .stale.old */
   }
 
-  return RefSetInter(ld->_rs, rs) != RefSetEMPTY;
+  return RefSetInter(ld->_rs, ZoneSetFold(rs)) != RefSetEMPTY; /* .fold */
 }
 
 
@@ -88,6 +88,17 @@ extern Bool LockCheck(Lock lock);
 extern Bool LockIsHeld(Lock lock);
 
 
+/* LockContentions -- number of claims that had to wait
+ *
+ * Returns the number of times a claim on the lock found it owned by
+ * another thread and had to wait for it to be released.  This is
+ * only a statistic, and is zero on platforms that can't measure it.
+ * It is exact only if the caller holds the lock.
+ */
+
+extern Count LockContentions(Lock lock);
+
+
 /*  == Global locks == */
 
 
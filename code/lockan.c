@@ -20,6 +20,7 @@ SRCID(lockan, "$Id$");
 typedef struct LockStruct {     /* ANSI fake lock structure */
   Sig sig;                      /* <design/sig> */
   unsigned long claims;         /* # claims held by owner */
+  Count contentions;            /* # claims that had to wait; always 0 */
 } LockStruct;
 
 
@@ -39,6 +40,7 @@ void (LockInit)(Lock lock)
 {
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->contentions = 0;
   lock->sig = LockSig;
   AVERT(Lock, lock);
 }
@@ -85,6 +87,12 @@ Bool (LockIsHeld)(Lock lock)
   return lock->claims > 0;
 }
 
+Count (LockContentions)(Lock lock)
+{
+  AVERT(Lock, lock);
+  return lock->contentions;
+}
+
 
 /* Global locking is performed by normal locks.
  * A separate lock structure is used for recursive and
@@ -94,11 +102,13 @@ Bool (LockIsHeld)(Lock lock)
 
 static LockStruct globalLockStruct = {
   LockSig,
+  0,
   0
 };
 
 static LockStruct globalRecursiveLockStruct = {
   LockSig,
+  0,
   0
 };
 
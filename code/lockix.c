@@ -53,6 +53,7 @@ SRCID(lockix, "$Id$");
 typedef struct LockStruct {
   Sig sig;                      /* <design/sig> */
   unsigned long claims;         /* # claims held by owner */
+  Count contentions;            /* # claims that had to wait */
   pthread_mutex_t mut;          /* the mutex itself */
 } LockStruct;
 
@@ -85,6 +86,7 @@ void (LockInit)(Lock lock)
 
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->contentions = 0;
   res = pthread_mutexattr_init(&attr);
   AVER(res == 0);
   res = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
@@ -121,9 +123,17 @@ void (LockClaim)(Lock lock)
 
   AVERT(Lock, lock);
 
-  res = pthread_mutex_lock(&lock->mut);
-  /* pthread_mutex_lock will error if we own the lock already. */
-  AVER(res == 0); /* <design/check/#.common> */
+  /* .contention: Try the mutex first so that we can count the claims
+     that have to wait.  The count is only updated once the mutex is
+     owned. */
+  res = pthread_mutex_trylock(&lock->mut);
+  if (res == EBUSY) {
+    res = pthread_mutex_lock(&lock->mut);
+    /* pthread_mutex_lock will error if we own the lock already. */
+    AVER(res == 0); /* <design/check/#.common> */
+    ++lock->contentions;
+  }
+  AVER(res == 0);
 
   /* This should be the first claim.  Now we own the mutex */
   /* it is ok to check this. */
@@ -155,7 +165,13 @@ void (LockClaimRecursive)(Lock lock)
 
   AVERT(Lock, lock);
 
-  res = pthread_mutex_lock(&lock->mut);
+  /* See .contention. */
+  res = pthread_mutex_trylock(&lock->mut);
+  if (res == EBUSY) {
+    res = pthread_mutex_lock(&lock->mut);
+    if (res == 0)
+      ++lock->contentions;
+  }
   /* pthread_mutex_lock will return: */
   /*     0 if we have just claimed the lock */
   /*     EDEADLK if we own the lock already. */
@@ -184,6 +200,15 @@ void (LockReleaseRecursive)(Lock lock)
 }
 
 
+/* LockContentions -- number of claims that had to wait */
+
+Count (LockContentions)(Lock lock)
+{
+  AVERT(Lock, lock);
+  return lock->contentions;
+}
+
+
 /* LockIsHeld -- test whether lock is held */
 
 Bool (LockIsHeld)(Lock lock)
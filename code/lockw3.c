@@ -37,6 +37,7 @@ SRCID(lockw3, "$Id$");
 typedef struct LockStruct {
   Sig sig;                      /* <design/sig> */
   unsigned long claims;         /* # claims held by the owning thread */
+  Count contentions;            /* # claims that had to wait */
   CRITICAL_SECTION cs;          /* Win32's recursive lock thing */
 } LockStruct;
 
@@ -56,6 +57,7 @@ void (LockInit)(Lock lock)
 {
   AVER(lock != NULL);
   lock->claims = 0;
+  lock->contentions = 0;
   InitializeCriticalSection(&lock->cs);
   lock->sig = LockSig;
   AVERT(Lock, lock);
@@ -73,7 +75,12 @@ void (LockFinish)(Lock lock)
 void (LockClaim)(Lock lock)
 {
   AVERT(Lock, lock);
-  EnterCriticalSection(&lock->cs);
+  /* .contention: Try the critical section first so that we can count
+     the claims that have to wait. */
+  if (!TryEnterCriticalSection(&lock->cs)) {
+    EnterCriticalSection(&lock->cs);
+    ++lock->contentions;
+  }
   /* This should be the first claim.  Now we are inside the
    * critical section it is ok to check this. */
   AVER(lock->claims == 0); /* <design/check/#.common> */
@@ -91,7 +98,11 @@ void (LockRelease)(Lock lock)
 void (LockClaimRecursive)(Lock lock)
 {
   AVERT(Lock, lock);
-  EnterCriticalSection(&lock->cs);
+  /* See .contention.  A recursive claim by the owner never waits. */
+  if (!TryEnterCriticalSection(&lock->cs)) {
+    EnterCriticalSection(&lock->cs);
+    ++lock->contentions;
+  }
   ++lock->claims;
   AVER(lock->claims > 0);
 }
@@ -104,6 +115,12 @@ void (LockReleaseRecursive)(Lock lock)
   LeaveCriticalSection(&lock->cs);
 }
 
+Count (LockContentions)(Lock lock)
+{
+  AVERT(Lock, lock);
+  return lock->contentions;
+}
+
 Bool (LockIsHeld)(Lock lock)
 {
   if (TryEnterCriticalSection(&lock->cs)) {
@@ -92,8 +92,8 @@ Res LocusPrefDescribe(LocusPref pref, mps_lib_FILE *stream, Count depth)
   res = WriteF(stream, depth,
                "LocusPref $P {\n", (WriteFP)pref,
                "  high $S\n", WriteFYesNo(pref->high),
-               "  zones $B\n", (WriteFB)pref->zones,
-               "  avoid $B\n", (WriteFB)pref->avoid,
+               "  zones " ZoneSetFORMAT "\n", ZoneSetWriteF(pref->zones),
+               "  avoid " ZoneSetFORMAT "\n", ZoneSetWriteF(pref->avoid),
                "} LocusPref $P\n", (WriteFP)pref,
                NULL);
   return res;
@@ -307,7 +307,7 @@ Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth)
 
   res = WriteF(stream, depth,
                "GenDesc $P {\n", (WriteFP)gen,
-               "  zones $B\n", (WriteFB)gen->zones,
+               "  zones " ZoneSetFORMAT "\n", ZoneSetWriteF(gen->zones),
                "  capacity $U\n", (WriteFW)gen->capacity,
                "  mortality $D\n", (WriteFD)gen->mortality,
                "  activeTraces $B\n", (WriteFB)gen->activeTraces,
@@ -634,7 +634,7 @@ Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
     /* Tracking the whole zoneset for each generation gives more
      * understandable telemetry than just reporting the added
      * zones. */
-    EVENT3(GenZoneSet, arena, gen, moreZones);
+    EVENT3(GenZoneSet, arena, gen, ZoneSetFold(moreZones));
   }
 
   PoolGenAccountForAlloc(pgen, SegSize(seg));
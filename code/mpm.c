@@ -46,6 +46,12 @@ Bool MPMCheck(void)
   /* Check that there are enough bits in */
   /* a TraceSet to store all possible trace ids. */
   CHECKL(sizeof(TraceSet) * CHAR_BIT >= TraceLIMIT);
+  /* Check that zone sets have a bit for each zone, and that the */
+  /* scan state in mps.h has room for them.  See .zones.128 in */
+  /* <code/mpmtypes.h>. */
+  CHECKL(sizeof(ZoneSet) * CHAR_BIT == ZoneCOUNT);
+  CHECKL(sizeof(RefSet) == sizeof(ZoneSet));
+  CHECKL(sizeof(mps_ss_s) == sizeof(Word) * (1 + 2 * (ZoneCOUNT >> MPS_WORD_SHIFT)));
 
   CHECKL((SizeAlignUp(0, 2048) == 0));
   CHECKL(!SizeIsAligned(64, (unsigned) -1));
@@ -93,6 +99,7 @@ Bool MPMCheck(void)
   CHECKL(WB_DEFER_INIT  <= ((1ul << WB_DEFER_BITS) - 1));
   CHECKL(WB_DEFER_DELAY <= ((1ul << WB_DEFER_BITS) - 1));
   CHECKL(WB_DEFER_HIT   <= ((1ul << WB_DEFER_BITS) - 1));
+  CHECKL(RB_EAGER_HIT   <= ((1ul << RB_EAGER_BITS) - 1));
 
   return TRUE;
 }
@@ -229,8 +229,11 @@ extern Res PoolCreate(Pool *poolReturn, Arena arena, PoolClass klass,
                       ArgList args);
 extern void PoolDestroy(Pool pool);
 extern BufferClass PoolDefaultBufferClass(Pool pool);
+extern Res PoolLockCreate(Pool pool);
 extern Res PoolAlloc(Addr *pReturn, Pool pool, Size size);
 extern void (PoolFree)(Pool pool, Addr old, Size size);
+extern Bool PoolAllocFast(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolFreeFast(Pool pool, Addr old, Size size);
 extern PoolGen PoolSegPoolGen(Pool pool, Seg seg);
 extern Res PoolTraceBegin(Pool pool, Trace trace);
 extern void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p);
@@ -243,6 +246,8 @@ extern Res PoolNoAlloc(Addr *pReturn, Pool pool, Size size);
 extern Res PoolTrivAlloc(Addr *pReturn, Pool pool, Size size);
 extern void PoolNoFree(Pool pool, Addr old, Size size);
 extern void PoolTrivFree(Pool pool, Addr old, Size size);
+extern Bool PoolNoAllocFast(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolNoFreeFast(Pool pool, Addr old, Size size);
 extern PoolGen PoolNoSegPoolGen(Pool pool, Seg seg);
 extern Res PoolNoBufferFill(Addr *baseReturn, Addr *limitReturn,
                             Pool pool, Buffer buffer, Size size);
@@ -268,8 +273,32 @@ extern PoolDebugMixin PoolNoDebugMixin(Pool pool);
 extern BufferClass PoolNoBufferClass(void);
 extern Size PoolNoSize(Pool pool);
 
+/* PoolClaim, PoolRelease -- claim and release the pool lock, if any
+ *
+ * Pool locks are recursive, because some pool methods call generic
+ * pool functions on the same pool.  See <code/pool.c#.lock>.
+ */
+
+#define PoolClaim(pool) \
+  BEGIN \
+    if ((pool)->lock != NULL) \
+      LockClaimRecursive((pool)->lock); \
+  END
+
+#define PoolRelease(pool) \
+  BEGIN \
+    if ((pool)->lock != NULL) \
+      LockReleaseRecursive((pool)->lock); \
+  END
+
 /* See .critical.macros. */
-#define PoolFreeMacro(pool, old, size) Method(Pool, pool, free)(pool, old, size)
+#define PoolFreeMacro(pool, old, size) \
+  BEGIN \
+    Pool _freePool = (pool); \
+    PoolClaim(_freePool); \
+    Method(Pool, _freePool, free)(_freePool, old, size); \
+    PoolRelease(_freePool); \
+  END
 #if !defined(AVER_AND_CHECK_ALL)
 #define PoolFree(pool, old, size) PoolFreeMacro(pool, old, size)
 #endif /* !defined(AVER_AND_CHECK_ALL) */
@@ -357,11 +386,24 @@ extern RefSet ScanStateSummary(ScanState ss);
 
 /* See impl.h.mpmst.ss */
 #define ScanStateZoneShift(ss)             ((Shift)(ss)->ss_s._zs)
+#define ScanStateSetZoneShift(ss, shift)   ((void)((ss)->ss_s._zs = (shift)))
+#if defined(ZONES_128)
+#define ScanStateWhite(ss) \
+  ZoneSetOfWords((ss)->ss_s._w, (ss)->ss_s._w1)
+#define ScanStateUnfixedSummary(ss) \
+  ZoneSetOfWords((ss)->ss_s._ufs, (ss)->ss_s._ufs1)
+#define ScanStateSetWhite(ss, zs) \
+  ((void)((ss)->ss_s._w = ZoneSetLow(zs), \
+          (ss)->ss_s._w1 = ZoneSetHigh(zs)))
+#define ScanStateSetUnfixedSummary(ss, rs) \
+  ((void)((ss)->ss_s._ufs = ZoneSetLow(rs), \
+          (ss)->ss_s._ufs1 = ZoneSetHigh(rs)))
+#else
 #define ScanStateWhite(ss)                 ((ZoneSet)(ss)->ss_s._w)
 #define ScanStateUnfixedSummary(ss)        ((RefSet)(ss)->ss_s._ufs)
-#define ScanStateSetZoneShift(ss, shift)   ((void)((ss)->ss_s._zs = (shift)))
 #define ScanStateSetWhite(ss, zs)          ((void)((ss)->ss_s._w = (zs)))
 #define ScanStateSetUnfixedSummary(ss, rs) ((void)((ss)->ss_s._ufs = (rs)))
+#endif
 
 extern Bool TraceIdCheck(TraceId id);
 extern Bool TraceSetCheck(TraceSet ts);
@@ -380,9 +422,15 @@ extern Bool TracePoll(Work *workReturn, Bool *collectWorldReturn,
 
 extern Rank TraceRankForAccess(Arena arena, Seg seg);
 extern void TraceSegAccess(Arena arena, Seg seg, AccessSet mode);
+extern void TraceSegBlacken(Arena arena, Seg seg);
+extern void TraceSegReadHit(Seg seg);
+extern void TraceRootAccess(Arena arena, Root root);
 
 extern void TraceAdvance(Trace trace);
+extern void TraceHandshake(Thread thread);
+extern void TraceHandshakeCancel(Thread thread);
 extern Res TraceStartCollectAll(Trace *traceReturn, Arena arena, TraceStartWhy why);
+extern Res TraceStartCompact(Trace *traceReturn, Arena arena, TraceStartWhy why);
 extern Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth);
 
 /* traceanc.c -- Trace Ancillary */
@@ -406,7 +454,7 @@ extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
       Shift SCANzoneShift = ScanStateZoneShift(ss); \
       ZoneSet SCANwhite = ScanStateWhite(ss); \
       RefSet SCANsummary = ScanStateUnfixedSummary(ss); \
-      Word SCANt; \
+      ZoneSet SCANt; \
       mps_addr_t SCANref; \
       Res SCANres; \
       {
@@ -414,7 +462,7 @@ extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
 /* Equivalent to <code/mps.h> MPS_FIX1 */
 
 #define TRACE_FIX1(ss, ref) \
-  (SCANt = (Word)1 << ((Word)(ref) >> SCANzoneShift & (MPS_WORD_WIDTH-1)), \
+  (SCANt = (ZoneSet)1 << ((Word)(ref) >> SCANzoneShift & (ZoneCOUNT-1)), \
    SCANsummary |= SCANt, \
    (SCANwhite & SCANt) != 0)
 
@@ -448,6 +496,8 @@ extern void TraceIdMessagesDestroy(Arena arena, TraceId ti);
 extern Res TraceScanArea(ScanState ss, Word *base, Word *limit,
                          mps_area_scan_t scan_area,
                          void *closure);
+extern void TraceScanPart(TraceSet ts, Rank rank, Arena arena,
+                          Seg seg, Addr base, Addr limit);
 extern void TraceScanSingleRef(TraceSet ts, Rank rank, Arena arena,
                                Seg seg, Ref *refIO);
 
@@ -461,6 +511,7 @@ extern Bool ArenaClassCheck(ArenaClass klass);
 extern Bool ArenaCheck(Arena arena);
 extern Res ArenaCreate(Arena *arenaReturn, ArenaClass klass, ArgList args);
 extern void ArenaDestroy(Arena arena);
+extern Res ArenaReset(Arena arena);
 extern Res ArenaDescribe(Arena arena, mps_lib_FILE *stream, Count depth);
 extern Res ArenaDescribeTracts(Arena arena, mps_lib_FILE *stream, Count depth);
 extern Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context);
@@ -472,6 +523,7 @@ extern Res GlobalsInit(Globals arena);
 extern void GlobalsFinish(Globals arena);
 extern Res GlobalsCompleteCreate(Globals arenaGlobals);
 extern void GlobalsPrepareToDestroy(Globals arenaGlobals);
+extern Res GlobalsReset(Globals arenaGlobals);
 extern Res GlobalsDescribe(Globals arena, mps_lib_FILE *stream, Count depth);
 extern Ring GlobalsRememberedSummaryRing(Globals);
 extern void GlobalsArenaMap(void (*func)(Arena arena));
@@ -529,6 +581,8 @@ extern void ArenaExposeRemember(Globals globals, Bool remember);
 extern void ArenaRestoreProtection(Globals globals);
 extern Res ArenaStartCollect(Globals globals, TraceStartWhy why);
 extern Res ArenaCollect(Globals globals, TraceStartWhy why);
+extern Res ArenaEvacuate(Size *reclaimedReturn, Globals globals,
+                         TraceStartWhy why);
 extern Bool ArenaBusy(Arena arena);
 extern Bool ArenaHasAddr(Arena arena, Addr addr);
 extern void ArenaChunkInsert(Arena arena, Chunk chunk);
@@ -584,6 +638,8 @@ extern Res ArenaSetCommitLimit(Arena arena, Size limit);
 extern double ArenaPauseTime(Arena arena);
 extern void ArenaSetPauseTime(Arena arena, double pauseTime);
 extern Size ArenaNoPurgeSpare(Arena arena, Size size);
+extern Size ArenaNoPrefaultSpare(Arena arena, Size size);
+extern Size ArenaPrefault(Arena arena);
 extern Res ArenaNoGrow(Arena arena, LocusPref pref, Size size);
 
 extern Size ArenaAvail(Arena arena);
@@ -592,6 +648,7 @@ extern Size ArenaCollectable(Arena arena);
 extern Res ArenaExtend(Arena, Addr base, Size size);
 
 extern void ArenaCompact(Arena arena, Trace trace);
+extern void ArenaChunkEvacuate(Chunk chunk);
 
 extern Res ArenaFinalize(Arena arena, Ref obj);
 extern Res ArenaDefinalize(Arena arena, Ref obj);
@@ -601,6 +658,7 @@ extern Res ArenaAlloc(Addr *baseReturn, LocusPref pref,
 extern Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                               Bool high, Size size, Pool pool);
 extern void ArenaFree(Addr base, Size size, Pool pool);
+extern Bool ArenaZeroed(Arena arena, Addr base, Addr limit);
 
 extern Res ArenaNoExtend(Arena arena, Addr base, Size size);
 
@@ -613,6 +671,9 @@ extern Bool PolicyShouldCollectWorld(Arena arena, double availableTime,
                                      Clock now, Clock clocks_per_sec);
 extern Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
                              Arena arena, Bool collectWorldAllowed);
+extern Count PolicyEvacuateChunks(Arena arena);
+extern Bool PolicyShouldCompact(Arena arena, Clock now,
+                                Clock clocks_per_sec);
 extern Bool PolicyPoll(Arena arena);
 extern Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork);
 
@@ -698,6 +759,8 @@ extern Addr (SegLimit)(Seg seg);
 #define SegGrey(seg)            RVALUE((TraceSet)(seg)->grey)
 #define SegWhite(seg)           RVALUE((TraceSet)(seg)->white)
 #define SegNailed(seg)          RVALUE((TraceSet)(seg)->nailed)
+#define SegZeroed(seg)          RVALUE((Bool)(seg)->zeroed)
+#define SegPinned(seg)          RVALUE((seg)->pinCount > 0)
 #define SegPoolRing(seg)        (&(seg)->poolRing)
 #define SegOfPoolRing(node)     RING_ELT(Seg, poolRing, (node))
 #define SegOfGreyRing(node)     (&(RING_ELT(GCSeg, greyRing, (node)) \
@@ -709,6 +772,7 @@ extern Addr (SegLimit)(Seg seg);
 #define SegSetSM(seg, mode)     ((void)((seg)->sm = BS_BITFIELD(Access, (mode))))
 #define SegSetDepth(seg, d)     ((void)((seg)->depth = BITFIELD(unsigned, (d), ShieldDepthWIDTH)))
 #define SegSetNailed(seg, ts)   ((void)((seg)->nailed = BS_BITFIELD(Trace, (ts))))
+#define SegSetZeroed(seg, b)    ((void)((seg)->zeroed = BOOLOF(b)))
 
 
 /* Buffer Interface -- see <code/buffer.c> */
@@ -732,6 +796,7 @@ extern Res BufferReserve(Addr *pReturn, Buffer buffer, Size size);
    BufferFill(pReturn, buffer, size))
 
 extern Res BufferFill(Addr *pReturn, Buffer buffer, Size size);
+extern Size BufferFillSize(Buffer buffer, Size min, Size max);
 
 extern Bool BufferCommit(Buffer buffer, Addr p, Size size);
 /* macro equivalent for BufferCommit, keep in sync with <code/buffer.c> */
@@ -795,6 +860,14 @@ extern AllocPattern AllocPatternRamp(void);
 extern AllocPattern AllocPatternRampCollectAll(void);
 
 
+/* Thread-local Allocation Points -- see <code/tlap.c> */
+
+extern Buffer TLAPLookup(Pool pool);
+extern Res TLAPCreate(Buffer *bufferReturn, Pool pool);
+extern void TLAPPoolFinish(Pool pool);
+extern void TLAPThreadFinish(Thread thread);
+
+
 /* FindDelete -- see <code/land.c> */
 
 extern Bool FindDeleteCheck(FindDelete findDelete);
@@ -822,7 +895,7 @@ extern Bool RankSetCheck(RankSet rankSet);
 #define RankSetDel(rs, r)       BS_DEL(RankSet, (rs), (r))
 
 #define AddrZone(arena, addr) \
-  (((Word)(addr) >> (arena)->zoneShift) & (MPS_WORD_WIDTH - 1))
+  (((Word)(addr) >> (arena)->zoneShift) & (ZoneCOUNT - 1))
 
 #define RefSetUnion(rs1, rs2)   BS_UNION((rs1), (rs2))
 #define RefSetInter(rs1, rs2)   BS_INTER((rs1), (rs2))
@@ -850,6 +923,31 @@ extern Bool RankSetCheck(RankSet rankSet);
 #define ZoneSetComp(zs)        BS_COMP(zs)
 #define ZoneSetIsMember(zs, z) BS_IS_MEMBER(zs, z)
 
+/* ZoneSetFold -- fold a zone set into a word
+ *
+ * Zone z becomes bit z modulo MPS_WORD_WIDTH of the result.  This is a
+ * conservative approximation to the zone set for word-sized fields,
+ * such as the reference sets in location dependencies and telemetry.
+ *
+ * ZoneSetFORMAT and ZoneSetWriteF are the WriteF format and arguments
+ * for a zone set or reference set.  See .zones.128 in <code/mpmtypes.h>.
+ */
+
+#if defined(ZONES_128)
+#define ZoneSetLow(zs)         ((Word)(zs))
+#define ZoneSetHigh(zs)        ((Word)((zs) >> MPS_WORD_WIDTH))
+#define ZoneSetOfWords(low, high) \
+  (((ZoneSet)(high) << MPS_WORD_WIDTH) | (ZoneSet)(low))
+#define ZoneSetFold(zs)        (ZoneSetLow(zs) | ZoneSetHigh(zs))
+#define ZoneSetFORMAT          "$B$B"
+#define ZoneSetWriteF(zs) \
+  (WriteFB)ZoneSetHigh(zs), (WriteFB)ZoneSetLow(zs)
+#else
+#define ZoneSetFold(zs)        ((Word)(zs))
+#define ZoneSetFORMAT          "$B"
+#define ZoneSetWriteF(zs)      (WriteFB)(zs)
+#endif
+
 
 extern ZoneSet ZoneSetOfRange(Arena arena, Addr base, Addr limit);
 extern ZoneSet ZoneSetOfSeg(Arena arena, Seg seg);
@@ -946,21 +1044,43 @@ extern Res RootCreateFmt(Root *rootReturn, Arena arena,
 extern Res RootCreateFun(Root *rootReturn, Arena arena,
                         Rank rank, mps_root_scan_t scan,
                         void *p, size_t s);
+extern Res RootCreateThreadExact(Root *rootReturn, Arena arena,
+                                 Thread thread, mps_stack_scan_t scan,
+                                 void *closure, Word *stackCold);
+extern Res RootCreateStack(Root *rootReturn, Arena arena,
+                           Rank rank, RootMode mode, Word *cold,
+                           mps_area_scan_t scan_area, void *closure);
+extern void RootStackSuspend(Root root, Word *hot);
+extern void RootStackResume(Root root, Thread thread);
 extern void RootDestroy(Root root);
 extern Bool RootModeCheck(RootMode mode);
 extern Bool RootCheck(Root root);
 extern Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth);
 extern Res RootsDescribe(Globals arenaGlobals, mps_lib_FILE *stream, Count depth);
 extern Rank RootRank(Root root);
+extern Rank RootScanRank(Root root);
 extern AccessSet RootPM(Root root);
+extern Thread RootThread(Root root);
 extern RefSet RootSummary(Root root);
 extern void RootGrey(Root root, Trace trace);
 extern Res RootScan(ScanState ss, Root root);
+extern Bool RootParallelScannable(Root root, TraceSet ts);
+extern Res RootParallelScan(ScanState ss, Root root);
+extern void RootParallelScanned(ScanState ss, Root root);
 extern Arena RootArena(Root root);
 extern Bool RootOfAddr(Root *root, Arena arena, Addr addr);
-extern void RootAccess(Root root, AccessSet mode);
+extern void RootAccess(Root root, Addr addr, AccessSet mode);
+extern Bool RootDefer(Root root, TraceSet ts);
+extern void RootUndefer(Root root, TraceSet ts);
+extern Bool RootDeferred(Root root, TraceSet ts);
 typedef Res (*RootIterateFn)(Root root, void *p);
 extern Res RootsIterate(Globals arena, RootIterateFn f, void *p);
+extern Res ArenaPin(Arena arena, Addr addr);
+extern void ArenaUnpin(Arena arena, Addr addr);
+extern Count ArenaPinCount(Arena arena);
+extern Count ArenaPinCountRange(Arena arena, Addr base, Addr limit);
+extern void ArenaBlackenPins(Arena arena);
+extern Res ArenaScanPins(ScanState ss);
 
 
 /* Land Interface -- see <design/land> */
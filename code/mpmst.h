@@ -28,6 +28,7 @@
 #include "locus.h"
 #include "splay.h"
 #include "meter.h"
+#include "table.h"
 
 
 /* PoolClassStruct -- pool class structure
@@ -56,6 +57,8 @@ typedef struct mps_pool_class_s {
   PoolInitMethod init;          /* initialize the pool descriptor */
   PoolAllocMethod alloc;        /* allocate memory from pool */
   PoolFreeMethod free;          /* free memory to pool */
+  PoolAllocFastMethod allocFast; /* allocate without the arena lock */
+  PoolFreeFastMethod freeFast;  /* free without the arena lock */
   PoolSegPoolGenMethod segPoolGen; /* get pool generation of segment */
   PoolBufferFillMethod bufferFill;      /* out-of-line reserve */
   PoolBufferEmptyMethod bufferEmpty;    /* out-of-line commit */
@@ -93,9 +96,13 @@ typedef struct mps_pool_s {     /* generic structure */
   RingStruct bufferRing;        /* allocation buffers are attached to pool */
   Serial bufferSerial;          /* serial of next buffer */
   RingStruct segRing;           /* segs are attached to pool */
+  RingStruct sacRing;           /* SACs are attached to pool */
+  RingStruct tlapRing;          /* thread-local allocation points */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  Lock lock;                    /* pool lock or NULL, <code/pool.c#.lock> */
+  Size fastFillSize;            /* allocated under pool lock, not counted */
 } PoolStruct;
 
 
@@ -227,13 +234,16 @@ typedef struct SegStruct {      /* segment structure */
   Addr limit;                   /* limit of segment */
   unsigned depth : ShieldDepthWIDTH; /* see <design/shield#.def.depth> */
   BOOLFIELD(queued);            /* in shield queue? */
+  BOOLFIELD(zeroed);            /* memory untouched since mapped? */
   AccessSet pm : AccessLIMIT;   /* protection mode, <code/shield.c> */
   AccessSet sm : AccessLIMIT;   /* shield mode, <code/shield.c> */
   TraceSet grey : TraceLIMIT;   /* traces for which seg is grey */
   TraceSet white : TraceLIMIT;  /* traces for which seg is white */
+  Count pinCount;               /* pinned addresses in seg <code/root.c#.pin.seg> */
   TraceSet nailed : TraceLIMIT; /* traces for which seg has nailed objects */
   RankSet rankSet : RankLIMIT;  /* ranks of references in this seg */
   unsigned defer : WB_DEFER_BITS; /* defer write barrier for this many scans */
+  unsigned eager : RB_EAGER_BITS; /* scan at flip for this many flips */
 } SegStruct;
 
 
@@ -315,6 +325,7 @@ typedef struct BufferStruct {
   Arena arena;                  /* owning arena */
   Pool pool;                    /* owning pool */
   RingStruct poolRing;          /* buffers are attached to pools */
+  RingStruct flipRing;          /* <code/buffer.c#.flip.ring> */
   Bool isMutator;               /* TRUE iff buffer used by mutator */
   BufferMode mode;              /* Attached/Logged/Flipped/etc */
   double fillSize;              /* bytes filled in this buffer */
@@ -325,6 +336,8 @@ typedef struct BufferStruct {
   Addr poolLimit;               /* the pool's idea of the limit */
   Align alignment;              /* allocation alignment */
   unsigned rampCount;           /* see <code/buffer.c#ramp.hack> */
+  Size fillHint;                /* <code/buffer.c#.fill.adapt> */
+  Clock fillClock;              /* time of last BufferFillSize */
 } BufferStruct;
 
 
@@ -442,6 +455,8 @@ typedef struct TraceStruct {
   Size notCondemned;            /* collectable but not condemned */
   Size foundation;              /* initial grey set size */
   Work quantumWork;             /* tracing work to be done in each poll */
+  Count handshakes;             /* threads awaiting handshake */
+  Bool rootsDeferred;           /* roots may be grey after flip? */
   STATISTIC_DECL(Count greySegCount) /* number of grey segments */
   STATISTIC_DECL(Count greySegMax) /* maximum number of grey segments */
   STATISTIC_DECL(Count rootScanCount) /* number of roots scanned */
@@ -457,6 +472,7 @@ typedef struct TraceStruct {
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segments */
   STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
   STATISTIC_DECL(Count nailCount) /* segments nailed by ambiguous refs */
+  STATISTIC_DECL(Count pinCount) /* pinned objects fixed at flip */
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objects */
   STATISTIC_DECL(Count readBarrierHitCount) /* read barrier faults */
   STATISTIC_DECL(Count pointlessScanCount) /* pointless segment scans */
@@ -481,6 +497,7 @@ typedef struct mps_arena_class_s {
   ArenaCreateMethod create;
   ArenaDestroyMethod destroy;
   ArenaPurgeSpareMethod purgeSpare;
+  ArenaPrefaultSpareMethod prefaultSpare;
   ArenaExtendMethod extend;
   ArenaGrowMethod grow;
   ArenaFreeMethod free;
@@ -524,6 +541,7 @@ typedef struct GlobalsStruct {
 
   /* buffer fields <code/buffer.c> */
   Bool bufferLogging;           /* <design/buffer#.logging.control> */
+  RingStruct bufferRing;        /* buffers to flip <code/buffer.c#.flip.ring> */
 
   /* pool fields <code/pool.c> */
   RingStruct poolRing;          /* ring of pools in arena */
@@ -753,6 +771,7 @@ typedef struct mps_arena_s {
 
   Size spareCommitted;          /* amount of memory in hysteresis fund */
   double spare;                 /* maximum spareCommitted/committed */
+  Size prefaultSize;            /* spare memory to keep hot */
   double pauseTime;             /* maximum pause time, in seconds */
 
   Shift zoneShift;              /* see also <code/ref.c> */
@@ -765,6 +784,7 @@ typedef struct mps_arena_s {
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
   Serial chunkSerial;           /* next chunk number */
+  Count evacuatingChunks;       /* chunks with evacuating set */
 
   Bool hasFreeLand;              /* Is freeLand available? */
   MFSStruct freeCBSBlockPoolStruct;
@@ -793,8 +813,18 @@ typedef struct mps_arena_s {
   RingStruct threadRing;        /* ring of attached threads */
   RingStruct deadRing;          /* ring of dead threads */
   Serial threadSerial;          /* serial of next thread */
+  ThreadLocal threadLocal;      /* thread-local APs <code/tlap.c> */
+  Count scanWorkerCount;        /* worker threads requested */
+  ThreadWorkers scanWorkers;    /* flip workers, or NULL <code/trace.c> */
+  Bool handshake;               /* flip by handshakes? <code/trace.c> */
 
   ShieldStruct shieldStruct;
+
+  /* barrier fault fields <code/global.c#.access> */
+  Count accessCount;            /* faults handled in this arena */
+  Count accessCoalesced;        /* faults whose protection had gone */
+  Count accessAvoided;          /* segments scanned at flip, not faulted */
+  EventClock accessLatencyMax;  /* longest fault so far */
   
   /* trace fields <code/trace.c> */
   TraceSet busyTraces;          /* set of running traces */
@@ -805,11 +835,15 @@ typedef struct mps_arena_s {
   /* trace ancillary fields <code/traceanc.c> */
   TraceStartMessage tsMessage[TraceLIMIT];  /* <design/message-gc> */
   TraceMessage tMessage[TraceLIMIT];  /* <design/message-gc> */
+  STATISTIC_DECL(Count fixRefCount) /* refs which passed zone check */
+  STATISTIC_DECL(Count whiteSegRefCount) /* refs which referred to white segs */
 
   /* policy fields */
   double tracedWork;
   double tracedTime;
   Clock lastWorldCollect;
+  Size compactReserved;         /* reserved after last compaction */
+  Clock lastCompactCheck;       /* time of last PolicyShouldCompact check */
 
   RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
   RingStruct chainRing;         /* ring of chains */
@@ -822,6 +856,9 @@ typedef struct mps_arena_s {
   void *stackWarm;               /* NULL or stack pointer warmer than
                                     mutator state. */
 
+  Table pinTable;               /* NULL or pinned objects <code/root.c#.pin.table> */
+  Bool pinsGrey;                /* pinned segs may be grey? <code/root.c#.pin.barrier> */
+
   Sig sig;
 } ArenaStruct;
 
@@ -51,8 +51,29 @@ typedef mps_arg_s *Arg;
 typedef mps_arg_s *ArgList;
 typedef mps_key_t Key;
 
+
+/* .zones.128: With ZONES_128 (see <code/config.h>), reference sets and
+ * zone sets are 128-bit integers, so that the bit set operations in
+ * <code/misc.h> still apply.  Their alignment is reduced to that of a
+ * word, so that they don't impose stricter alignment on the structures
+ * that contain them than the MPS allocators provide. */
+
+#if defined(ZONES_128)
+#if !defined(__SIZEOF_INT128__) || MPS_WORD_WIDTH != 64
+#error "ZONES_128 requires a 64-bit platform with a 128-bit integer type"
+#endif
+__extension__ typedef unsigned __int128 ZoneBits
+  __attribute__((__aligned__(sizeof(Word))));
+typedef ZoneBits RefSet;                /* <design/collection#.refsets> */
+typedef ZoneBits ZoneSet;               /* <design/collection#.refsets> */
+#define ZoneSHIFT       ((Shift)(MPS_WORD_SHIFT + 1))
+#else
 typedef Word RefSet;                    /* <design/collection#.refsets> */
 typedef Word ZoneSet;                   /* <design/collection#.refsets> */
+#define ZoneSHIFT       ((Shift)MPS_WORD_SHIFT)
+#endif
+#define ZoneCOUNT       ((Count)1 << ZoneSHIFT)
+
 typedef unsigned Rank;                  /* <design/type#.rank> */
 typedef unsigned RankSet;               /* <design/type#.rankset> */
 typedef unsigned RootMode;              /* <design/type#.rootmode> */
@@ -95,6 +116,8 @@ typedef struct GlobalsStruct *Globals;  /* <design/arena> */
 typedef struct VMStruct *VM;            /* <code/vm.c>* */
 typedef struct RootStruct *Root;        /* <code/root.c> */
 typedef struct mps_thr_s *Thread;       /* <code/th.c>* */
+typedef struct ThreadWorkersStruct *ThreadWorkers; /* <code/th.h> */
+typedef struct ThreadLocalStruct *ThreadLocal; /* <code/th.h> */
 typedef struct MutatorContextStruct *MutatorContext; /* <design/prmc> */
 typedef struct PoolDebugMixinStruct *PoolDebugMixin;
 typedef struct AllocPatternStruct *AllocPattern;
@@ -117,6 +140,7 @@ typedef Res (*ArenaCreateMethod)(Arena *arenaReturn, ArgList args);
 typedef void (*ArenaDestroyMethod)(Arena arena);
 typedef Res (*ArenaInitMethod)(Arena arena, Size grainSize, ArgList args);
 typedef Size (*ArenaPurgeSpareMethod)(Arena arena, Size size);
+typedef Size (*ArenaPrefaultSpareMethod)(Arena arena, Size size);
 typedef Res (*ArenaExtendMethod)(Arena arena, Addr base, Size size);
 typedef Res (*ArenaGrowMethod)(Arena arena, LocusPref pref, Size size);
 typedef void (*ArenaFreeMethod)(Addr base, Size size, Pool pool);
@@ -150,6 +174,11 @@ typedef void (*FormattedObjectsVisitor)(Addr obj, Format fmt, Pool pool,
 typedef void (*FreeBlockVisitor)(Addr base, Addr limit, Pool pool, void *p);
 
 
+/* Worker threads -- see <code/th.h> */
+
+typedef void (*ThreadWorkersFunction)(void *closure, Index i);
+
+
 /* Seg*Method -- see <design/seg> */
 
 typedef Res (*SegInitMethod)(Seg seg, Pool pool, Addr base, Size size,
@@ -204,6 +233,8 @@ typedef void (*PoolVarargsMethod)(ArgStruct args[], va_list varargs);
 typedef Res (*PoolInitMethod)(Pool pool, Arena arena, PoolClass klass, ArgList args);
 typedef Res (*PoolAllocMethod)(Addr *pReturn, Pool pool, Size size);
 typedef void (*PoolFreeMethod)(Pool pool, Addr old, Size size);
+typedef Bool (*PoolAllocFastMethod)(Addr *pReturn, Pool pool, Size size);
+typedef Bool (*PoolFreeFastMethod)(Pool pool, Addr old, Size size);
 typedef PoolGen (*PoolSegPoolGenMethod)(Pool pool, Seg seg);
 typedef Res (*PoolBufferFillMethod)(Addr *baseReturn, Addr *limitReturn,
                                     Pool pool, Buffer buffer, Size size);
@@ -298,6 +329,7 @@ enum {
 #define BufferModeFLIPPED       ((BufferMode)(1<<1))
 #define BufferModeLOGGED        ((BufferMode)(1<<2))
 #define BufferModeTRANSITION    ((BufferMode)(1<<3))
+#define BufferModeZEROED        ((BufferMode)(1<<4))
 
 
 /* Rank constants -- see <design/type#.rank> */
@@ -323,6 +355,7 @@ enum {
 #define RootModeCONSTANT          ((RootMode)1<<0)
 #define RootModePROTECTABLE       ((RootMode)1<<1)
 #define RootModePROTECTABLE_INNER ((RootMode)1<<2)
+#define RootModeINCREMENTAL       ((RootMode)1<<3)
 
 
 /* Root Variants -- see <design/type#.rootvar>
@@ -336,7 +369,9 @@ enum {
   RootAREA_TAGGED,
   RootTHREAD,
   RootTHREAD_TAGGED,
+  RootTHREAD_EXACT,
   RootFMT,
+  RootSTACK,
   RootLIMIT
 };
 
@@ -379,7 +414,12 @@ enum {
     "Client requests: immediate full collection.")                      \
   X(WALK, "walk", "Walking all live objects.")                          \
   X(EXTENSION, "extension", \
-    "Extension: an MPS extension started the trace.")
+    "Extension: an MPS extension started the trace.")                   \
+  X(COMPACTION, "compaction",                                           \
+    "Compaction: client has idle time, and the arena has grown and "    \
+    "has sparsely occupied chunks, so evacuate them.")                  \
+  X(CLIENTCOMPACT, "client compaction",                                 \
+    "Client requests: evacuate sparsely occupied chunks now.")
 
 enum {
 #define X(WHY, SHORT, LONG) TraceStartWhy ## WHY,
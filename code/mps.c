@@ -40,6 +40,7 @@
 #include "tract.c"
 #include "walk.c"
 #include "protocol.c"
+#include "protsh.c"
 #include "pool.c"
 #include "poolabs.c"
 #include "trace.c"
@@ -56,6 +57,7 @@
 #include "ld.c"
 #include "event.c"
 #include "sac.c"
+#include "tlap.c"
 #include "message.c"
 #include "poolmrg.c"
 #include "poolmfs.c"
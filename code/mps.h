@@ -110,6 +110,7 @@ typedef struct mps_scan_tag_s {
 
 typedef mps_res_t (*mps_root_scan_t)(mps_ss_t, void *, size_t);
 typedef mps_res_t (*mps_area_scan_t)(mps_ss_t, void *, void *, void *);
+typedef mps_res_t (*mps_stack_scan_t)(mps_ss_t, void *, void *, void *);
 typedef mps_res_t (*mps_fmt_scan_t)(mps_ss_t, mps_addr_t, mps_addr_t);
 typedef mps_res_t (*mps_reg_scan_t)(mps_ss_t, mps_thr_t,
                                     void *, size_t);
@@ -183,6 +184,9 @@ extern const struct mps_key_s _mps_key_GEN;
 extern const struct mps_key_s _mps_key_RANK;
 #define MPS_KEY_RANK            (&_mps_key_RANK)
 #define MPS_KEY_RANK_FIELD      rank
+extern const struct mps_key_s _mps_key_AP_ZEROED;
+#define MPS_KEY_AP_ZEROED       (&_mps_key_AP_ZEROED)
+#define MPS_KEY_AP_ZEROED_FIELD b
 extern const struct mps_key_s _mps_key_COMMIT_LIMIT;
 #define MPS_KEY_COMMIT_LIMIT (&_mps_key_COMMIT_LIMIT)
 #define MPS_KEY_COMMIT_LIMIT_FIELD size
@@ -221,6 +225,22 @@ extern const struct mps_key_s _mps_key_INTERIOR;
 extern const struct mps_key_s _mps_key_VMW3_TOP_DOWN;
 #define MPS_KEY_VMW3_TOP_DOWN   (&_mps_key_VMW3_TOP_DOWN)
 #define MPS_KEY_VMW3_TOP_DOWN_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_PREFAULT;
+#define MPS_KEY_ARENA_PREFAULT  (&_mps_key_ARENA_PREFAULT)
+#define MPS_KEY_ARENA_PREFAULT_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_PREFAULT_SIZE;
+#define MPS_KEY_ARENA_PREFAULT_SIZE (&_mps_key_ARENA_PREFAULT_SIZE)
+#define MPS_KEY_ARENA_PREFAULT_SIZE_FIELD size
+extern const struct mps_key_s _mps_key_ARENA_SCAN_WORKERS;
+#define MPS_KEY_ARENA_SCAN_WORKERS (&_mps_key_ARENA_SCAN_WORKERS)
+#define MPS_KEY_ARENA_SCAN_WORKERS_FIELD count
+extern const struct mps_key_s _mps_key_ARENA_HANDSHAKE;
+#define MPS_KEY_ARENA_HANDSHAKE (&_mps_key_ARENA_HANDSHAKE)
+#define MPS_KEY_ARENA_HANDSHAKE_FIELD b
+
+extern const struct mps_key_s _mps_key_THREAD_SAFEPOINT;
+#define MPS_KEY_THREAD_SAFEPOINT (&_mps_key_THREAD_SAFEPOINT)
+#define MPS_KEY_THREAD_SAFEPOINT_FIELD b
 
 extern const struct mps_key_s _mps_key_FMT_ALIGN;
 #define MPS_KEY_FMT_ALIGN   (&_mps_key_FMT_ALIGN)
@@ -313,6 +333,7 @@ extern mps_rank_t mps_rank_weak(void);
 #define MPS_RM_CONST      (((mps_rm_t)1<<0))
 #define MPS_RM_PROT       (((mps_rm_t)1<<1))
 #define MPS_RM_PROT_INNER (((mps_rm_t)1<<1))
+#define MPS_RM_INCREMENTAL (((mps_rm_t)1<<3))
 
 
 /* Allocation Point */
@@ -353,6 +374,15 @@ typedef struct mps_sac_class_s {
 
 #define mps_sac_classes_s mps_sac_class_s
 
+/* .sacs: Keep in sync with <code/sac.h>. */
+typedef struct mps_sac_stats_s {
+  size_t mps_block_size;
+  size_t mps_cached_count;
+  size_t mps_cached_size;
+  size_t mps_hits;
+  size_t mps_misses;
+} mps_sac_stats_s;
+
 
 /* Location Dependency */
 /* .ld: Keep in sync with <code/mpmst.h#ld.struct>. */
@@ -364,10 +394,19 @@ typedef struct mps_ld_s {       /* location dependency descriptor */
 
 /* Scan State */
 /* .ss: See also <code/mpmst.h#ss>. */
+/* .ss.zones-128: If the MPS is built with CONFIG_ZONES_128, the white
+ * set and unfixed summary are two words each, and client code must be
+ * compiled with CONFIG_ZONES_128 too. */
 
+#if defined(CONFIG_ZONES_128)
+typedef struct mps_ss_s {
+  mps_word_t _zs, _w, _ufs, _w1, _ufs1;
+} mps_ss_s;
+#else
 typedef struct mps_ss_s {
   mps_word_t _zs, _w, _ufs;
 } mps_ss_s;
+#endif
 
 
 /* Format Variants */
@@ -441,6 +480,7 @@ extern void mps_arena_unsafe_expose_remember_protection(mps_arena_t);
 extern void mps_arena_unsafe_restore_protection(mps_arena_t);
 extern mps_res_t mps_arena_start_collect(mps_arena_t);
 extern mps_res_t mps_arena_collect(mps_arena_t);
+extern mps_res_t mps_arena_compact(mps_arena_t, size_t *);
 extern mps_bool_t mps_arena_step(mps_arena_t, double, double);
 
 extern mps_res_t mps_arena_create(mps_arena_t *, mps_arena_class_t, ...);
@@ -448,6 +488,7 @@ extern mps_res_t mps_arena_create_v(mps_arena_t *, mps_arena_class_t, va_list);
 extern mps_res_t mps_arena_create_k(mps_arena_t *, mps_arena_class_t,
                                     mps_arg_s []);
 extern void mps_arena_destroy(mps_arena_t);
+extern mps_res_t mps_arena_reset(mps_arena_t);
 
 extern size_t mps_arena_reserved(mps_arena_t);
 extern size_t mps_arena_committed(mps_arena_t);
@@ -532,6 +573,12 @@ extern void mps_ap_destroy(mps_ap_t);
 
 extern mps_res_t (mps_reserve)(mps_addr_t *, mps_ap_t, size_t);
 extern mps_bool_t (mps_commit)(mps_ap_t, mps_addr_t, size_t);
+extern mps_res_t mps_reserve_many(mps_addr_t *, mps_ap_t, size_t, size_t);
+extern mps_bool_t mps_commit_many(mps_ap_t, mps_addr_t *, size_t, size_t);
+
+extern mps_res_t mps_tl_ap(mps_ap_t *, mps_pool_t);
+extern mps_res_t mps_tl_reserve(mps_addr_t *, mps_pool_t, size_t);
+extern mps_bool_t mps_tl_commit(mps_pool_t, mps_addr_t, size_t);
 
 extern mps_res_t mps_ap_fill(mps_addr_t *, mps_ap_t, size_t);
 
@@ -556,10 +603,12 @@ extern mps_res_t mps_ap_alloc_pattern_reset(mps_ap_t);
 
 extern mps_res_t mps_sac_create(mps_sac_t *, mps_pool_t, size_t,
                                 mps_sac_classes_s *);
+extern mps_res_t mps_sac_create_adaptive(mps_sac_t *, mps_pool_t, size_t);
 extern void mps_sac_destroy(mps_sac_t);
 extern mps_res_t mps_sac_alloc(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
 extern void mps_sac_free(mps_sac_t, mps_addr_t, size_t);
 extern void mps_sac_flush(mps_sac_t);
+extern size_t mps_sac_stats(mps_sac_t, size_t, mps_sac_stats_s *);
 
 /* Direct access to mps_sac_fill and mps_sac_empty is not supported. */
 extern mps_res_t mps_sac_fill(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
@@ -705,19 +754,38 @@ extern mps_res_t mps_root_create_thread_tagged(mps_root_t *, mps_arena_t,
                                                mps_area_scan_t,
                                                mps_word_t, mps_word_t,
                                                void *);
+extern mps_res_t mps_root_create_thread_exact(mps_root_t *, mps_arena_t,
+                                              mps_thr_t, mps_stack_scan_t,
+                                              void *, void *);
+extern mps_res_t mps_root_create_stack(mps_root_t *, mps_arena_t,
+                                       mps_rank_t, mps_rm_t,
+                                       mps_area_scan_t, void *,
+                                       void *);
+extern void mps_root_stack_suspend(mps_root_t, void *);
+extern void mps_root_stack_resume(mps_root_t, mps_thr_t);
 extern void mps_root_destroy(mps_root_t);
 
 extern mps_res_t mps_stack_scan_ambig(mps_ss_t, mps_thr_t,
                                       void *, size_t);
 
 
+/* Pinning */
+
+extern mps_res_t mps_pin(mps_arena_t, mps_addr_t);
+extern void mps_unpin(mps_arena_t, mps_addr_t);
+
+
 /* Protection Trampoline and Thread Registration */
 
 typedef void *(*mps_tramp_t)(void *, size_t);
 extern void (mps_tramp)(void **, mps_tramp_t, void *, size_t);
 
 extern mps_res_t mps_thread_reg(mps_thr_t *, mps_arena_t);
+extern mps_res_t mps_thread_reg_k(mps_thr_t *, mps_arena_t, mps_arg_s []);
 extern void mps_thread_dereg(mps_thr_t);
+extern void mps_thread_safepoint(mps_thr_t);
+extern void mps_thread_call_native(void **, mps_thr_t, mps_tramp_t,
+                                   void *, size_t);
 
 
 /* Location Dependency */
@@ -825,6 +893,32 @@ extern mps_res_t mps_scan_area_tagged_or_zero(mps_ss_t, void *, void *, void *);
 
 extern mps_res_t mps_fix(mps_ss_t, mps_addr_t *);
 
+#if defined(CONFIG_ZONES_128)
+
+/* .fix1.zones-128: The zone of the reference selects a bit in one of
+ * two words of the white set and unfixed summary.  _mps_wm is all ones
+ * if it's the second word and zero if it's the first, so that the test
+ * doesn't branch. */
+
+#define MPS_SCAN_BEGIN(ss) \
+  MPS_BEGIN \
+    mps_ss_t _ss = (ss); \
+    mps_word_t _mps_zs = (_ss)->_zs; \
+    mps_word_t _mps_w = (_ss)->_w, _mps_w1 = (_ss)->_w1; \
+    mps_word_t _mps_ufs = (_ss)->_ufs, _mps_ufs1 = (_ss)->_ufs1; \
+    mps_word_t _mps_wt, _mps_wm; \
+    {
+
+#define MPS_FIX1(ss, ref) \
+  (_mps_wm = (mps_word_t)(ref) >> _mps_zs, \
+   _mps_wt = (mps_word_t)1 << (_mps_wm & (sizeof(mps_word_t) * CHAR_BIT - 1)), \
+   _mps_wm = (mps_word_t)0 - (_mps_wm / (sizeof(mps_word_t) * CHAR_BIT) & 1), \
+   _mps_ufs |= _mps_wt & ~_mps_wm, \
+   _mps_ufs1 |= _mps_wt & _mps_wm, \
+   (((_mps_w & ~_mps_wm) | (_mps_w1 & _mps_wm)) & _mps_wt) != 0)
+
+#else /* CONFIG_ZONES_128 */
+
 #define MPS_SCAN_BEGIN(ss) \
   MPS_BEGIN \
     mps_ss_t _ss = (ss); \
@@ -840,6 +934,8 @@ extern mps_res_t mps_fix(mps_ss_t, mps_addr_t *);
    _mps_ufs |= _mps_wt, \
    (_mps_w & _mps_wt) != 0)
 
+#endif /* CONFIG_ZONES_128 */
+
 extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
 #define MPS_FIX2(ss, ref_io) _mps_fix2(ss, ref_io)
 
@@ -850,6 +946,21 @@ extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
 /* MPS_FIX is deprecated */
 #define MPS_FIX(ss, ref_io) MPS_FIX12(ss, ref_io)
 
+#if defined(CONFIG_ZONES_128)
+
+#define MPS_FIX_CALL(ss, call) \
+  MPS_BEGIN \
+    (call); _mps_ufs |= (ss)->_ufs; _mps_ufs1 |= (ss)->_ufs1; \
+  MPS_END
+
+#define MPS_SCAN_END(ss) \
+   } \
+   (ss)->_ufs = _mps_ufs; \
+   (ss)->_ufs1 = _mps_ufs1; \
+  MPS_END
+
+#else /* CONFIG_ZONES_128 */
+
 #define MPS_FIX_CALL(ss, call) \
   MPS_BEGIN \
     (call); _mps_ufs |= (ss)->_ufs; \
@@ -860,6 +971,8 @@ extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
    (ss)->_ufs = _mps_ufs; \
   MPS_END
 
+#endif /* CONFIG_ZONES_128 */
+
 
 #endif /* mps_h */
 
@@ -338,6 +338,22 @@ mps_res_t mps_arena_collect(mps_arena_t arena)
   return (mps_res_t)res;
 }
 
+mps_res_t mps_arena_compact(mps_arena_t arena, size_t *reclaimed_o)
+{
+  Res res;
+  Size reclaimed = 0;
+  AVER(reclaimed_o != NULL);
+  ArenaEnter(arena);
+  STACK_CONTEXT_BEGIN(arena) {
+    res = ArenaEvacuate(&reclaimed, ArenaGlobals(arena),
+                        TraceStartWhyCLIENTCOMPACT);
+  } STACK_CONTEXT_END(arena);
+  ArenaLeave(arena);
+  if (res == ResOK)
+    *reclaimed_o = (size_t)reclaimed;
+  return (mps_res_t)res;
+}
+
 mps_bool_t mps_arena_step(mps_arena_t arena,
                           double interval,
                           double multiplier)
@@ -413,6 +429,18 @@ void mps_arena_destroy(mps_arena_t arena)
 }
 
 
+/* mps_arena_reset -- return an arena to its state after creation */
+
+mps_res_t mps_arena_reset(mps_arena_t arena)
+{
+  Res res;
+  ArenaEnter(arena);
+  res = ArenaReset(arena);
+  ArenaLeave(arena);
+  return (mps_res_t)res;
+}
+
+
 /* mps_arena_busy -- is the arena part way through an operation? */
 
 mps_bool_t mps_arena_busy(mps_arena_t arena)
@@ -731,6 +759,11 @@ mps_res_t mps_pool_create_k(mps_pool_t *mps_pool_o, mps_arena_t arena,
   AVERT(ArgList, args);
 
   res = PoolCreate(&pool, arena, pool_class, args);
+  if (res == ResOK) {
+    res = PoolLockCreate(pool);
+    if (res != ResOK)
+      PoolDestroy(pool);
+  }
 
   ArenaLeave(arena);
 
@@ -781,7 +814,8 @@ size_t mps_pool_free_size(mps_pool_t pool)
 
   ArenaEnter(arena);
 
-  size = PoolFreeSize(pool);
+  /* Blocks in segregated allocation caches are free too. */
+  size = PoolFreeSize(pool) + SACPoolCachedSize(pool);
 
   ArenaLeave(arena);
 
@@ -796,14 +830,21 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
   Res res;
 
   AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(p_o != NULL);
   arena = PoolArena(pool);
 
+  /* .alloc.fast: Pools with a pool lock can often allocate without */
+  /* entering the arena.  See <code/pool.c#.lock>. */
+  if (pool->lock != NULL && size > 0 && PoolAllocFast(&p, pool, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
   STACK_CONTEXT_BEGIN(arena) {
 
     ArenaPoll(ArenaGlobals(arena)); /* .poll */
 
-    AVER_CRITICAL(p_o != NULL);
     AVERT_CRITICAL(Pool, pool);
     AVER_CRITICAL(size > 0);
     /* Note: class may allow unaligned size, see */
@@ -842,6 +883,11 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* See .alloc.fast. */
+  if (pool->lock != NULL && p != NULL && size > 0
+      && PoolFreeFast(pool, (Addr)p, size))
+    return;
+
   ArenaEnter(arena);
 
   AVERT_CRITICAL(Pool, pool);
@@ -989,6 +1035,132 @@ mps_bool_t (mps_commit)(mps_ap_t mps_ap, mps_addr_t p, size_t size)
 }
 
 
+/* mps_reserve_many -- reserve several blocks of the same size
+ *
+ * The blocks are reserved as one block of count * size bytes, and
+ * p_o[i] is set to the address of the i'th.  The client initializes
+ * them all and then commits them all with mps_commit_many, so the
+ * reserve and commit checks are done once for the batch.
+ */
+
+mps_res_t mps_reserve_many(mps_addr_t *p_o, mps_ap_t mps_ap,
+                           size_t count, size_t size)
+{
+  mps_addr_t p;
+  mps_res_t res;
+  size_t i;
+
+  AVER(p_o != NULL);
+  AVER(mps_ap != NULL);
+  AVER(TESTT(Buffer, BufferOfAP(mps_ap)));
+  AVER(mps_ap->init == mps_ap->alloc);
+  AVER(count > 0);
+  AVER(size > 0);
+  /* Otherwise p_o[1] onwards would be misaligned. */
+  AVER(SizeIsAligned(size, BufferPool(BufferOfAP(mps_ap))->alignment));
+
+  if (size > (size_t)-1 / count)
+    return MPS_RES_MEMORY;
+
+  MPS_RESERVE_BLOCK(res, p, mps_ap, count * size);
+  if (res != MPS_RES_OK)
+    return res;
+
+  for (i = 0; i < count; ++i)
+    p_o[i] = PointerAdd(p, i * size);
+  return MPS_RES_OK;
+}
+
+
+/* mps_commit_many -- commit blocks reserved by mps_reserve_many
+ *
+ * Returns FALSE if none of the blocks could be committed, in which
+ * case the client must reserve and initialize them all again.
+ */
+
+mps_bool_t mps_commit_many(mps_ap_t mps_ap, mps_addr_t *p_o,
+                           size_t count, size_t size)
+{
+  AVER(mps_ap != NULL);
+  AVER(TESTT(Buffer, BufferOfAP(mps_ap)));
+  AVER(p_o != NULL);
+  AVER(count > 0);
+  AVER(size > 0);
+  AVER(p_o[0] == mps_ap->init);
+  AVER(PointerAdd(mps_ap->init, count * size) == mps_ap->alloc);
+
+  return mps_commit(mps_ap, p_o[0], count * size);
+}
+
+
+/* mps_tl_ap -- get the calling thread's allocation point in a pool
+ *
+ * See <code/tlap.c>.  The allocation point is created the first time
+ * a thread asks for it, which needs the arena lock, but after that it
+ * is found without the arena lock.
+ */
+
+mps_res_t mps_tl_ap(mps_ap_t *mps_ap_o, mps_pool_t pool)
+{
+  Buffer buf;
+
+  AVER(mps_ap_o != NULL);
+  AVER(TESTT(Pool, pool));
+
+  buf = TLAPLookup(pool);
+  if (buf == NULL) {
+    Arena arena = PoolArena(pool);
+    Res res;
+
+    ArenaEnter(arena);
+    AVERT(Pool, pool);
+    res = TLAPCreate(&buf, pool);
+    ArenaLeave(arena);
+
+    if (res != ResOK)
+      return (mps_res_t)res;
+  }
+
+  *mps_ap_o = BufferAP(buf);
+  return MPS_RES_OK;
+}
+
+
+/* mps_tl_reserve -- reserve through the calling thread's allocation point */
+
+mps_res_t mps_tl_reserve(mps_addr_t *p_o, mps_pool_t pool, size_t size)
+{
+  mps_ap_t mps_ap;
+  mps_res_t res;
+
+  AVER(p_o != NULL);
+  AVER(size > 0);
+
+  res = mps_tl_ap(&mps_ap, pool);
+  if (res != MPS_RES_OK)
+    return res;
+  return mps_reserve(p_o, mps_ap, size);
+}
+
+
+/* mps_tl_commit -- commit through the calling thread's allocation point */
+
+mps_bool_t mps_tl_commit(mps_pool_t pool, mps_addr_t p, size_t size)
+{
+  Buffer buf;
+
+  AVER(TESTT(Pool, pool));
+
+  /* If mps_tl_reserve failed to create the allocation point, or wasn't */
+  /* called in this thread, there is nothing to commit.  Fail, so that */
+  /* the client program tries the reserve again. */
+  buf = TLAPLookup(pool);
+  if (buf == NULL)
+    return FALSE;
+  return mps_commit(BufferAP(buf), p, size);
+}
+
+
 /* Allocation frame support
  *
  * These are candidates for being inlineable as macros.
@@ -1190,6 +1362,33 @@ mps_res_t mps_sac_create(mps_sac_t *mps_sac_o, mps_pool_t pool,
 }
 
 
+/* mps_sac_create_adaptive -- create an SAC that chooses its classes */
+
+mps_res_t mps_sac_create_adaptive(mps_sac_t *mps_sac_o, mps_pool_t pool,
+                                  size_t cache_size)
+{
+  Arena arena;
+  SAC sac;
+  Res res;
+
+  AVER(mps_sac_o != NULL);
+  AVER(TESTT(Pool, pool));
+  AVER(cache_size > 0);
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = SACCreateAdaptive(&sac, pool, (Size)cache_size);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_sac_o = ExternalSACOfSAC(sac);
+  return (mps_res_t)res;
+}
+
+
 /* mps_sac_destroy -- destroy an SAC object */
 
 void mps_sac_destroy(mps_sac_t mps_sac)
@@ -1226,6 +1425,29 @@ void mps_sac_flush(mps_sac_t mps_sac)
 }
 
 
+/* mps_sac_stats -- get statistics for the classes of an SAC */
+
+size_t mps_sac_stats(mps_sac_t mps_sac, size_t count,
+                     mps_sac_stats_s *stats)
+{
+  SAC sac = SACOfExternalSAC(mps_sac);
+  Arena arena;
+  Count classes;
+
+  AVER(TESTT(SAC, sac));
+  AVER(count == 0 || stats != NULL);
+  arena = SACArena(sac);
+
+  ArenaEnter(arena);
+
+  classes = SACStatsGet(sac, (Count)count, stats);
+
+  ArenaLeave(arena);
+
+  return (size_t)classes;
+}
+
+
 /* mps_sac_fill -- alloc an object, and perhaps fill the cache */
 
 mps_res_t mps_sac_fill(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
@@ -1241,6 +1463,12 @@ mps_res_t mps_sac_fill(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
   arena = SACArena(sac);
   UNUSED(has_reservoir_permit); /* deprecated */
 
+  /* See <code/sac.c#.fast>. */
+  if (sac->pool->lock != NULL && size > 0 && SACFillFast(&p, sac, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
 
   res = SACFill(&p, sac, size);
@@ -1264,6 +1492,11 @@ void mps_sac_empty(mps_sac_t mps_sac, mps_addr_t p, size_t size)
   AVER(TESTT(SAC, sac));
   arena = SACArena(sac);
 
+  /* See <code/sac.c#.fast>. */
+  if (sac->pool->lock != NULL && p != NULL && size > 0
+      && SACEmptyFast(sac, (Addr)p, (Size)size))
+    return;
+
   ArenaEnter(arena);
 
   SACEmpty(sac, (Addr)p, (Size)size);
@@ -1615,6 +1848,107 @@ mps_res_t mps_stack_scan_ambig(mps_ss_t mps_ss,
 }
 
 
+mps_res_t mps_root_create_thread_exact(mps_root_t *mps_root_o,
+                                       mps_arena_t arena,
+                                       mps_thr_t thread,
+                                       mps_stack_scan_t stack_scan,
+                                       void *closure,
+                                       void *cold)
+{
+  Root root;
+  Res res;
+
+  ArenaEnter(arena);
+
+  AVER(mps_root_o != NULL);
+  AVER(cold != NULL);
+  AVER(AddrIsAligned(cold, sizeof(Word)));
+  AVER(FUNCHECK(stack_scan));
+  /* Can't check anything about closure. */
+
+  res = RootCreateThreadExact(&root, arena, thread, stack_scan, closure,
+                              (Word *)cold);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_root_o = (mps_root_t)root;
+  return MPS_RES_OK;
+}
+
+
+mps_res_t mps_root_create_stack(mps_root_t *mps_root_o,
+                                mps_arena_t arena,
+                                mps_rank_t mps_rank,
+                                mps_rm_t mps_rm,
+                                mps_area_scan_t scan_area,
+                                void *closure,
+                                void *cold)
+{
+  Rank rank = (Rank)mps_rank;
+  Root root;
+  Res res;
+
+  ArenaEnter(arena);
+
+  AVER(mps_root_o != NULL);
+  AVER(cold != NULL);
+  AVER(AddrIsAligned(cold, sizeof(Word)));
+  AVER(rank == mps_rank_ambig());
+  AVER(mps_rm == (mps_rm_t)0);
+  AVER(FUNCHECK(scan_area));
+  /* Can't check anything about closure. */
+
+  res = RootCreateStack(&root, arena, rank, (RootMode)mps_rm,
+                        (Word *)cold, scan_area, closure);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_root_o = (mps_root_t)root;
+  return MPS_RES_OK;
+}
+
+
+void mps_root_stack_suspend(mps_root_t mps_root, void *hot)
+{
+  Root root = (Root)mps_root;
+  Arena arena;
+
+  arena = RootArena(root);
+
+  ArenaEnter(arena);
+
+  AVER(hot != NULL);
+  AVER(AddrIsAligned(hot, sizeof(Word)));
+
+  RootStackSuspend(root, (Word *)hot);
+
+  ArenaLeave(arena);
+}
+
+
+void mps_root_stack_resume(mps_root_t mps_root, mps_thr_t mps_thr)
+{
+  Root root = (Root)mps_root;
+  Thread thread = (Thread)mps_thr;
+  Arena arena;
+
+  arena = RootArena(root);
+
+  ArenaEnter(arena);
+
+  AVER(ThreadCheckSimple(thread));
+  AVER(ThreadIsCurrent(thread));
+
+  RootStackResume(root, thread);
+
+  ArenaLeave(arena);
+}
+
+
 void mps_root_destroy(mps_root_t mps_root)
 {
   Root root = (Root)mps_root;
@@ -1630,6 +1964,32 @@ void mps_root_destroy(mps_root_t mps_root)
 }
 
 
+mps_res_t mps_pin(mps_arena_t arena, mps_addr_t addr)
+{
+  Res res;
+
+  ArenaEnter(arena);
+
+  AVER(addr != NULL);
+
+  res = ArenaPin(arena, (Addr)addr);
+
+  ArenaLeave(arena);
+
+  return (mps_res_t)res;
+}
+
+
+void mps_unpin(mps_arena_t arena, mps_addr_t addr)
+{
+  ArenaEnter(arena);
+
+  ArenaUnpin(arena, (Addr)addr);
+
+  ArenaLeave(arena);
+}
+
+
 void (mps_tramp)(void **r_o,
                  void *(*f)(void *p, size_t s),
                  void *p, size_t s)
@@ -1652,7 +2012,29 @@ mps_res_t mps_thread_reg(mps_thr_t *mps_thr_o, mps_arena_t arena)
   AVER(mps_thr_o != NULL);
   AVERT(Arena, arena);
 
-  res = ThreadRegister(&thread, arena);
+  res = ThreadRegister(&thread, arena, argsNone);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_thr_o = (mps_thr_t)thread;
+  return MPS_RES_OK;
+}
+
+mps_res_t mps_thread_reg_k(mps_thr_t *mps_thr_o, mps_arena_t arena,
+                           mps_arg_s mps_args[])
+{
+  Thread thread;
+  Res res;
+
+  ArenaEnter(arena);
+
+  AVER(mps_thr_o != NULL);
+  AVERT(Arena, arena);
+  AVERT(ArgList, mps_args);
+
+  res = ThreadRegister(&thread, arena, mps_args);
 
   ArenaLeave(arena);
 
@@ -1671,11 +2053,75 @@ void mps_thread_dereg(mps_thr_t thread)
 
   ArenaEnter(arena);
 
+  /* A thread deregistering itself has just done any handshake in */
+  /* ArenaEnter.  See <code/trace.c#.flip.handshake>. */
+  if (ThreadHandshake(thread) != TraceSetEMPTY)
+    TraceHandshakeCancel(thread);
+  TLAPThreadFinish(thread);
   ThreadDeregister(thread, arena);
 
   ArenaLeave(arena);
 }
 
+
+/* mpsThreadHandshake -- do any handshake the flip left for a thread
+ *
+ * Called by a thread when it leaves a native region, before it can
+ * touch managed memory.  Entering the arena does the handshake: see
+ * <code/trace.c#.flip.handshake.self>.  The thread's handshake set
+ * only changes while it is native, so it doesn't need the arena lock
+ * to look.
+ */
+
+static void mpsThreadHandshake(mps_thr_t thread)
+{
+  if (ThreadHandshake(thread) != TraceSetEMPTY) {
+    Arena arena = ThreadArena(thread);
+    ArenaEnter(arena);
+    ArenaLeave(arena);
+  }
+}
+
+
+/* mps_thread_safepoint -- stop here if the collector wants to
+ *
+ * Called by the thread itself, without the arena lock: see
+ * <code/thix.c#.safepoint>.
+ */
+
+void mps_thread_safepoint(mps_thr_t thread)
+{
+  AVER(ThreadCheckSimple(thread));
+
+  if (ThreadSafepointRequested(thread)) {
+    THREAD_NATIVE_BEGIN(thread) {
+      NOOP;
+    } THREAD_NATIVE_END(thread);
+    mpsThreadHandshake(thread);
+  }
+}
+
+
+/* mps_thread_call_native -- call a function in a native region
+ *
+ * The collector doesn't wait for the thread while it is in f, so f
+ * may block, but mustn't touch memory managed by the MPS.
+ */
+
+void mps_thread_call_native(void **r_o, mps_thr_t thread,
+                            mps_tramp_t f, void *p, size_t s)
+{
+  AVER(r_o != NULL);
+  AVER(ThreadCheckSimple(thread));
+  AVER(FUNCHECK(f));
+  /* Can't check p and s as they are interpreted by the client */
+
+  THREAD_NATIVE_BEGIN(thread) {
+    *r_o = (*f)(p, s);
+  } THREAD_NATIVE_END(thread);
+  mpsThreadHandshake(thread);
+}
+
 void mps_ld_reset(mps_ld_t ld, mps_arena_t arena)
 {
   ArenaEnter(arena);
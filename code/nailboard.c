@@ -61,8 +61,20 @@ Bool NailboardCheck(Nailboard board)
   CHECKL(nailboardLevelBits(nails, board->levels - 1) != 0);
   CHECKL(nailboardLevelBits(nails, board->levels) == 1);
   CHECKL(BoolCheck(board->newNails));
+  CHECKU(Arena, board->arena);
+  CHECKL(BoolCheck(board->dense));
+  CHECKL(BoolCheck(board->saturated));
+  CHECKL(!(board->dense && board->saturated));
+  CHECKL(board->sparseCount <= NAILBOARD_SPARSE_MAX);
+  CHECKL(board->dense == (board->tables != NULL));
+  if (board->dense || board->saturated)
+    CHECKL(board->sparseCount == 0);
+  for (i = 0; i < board->sparseCount; ++i) {
+    CHECKL(board->sparse[i] < nails);
+    CHECKL(i == 0 || board->sparse[i - 1] < board->sparse[i]);
+  }
   for (i = 0; i < board->levels; ++i) {
-    CHECKL(board->level[i] != NULL);
+    CHECKL(board->dense == (board->level[i] != NULL));
   }
   return TRUE;
 }
@@ -78,17 +90,16 @@ static Size nailboardStructSize(Count levels)
 }
 
 
-/* nailboardSize -- return the total size of the nailboard
+/* nailboardTablesSize -- return the combined sizes of the bit tables
  *
- * This is the size of the nailboard structure plus the combined sizes
- * of the bit tables.
+ * The bit tables are allocated in a single block when the nailboard
+ * becomes dense. <design/nailboard#.impl.sparse.dense>
  */
 
-static Size nailboardSize(Count nails, Count levels)
+static Size nailboardTablesSize(Count nails, Count levels)
 {
   Index i;
-  Size size;
-  size = nailboardStructSize(levels);
+  Size size = 0;
   for (i = 0; i < levels; ++i) {
     size += BTSize(nailboardLevelBits(nails, i));
   }
@@ -105,6 +116,10 @@ static Size nailboardSize(Count nails, Count levels)
  * 
  * alignment specifies the granularity of the nails: that is, the
  * number of bytes covered by each nail.
+ *
+ * The nailboard starts out sparse, and the bit tables are only
+ * allocated when it has too many nails to fit in the sparse array.
+ * <design/nailboard#.impl.sparse>
  */
 
 Res NailboardCreate(Nailboard *boardReturn, Arena arena, Align alignment,
@@ -127,25 +142,23 @@ Res NailboardCreate(Nailboard *boardReturn, Arena arena, Align alignment,
   alignShift = SizeLog2((Size)alignment);
   nails = AddrOffset(base, limit) >> alignShift;
   levels = nailboardLevels(nails);
-  res = ControlAlloc(&p, arena, nailboardSize(nails, levels));
+  res = ControlAlloc(&p, arena, nailboardStructSize(levels));
   if (res != ResOK)
     return res;
 
   board = p;
+  board->arena = arena;
   RangeInit(&board->range, base, limit);
   board->levels = levels;
   board->alignShift = alignShift;
   board->newNails = FALSE;
+  board->dense = FALSE;
+  board->saturated = FALSE;
+  board->sparseCount = 0;
+  board->tables = NULL;
+  for (i = 0; i < levels; ++i)
+    board->level[i] = NULL;
 
-  p = PointerAdd(p, nailboardStructSize(levels));
-  for (i = 0; i < levels; ++i) {
-    Count levelBits = nailboardLevelBits(nails, i);
-    AVER(levelBits > 0);
-    board->level[i] = p;
-    BTResRange(board->level[i], 0, levelBits);
-    p = PointerAdd(p, BTSize(levelBits));
-  }
-  
   board->sig = NailboardSig;
   AVERT(Nailboard, board);
   *boardReturn = board;
@@ -157,17 +170,16 @@ Res NailboardCreate(Nailboard *boardReturn, Arena arena, Align alignment,
 
 void NailboardDestroy(Nailboard board, Arena arena)
 {
-  Count nails;
-  Size size;
-
   AVERT(Nailboard, board);
   AVERT(Arena, arena);
+  AVER(board->arena == arena);
 
-  nails = nailboardNails(board);
-  size = nailboardSize(nails, board->levels);
+  if (board->dense)
+    ControlFree(arena, board->tables,
+                nailboardTablesSize(nailboardNails(board), board->levels));
 
   board->sig = SigInvalid;
-  ControlFree(arena, board, size);
+  ControlFree(arena, board, nailboardStructSize(board->levels));
 }
 
 
@@ -194,6 +206,20 @@ Bool (NailboardNewNails)(Nailboard board)
 }
 
 
+/* NailboardSaturated -- return the "saturated" flag
+ *
+ * Return TRUE if the nailboard ran out of memory for its bit tables,
+ * and so behaves as if all its nails were set.
+ * <design/nailboard#.impl.saturated>
+ */
+
+Bool (NailboardSaturated)(Nailboard board)
+{
+  AVERT(Nailboard, board);
+  return NailboardSaturated(board);
+}
+
+
 /* nailboardIndex -- return the index of the nail corresponding to
  * addr in the given level.
  */
@@ -233,6 +259,104 @@ static void nailboardIndexRange(Index *ibaseReturn, Index *ilimitReturn,
 }
 
 
+/* nailboardSparseFind -- return the position in the sparse array of
+ * the first nail whose index is at least j, or the number of nails in
+ * the array if there is no such nail.
+ */
+
+static Index nailboardSparseFind(Nailboard board, Index j)
+{
+  Index lo = 0, hi = board->sparseCount;
+  while (lo < hi) {
+    Index mid = lo + (hi - lo) / 2;
+    if (board->sparse[mid] < j)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+/* nailboardSparseInsert -- insert nails at indexes j to j + n - 1
+ * before position k in the sparse array.
+ */
+
+static void nailboardSparseInsert(Nailboard board, Index k, Index j, Count n)
+{
+  Index m;
+  AVER_CRITICAL(k <= board->sparseCount);
+  AVER_CRITICAL(board->sparseCount + n <= NAILBOARD_SPARSE_MAX);
+  for (m = board->sparseCount; m > k; --m)
+    board->sparse[m + n - 1] = board->sparse[m - 1];
+  for (m = 0; m < n; ++m)
+    board->sparse[k + m] = j + m;
+  board->sparseCount += n;
+}
+
+
+/* nailboardDenseSet -- set a nail in the bit tables and return the
+ * old nail.
+ */
+
+static Bool nailboardDenseSet(Nailboard board, Addr addr)
+{
+  Index i, j;
+
+  j = nailboardIndex(board, 0, addr);
+  if (BTGet(board->level[0], j))
+    return TRUE;
+  board->newNails = TRUE;
+  BTSet(board->level[0], j);
+
+  for (i = 1; i < board->levels; ++i) {
+    j = nailboardIndex(board, i, addr);
+    if (BTGet(board->level[i], j))
+      break;
+    BTSet(board->level[i], j);
+  }
+  return FALSE;
+}
+
+
+/* nailboardDensify -- switch from the sparse array to the bit tables
+ *
+ * If the bit tables can't be allocated, return a result code to
+ * indicate failure, leaving the nailboard unchanged.
+ */
+
+static Res nailboardDensify(Nailboard board)
+{
+  Count nails = nailboardNails(board);
+  Index i;
+  void *p;
+  Res res;
+
+  AVER(!board->dense);
+  AVER(!board->saturated);
+
+  res = ControlAlloc(&p, board->arena,
+                     nailboardTablesSize(nails, board->levels));
+  if (res != ResOK)
+    return res;
+
+  board->tables = p;
+  for (i = 0; i < board->levels; ++i) {
+    Count levelBits = nailboardLevelBits(nails, i);
+    AVER(levelBits > 0);
+    board->level[i] = p;
+    BTResRange(board->level[i], 0, levelBits);
+    p = PointerAdd(p, BTSize(levelBits));
+  }
+  board->dense = TRUE;
+
+  for (i = 0; i < board->sparseCount; ++i)
+    (void)nailboardDenseSet(board, nailboardAddr(board, 0, board->sparse[i]));
+  board->sparseCount = 0;
+  return ResOK;
+}
+
+
 /* NailboardGet -- return nail corresponding to address
  * 
  * Return the nail in the nailboard corresponding to the address addr.
@@ -242,9 +366,18 @@ static void nailboardIndexRange(Index *ibaseReturn, Index *ilimitReturn,
 
 Bool NailboardGet(Nailboard board, Addr addr)
 {
+  Index j, k;
+
   AVERT(Nailboard, board);
   AVER(RangeContains(&board->range, addr));
-  return BTGet(board->level[0], nailboardIndex(board, 0, addr));
+
+  j = nailboardIndex(board, 0, addr);
+  if (board->dense)
+    return BTGet(board->level[0], j);
+  if (board->saturated)
+    return TRUE;
+  k = nailboardSparseFind(board, j);
+  return k < board->sparseCount && board->sparse[k] == j;
 }
 
 
@@ -260,22 +393,34 @@ Bool NailboardGet(Nailboard board, Addr addr)
 
 Bool NailboardSet(Nailboard board, Addr addr)
 {
-  Index i, j;
+  Index j, k;
 
   AVERT_CRITICAL(Nailboard, board);
   AVER_CRITICAL(RangeContains(&board->range, addr));
 
+  if (board->dense)
+    return nailboardDenseSet(board, addr);
+  if (board->saturated)
+    return TRUE;
+
   j = nailboardIndex(board, 0, addr);
-  if (BTGet(board->level[0], j))
+  k = nailboardSparseFind(board, j);
+  if (k < board->sparseCount && board->sparse[k] == j)
     return TRUE;
   board->newNails = TRUE;
-  BTSet(board->level[0], j);
+  if (board->sparseCount < NAILBOARD_SPARSE_MAX) {
+    nailboardSparseInsert(board, k, j, 1);
+    return FALSE;
+  }
 
-  for (i = 1; i < board->levels; ++i) {
-    j = nailboardIndex(board, i, addr);
-    if (BTGet(board->level[i], j))
-      break;
-    BTSet(board->level[i], j);
+  if (nailboardDensify(board) == ResOK) {
+    (void)nailboardDenseSet(board, addr);
+  } else {
+    /* There's no way to report failure on the critical path, so
+     * behave as if all nails are set from now on.
+     * <design/nailboard#.impl.saturated> */
+    board->saturated = TRUE;
+    board->sparseCount = 0;
   }
   return FALSE;
 }
@@ -284,20 +429,36 @@ Bool NailboardSet(Nailboard board, Addr addr)
 /* NailboardSetRange -- set all nails in range
  *
  * Set all nails in the nailboard corresponding to the range between
- * base and limit. It is an error if any part of the range is not
+ * base and limit, and return ResOK. If there's no memory for the bit
+ * tables, return a result code to indicate failure, leaving the
+ * nailboard unchanged. It is an error if any part of the range is not
  * covered by the nailboard, or if any nail in the range is set.
  */
 
-void NailboardSetRange(Nailboard board, Addr base, Addr limit)
+Res NailboardSetRange(Nailboard board, Addr base, Addr limit)
 {
   Index i, ibase, ilimit;
+  AVERT(Nailboard, board);
+  AVER(NailboardIsResRange(board, base, limit));
   nailboardIndexRange(&ibase, &ilimit, board, 0, base, limit);
-  AVER(BTIsResRange(board->level[0], ibase, ilimit));
+  if (!board->dense) {
+    Count n = ilimit - ibase;
+    Res res;
+    if (board->sparseCount + n <= NAILBOARD_SPARSE_MAX) {
+      nailboardSparseInsert(board, nailboardSparseFind(board, ibase),
+                            ibase, n);
+      return ResOK;
+    }
+    res = nailboardDensify(board);
+    if (res != ResOK)
+      return res;
+  }
   BTSetRange(board->level[0], ibase, ilimit);
   for (i = 1; i < board->levels; ++i) {
     nailboardIndexRange(&ibase, &ilimit, board, i, base, limit);
     BTSetRange(board->level[i], ibase, ilimit);
   }
+  return ResOK;
 }
 
 
@@ -314,10 +475,18 @@ void NailboardSetRange(Nailboard board, Addr base, Addr limit)
 
 Bool NailboardIsSetRange(Nailboard board, Addr base, Addr limit)
 {
-  Index ibase, ilimit;
+  Index ibase, ilimit, k;
   AVERT(Nailboard, board);
   nailboardIndexRange(&ibase, &ilimit, board, 0, base, limit);
-  return BTIsSetRange(board->level[0], ibase, ilimit);
+  if (board->dense)
+    return BTIsSetRange(board->level[0], ibase, ilimit);
+  if (board->saturated)
+    return TRUE;
+  /* The sparse array is sorted and has no duplicates, so the range is
+   * all set if it has one nail for each index. */
+  k = nailboardSparseFind(board, ibase);
+  return k + (ilimit - ibase) <= board->sparseCount
+    && board->sparse[k + (ilimit - ibase) - 1] == ilimit - 1;
 }
 
 
@@ -342,6 +511,16 @@ Bool NailboardIsResRange(Nailboard board, Addr base, Addr limit)
 
   AVERT_CRITICAL(Nailboard, board);
 
+  if (!board->dense) {
+    Index k;
+    if (board->saturated)
+      return FALSE;
+    /* <design/nailboard#.impl.sparse.isresrange> */
+    nailboardIndexRange(&ibase, &ilimit, board, 0, base, limit);
+    k = nailboardSparseFind(board, ibase);
+    return k == board->sparseCount || board->sparse[k] >= ilimit;
+  }
+
   /* Descend levels until ibase and ilimit are two or more bits apart:
    * that is, until there is an "inner" part to the range. */
   i = board->levels;
@@ -403,6 +582,55 @@ Bool NailboardIsResRange(Nailboard board, Addr base, Addr limit)
 }
 
 
+/* NailboardNext -- find the first nail that is set in a range
+ *
+ * If any nail is set in the range between base and limit, set
+ * *nailReturn to the address of the first such nail and return TRUE.
+ * Otherwise return FALSE. It is an error if any part of the range is
+ * not covered by the nailboard.
+ *
+ * <design/nailboard#.impl.next>.
+ */
+
+Bool NailboardNext(Addr *nailReturn, Nailboard board, Addr base, Addr limit)
+{
+  Index ibase, ilimit, j;
+
+  AVER(nailReturn != NULL);
+  AVERT(Nailboard, board);
+  AVER(base < limit);
+  AVER(RangeContains(&board->range, base));
+  AVER(limit <= RangeLimit(&board->range));
+
+  nailboardIndexRange(&ibase, &ilimit, board, 0, base, limit);
+  if (board->dense) {
+    if (BTGet(board->level[0], ibase)) {
+      j = ibase;
+    } else {
+      Index resBase = ibase, resLimit = ilimit;
+      Bool found = BTFindLongResRange(&resBase, &resLimit, board->level[0],
+                                      ibase, ilimit, 1);
+      AVER(found);
+      AVER(resBase == ibase);
+      UNUSED(found);
+      if (resLimit == ilimit)
+        return FALSE;
+      j = resLimit;
+    }
+  } else if (board->saturated) {
+    j = ibase;
+  } else {
+    Index k = nailboardSparseFind(board, ibase);
+    if (k == board->sparseCount || board->sparse[k] >= ilimit)
+      return FALSE;
+    j = board->sparse[k];
+  }
+
+  *nailReturn = nailboardAddr(board, 0, j);
+  return TRUE;
+}
+
+
 Res NailboardDescribe(Nailboard board, mps_lib_FILE *stream, Count depth)
 {
   Index i, j;
@@ -418,6 +646,8 @@ Res NailboardDescribe(Nailboard board, mps_lib_FILE *stream, Count depth)
                "  levels: $U\n", (WriteFU)board->levels,
                "  newNails: $S\n", WriteFYesNo(board->newNails),
                "  alignShift: $U\n", (WriteFU)board->alignShift,
+               "  dense: $S\n", WriteFYesNo(board->dense),
+               "  saturated: $S\n", WriteFYesNo(board->saturated),
                NULL);
   if (res != ResOK)
     return res;
@@ -426,7 +656,22 @@ Res NailboardDescribe(Nailboard board, mps_lib_FILE *stream, Count depth)
   if (res != ResOK)
     return res;
 
-  for(i = 0; i < board->levels; ++i) {
+  if (!board->dense) {
+    res = WriteF(stream, depth + 2, "Sparse ($U set):",
+                 (WriteFU)board->sparseCount, NULL);
+    if (res != ResOK)
+      return res;
+    for (j = 0; j < board->sparseCount; ++j) {
+      res = WriteF(stream, 0, " $U", (WriteFU)board->sparse[j], NULL);
+      if (res != ResOK)
+        return res;
+    }
+    res = WriteF(stream, 0, "\n", NULL);
+    if (res != ResOK)
+      return res;
+  }
+
+  for(i = 0; board->dense && i < board->levels; ++i) {
     Count levelNails = nailboardLevelBits(nailboardNails(board), i);
     Count resetNails = BTCountResRange(board->level[i], 0, levelNails);
     res = WriteF(stream, depth + 2, "Level $U ($U bits, $U set): ",
@@ -23,28 +23,38 @@ typedef struct NailboardStruct *Nailboard;
  */
 typedef struct NailboardStruct {
   Sig sig;
+  Arena arena;         /* arena whose control pool holds the nailboard */
   RangeStruct range;   /* range of addresses covered by nailboard */
   Count levels;        /* number of levels */
   Shift alignShift;    /* shift due to address alignment */
   Bool newNails;       /* set to TRUE if a new nail is set */
-  BT level[1];         /* bit tables for each level */
+  Bool dense;          /* bit tables in use? <design/nailboard#.impl.sparse> */
+  Bool saturated;      /* all nails set? <design/nailboard#.impl.saturated> */
+  Count sparseCount;   /* number of nails in sparse array */
+  Index sparse[NAILBOARD_SPARSE_MAX]; /* sorted indexes of nails */
+  void *tables;        /* block holding the bit tables, or NULL */
+  BT level[1];         /* bit tables for each level, if dense */
 } NailboardStruct;
 
 #define NailboardSig ((Sig)0x5194A17B) /* SIGnature NAILBoard */
 
 #define NailboardClearNewNails(board) ((board)->newNails = FALSE)
 #define NailboardNewNails(board) RVALUE((board)->newNails)
+#define NailboardSaturated(board) RVALUE((board)->saturated)
 
 extern Bool NailboardCheck(Nailboard board);
 extern Res NailboardCreate(Nailboard *boardReturn, Arena arena, Align alignment, Addr base, Addr limit);
 extern void NailboardDestroy(Nailboard board, Arena arena);
 extern void (NailboardClearNewNails)(Nailboard board);
 extern Bool (NailboardNewNails)(Nailboard board);
+extern Bool (NailboardSaturated)(Nailboard board);
 extern Bool NailboardGet(Nailboard board, Addr addr);
 extern Bool NailboardSet(Nailboard board, Addr addr);
-extern void NailboardSetRange(Nailboard board, Addr base, Addr limit);
+extern Res NailboardSetRange(Nailboard board, Addr base, Addr limit);
 extern Bool NailboardIsSetRange(Nailboard board, Addr base, Addr limit);
 extern Bool NailboardIsResRange(Nailboard board, Addr base, Addr limit);
+extern Bool NailboardNext(Addr *nailReturn, Nailboard board,
+                          Addr base, Addr limit);
 extern Res NailboardDescribe(Nailboard board, mps_lib_FILE *stream, Count depth);
 
 #endif /* nailboard.h */
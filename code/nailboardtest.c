@@ -21,6 +21,7 @@ static void test(mps_arena_t arena)
   Nailboard board;
   Align align;
   Count nails;
+  Count setCount = 0;
   Addr base, limit;
   Index i, j, k;
 
@@ -39,19 +40,40 @@ static void test(mps_arena_t arena)
     j = rnd() % nails;
     old = BTGet(bt, j);
     BTSet(bt, j);
+    if (!old)
+      ++setCount;
     cdie(NailboardSet(board, AddrAdd(base, j * align)) == old, "NailboardSet");
+    cdie(NailboardGet(board, AddrAdd(base, j * align)), "NailboardGet");
+    /* The board only switches to bit tables when the sparse array
+     * overflows. */
+    cdie(board->dense == (setCount > NAILBOARD_SPARSE_MAX), "dense");
     for (k = 0; k < nails / 8; ++k) {
-      Index b, l;
+      Index b, l, next;
+      Addr nail;
+      Bool found;
       b = rnd() % nails;
       l = b + rnd() % (nails - b) + 1;
       cdie(BTIsResRange(bt, b, l)
            == NailboardIsResRange(board, AddrAdd(base, b * align),
                                   AddrAdd(base, l * align)),
            "NailboardIsResRange");
+      cdie(BTGet(bt, b) == NailboardGet(board, AddrAdd(base, b * align)),
+           "NailboardGet");
+      found = NailboardNext(&nail, board, AddrAdd(base, b * align),
+                            AddrAdd(base, l * align));
+      cdie(found == !BTIsResRange(bt, b, l), "NailboardNext");
+      if (found) {
+        next = (Index)(AddrOffset(base, nail) / align);
+        cdie(b <= next && next < l, "NailboardNext range");
+        cdie(BTGet(bt, next), "NailboardNext set");
+        cdie(next == b || BTIsResRange(bt, b, next), "NailboardNext first");
+      }
     }
   }
 
   die(NailboardDescribe(board, mps_lib_get_stdout(), 0), "NailboardDescribe");
+  NailboardDestroy(board, arena);
+  BTDestroy(bt, arena, nails);
 }
 
 int main(int argc, char *argv[])
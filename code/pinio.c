@@ -0,0 +1,259 @@
+/* pinio.c: PINNED OBJECT I/O TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Pin some objects in an AMC pool, and use them as buffers for read()
+ * and write() on a pipe, both while a collection is in progress and
+ * after it has finished.  The operating system can't handle a barrier
+ * hit on the MPS's behalf, so the system calls fail if the MPS
+ * protects a pinned object <design/root#.pin.barrier>.
+ *
+ * Unix only, because of the pipe.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <errno.h> /* errno */
+#include <stdio.h> /* printf */
+#include <string.h> /* strerror */
+#include <unistd.h> /* pipe, read, write */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define objCOUNT          1000  /* objects referenced by the roots */
+#define pinFREQ           10    /* one in pinFREQ objects is pinned */
+#define bufBASE           2     /* first slot used as an I/O buffer */
+#define bufSLOTS          64    /* slots used as an I/O buffer */
+#define garbageCOUNT      10000 /* garbage objects between collections */
+#define collectCOUNT      4
+#define genCOUNT          2
+
+static mps_arena_t arena;
+static mps_ap_t ap;
+static mps_word_t roots[objCOUNT];  /* exact root */
+static int fds[2];                  /* pipe */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 128, 0.85 }, { 512, 0.45 } };
+
+
+/* make -- make a vector whose first slot identifies it, whose second
+ * slot refers to another object, and whose remaining slots hold
+ * integers */
+
+static mps_word_t make(size_t id)
+{
+  mps_word_t v, child;
+  size_t i;
+  die(make_dylan_vector(&v, ap, bufBASE + bufSLOTS), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(v, 0) = DYLAN_INT(id);
+  for (i = 0; i < bufSLOTS; ++i)
+    DYLAN_VECTOR_SLOT(v, bufBASE + i) = DYLAN_INT(0);
+  die(make_dylan_vector(&child, ap, 1), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(child, 0) = DYLAN_INT(id);
+  DYLAN_VECTOR_SLOT(v, 1) = child;
+  return v;
+}
+
+
+/* transfer -- read from a pipe into an object, and write it back out
+ *
+ * The slots are filled with integers, so that the object stays valid
+ * whatever the collector thinks of it.
+ */
+
+static void transfer(mps_word_t obj, size_t round)
+{
+  mps_word_t data[bufSLOTS], copy[bufSLOTS];
+  mps_word_t *buf = &DYLAN_VECTOR_SLOT(obj, bufBASE);
+  ssize_t n;
+  size_t i;
+
+  for (i = 0; i < bufSLOTS; ++i)
+    data[i] = DYLAN_INT(round * bufSLOTS + i);
+
+  /* The operating system writes into the pinned object... */
+  n = write(fds[1], data, sizeof data);
+  cdie(n == (ssize_t)sizeof data, "write to pipe");
+  n = read(fds[0], buf, sizeof data);
+  if (n != (ssize_t)sizeof data)
+    error("read into pinned object returned %ld: %s",
+          (long)n, n < 0 ? strerror(errno) : "short read");
+  for (i = 0; i < bufSLOTS; ++i)
+    cdie(buf[i] == data[i], "data read");
+
+  /* ...and reads from it. */
+  n = write(fds[1], buf, sizeof data);
+  if (n != (ssize_t)sizeof data)
+    error("write from pinned object returned %ld: %s",
+          (long)n, n < 0 ? strerror(errno) : "short write");
+  n = read(fds[0], copy, sizeof copy);
+  cdie(n == (ssize_t)sizeof copy, "read from pipe");
+  for (i = 0; i < bufSLOTS; ++i)
+    cdie(copy[i] == data[i], "data written");
+}
+
+
+/* transferAll -- do I/O on all the pinned objects */
+
+static void transferAll(size_t round)
+{
+  size_t i;
+  for (i = 0; i < objCOUNT; i += pinFREQ)
+    transfer(roots[i], round);
+}
+
+
+/* checkAll -- check the objects are intact */
+
+static void checkAll(size_t round)
+{
+  size_t i, j;
+  for (i = 0; i < objCOUNT; ++i) {
+    mps_word_t child = DYLAN_VECTOR_SLOT(roots[i], 1);
+    cdie(dylan_check((mps_addr_t)roots[i]), "object check");
+    cdie(DYLAN_VECTOR_SLOT(roots[i], 0) == DYLAN_INT(i), "object id");
+    cdie(DYLAN_VECTOR_SLOT(child, 0) == DYLAN_INT(i), "child id");
+    if (i % pinFREQ == 0)
+      for (j = 0; j < bufSLOTS; ++j)
+        cdie(DYLAN_VECTOR_SLOT(roots[i], bufBASE + j)
+             == DYLAN_INT(round * bufSLOTS + j), "object data");
+  }
+}
+
+
+static void test(void)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  size_t i, r;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           roots, roots + objCOUNT, mps_scan_area, NULL),
+      "root_create_area");
+  cdie(pipe(fds) == 0, "pipe");
+
+  mps_arena_park(arena);
+  for (i = 0; i < objCOUNT; ++i) {
+    roots[i] = make(i);
+    if (i % pinFREQ == 0)
+      die(mps_pin(arena, (mps_addr_t)roots[i]), "pin");
+  }
+
+  for (r = 0; r < collectCOUNT; ++r) {
+    for (i = 0; i < garbageCOUNT; ++i)
+      (void)make(0);
+
+    /* During the collection, when the pinned objects' segments may */
+    /* be grey for a flipped trace... */
+    die(mps_arena_start_collect(arena), "start_collect");
+    transferAll(2 * r);
+    checkAll(2 * r);
+
+    /* ...and after it, when their summaries are up to date. */
+    mps_arena_park(arena);
+    transferAll(2 * r + 1);
+    checkAll(2 * r + 1);
+  }
+  printf("%lu transfers on pinned objects\n",
+         (unsigned long)(2 * collectCOUNT * (objCOUNT / pinFREQ)));
+
+  for (i = 0; i < objCOUNT; i += pinFREQ)
+    mps_unpin(arena, (mps_addr_t)roots[i]);
+
+  cdie(close(fds[0]) == 0, "close");
+  cdie(close(fds[1]) == 0, "close");
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    /* Do as little work as possible when the collection starts, so */
+    /* that it is still in progress while the I/O is done. */
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, 0.0);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test();
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,231 @@
+/* pintest.c: OBJECT PINNING TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Pin some objects in an AMC pool with mps_pin, and check that
+ * collections preserve them in place, while the objects next to them
+ * still move.  Check that an object that is only referenced by its pin
+ * is kept alive and scanned, that pins nest, and that mps_unpin lets
+ * the objects move again.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)16 << 20)
+#define objCOUNT          1000  /* objects referenced by the roots */
+#define pinFREQ           100   /* one in pinFREQ objects is pinned */
+#define garbageCOUNT      10000 /* garbage objects between collections */
+#define genCOUNT          2
+
+static mps_arena_t arena;
+static mps_ap_t ap;
+static mps_word_t roots[objCOUNT];  /* exact root */
+static mps_word_t seen[objCOUNT];   /* where each object was last seen */
+static mps_bool_t movedLast[objCOUNT]; /* moved by the last collection? */
+static mps_word_t floating;         /* referenced only by its pin */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 128, 0.85 }, { 512, 0.45 } };
+
+
+/* make -- make a vector whose first slot identifies it */
+
+static mps_word_t make(size_t id)
+{
+  mps_word_t v;
+  die(make_dylan_vector(&v, ap, 2), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(v, 0) = DYLAN_INT(id);
+  return v;
+}
+
+
+/* checkObj -- check that an object is intact */
+
+static void checkObj(mps_word_t v, size_t id)
+{
+  cdie(mps_arena_has_addr(arena, (mps_addr_t)v), "object in arena");
+  cdie(dylan_check((mps_addr_t)v), "object check");
+  cdie(DYLAN_VECTOR_SLOT(v, 0) == DYLAN_INT(id), "object id");
+}
+
+
+/* collect -- make garbage, collect the world, and count the moves
+ *
+ * Returns the number of objects referenced by the roots that moved.
+ * If pinned is TRUE, checks that the pinned objects did not move, and
+ * sets *neighboursMovedReturn to the number of their neighbours that
+ * moved.
+ */
+
+static size_t collect(mps_bool_t pinned, size_t *neighboursMovedReturn)
+{
+  size_t i, moved = 0, neighboursMoved = 0;
+
+  for (i = 0; i < garbageCOUNT; ++i)
+    (void)make(0);
+  die(mps_arena_collect(arena), "collect");
+  mps_arena_release(arena);
+
+  for (i = 0; i < objCOUNT; ++i) {
+    checkObj(roots[i], i);
+    movedLast[i] = roots[i] != seen[i];
+    if (movedLast[i]) {
+      ++moved;
+      if (i % pinFREQ == 1 || i % pinFREQ == pinFREQ - 1)
+        ++neighboursMoved;
+    }
+    if (pinned && i % pinFREQ == 0)
+      cdie(roots[i] == seen[i], "pinned object moved");
+    seen[i] = roots[i];
+  }
+  checkObj(floating, objCOUNT);
+  checkObj(DYLAN_VECTOR_SLOT(floating, 1), objCOUNT + 1);
+
+  if (neighboursMovedReturn != NULL)
+    *neighboursMovedReturn = neighboursMoved;
+  return moved;
+}
+
+
+static void test(void)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  size_t i, moved, neighboursMoved;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           roots, roots + objCOUNT, mps_scan_area, NULL),
+      "root_create_area");
+
+  /* Allocate the objects one after another, so that each pinned */
+  /* object shares its segment with its neighbours. */
+  for (i = 0; i < objCOUNT; ++i) {
+    roots[i] = make(i);
+    seen[i] = roots[i];
+    if (i % pinFREQ == 0)
+      die(mps_pin(arena, (mps_addr_t)roots[i]), "pin");
+  }
+  /* Pin one object twice, to check that pins nest. */
+  die(mps_pin(arena, (mps_addr_t)roots[0]), "pin again");
+
+  /* The floating object must be pinned before anything else is */
+  /* allocated, because nothing else refers to it. */
+  floating = make(objCOUNT);
+  die(mps_pin(arena, (mps_addr_t)floating), "pin floating");
+  DYLAN_VECTOR_SLOT(floating, 1) = make(objCOUNT + 1);
+
+  moved = collect(TRUE, &neighboursMoved);
+  printf("pinned: %lu objects moved, %lu next to pins\n",
+         (unsigned long)moved, (unsigned long)neighboursMoved);
+  Insist(moved > 0);
+  Insist(neighboursMoved > 0);
+
+  /* roots[0] is still pinned once. */
+  mps_unpin(arena, (mps_addr_t)roots[0]);
+  cdie(roots[0] == seen[0], "pinned object moved");
+  (void)collect(TRUE, NULL);
+
+  /* Without their pins, the objects are free to move again. */
+  for (i = 0; i < objCOUNT; i += pinFREQ)
+    mps_unpin(arena, (mps_addr_t)roots[i]);
+  (void)collect(FALSE, NULL);
+  moved = 0;
+  for (i = 0; i < objCOUNT; i += pinFREQ)
+    if (movedLast[i])
+      ++moved;
+  printf("unpinned: %lu objects moved\n", (unsigned long)moved);
+  Insist(moved > 0);
+
+  mps_unpin(arena, (mps_addr_t)floating);
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+  mps_arena_release(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+
+  test();
+
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -248,6 +248,153 @@ static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
 }
 
 
+/* policyChunkIsSparse -- is a chunk worth evacuating?
+ *
+ * A chunk is worth evacuating if it is not the primary chunk (which
+ * can't be destroyed), if every allocated page in it belongs to a
+ * segment of a moving pool (otherwise it can't become empty), and if
+ * no more than ARENA_COMPACT_OCCUPANCY of its pages are allocated (so
+ * that the survivors are cheap to copy). If so, update
+ * *allocatedReturn with the size of the allocated pages.
+ */
+
+static Bool policyChunkIsSparse(Size *allocatedReturn, Chunk chunk)
+{
+  Arena arena;
+  Count allocated, maxAllocated;
+  Index pi;
+
+  AVER(allocatedReturn != NULL);
+  AVERT(Chunk, chunk);
+  arena = ChunkArena(chunk);
+
+  if (chunk == arena->primary)
+    return FALSE;
+
+  maxAllocated = (Count)((double)(chunk->pages - chunk->allocBase)
+                         * ARENA_COMPACT_OCCUPANCY);
+  allocated = 0;
+  pi = chunk->allocBase;
+  while (pi < chunk->pages) {
+    if (BTGet(chunk->allocTable, pi)) {
+      Tract tract = PageTract(ChunkPage(chunk, pi));
+      Count pages;
+      if (!TractHasSeg(tract)
+          || !PoolHasAttr(TractPool(tract), AttrMOVINGGC))
+        return FALSE;
+      /* Pages are visited in address order, so this is the segment's
+         first tract, and segments don't cross chunks. */
+      AVER(TractBase(tract) == SegBase(TractSeg(tract)));
+      pages = ChunkSizeToPages(chunk, SegSize(TractSeg(tract)));
+      allocated += pages;
+      if (allocated > maxAllocated)
+        return FALSE;
+      pi += pages;
+    } else {
+      ++pi;
+    }
+  }
+
+  *allocatedReturn = ChunkPagesToSize(chunk, allocated);
+  return TRUE;
+}
+
+
+/* policyChooseChunks -- choose chunks for a compaction to evacuate
+ *
+ * Choose sparse chunks for as long as the memory allocated in the
+ * chosen chunks would fit in the free memory outside them, so that
+ * evacuation need not extend the arena. (Otherwise a chunk of
+ * survivors might be evacuated into a new chunk of its own, and back
+ * again at the next compaction.) If evacuate is TRUE, start evacuating
+ * the chosen chunks. Return the number of chunks chosen.
+ */
+
+static Count policyChooseChunks(Arena arena, Bool evacuate)
+{
+  Ring node, next;
+  Size free, survivors = 0;
+  Count chunks = 0;
+
+  AVERT(Arena, arena);
+  AVER(BoolCheck(evacuate));
+
+  if (!arena->hasFreeLand)
+    return 0;
+
+  free = 0;
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    AVER(!chunk->evacuating);
+    free += ChunkPagesToSize(chunk, BTCountResRange(chunk->allocTable,
+                                                    chunk->allocBase,
+                                                    chunk->pages));
+  }
+
+  RING_FOR(node, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, node);
+    Size allocated, chunkFree;
+    if (policyChunkIsSparse(&allocated, chunk)) {
+      chunkFree = ChunkPagesToSize(chunk, chunk->pages - chunk->allocBase)
+                  - allocated;
+      AVER(chunkFree <= free);
+      if (survivors + allocated <= free - chunkFree) {
+        free -= chunkFree;
+        survivors += allocated;
+        ++chunks;
+        if (evacuate)
+          ArenaChunkEvacuate(chunk);
+      }
+    }
+  }
+  return chunks;
+}
+
+
+/* PolicyEvacuateChunks -- start evacuating chunks for a compaction
+ *
+ * Return the number of chunks being evacuated.
+ */
+
+Count PolicyEvacuateChunks(Arena arena)
+{
+  AVERT(Arena, arena);
+  return policyChooseChunks(arena, TRUE);
+}
+
+
+/* PolicyShouldCompact -- should we start a compaction trace?
+ *
+ * Return TRUE if some chunks are worth evacuating.
+ *
+ * .compact.hysteresis: Only consider compaction if the arena has
+ * reserved more address space since the last compaction finished
+ * (see ArenaCompact). Otherwise chunks whose survivors were pinned by
+ * ambiguous references would be condemned over and over again.
+ *
+ * .compact.rate: Choosing chunks looks at the allocation table of
+ * every chunk, so ArenaStep only does it once in each
+ * ARENA_COMPACT_CHECK_INTERVAL, not on every idle step.
+ */
+
+Bool PolicyShouldCompact(Arena arena, Clock now, Clock clocks_per_sec)
+{
+  double sinceLastCheck;
+
+  AVERT(Arena, arena);
+
+  if (ArenaReserved(arena) <= arena->compactReserved)
+    return FALSE;
+
+  sinceLastCheck = (now - arena->lastCompactCheck) / (double)clocks_per_sec;
+  if (sinceLastCheck < ARENA_COMPACT_CHECK_INTERVAL)
+    return FALSE;
+  arena->lastCompactCheck = now;
+
+  return policyChooseChunks(arena, FALSE) > 0;
+}
+
+
 /* PolicyStartTrace -- consider starting a trace
  *
  * If collectWorldAllowed is TRUE, consider starting a collection of
@@ -45,6 +45,8 @@ Bool PoolClassCheck(PoolClass klass)
   CHECKL(FUNCHECK(klass->init));
   CHECKL(FUNCHECK(klass->alloc));
   CHECKL(FUNCHECK(klass->free));
+  CHECKL(FUNCHECK(klass->allocFast));
+  CHECKL(FUNCHECK(klass->freeFast));
   CHECKL(FUNCHECK(klass->segPoolGen));
   CHECKL(FUNCHECK(klass->bufferFill));
   CHECKL(FUNCHECK(klass->bufferEmpty));
@@ -67,6 +69,8 @@ Bool PoolClassCheck(PoolClass klass)
          (klass->framePop == PoolNoFramePop));
   CHECKL((klass->rampBegin == PoolNoRampBegin) ==
          (klass->rampEnd == PoolNoRampEnd));
+  CHECKL((klass->allocFast == PoolNoAllocFast) ==
+         (klass->freeFast == PoolNoFreeFast));
   
   CHECKS(PoolClass, klass);
   return TRUE;
@@ -90,11 +94,16 @@ Bool PoolCheck(Pool pool)
   CHECKD_NOSIG(Ring, &pool->bufferRing);
   /* Cannot check pool->bufferSerial */
   CHECKD_NOSIG(Ring, &pool->segRing);
+  CHECKD_NOSIG(Ring, &pool->sacRing);
+  CHECKD_NOSIG(Ring, &pool->tlapRing);
   CHECKL(AlignCheck(pool->alignment));
   CHECKL(ShiftCheck(pool->alignShift));
   CHECKL(pool->alignment == PoolGrainsSize(pool, (Align)1));
   if (pool->format != NULL)
     CHECKD(Format, pool->format);
+  if (pool->lock != NULL)
+    CHECKL(LockCheck(pool->lock));
+  /* Can't check fastFillSize without claiming the pool lock. */
   return TRUE;
 }
 
@@ -192,6 +201,13 @@ void PoolDestroy(Pool pool)
   AVERT(Pool, pool); 
   arena = pool->arena;
   size = ClassOfPoly(Pool, pool)->size;
+  TLAPPoolFinish(pool);
+  if (pool->lock != NULL) {
+    ArenaGlobals(arena)->fillMutatorSize += pool->fastFillSize;
+    LockFinish(pool->lock);
+    ControlFree(arena, pool->lock, LockSize());
+    pool->lock = NULL;
+  }
   PoolFinish(pool);
 
   /* .space.free: Free the pool instance structure.  See .space.alloc */
@@ -199,6 +215,57 @@ void PoolDestroy(Pool pool)
 }
 
 
+/* PoolLockCreate -- give a client pool its own lock
+ *
+ * .lock: A pool whose class implements the allocFast or freeFast
+ * methods gets a pool lock when it is created by the client.  The
+ * pool lock protects the class-specific state of the pool, so that
+ * mps_alloc and mps_free can run the fast methods while holding the
+ * pool lock alone, without entering the arena.  This means that
+ * allocation in manual pools does not wait for a collection that
+ * holds the arena lock.
+ *
+ * .lock.order: The arena lock is always claimed before the pool lock.
+ * A thread holding only the pool lock must not claim the arena lock,
+ * so the fast methods must not call ArenaAlloc, ArenaFree, or anything
+ * else that needs the arena (including emitting events, because the
+ * event buffers are protected by the arena lock).  If a fast method
+ * can't complete without the arena it returns FALSE and the caller
+ * takes the slow path, which enters the arena and then claims the
+ * pool lock.  Generic functions that call class methods with the
+ * arena lock held (PoolAlloc, PoolFree, BufferFill and so on) claim
+ * the pool lock using PoolClaim.
+ *
+ * Pools created internally by the MPS (and the control pool) have no
+ * lock, so they pay only the cost of a test in PoolClaim.
+ */
+
+Res PoolLockCreate(Pool pool)
+{
+  PoolClass klass;
+  Arena arena;
+  void *p;
+  Res res;
+
+  AVERT(Pool, pool);
+  AVER(pool->lock == NULL);
+  klass = ClassOfPoly(Pool, pool);
+  arena = PoolArena(pool);
+
+  if (klass->allocFast == PoolNoAllocFast)
+    return ResOK;
+
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    return res;
+  LockInit(p);
+  pool->lock = p;
+  pool->fastFillSize = 0;
+  AVERT(Pool, pool);
+  return ResOK;
+}
+
+
 /* PoolDefaultBufferClass -- return the buffer class used by the pool */
 
 BufferClass PoolDefaultBufferClass(Pool pool)
@@ -222,17 +289,23 @@ Res PoolAlloc(Addr *pReturn, Pool pool, Size size)
   AVERT_CRITICAL(Pool, pool);
   AVER_CRITICAL(size > 0);
 
+  PoolClaim(pool);
   res = Method(Pool, pool, alloc)(pReturn, pool, size);
-  if (res != ResOK)
+  if (res != ResOK) {
+    PoolRelease(pool);
     return res;
+  }
   /* Make sure that the allocated address was in the pool's memory. */
   AVER_CRITICAL(PoolHasAddr(pool, *pReturn));
   /* All allocations should be aligned to the pool's alignment */
   AVER_CRITICAL(AddrIsAligned(*pReturn, pool->alignment));
 
   /* All PoolAllocs should advance the allocation clock, so we count */
-  /* it all in the fillMutatorSize field. */
-  ArenaGlobals(PoolArena(pool))->fillMutatorSize += size;
+  /* it all in the fillMutatorSize field, including allocations made */
+  /* by PoolAllocFast since the last time.  See .lock.clock. */
+  ArenaGlobals(PoolArena(pool))->fillMutatorSize += size + pool->fastFillSize;
+  pool->fastFillSize = 0;
+  PoolRelease(pool);
 
   EVENT_CRITICAL3(PoolAlloc, pool, *pReturn, size);
 
@@ -257,6 +330,83 @@ void (PoolFree)(Pool pool, Addr old, Size size)
 }
 
 
+/* PoolAllocFast -- try to allocate without entering the arena
+ *
+ * Called by mps_alloc without the arena lock, for pools that have a
+ * pool lock.  Returns TRUE and updates *pReturn if the pool class
+ * could allocate the block holding only the pool lock, or FALSE if
+ * the caller must fall back to PoolAlloc.  See .lock.
+ *
+ * .lock.clock: Allocations made here are counted in fastFillSize
+ * rather than in the arena's fillMutatorSize, which is protected by
+ * the arena lock.  When fastFillSize reaches POOL_FAST_FILL_LIMIT
+ * this returns FALSE, so that the slow path advances the allocation
+ * clock and polls the arena.
+ *
+ * .lock.event: PoolAllocFast and PoolFreeFast emit no events.  If
+ * the PoolAlloc and PoolFree events are being recorded, they decline,
+ * so that the telemetry stream stays complete.
+ */
+
+Bool PoolAllocFast(Addr *pReturn, Pool pool, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVER_CRITICAL(pool->lock != NULL);
+  AVER_CRITICAL(size > 0);
+
+#ifdef EVENT
+  if (BS_IS_MEMBER(EventKindControl, EventPoolAllocKind))
+    return FALSE;
+#endif
+
+  LockClaimRecursive(pool->lock);
+  AVERT_CRITICAL(Pool, pool);
+  b = FALSE;
+  if (pool->fastFillSize < POOL_FAST_FILL_LIMIT) {
+    b = Method(Pool, pool, allocFast)(pReturn, pool, size);
+    if (b) {
+      /* Can't check PoolHasAddr without the arena lock. */
+      AVER_CRITICAL(AddrIsAligned(*pReturn, pool->alignment));
+      pool->fastFillSize += size;
+    }
+  }
+  LockReleaseRecursive(pool->lock);
+  return b;
+}
+
+
+/* PoolFreeFast -- try to free without entering the arena
+ *
+ * Called by mps_free without the arena lock, for pools that have a
+ * pool lock.  Returns TRUE if the pool class freed the block holding
+ * only the pool lock, or FALSE if the caller must fall back to
+ * PoolFree.  See .lock.
+ */
+
+Bool PoolFreeFast(Pool pool, Addr old, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(pool->lock != NULL);
+  AVER_CRITICAL(old != NULL);
+  AVER_CRITICAL(size > 0);
+
+#ifdef EVENT
+  if (BS_IS_MEMBER(EventKindControl, EventPoolFreeKind))
+    return FALSE;
+#endif
+
+  LockClaimRecursive(pool->lock);
+  AVERT_CRITICAL(Pool, pool);
+  AVER_CRITICAL(AddrIsAligned(old, pool->alignment));
+  b = Method(Pool, pool, freeFast)(pool, old, size);
+  LockReleaseRecursive(pool->lock);
+  return b;
+}
+
+
 /* PoolSegPoolGen -- get pool generation for a segment */
 
 PoolGen PoolSegPoolGen(Pool pool, Seg seg)
@@ -279,7 +429,9 @@ void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p)
   AVER(FUNCHECK(f));
   /* p is arbitrary, hence can't be checked. */
 
+  PoolClaim(pool);
   Method(Pool, pool, freewalk)(pool, f, p);
+  PoolRelease(pool);
 }
 
 
@@ -287,9 +439,14 @@ void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p)
 
 Size PoolTotalSize(Pool pool)
 {
+  Size size;
+
   AVERT(Pool, pool);
 
-  return Method(Pool, pool, totalSize)(pool);
+  PoolClaim(pool);
+  size = Method(Pool, pool, totalSize)(pool);
+  PoolRelease(pool);
+  return size;
 }
 
 
@@ -297,9 +454,14 @@ Size PoolTotalSize(Pool pool)
 
 Size PoolFreeSize(Pool pool)
 {
+  Size size;
+
   AVERT(Pool, pool);
 
-  return Method(Pool, pool, freeSize)(pool);
+  PoolClaim(pool);
+  size = Method(Pool, pool, freeSize)(pool);
+  PoolRelease(pool);
+  return size;
 }
 
 
@@ -307,7 +469,13 @@ Size PoolFreeSize(Pool pool)
 
 Res PoolDescribe(Pool pool, mps_lib_FILE *stream, Count depth)
 {
-  return Method(Inst, pool, describe)(MustBeA(Inst, pool), stream, depth);
+  Res res;
+  Inst inst = MustBeA(Inst, pool);
+
+  PoolClaim(pool);
+  res = Method(Inst, inst, describe)(inst, stream, depth);
+  PoolRelease(pool);
+  return res;
 }
 
 
@@ -85,10 +85,14 @@ Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   RingInit(&pool->arenaRing);
   RingInit(&pool->bufferRing);
   RingInit(&pool->segRing);
+  RingInit(&pool->sacRing);
+  RingInit(&pool->tlapRing);
   pool->bufferSerial = (Serial)0;
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  pool->lock = NULL;
+  pool->fastFillSize = 0;
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -139,6 +143,8 @@ void PoolAbsFinish(Inst inst)
   pool->sig = SigInvalid;
   InstFinish(CouldBeA(Inst, pool));
  
+  RingFinish(&pool->sacRing);
+  RingFinish(&pool->tlapRing);
   RingFinish(&pool->segRing);
   RingFinish(&pool->bufferRing);
   RingFinish(&pool->arenaRing);
@@ -161,6 +167,8 @@ DEFINE_CLASS(Pool, AbstractPool, klass)
   klass->init = PoolAbsInit;
   klass->alloc = PoolNoAlloc;
   klass->free = PoolNoFree;
+  klass->allocFast = PoolNoAllocFast;
+  klass->freeFast = PoolNoFreeFast;
   klass->bufferFill = PoolNoBufferFill;
   klass->bufferEmpty = PoolNoBufferEmpty;
   klass->rampBegin = PoolNoRampBegin;
@@ -230,6 +238,24 @@ void PoolNoFree(Pool pool, Addr old, Size size)
   NOTREACHED;
 }
 
+Bool PoolNoAllocFast(Addr *pReturn, Pool pool, Size size)
+{
+  AVER(pReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(size > 0);
+  NOTREACHED;
+  return FALSE;
+}
+
+Bool PoolNoFreeFast(Pool pool, Addr old, Size size)
+{
+  AVERT(Pool, pool);
+  AVER(old != NULL);
+  AVER(size > 0);
+  NOTREACHED;
+  return FALSE;
+}
+
 void PoolTrivFree(Pool pool, Addr old, Size size)
 {
   AVERT(Pool, pool);
@@ -343,6 +369,16 @@ Res PoolAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
   if (res != ResOK)
     return res;
 
+  if (pool->lock != NULL) {
+    res = WriteF(stream, depth + 2,
+                 "lock contentions $U\n",
+                 (WriteFU)LockContentions(pool->lock),
+                 "fastFillSize $W\n", (WriteFW)pool->fastFillSize,
+                 NULL);
+    if (res != ResOK)
+      return res;
+  }
+
   if (pool->format != NULL) {
     res = FormatDescribe(pool->format, stream, depth + 2);
     if (res != ResOK)
@@ -26,6 +26,10 @@ typedef Bool (*amcPinnedFunction)(AMC amc, Nailboard board, Addr base, Addr limi
 static void amcSegBufferEmpty(Seg seg, Buffer buffer);
 static Res amcSegWhiten(Seg seg, Trace trace);
 static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss);
+static void amcSegSetGrey(Seg seg, TraceSet grey);
+static void amcSegFlip(Seg seg, Trace trace);
+static Res amcSegAccess(Seg seg, Arena arena, Addr addr,
+                        AccessSet mode, MutatorContext context);
 static void amcSegReclaim(Seg seg, Trace trace);
 static Bool amcSegHasNailboard(Seg seg);
 static Nailboard amcSegNailboard(Seg seg);
@@ -64,6 +68,18 @@ typedef struct amcGenStruct {
 
 #define amcGenNr(amcgen) ((amcgen)->pgen.nr)
 
+#define amcSegGrains(seg) \
+  (SegSize(seg) / ArenaGrainSize(PoolArena(SegPool(seg))))
+
+/* Bits in the starts table, and the map between bits and addresses. */
+/* See .seg.starts. */
+#define amcSegStartsBits(seg) \
+  (SegSize(seg) >> SegPool(seg)->alignShift)
+#define amcSegStartsIndex(seg, addr) \
+  ((Index)(AddrOffset(SegBase(seg), addr) >> SegPool(seg)->alignShift))
+#define amcSegStartsAddr(seg, i) \
+  AddrAdd(SegBase(seg), (Size)(i) << SegPool(seg)->alignShift)
+
 
 #define RAMP_RELATION(X)                        \
   X(RampOUTSIDE,        "outside ramp")         \
@@ -99,6 +115,25 @@ enum {
  * collection via TracePoll), and by hash array allocations (where we
  * don't want the allocation to provoke a collection that makes the
  * location dependency stale immediately).
+ *
+ * .seg.scanned: The "scanned" bit table has one bit for each arena
+ * grain in the segment, set if the grain has been scanned by
+ * amcSegAccess for the traces "scannedTraces", or is NULL if no grain
+ * has been scanned that way. <design/poolamc#.access.part>.
+ *
+ * .seg.firsts: The "firsts" table has one entry for each arena grain
+ * in the segment, holding the client pointer of the first object that
+ * ends after the base of the grain.  It is only valid for the first
+ * "firstsCount" grains, and it lives and dies with "scanned".
+ * <design/poolamc#.access.part.firsts>.
+ *
+ * .seg.starts: The "starts" bit table has one bit for each pool
+ * alignment grain in the segment, set if an object starts there.  It
+ * is only valid for the objects between the base of the segment and
+ * "startsLimit", which is always an object boundary.  It is NULL if
+ * the segment has no nailboard, if the segment contains no references
+ * (so is never scanned), or if there wasn't memory for it.
+ * <design/poolamc#.starts>.
  */
 
 typedef struct amcSegStruct *amcSeg;
@@ -110,6 +145,12 @@ typedef struct amcSegStruct {
   amcGen gen;               /* generation this segment belongs to */
   Nailboard board;          /* nailboard for this segment or NULL if none */
   Size forwarded[TraceLIMIT]; /* size of objects forwarded for each trace */
+  BT scanned;               /* .seg.scanned */
+  TraceSet scannedTraces;   /* traces for which scanned grains are black */
+  Addr *firsts;             /* .seg.firsts */
+  Count firstsCount;        /* number of grains with valid firsts */
+  BT starts;                /* .seg.starts */
+  Addr startsLimit;         /* limit of objects recorded in starts */
   BOOLFIELD(accountedAsBuffered); /* .seg.accounted-as-buffered */
   BOOLFIELD(old);           /* .seg.old */
   BOOLFIELD(deferred);      /* .seg.deferred */
@@ -127,6 +168,17 @@ static Bool amcSegCheck(amcSeg amcseg)
     CHECKD(Nailboard, amcseg->board);
     CHECKL(SegNailed(MustBeA(Seg, amcseg)) != TraceSetEMPTY);
   }
+  CHECKL(TraceSetCheck(amcseg->scannedTraces));
+  CHECKL((amcseg->scanned == NULL)
+         == (amcseg->scannedTraces == TraceSetEMPTY));
+  CHECKL((amcseg->scanned == NULL) == (amcseg->firsts == NULL));
+  CHECKL(amcseg->firstsCount == 0 || amcseg->firsts != NULL);
+  if (amcseg->starts != NULL) {
+    Seg seg = MustBeA(Seg, amcseg);
+    CHECKL(amcseg->board != NULL);
+    CHECKL(SegBase(seg) <= amcseg->startsLimit);
+    CHECKL(amcseg->startsLimit <= SegLimit(seg));
+  }
   /* CHECKL(BoolCheck(amcseg->accountedAsBuffered)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->old)); <design/type#.bool.bitfield.check> */
   /* CHECKL(BoolCheck(amcseg->deferred)); <design/type#.bool.bitfield.check> */
@@ -157,6 +209,12 @@ static Res AMCSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
 
   amcseg->gen = amcgen;
   amcseg->board = NULL;
+  amcseg->scanned = NULL;
+  amcseg->scannedTraces = TraceSetEMPTY;
+  amcseg->firsts = NULL;
+  amcseg->firstsCount = 0;
+  amcseg->starts = NULL;
+  amcseg->startsLimit = base;
   amcseg->accountedAsBuffered = FALSE;
   amcseg->old = FALSE;
   amcseg->deferred = FALSE;
@@ -176,6 +234,11 @@ static void amcSegFinish(Inst inst)
   Seg seg = MustBeA(Seg, inst);
   amcSeg amcseg = MustBeA(amcSeg, seg);
 
+  if (amcseg->scanned != NULL) {
+    Arena arena = PoolArena(SegPool(seg));
+    BTDestroy(amcseg->scanned, arena, amcSegGrains(seg));
+    ControlFree(arena, amcseg->firsts, amcSegGrains(seg) * sizeof(Addr));
+  }
   amcseg->sig = SigInvalid;
 
   /* finish the superclass fields last */
@@ -360,11 +423,14 @@ DEFINE_CLASS(Seg, amcSeg, klass)
   klass->init = AMCSegInit;
   klass->bufferEmpty = amcSegBufferEmpty;
   klass->whiten = amcSegWhiten;
+  klass->setGrey = amcSegSetGrey;
+  klass->flip = amcSegFlip;
   klass->scan = amcSegScan;
   klass->fix = amcSegFix;
   klass->fixEmergency = amcSegFixEmergency;
   klass->reclaim = amcSegReclaim;
   klass->walk = amcSegWalk;
+  klass->access = amcSegAccess;
   AVERT(SegClass, klass);
 }
 
@@ -422,6 +488,7 @@ typedef struct AMCStruct { /* <design/poolamc#.struct> */
   amcPinnedFunction pinned; /* function determining if block is pinned */
   Size extendBy;           /* segment size to extend pool by */
   Size largeSize;          /* min size of "large" segments */
+  Size fillMax;            /* max segment size for small requests */
   Sig sig;                 /* <design/pool#.outer-structure.sig> */
 } AMCStruct;
 
@@ -670,15 +737,164 @@ static Res amcSegCreateNailboard(Seg seg)
 
   amcseg->board = board;
 
+  /* The starts table is optional, so carry on without it if it */
+  /* can't be allocated.  A segment without references is only */
+  /* walked once, by reclaim, so the table wouldn't pay for itself. */
+  /* See .seg.starts. */
+  AVER(amcseg->starts == NULL);
+  if (SegRankSet(seg) != RankSetEMPTY) {
+    res = BTCreate(&amcseg->starts, arena, amcSegStartsBits(seg));
+    if (res != ResOK)
+      amcseg->starts = NULL;
+  }
+  amcseg->startsLimit = SegBase(seg);
+
   return ResOK;
 }
 
 
+/* amcSegDestroyNailboard -- destroy nailboard for segment */
+
+static void amcSegDestroyNailboard(Seg seg)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Arena arena = PoolArena(SegPool(seg));
+
+  AVER(amcSegHasNailboard(seg));
+  NailboardDestroy(amcseg->board, arena);
+  amcseg->board = NULL;
+  if (amcseg->starts != NULL) {
+    BTDestroy(amcseg->starts, arena, amcSegStartsBits(seg));
+    amcseg->starts = NULL;
+  }
+  amcseg->startsLimit = SegBase(seg);
+}
+
+
+/* amcSegNextObject -- return the base of the object following p
+ *
+ * p is the base of an object in the segment (not its client
+ * pointer).  If the starts table covers p, the next object is found
+ * in the table, without touching the object.  Otherwise the format's
+ * skip method is called, and if p is at the limit of the table, the
+ * object is added to it.  See <design/poolamc#.starts>.
+ */
+
+static Addr amcSegNextObject(Seg seg, Format format, Addr p)
+{
+  amcSeg amcseg = MustBeA_CRITICAL(amcSeg, seg);
+  BT starts = amcseg->starts;
+  Addr q;
+
+  if (starts != NULL && p < amcseg->startsLimit) {
+    Index i = amcSegStartsIndex(seg, p);
+    Index limit = amcSegStartsIndex(seg, amcseg->startsLimit);
+    Index base = i + 1, next = limit;
+    Bool found;
+    AVER_CRITICAL(BTGet(starts, i));
+    if (i + 1 == limit)
+      return amcseg->startsLimit;
+    if (BTGet(starts, i + 1))
+      return amcSegStartsAddr(seg, i + 1);
+    found = BTFindLongResRange(&base, &next, starts, i + 1, limit, 1);
+    AVER_CRITICAL(found);
+    AVER_CRITICAL(base == i + 1);
+    UNUSED(found);
+    if (next == limit)
+      return amcseg->startsLimit;
+    return amcSegStartsAddr(seg, next);
+  }
+
+  q = AddrSub((*format->skip)(AddrAdd(p, format->headerSize)),
+              format->headerSize);
+  AVER_CRITICAL(p < q);
+  AVER_CRITICAL(q <= SegLimit(seg));
+  if (starts != NULL && p == amcseg->startsLimit) {
+    Index i = amcSegStartsIndex(seg, p);
+    Index next = amcSegStartsIndex(seg, q);
+    BTSet(starts, i);
+    if (i + 1 < next)
+      BTResRange(starts, i + 1, next);
+    amcseg->startsLimit = q;
+  }
+  return q;
+}
+
+
+/* amcSegObjectBase -- find the object containing an address
+ *
+ * If the starts table covers addr, returns TRUE and sets *baseReturn
+ * to the base of the object containing addr.  Returns FALSE if the
+ * table doesn't cover addr.
+ */
+
+static Bool amcSegObjectBase(Addr *baseReturn, Seg seg, Addr addr)
+{
+  amcSeg amcseg = MustBeA_CRITICAL(amcSeg, seg);
+  BT starts = amcseg->starts;
+  Index i, base, limit;
+  Bool found;
+
+  if (starts == NULL || addr >= amcseg->startsLimit)
+    return FALSE;
+  AVER_CRITICAL(SegBase(seg) <= addr);
+
+  i = amcSegStartsIndex(seg, addr);
+  if (!BTGet(starts, i)) {
+    /* The base of the segment is always the start of an object, so */
+    /* there must be a set bit below i. */
+    base = limit = i;
+    found = BTFindLongResRangeHigh(&base, &limit, starts, 0, i + 1, 1);
+    AVER_CRITICAL(found);
+    AVER_CRITICAL(limit == i + 1);
+    UNUSED(found);
+    AVER_CRITICAL(base > 0);
+    i = base - 1;
+  }
+  *baseReturn = amcSegStartsAddr(seg, i);
+  return TRUE;
+}
+
+
+/* amcSegStartsPad -- note that a run of objects has become one pad */
+
+static void amcSegStartsPad(Seg seg, Addr base, Size size)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Addr limit = AddrAdd(base, size);
+
+  if (amcseg->starts != NULL && limit <= amcseg->startsLimit) {
+    Index i = amcSegStartsIndex(seg, base);
+    Index next = amcSegStartsIndex(seg, limit);
+    AVER(BTGet(amcseg->starts, i));
+    if (i + 1 < next)
+      BTResRange(amcseg->starts, i + 1, next);
+  }
+}
+
+
+/* amcPinnedSaturated -- block is pinned by a saturated nailboard
+ *
+ * A saturated nailboard has all its nails set, but it may have become
+ * saturated after some objects in the segment were forwarded, so it
+ * only pins the objects that have not moved, just as if the segment
+ * had been nailed without a nailboard. <design/poolamc#.pin.saturated>
+ */
+
+static Bool amcPinnedSaturated(AMC amc, Addr base)
+{
+  Format format = MustBeA(AbstractPool, amc)->format;
+  return (*format->isMoved)(base) == (Addr)0;
+}
+
+
 /* amcPinnedInterior -- block is pinned by any nail */
 
 static Bool amcPinnedInterior(AMC amc, Nailboard board, Addr base, Addr limit)
 {
   Size headerSize = MustBeA(AbstractPool, amc)->format->headerSize;
+  if (NailboardSaturated(board))
+    return amcPinnedSaturated(amc, base);
   return !NailboardIsResRange(board, AddrSub(base, headerSize),
                               AddrSub(limit, headerSize));
 }
@@ -688,8 +904,9 @@ static Bool amcPinnedInterior(AMC amc, Nailboard board, Addr base, Addr limit)
 
 static Bool amcPinnedBase(AMC amc, Nailboard board, Addr base, Addr limit)
 {
-  UNUSED(amc);
   UNUSED(limit);
+  if (NailboardSaturated(board))
+    return amcPinnedSaturated(amc, base);
   return NailboardGet(board, base);
 }
 
@@ -785,6 +1002,11 @@ static Res amcInitComm(Pool pool, Arena arena, PoolClass klass,
   /* .extend-by.aligned: extendBy is aligned to the arena alignment. */
   amc->extendBy = SizeArenaGrains(extendBy, arena);
   amc->largeSize = largeSize;
+  /* .fill.max: Segments for small requests are at most largeSize, */
+  /* but the pool must still be able to extend by extendBy. */
+  amc->fillMax = SizeAlignDown(largeSize, ArenaGrainSize(arena));
+  if (amc->fillMax < amc->extendBy)
+    amc->fillMax = amc->extendBy;
 
   SetClassOfPoly(pool, klass);
   amc->sig = AMCSig;
@@ -919,7 +1141,7 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   Res res;
   Addr base, limit;
   Arena arena;
-  Size grainsSize;
+  Size grainsSize, fillSize;
   amcGen gen;
   PoolGen pgen;
   amcBuf amcbuf = MustBeA(amcBuf, buffer);
@@ -939,8 +1161,12 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* Create and attach segment.  The location of this segment is */
   /* expressed via the pool generation. We rely on the arena to */
   /* organize locations appropriately.  */
-  if (size < amc->extendBy) {
-    grainsSize = amc->extendBy; /* .extend-by.aligned */
+  /* .fill.adapt: Small requests get a segment of between extendBy */
+  /* and largeSize, depending on how fast the buffer allocates. */
+  /* See <code/buffer.c#.fill.adapt>. */
+  fillSize = BufferFillSize(buffer, amc->extendBy, amc->fillMax);
+  if (size < fillSize) {
+    grainsSize = SizeArenaGrains(fillSize, arena);
   } else {
     grainsSize = SizeArenaGrains(size, arena);
   }
@@ -1186,9 +1412,14 @@ static Res amcSegWhiten(Seg seg, Trace trace)
               return ResOK;
             }
             if (bufferScanLimit != BufferLimit(buffer)) {
-              NailboardSetRange(amcSegNailboard(seg),
-                                bufferScanLimit,
-                                BufferLimit(buffer));
+              res = NailboardSetRange(amcSegNailboard(seg),
+                                      bufferScanLimit,
+                                      BufferLimit(buffer));
+              if (res != ResOK) {
+                /* Can't nail the buffer, don't condemn. */
+                amcSegDestroyNailboard(seg);
+                return ResOK;
+              }
             }
             STATISTIC(++trace->nailCount);
             SegSetNailed(seg, TraceSetSingle(trace));
@@ -1219,6 +1450,22 @@ static Res amcSegWhiten(Seg seg, Trace trace)
     }
   }
 
+  /* .pin: If the segment contains pinned objects, give it a nailboard */
+  /* now, so that when the pins are fixed at flip they nail just the */
+  /* pinned objects and the rest of the segment stays mobile.  See */
+  /* <design/poolamc#.pin>. */
+  if (!amcSegHasNailboard(seg) && SegNailed(seg) == TraceSetEMPTY
+      && SegPinned(seg))
+  {
+    res = amcSegCreateNailboard(seg);
+    if (res != ResOK) {
+      /* Can't create nailboard, don't condemn. */
+      return ResOK;
+    }
+    STATISTIC(++trace->nailCount);
+    SegSetNailed(seg, TraceSetSingle(trace));
+  }
+
   gen = amcSegGen(seg);
   AVERT(amcGen, gen);
   if (!amcseg->old) {
@@ -1262,8 +1509,8 @@ static Res amcSegWhiten(Seg seg, Trace trace)
  * limit have been scanned.  It is not touched otherwise.
  */
 static Res amcSegScanNailedRange(Bool *totalReturn, Bool *moreReturn,
-                                 ScanState ss, AMC amc, Nailboard board,
-                                 Addr base, Addr limit)
+                                 ScanState ss, AMC amc, Seg seg,
+                                 Nailboard board, Addr base, Addr limit)
 {
   Format format;
   Size headerSize;
@@ -1275,7 +1522,8 @@ static Res amcSegScanNailedRange(Bool *totalReturn, Bool *moreReturn,
   clientLimit = AddrAdd(limit, headerSize);
   while (p < clientLimit) {
     Addr q;
-    q = (*format->skip)(p);
+    q = AddrAdd(amcSegNextObject(seg, format, AddrSub(p, headerSize)),
+                headerSize);
     if ((*amc->pinned)(amc, board, p, q)) {
       Res res = FormatScan(format, ss, p, q);
       if(res != ResOK) {
@@ -1323,7 +1571,7 @@ static Res amcSegScanNailedOnce(Bool *totalReturn, Bool *moreReturn,
       goto returnGood;
     }
     res = amcSegScanNailedRange(totalReturn, moreReturn,
-                                ss, amc, board, p, limit);
+                                ss, amc, seg, board, p, limit);
     if (res != ResOK)
       return res;
     p = limit;
@@ -1332,7 +1580,7 @@ static Res amcSegScanNailedOnce(Bool *totalReturn, Bool *moreReturn,
   limit = SegLimit(seg);
   /* @@@@ Shouldn't p be set to BufferLimit here?! */
   res = amcSegScanNailedRange(totalReturn, moreReturn,
-                              ss, amc, board, p, limit);
+                              ss, amc, seg, board, p, limit);
   if (res != ResOK)
     return res;
 
@@ -1363,7 +1611,9 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
   if(loops > 1) {
     RefSet refset;
 
-    AVER(ArenaEmergency(PoolArena(pool)));
+    /* Only the emergency fix nails objects in the segment being */
+    /* scanned.  See <code/trace.c#.flip.handshake.move>. */
+    AVER(ArenaEmergency(PoolArena(pool)) || ss->fix == SegFixEmergency);
 
     /* Looped: fixed refs (from 1st pass) were seen by MPS_FIX1
      * (in later passes), so the "ss.unfixedSummary" is _not_
@@ -1377,8 +1627,10 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
     refset = ScanStateSummary(ss);
 
     /* A rare event, which might prompt a rare defect to appear. */
-    EVENT6(AMCScanNailed, loops, SegSummary(seg), ScanStateWhite(ss),
-           ScanStateUnfixedSummary(ss), ss->fixedSummary, refset);
+    EVENT6(AMCScanNailed, loops, ZoneSetFold(SegSummary(seg)),
+           ZoneSetFold(ScanStateWhite(ss)),
+           ZoneSetFold(ScanStateUnfixedSummary(ss)),
+           ZoneSetFold(ss->fixedSummary), ZoneSetFold(refset));
 
     ScanStateSetSummary(ss, refset);
   }
@@ -1450,6 +1702,201 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
 }
 
 
+/* amcSegScannedReset -- forget the grains scanned by barrier hits
+ *
+ * Give the whole segment back the protection the shield thinks it
+ * has, and discard the record of scanned grains.
+ * <design/poolamc#.access.part.reset>.
+ */
+
+static void amcSegScannedReset(Seg seg)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+
+  if (amcseg->scanned != NULL) {
+    Arena arena = PoolArena(SegPool(seg));
+    ProtSet(SegBase(seg), SegLimit(seg), SegPM(seg));
+    BTDestroy(amcseg->scanned, arena, amcSegGrains(seg));
+    ControlFree(arena, amcseg->firsts, amcSegGrains(seg) * sizeof(Addr));
+    amcseg->scanned = NULL;
+    amcseg->scannedTraces = TraceSetEMPTY;
+    amcseg->firsts = NULL;
+    amcseg->firstsCount = 0;
+  }
+}
+
+
+/* amcSegSetGrey -- change greyness of an AMC segment
+ *
+ * As mutatorSegSetGrey, but if the set of flipped traces for which
+ * the segment is grey changes, the grains scanned by barrier hits are
+ * no longer black for the right traces.
+ */
+
+static void amcSegSetGrey(Seg seg, TraceSet grey)
+{
+  TraceSet flipped = PoolArena(SegPool(seg))->flippedTraces;
+  TraceSet oldGrey = SegGrey(seg);
+
+  NextMethod(Seg, amcSeg, setGrey)(seg, grey);
+
+  if (TraceSetInter(oldGrey, flipped) != TraceSetInter(grey, flipped))
+    amcSegScannedReset(seg);
+}
+
+
+/* amcSegFlip -- update barriers of an AMC segment for a flip */
+
+static void amcSegFlip(Seg seg, Trace trace)
+{
+  NextMethod(Seg, amcSeg, flip)(seg, trace);
+  amcSegScannedReset(seg);
+}
+
+
+/* amcSegAccessPartOK -- can a read barrier hit scan part of the seg? */
+
+static Bool amcSegAccessPartOK(Seg seg, Arena arena, TraceSet ts)
+{
+  Buffer buffer;
+
+  return SegSize(seg) >= AMC_ACCESS_PART_MIN
+    && SizeIsAligned(ArenaGrainSize(arena), ProtGranularity())
+    && ts != TraceSetEMPTY
+    && SegRankSet(seg) == RankSetSingle(RankEXACT)
+    && !amcSegHasNailboard(seg)
+    && !SegBuffer(&buffer, seg);
+}
+
+
+/* amcSegScanGrain -- scan the objects overlapping a grain of a seg
+ *
+ * Scan, for the traces ts, every object in the segment that overlaps
+ * grain i, which is [base, limit).  The segment has no buffer, so its
+ * objects run without a gap from the base of the segment to its limit.
+ */
+
+static void amcSegScanGrain(Seg seg, Arena arena, TraceSet ts,
+                            Index i, Addr base, Addr limit)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Format format = SegPool(seg)->format;
+  Size headerSize = format->headerSize;
+  Size grainSize = ArenaGrainSize(arena);
+  Addr segLimit = AddrAdd(SegLimit(seg), headerSize);
+  Addr p, q;
+
+  AVER(i < amcSegGrains(seg));
+
+  ShieldExpose(arena, seg);
+
+  /* Find the first object that ends after the base of the grain.  If
+   * firsts doesn't know it yet, carry on from the last grain it does
+   * know, so that each object is skipped at most once in the lifetime
+   * of the table.  See .seg.firsts. */
+  if (i >= amcseg->firstsCount) {
+    Index j = amcseg->firstsCount;
+    p = (j == 0) ? AddrAdd(SegBase(seg), headerSize) : amcseg->firsts[j - 1];
+    for (; j <= i; ++j) {
+      Addr grainBase = AddrAdd(SegBase(seg), j * grainSize + headerSize);
+      for (;;) {
+        AVER(p < segLimit);
+        q = (*format->skip)(p);
+        if (q > grainBase)
+          break;
+        p = q;
+      }
+      amcseg->firsts[j] = p;
+    }
+    amcseg->firstsCount = i + 1;
+  }
+  p = amcseg->firsts[i];
+  AVER(p <= AddrAdd(base, headerSize));
+
+  /* Find the first object that starts at or after its limit. */
+  q = (*format->skip)(p);
+  while (q < AddrAdd(limit, headerSize)) {
+    AVER(q < segLimit);
+    q = (*format->skip)(q);
+  }
+
+  TraceScanPart(ts, TraceRankForAccess(arena, seg), arena, seg, p, q);
+
+  ShieldCover(arena, seg);
+}
+
+
+/* amcSegAccess -- handle a barrier hit on an AMC segment
+ *
+ * A read barrier hit on a large grey segment scans only the objects
+ * overlapping the faulting grain and removes the read protection from
+ * that grain, leaving the rest of the segment grey and protected.
+ * <design/poolamc#.access.part>.
+ */
+
+static Res amcSegAccess(Seg seg, Arena arena, Addr addr,
+                        AccessSet mode, MutatorContext context)
+{
+  amcSeg amcseg = MustBeA(amcSeg, seg);
+  Size grainSize;
+  TraceSet ts;
+  Index i;
+  Addr base, limit;
+
+  AVERT(Arena, arena);
+  AVER(SegBase(seg) <= addr);
+  AVER(addr < SegLimit(seg));
+  AVERT(AccessSet, mode);
+  AVERT(MutatorContext, context);
+
+  ts = TraceSetInter(SegGrey(seg), arena->flippedTraces);
+  if ((mode & SegSM(seg) & AccessREAD) == 0
+      || !amcSegAccessPartOK(seg, arena, ts))
+    return NextMethod(Seg, amcSeg, access)(seg, arena, addr, mode, context);
+
+  if (amcseg->scanned == NULL) {
+    void *p;
+    Res res = BTCreate(&amcseg->scanned, arena, amcSegGrains(seg));
+    if (res != ResOK)
+      return NextMethod(Seg, amcSeg, access)(seg, arena, addr, mode, context);
+    res = ControlAlloc(&p, arena, amcSegGrains(seg) * sizeof(Addr));
+    if (res != ResOK) {
+      BTDestroy(amcseg->scanned, arena, amcSegGrains(seg));
+      amcseg->scanned = NULL;
+      return NextMethod(Seg, amcSeg, access)(seg, arena, addr, mode, context);
+    }
+    BTResRange(amcseg->scanned, 0, amcSegGrains(seg));
+    amcseg->scannedTraces = ts;
+    amcseg->firsts = p;
+    amcseg->firstsCount = 0;
+    TraceSegReadHit(seg);
+  }
+  AVER(amcseg->scannedTraces == ts);
+
+  grainSize = ArenaGrainSize(arena);
+  i = AddrOffset(SegBase(seg), addr) / grainSize;
+  base = AddrAdd(SegBase(seg), i * grainSize);
+  limit = AddrAdd(base, grainSize);
+
+  if (BTGet(amcseg->scanned, i)) {
+    /* The grain is black already, so the hit is on the write barrier,
+       or the shield has protected the whole segment again. */
+    if ((mode & SegSM(seg) & AccessWRITE) != 0)
+      TraceSegAccess(arena, seg, AccessWRITE);
+  } else {
+    amcSegScanGrain(seg, arena, ts, i, base, limit);
+    BTSet(amcseg->scanned, i);
+    /* Scanning exposed the segment, and covering it queued it to get */
+    /* its protection back.  Do that now, or ShieldLeave would protect */
+    /* the grain again.  See <design/poolamc#.access.part.prot>. */
+    ShieldFlush(arena);
+  }
+
+  AVER(SegPM(seg) == SegSM(seg));
+  ProtSet(base, limit, BS_DIFF(SegSM(seg), AccessREAD));
+  return ResOK;
+}
+
 /* amcSegFixInPlace -- fix a reference without moving the object
  *
  * Usually this function is used for ambiguous references, but during
@@ -1471,7 +1918,16 @@ static void amcSegFixInPlace(Seg seg, ScanState ss, Ref *refIO)
   AVER(ref < SegLimit(seg));
 
   if(amcSegHasNailboard(seg)) {
-    Bool wasMarked = NailboardSet(amcSegNailboard(seg), ref);
+    Bool wasMarked;
+    Addr base;
+    /* .fix.in-place.base: If interior pointers pin objects, nail the */
+    /* object at its client pointer, so that other references into */
+    /* the same object find it nailed already and don't grey the */
+    /* segment again.  See <design/poolamc#.starts.fix>. */
+    if (MustBeA_CRITICAL(AMCZPool, SegPool(seg))->pinned == amcPinnedInterior
+        && amcSegObjectBase(&base, seg, ref))
+      ref = AddrAdd(base, SegPool(seg)->format->headerSize);
+    wasMarked = NailboardSet(amcSegNailboard(seg), ref);
     /* If there are no new marks (i.e., no new traces for which we */
     /* are marking, and no new mark bits set) then we can return */
     /* immediately, without changing colour. */
@@ -1691,8 +2147,10 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   Count preservedInPlaceCount = (Count)0;
   Size preservedInPlaceSize = (Size)0;
   AMC amc = MustBeA(AMCZPool, pool);
+  amcSeg amcseg = MustBeA(amcSeg, seg);
   PoolGen pgen;
   Size headerSize;
+  Size nailOffset;       /* offset of the pinning nail from object base */
   Addr padBase;          /* base of next padding object */
   Size padLength;        /* length of next padding object */
   Buffer buffer;
@@ -1711,13 +2169,52 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
   limit = SegBufferScanLimit(seg);
   padBase = p;
   padLength = 0;
+  nailOffset = amc->pinned == amcPinnedInterior ? 0 : headerSize;
+
+  if (amcSegHasNailboard(seg) && amcseg->starts != NULL
+      && limit <= amcseg->startsLimit
+      && SizeIsAligned(nailOffset, pool->alignment)) {
+    /* .reclaim.jump: The starts table covers all the objects, so go */
+    /* straight from each nail to the object it might pin, and pad */
+    /* the objects in between without visiting them. */
+    /* <design/poolamc#.reclaim.jump> */
+    Nailboard board = amcSegNailboard(seg);
+    Addr nailLimit = AddrAdd(limit, nailOffset), nail;
+    if (nailLimit > SegLimit(seg))
+      nailLimit = SegLimit(seg);
+    while (AddrAdd(p, nailOffset) < nailLimit
+           && NailboardNext(&nail, board, AddrAdd(p, nailOffset), nailLimit)) {
+      Addr base = p, q;
+      Bool found = amcSegObjectBase(&base, seg, AddrSub(nail, nailOffset));
+      AVER(found);
+      UNUSED(found);
+      AVER(p <= base);
+      q = amcSegNextObject(seg, format, base);
+      if ((*amc->pinned)(amc, board, AddrAdd(base, headerSize),
+                         AddrAdd(q, headerSize))) {
+        ++preservedInPlaceCount;
+        preservedInPlaceSize += AddrOffset(base, q);
+        if (padBase < base) {
+          padLength = AddrOffset(padBase, base);
+          (*format->pad)(padBase, padLength);
+          amcSegStartsPad(seg, padBase, padLength);
+          STATISTIC(bytesReclaimed += padLength);
+        }
+        padBase = q;
+      }
+      p = q;
+    }
+    p = limit;
+    padLength = AddrOffset(padBase, limit);
+  }
+
   while(p < limit) {
     Addr clientP, q, clientQ;
     Size length;
     Bool preserve;
     clientP = AddrAdd(p, headerSize);
-    clientQ = (*format->skip)(clientP);
-    q = AddrSub(clientQ, headerSize);
+    q = amcSegNextObject(seg, format, p);
+    clientQ = AddrAdd(q, headerSize);
     length = AddrOffset(p, q);
     if(amcSegHasNailboard(seg)) {
       preserve = (*amc->pinned)(amc, amcSegNailboard(seg), clientP, clientQ);
@@ -1734,6 +2231,7 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
         /* Replace run of forwarding pointers and unreachable objects
          * with a padding object. */
         (*format->pad)(padBase, padLength);
+        amcSegStartsPad(seg, padBase, padLength);
         STATISTIC(bytesReclaimed += padLength);
         padLength = 0;
       }
@@ -1751,16 +2249,15 @@ static void amcSegReclaimNailed(Pool pool, Trace trace, Seg seg)
     /* Replace final run of forwarding pointers and unreachable
      * objects with a padding object. */
     (*format->pad)(padBase, padLength);
+    amcSegStartsPad(seg, padBase, padLength);
     STATISTIC(bytesReclaimed += padLength);
   }
   ShieldCover(arena, seg);
 
   SegSetNailed(seg, TraceSetDel(SegNailed(seg), trace));
   SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
-  if(SegNailed(seg) == TraceSetEMPTY && amcSegHasNailboard(seg)) {
-    NailboardDestroy(amcSegNailboard(seg), arena);
-    MustBeA(amcSeg, seg)->board = NULL;
-  }
+  if(SegNailed(seg) == TraceSetEMPTY && amcSegHasNailboard(seg))
+    amcSegDestroyNailboard(seg);
 
   STATISTIC(AVER(bytesReclaimed <= SegSize(seg)));
   STATISTIC(trace->reclaimSize += bytesReclaimed);
@@ -2109,6 +2606,8 @@ static Bool AMCCheck(AMC amc)
     CHECKD(amcGen, amc->afterRampGen);
   }
 
+  CHECKL(amc->extendBy <= amc->fillMax);
+
   CHECKL(amc->rampMode >= RampOUTSIDE);
   CHECKL(amc->rampMode <= RampCOLLECTING);
 
@@ -959,6 +959,7 @@ static Res AMSBufferFill(Addr *baseReturn, Addr *limitReturn,
   Ring node, nextNode;
   RankSet rankSet;
   Seg seg;
+  Size fillSize, grainSize;
   Bool b;
 
   AVER(baseReturn != NULL);
@@ -980,8 +981,16 @@ static Res AMSBufferFill(Addr *baseReturn, Addr *limitReturn,
       return ResOK;
   }
 
-  /* No segment had enough space, so make a new one. */
-  res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer));
+  /* No segment had enough space, so make a new one, bigger if the */
+  /* buffer allocates quickly.  See <code/buffer.c#.fill.adapt>. */
+  grainSize = ArenaGrainSize(PoolArena(pool));
+  fillSize = BufferFillSize(buffer, grainSize,
+                            AMS_FILL_MAX < grainSize ? grainSize : AMS_FILL_MAX);
+  if (fillSize < size)
+    fillSize = size;
+  res = AMSSegCreate(&seg, pool, fillSize, BufferRankSet(buffer));
+  if (res != ResOK && fillSize > size)
+    res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer));
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
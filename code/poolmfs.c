@@ -299,6 +299,31 @@ static void MFSFree(Pool pool, Addr old, Size size)
 }
 
 
+/* MFSAllocFast, MFSFreeFast -- allocate and free without the arena
+ *
+ * Allocation succeeds only if there's a unit on the free list, so
+ * that the pool doesn't need to extend.  See <code/pool.c#.lock>.
+ */
+
+static Bool MFSAllocFast(Addr *pReturn, Pool pool, Size size)
+{
+  MFS mfs = MustBeA_CRITICAL(MFSPool, pool);
+  Res res;
+
+  if (mfs->freeList == NULL)
+    return FALSE;
+  res = MFSAlloc(pReturn, pool, size);
+  AVER_CRITICAL(res == ResOK);
+  return TRUE;
+}
+
+static Bool MFSFreeFast(Pool pool, Addr old, Size size)
+{
+  MFSFree(pool, old, size);
+  return TRUE;
+}
+
+
 /* MFSTotalSize -- total memory allocated from the arena */
 
 static Size MFSTotalSize(Pool pool)
@@ -354,6 +379,8 @@ DEFINE_CLASS(Pool, MFSPool, klass)
   klass->init = MFSInit;
   klass->alloc = MFSAlloc;
   klass->free = MFSFree;
+  klass->allocFast = MFSAllocFast;
+  klass->freeFast = MFSFreeFast;
   klass->totalSize = MFSTotalSize;
   klass->freeSize = MFSFreeSize;  
   AVERT(PoolClass, klass);
@@ -330,6 +330,96 @@ static void MVFFFree(Pool pool, Addr old, Size size)
 }
 
 
+/* mvffLandIsFast -- can the free land be updated without the arena?
+ *
+ * The Failover flushes its secondary into its primary on every
+ * operation, which may need any number of CBS blocks, and the CBS
+ * block pool extends itself from the arena when it has no free units.
+ * A single insertion into or deletion from the primary needs at most
+ * one CBS block.  See <code/pool.c#.lock>.
+ */
+
+static Bool mvffLandIsFast(MVFF mvff)
+{
+  Land secondaryLand = MVFFFreeSecondary(mvff);
+  return LandSize(secondaryLand) == 0
+    && PoolFreeSize(MVFFBlockPool(mvff)) > 0;
+}
+
+
+/* MVFFAllocFast -- allocate a block without the arena lock
+ *
+ * Succeeds only if a suitable free block is already in the free land,
+ * so that the pool doesn't need to extend.
+ */
+
+static Bool MVFFAllocFast(Addr *aReturn, Pool pool, Size size)
+{
+  MVFF mvff;
+  RangeStruct range, oldRange;
+  LandFindMethod findMethod;
+  FindDelete findDelete;
+
+  AVER_CRITICAL(aReturn != NULL);
+  AVERT_CRITICAL(Pool, pool);
+  mvff = PoolMVFF(pool);
+  AVERT_CRITICAL(MVFF, mvff);
+  AVER_CRITICAL(size > 0);
+
+  if (!mvffLandIsFast(mvff))
+    return FALSE;
+
+  size = SizeAlignUp(size, PoolAlignment(pool));
+  findMethod = mvff->firstFit ? LandFindFirst : LandFindLast;
+  findDelete = mvff->slotHigh ? FindDeleteHIGH : FindDeleteLOW;
+
+  if (!(*findMethod)(&range, &oldRange, MVFFFreeLand(mvff), size, findDelete))
+    return FALSE;
+
+  AVER_CRITICAL(RangeSize(&range) == size);
+  *aReturn = RangeBase(&range);
+  return TRUE;
+}
+
+
+/* MVFFFreeFast -- free a block without the arena lock
+ *
+ * Succeeds only if MVFFReduce would not return any memory to the
+ * arena after the block is freed.
+ */
+
+static Bool MVFFFreeFast(Pool pool, Addr old, Size size)
+{
+  Res res;
+  RangeStruct range, coalescedRange;
+  MVFF mvff;
+  Size freeLimit;
+  Land totalLand, freeLand;
+
+  AVERT_CRITICAL(Pool, pool);
+  mvff = PoolMVFF(pool);
+  AVERT_CRITICAL(MVFF, mvff);
+  AVER_CRITICAL(old != (Addr)0);
+  AVER_CRITICAL(AddrIsAligned(old, PoolAlignment(pool)));
+  AVER_CRITICAL(size > 0);
+
+  if (!mvffLandIsFast(mvff))
+    return FALSE;
+
+  size = SizeAlignUp(size, PoolAlignment(pool));
+  totalLand = MVFFTotalLand(mvff);
+  freeLimit = (Size)(LandSize(totalLand) * mvff->spare);
+  freeLand = MVFFFreeLand(mvff);
+  if (LandSize(freeLand) + size >= freeLimit)
+    return FALSE;
+
+  RangeInitSize(&range, old, size);
+  res = LandInsert(&coalescedRange, freeLand, &range);
+  AVER_CRITICAL(res == ResOK);
+  return TRUE;
+}
+
+
 /* MVFFBufferFill -- Fill the buffer
  *
  * Fill it with the largest block we can find. This is worst-fit
@@ -689,6 +779,8 @@ DEFINE_CLASS(Pool, MVFFPool, klass)
   klass->init = MVFFInit;
   klass->alloc = MVFFAlloc;
   klass->free = MVFFFree;
+  klass->allocFast = MVFFAllocFast;
+  klass->freeFast = MVFFFreeFast;
   klass->bufferFill = MVFFBufferFill;
   klass->totalSize = MVFFTotalSize;
   klass->freeSize = MVFFFreeSize;
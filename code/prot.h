@@ -25,6 +25,13 @@ extern void ProtSet(Addr base, Addr limit, AccessSet mode);
 extern void ProtSync(Arena arena);
 
 
+/* Protection Shadow -- see <code/protsh.c> */
+
+extern void ProtShadowForget(Addr base, Addr limit);
+extern void ProtShadowRecord(Addr base, Addr limit, AccessSet mode);
+extern Bool ProtShadowAllows(Addr addr, AccessSet mode);
+
+
 #endif /* prot_h */
 
 
@@ -90,8 +90,10 @@ void ProtSet(Addr base, Addr limit, AccessSet mode)
   }
 
   /* .assume.mprotect.base */
+  ProtShadowForget(base, limit);    /* <code/protsh.c#.sound> */
   if(mprotect((void *)base, (size_t)AddrOffset(base, limit), flags) != 0)
     NOTREACHED;
+  ProtShadowRecord(base, limit, mode);
 }
 
 
@@ -0,0 +1,165 @@
+/* protsh.c: PROTECTION SHADOW
+ *
+ * $Id$
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: The protection shadow records the protection most recently
+ * set on pages of managed memory, so that ArenaAccess can recognize a
+ * fault on a page whose protection has already been lowered (for
+ * example, when many threads fault on the same segment at once) and
+ * return without claiming any locks.  See <design/prot#.shadow>.
+ *
+ * .impl: The shadow is a direct-mapped table of ProtShadowLENGTH words,
+ * indexed by the number of the ProtShadowGRAIN-sized grain.  Each word
+ * is zero, or the base of the grain, ORed with the grain's protection
+ * mode and protShadowVALID.  Slots are read and written as single
+ * words, so the table needs no lock.  Grains whose slots collide simply
+ * evict each other: a missing entry only sends the fault down the slow
+ * path.
+ *
+ * .sound: An entry must never claim that a grain is accessible when it
+ * isn't.  ProtSet calls ProtShadowForget before it changes the
+ * protection of a range, and ProtShadowRecord afterwards, both with
+ * the arena lock held.  Only the arena that manages a grain writes an
+ * entry for it, so a grain's entry can only be lost, not resurrected,
+ * by writes from other arenas.  The system call that raises the
+ * protection is ordered after the store that forgot the entry, and a
+ * thread can only fault after that system call.
+ *
+ * .unmap: Memory that leaves the MPS must be forgotten too, otherwise
+ * a later fault there (a client bug, or a protection set by someone
+ * else) would be taken for a spurious one and retried for ever.  So
+ * VMUnmap, the client arena's chunk finish, and RootDestroy (for
+ * protectable roots) call ProtShadowForget.
+ */
+
+#include "mpm.h"
+
+SRCID(protsh, "$Id$");
+
+
+#define protShadowVALID ((Word)1 << 2)
+#define protShadowMODE  ((Word)(AccessREAD | AccessWRITE))
+#define protShadowINDEX(grain) \
+  (((Word)(grain) / ProtShadowGRAIN) & (ProtShadowLENGTH - 1))
+
+static volatile Word protShadow[ProtShadowLENGTH];
+
+
+/* ProtShadowForget -- forget the protection of a range
+ *
+ * Forgets every grain that overlaps [base, limit).
+ */
+
+void ProtShadowForget(Addr base, Addr limit)
+{
+  Addr grain;
+  Index i;
+
+  AVER(base < limit);
+  AVER(ProtShadowGRAIN > protShadowVALID + protShadowMODE);
+  AVER(SizeIsP2(ProtShadowGRAIN));
+  AVER(WordIsP2(ProtShadowLENGTH));
+
+  base = AddrAlignDown(base, ProtShadowGRAIN);
+  if (AddrOffset(base, limit) / ProtShadowGRAIN < ProtShadowLENGTH) {
+    for (grain = base; grain < limit; grain = AddrAdd(grain, ProtShadowGRAIN)) {
+      i = protShadowINDEX(grain);
+      if ((protShadow[i] & ~(protShadowVALID | protShadowMODE))
+          == (Word)grain)
+        protShadow[i] = 0;
+    }
+  } else {
+    /* The range covers every slot: look at each entry instead. */
+    for (i = 0; i < ProtShadowLENGTH; ++i) {
+      Word entry = protShadow[i];
+      grain = (Addr)(entry & ~(protShadowVALID | protShadowMODE));
+      if ((entry & protShadowVALID) != 0 && base <= grain && grain < limit)
+        protShadow[i] = 0;
+    }
+  }
+}
+
+
+/* ProtShadowRecord -- record the protection of a range
+ *
+ * Records the grains that lie entirely within [base, limit), up to
+ * the length of the table.
+ */
+
+void ProtShadowRecord(Addr base, Addr limit, AccessSet mode)
+{
+  Addr grain;
+  Count count;
+
+  AVER(base < limit);
+  AVERT(AccessSet, mode);
+
+  grain = AddrAlignUp(base, ProtShadowGRAIN);
+  for (count = 0; count < ProtShadowLENGTH
+         && AddrAdd(grain, ProtShadowGRAIN) <= limit; ++count) {
+    protShadow[protShadowINDEX(grain)] = (Word)grain | protShadowVALID | mode;
+    grain = AddrAdd(grain, ProtShadowGRAIN);
+  }
+}
+
+
+/* ProtShadowAllows -- is an access already permitted?
+ *
+ * Returns TRUE if the shadow knows that the protection of the grain
+ * containing addr doesn't forbid any access in mode, so that a fault
+ * there was spurious and the access can be retried.  Called from the
+ * fault handler without any locks, so it mustn't check anything that
+ * could be changing.  See .sound.
+ */
+
+Bool ProtShadowAllows(Addr addr, AccessSet mode)
+{
+  Addr grain = AddrAlignDown(addr, ProtShadowGRAIN);
+  Word entry = protShadow[protShadowINDEX(grain)];
+
+  return (entry & ~protShadowMODE) == ((Word)grain | protShadowVALID)
+    && (entry & mode) == 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
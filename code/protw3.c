@@ -31,9 +31,11 @@ void ProtSet(Addr base, Addr limit, AccessSet mode)
   if((mode & AccessREAD) != 0)
     newProtect = PAGE_NOACCESS;
 
+  ProtShadowForget(base, limit);    /* <code/protsh.c#.sound> */
   if(VirtualProtect((LPVOID)base, (SIZE_T)AddrOffset(base, limit),
                     newProtect, &oldProtect) == 0)
     NOTREACHED;
+  ProtShadowRecord(base, limit, mode);
 }
 
 
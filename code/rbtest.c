@@ -0,0 +1,204 @@
+/* rbtest.c: READ BARRIER GRAIN TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Start a collection of a large AMC pool, so that the objects
+ * referenced by the roots are copied into large grey segments at
+ * flip, and then read the objects in order.  A read barrier hit on
+ * such a segment scans only the grain that was hit and unprotects it
+ * <design/poolamc#.access.part>, so reading the objects must take at
+ * most one fault per grain.
+ *
+ * This is a white box test: it counts the faults handled by the
+ * arena.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpm.h"
+#include "mpslib.h"
+#include "mpscamc.h"
+#include "mpsavm.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE     ((size_t)64 << 20)
+#define objCOUNT          8192  /* objects referenced by the roots */
+#define objSLOTS          6     /* slots in each object */
+#define extendBY          ((size_t)64 << 10) /* bigger than AMC_ACCESS_PART_MIN */
+#define collectCOUNT      4
+#define genCOUNT          2
+
+static mps_arena_t arena;
+static mps_ap_t ap;
+static mps_word_t roots[objCOUNT];  /* exact root */
+
+static mps_gen_param_s testChain[genCOUNT] = {
+  { 1024, 0.85 }, { 4096, 0.45 } };
+
+
+/* make -- make a vector whose first slot identifies it, and whose
+ * second slot refers to another object */
+
+static mps_word_t make(size_t id)
+{
+  mps_word_t v, child;
+  die(make_dylan_vector(&v, ap, objSLOTS), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(v, 0) = DYLAN_INT(id);
+  die(make_dylan_vector(&child, ap, 1), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(child, 0) = DYLAN_INT(id);
+  DYLAN_VECTOR_SLOT(v, 1) = child;
+  return v;
+}
+
+
+/* readAll -- read the objects in order, and count the faults
+ *
+ * Reading the objects in the order they were copied visits each grain
+ * of the grey segments once.  Their children aren't read, because they
+ * are copied to other segments when the objects are scanned.  Returns
+ * the number of faults, and sets *grainsReturn to the number of grains
+ * read.
+ */
+
+static Count readAll(Count *grainsReturn)
+{
+  Arena a = (Arena)arena;
+  Size grainSize = ArenaGrainSize(a);
+  Addr lastGrain = NULL;
+  Count grains = 0, faults;
+  Count before = a->accessCount;
+  size_t i;
+
+  for (i = 0; i < objCOUNT; ++i) {
+    Addr grain = AddrAlignDown((Addr)roots[i], grainSize);
+    if (grain != lastGrain) {
+      ++grains;
+      lastGrain = grain;
+    }
+    cdie(DYLAN_VECTOR_SLOT(roots[i], 0) == DYLAN_INT(i), "object id");
+  }
+  faults = a->accessCount - before;
+  *grainsReturn = grains;
+  return faults;
+}
+
+
+static void test(void)
+{
+  mps_fmt_t format;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t root;
+  size_t i, c;
+
+  die(dylan_fmt(&format, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, genCOUNT, testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, extendBY);
+    MPS_ARGS_ADD(args, MPS_KEY_LARGE_SIZE, extendBY);
+    die(mps_pool_create_k(&pool, arena, mps_class_amc(), args),
+        "pool_create(amc)");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create(&ap, pool, mps_rank_exact()), "ap_create");
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           roots, roots + objCOUNT, mps_scan_area, NULL),
+      "root_create_area");
+
+  mps_arena_park(arena);
+  for (i = 0; i < objCOUNT; ++i)
+    roots[i] = make(i);
+
+  for (c = 0; c < collectCOUNT; ++c) {
+    Count faults, grains;
+    die(mps_arena_start_collect(arena), "start_collect");
+    faults = readAll(&grains);
+    printf("collection %lu: %lu faults reading %lu grains\n",
+           (unsigned long)c, (unsigned long)faults, (unsigned long)grains);
+    Insist(faults > 0);
+    Insist(faults <= grains);
+    mps_arena_park(arena);
+  }
+
+  mps_arena_park(arena);
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(format);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_thr_t thread;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    /* Do as little work as possible when the collection starts, so */
+    /* that the segments are still grey when they are read. */
+    MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, 0.0);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  die(mps_thread_reg(&thread, arena), "thread_reg");
+
+  test();
+
+  mps_thread_dereg(thread);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (c) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -51,11 +51,11 @@ ZoneSet ZoneSetOfRange(Arena arena, Addr base, Addr limit)
 
   /* If the range is large enough to span all zones, its zone set is */
   /* universal. */
-  if (zlimit - zbase >= MPS_WORD_WIDTH)
+  if (zlimit - zbase >= ZoneCOUNT)
     return ZoneSetUNIV;
 
-  zbase  &= MPS_WORD_WIDTH - 1;
-  zlimit &= MPS_WORD_WIDTH - 1;
+  zbase  &= ZoneCOUNT - 1;
+  zlimit &= ZoneCOUNT - 1;
 
   /* If the base zone is less than the limit zone, the zone set looks */
   /* like 000111100, otherwise it looks like 111000011. */
@@ -35,6 +35,8 @@ typedef struct RootStruct {
   Addr protBase;                /* base of protectable area */
   Addr protLimit;               /* limit of protectable area */
   AccessSet pm;                 /* Protection Mode */
+  Count cards;                  /* number of cards, or zero */
+  RefSet *cardSummary;          /* summary of each card, <design/root#.card> */
   RootVar var;                  /* union discriminator */
   union RootUnion {
     struct {
@@ -54,10 +56,23 @@ typedef struct RootStruct {
       AreaScanUnion the;
       void *stackCold;          /* cold end of stack */
     } thread;
+    struct {
+      Thread thread;            /* passed to scan */
+      mps_stack_scan_t scan;    /* client's exact stack scanner */
+      void *closure;            /* closure for scan */
+      void *stackCold;          /* cold end of stack */
+    } threadExact;
     struct {
       mps_fmt_scan_t scan;      /* format-like scanner */
       Addr base, limit;         /* passed to scan */
     } fmt;
+    struct {
+      Thread thread;            /* thread running coroutine, or NULL */
+      Word *hot;                /* hot end of suspended stack */
+      Word *cold;               /* cold end of stack */
+      mps_area_scan_t scan_area;/* area scanning function */
+      void *closure;            /* closure for scan_area */
+    } stack;
   } the;
 } RootStruct;
 
@@ -71,7 +86,9 @@ Bool RootVarCheck(RootVar rootVar)
   CHECKL(rootVar == RootAREA || rootVar == RootAREA_TAGGED
          || rootVar == RootFUN || rootVar == RootFMT
          || rootVar == RootTHREAD
-         || rootVar == RootTHREAD_TAGGED);
+         || rootVar == RootTHREAD_TAGGED
+         || rootVar == RootTHREAD_EXACT
+         || rootVar == RootSTACK);
   UNUSED(rootVar);
   return TRUE;
 }
@@ -82,11 +99,14 @@ Bool RootVarCheck(RootVar rootVar)
 Bool RootModeCheck(RootMode mode)
 {
   CHECKL((mode & (RootModeCONSTANT | RootModePROTECTABLE
-                  | RootModePROTECTABLE_INNER))
+                  | RootModePROTECTABLE_INNER | RootModeINCREMENTAL))
          == mode);
   /* RootModePROTECTABLE_INNER implies RootModePROTECTABLE */
   CHECKL((mode & RootModePROTECTABLE_INNER) == 0
          || (mode & RootModePROTECTABLE));
+  /* RootModeINCREMENTAL implies RootModePROTECTABLE */
+  CHECKL((mode & RootModeINCREMENTAL) == 0
+         || (mode & RootModePROTECTABLE));
   UNUSED(mode);
 
   return TRUE;
@@ -145,12 +165,36 @@ Bool RootCheck(Root root)
     /* Can't check anything about stackCold. */
     break;
 
+  case RootTHREAD_EXACT:
+    CHECKL(root->rank == RankEXACT);
+    CHECKD_NOSIG(Thread, root->the.threadExact.thread); /* <design/check#.hidden-type> */
+    CHECKL(FUNCHECK(root->the.threadExact.scan));
+    /* Can't check anything about closure as it could mean anything to
+       scan. */
+    CHECKL(root->the.threadExact.stackCold != NULL);
+    break;
+
   case RootFMT:
     CHECKL(root->the.fmt.scan != NULL);
     CHECKL(root->the.fmt.base != 0);
     CHECKL(root->the.fmt.base < root->the.fmt.limit);
     break;
 
+  case RootSTACK:
+    CHECKL(root->rank == RankAMBIG);
+    CHECKL(root->the.stack.cold != NULL);
+    CHECKL(AddrIsAligned(root->the.stack.cold, sizeof(Word)));
+    CHECKL(AddrIsAligned(root->the.stack.hot, sizeof(Word)));
+    CHECKL(root->the.stack.hot <= root->the.stack.cold);
+    if (root->the.stack.thread != NULL) {
+      CHECKD_NOSIG(Thread, root->the.stack.thread); /* <design/check#.hidden-type> */
+      CHECKL(root->the.stack.hot == root->the.stack.cold);
+    }
+    CHECKL(FUNCHECK(root->the.stack.scan_area));
+    /* Can't check anything about closure as it could mean anything to
+       scan_area. */
+    break;
+
   default:
     NOTREACHED;
   }
@@ -161,16 +205,28 @@ Bool RootCheck(Root root)
     CHECKL(root->protLimit != (Addr)0);
     CHECKL(root->protBase < root->protLimit);
     CHECKL(AccessSetCheck(root->pm));
+    /* .defer: only grey roots are read-protected */
+    CHECKL((root->pm & AccessREAD) == 0 || root->grey != TraceSetEMPTY);
   } else {
     CHECKL(root->protBase == (Addr)0);
     CHECKL(root->protLimit == (Addr)0);
     CHECKL(root->pm == (AccessSet)0);
   }
+  if (root->cardSummary != NULL) {
+    CHECKL(root->protectable);
+    CHECKL((root->mode & RootModePROTECTABLE_INNER) == 0);
+    CHECKL(root->var == RootAREA || root->var == RootAREA_TAGGED);
+    CHECKL(root->cards == AddrOffset(root->protBase, root->protLimit)
+                          / ArenaGrainSize(root->arena));
+  } else {
+    CHECKL(root->cards == 0);
+  }
   return TRUE;
 }
 
 
-/* rootCreate, RootCreateArea, RootCreateThread, RootCreateFmt, RootCreateFun
+/* rootCreate, RootCreateArea, RootCreateThread, RootCreateFmt, RootCreateFun,
+ * RootCreateStack
  *
  * RootCreate* set up the appropriate union member, and call the generic
  * create function to do the actual creation
@@ -209,6 +265,8 @@ static Res rootCreate(Root *rootReturn, Arena arena,
   root->protectable = FALSE;
   root->protBase = (Addr)0;
   root->protLimit = (Addr)0;
+  root->cards = 0;
+  root->cardSummary = NULL;
 
   /* <design/arena#.root-ring> */
   RingInit(&root->arenaRing);
@@ -225,6 +283,40 @@ static Res rootCreate(Root *rootReturn, Arena arena,
   return ResOK;
 }
 
+/* rootCardsInit -- give a large area root a summary for each card
+ *
+ * .card: A card is an arena grain of a protectable area root.  The
+ * root keeps a summary for each card, and write-protects the cards
+ * whose summaries are not RefSetUNIV, so that RootScan can skip the
+ * cards that can't refer to the white set, and a write only loses
+ * the summary of one card.  <design/root#.card>.
+ *
+ * If there is no memory for the summaries, the root is scanned as a
+ * whole, as if it were too small to have cards.
+ */
+
+static void rootCardsInit(Root root)
+{
+  Arena arena = root->arena;
+  Size grainSize = ArenaGrainSize(arena);
+  Count cards, i;
+  void *p;
+  Res res;
+
+  cards = AddrOffset(root->protBase, root->protLimit) / grainSize;
+  if (cards < ROOT_CARDS_MIN
+      || !SizeIsAligned(grainSize, ProtGranularity()))
+    return;
+
+  res = ControlAlloc(&p, arena, cards * sizeof root->cardSummary[0]);
+  if (res != ResOK)
+    return;
+  root->cardSummary = p;
+  for (i = 0; i < cards; ++i)
+    root->cardSummary[i] = RefSetUNIV;
+  root->cards = cards;
+}
+
 static Res rootCreateProtectable(Root *rootReturn, Arena arena,
                                  Rank rank, RootMode mode, RootVar var,
                                  Addr base, Addr limit,
@@ -245,11 +337,14 @@ static Res rootCreateProtectable(Root *rootReturn, Arena arena,
       if (!(root->protBase < root->protLimit)) {
         /* root had no inner pages */
         root->protectable = FALSE;
-        root->mode &=~ (RootModePROTECTABLE|RootModePROTECTABLE_INNER);
+        root->mode &=~ (RootModePROTECTABLE|RootModePROTECTABLE_INNER
+                        |RootModeINCREMENTAL);
       }
     } else {
       root->protBase = AddrArenaGrainDown(base, arena);
       root->protLimit = AddrArenaGrainUp(limit, arena);
+      if (var == RootAREA || var == RootAREA_TAGGED)
+        rootCardsInit(root);
     }
   }
 
@@ -382,6 +477,45 @@ Res RootCreateThreadTagged(Root *rootReturn, Arena arena,
                     &theUnion);
 }
 
+/* RootCreateThreadExact -- create an exact root for a thread's stack
+ *
+ * .thread.exact: The client's scan function knows the layout of the
+ * thread's stack frames, so the references it finds are exact, and
+ * objects they refer to can be moved.  This is only possible if the
+ * thread is stopped where it has no references in its registers: that
+ * is, when it is the current thread, or a native safepoint thread
+ * (see ThreadStackHot).  <design/thread-manager#.if.stack.hot>.  So
+ * the thread must be the caller or a safepoint thread, and even then
+ * the stack of a thread that isn't a safepoint thread is scanned
+ * ambiguously when another thread collects: .thread.exact.ambig.
+ */
+
+Res RootCreateThreadExact(Root *rootReturn, Arena arena,
+                          Thread thread, mps_stack_scan_t scan,
+                          void *closure, Word *stackCold)
+{
+  union RootUnion theUnion;
+
+  AVER(rootReturn != NULL);
+  AVERT(Arena, arena);
+  AVERT(Thread, thread);
+  AVER(ThreadArena(thread) == arena);
+  AVER(FUNCHECK(scan));
+  /* Can't check anything about closure. */
+  AVER(stackCold != NULL);
+
+  if (!ThreadIsCurrent(thread) && !ThreadIsSafepoint(thread))
+    return ResPARAM;
+
+  theUnion.threadExact.thread = thread;
+  theUnion.threadExact.scan = scan;
+  theUnion.threadExact.closure = closure;
+  theUnion.threadExact.stackCold = stackCold;
+
+  return rootCreate(rootReturn, arena, RankEXACT, (RootMode)0,
+                    RootTHREAD_EXACT, &theUnion);
+}
+
 /* RootCreateFmt -- create root from block of formatted objects
  *
  * .fmt.no-align-check: Note that we don't check the alignment of base
@@ -428,6 +562,51 @@ Res RootCreateFun(Root *rootReturn, Arena arena, Rank rank,
   return rootCreate(rootReturn, arena, rank, (RootMode)0, RootFUN, &theUnion);
 }
 
+/* RootCreateStack -- create a root for the stack of a coroutine
+ *
+ * .stack: The stack of a coroutine (or fiber) is scanned from the hot
+ * end given to RootStackSuspend to the cold end while the coroutine
+ * is suspended.  While it is running, it is scanned like the stack of
+ * the thread running it, from the thread's stack pointer to the cold
+ * end of the coroutine's stack, together with the thread's registers.
+ * A stack that hasn't run since it was last scanned keeps its summary,
+ * so traces whose white set it doesn't refer to don't scan it.  A new
+ * coroutine hasn't started, so its root is empty.
+ * <design/root#.stack>.
+ */
+
+Res RootCreateStack(Root *rootReturn, Arena arena, Rank rank,
+                    RootMode mode, Word *cold,
+                    mps_area_scan_t scan_area, void *closure)
+{
+  union RootUnion theUnion;
+  Root root;
+  Res res;
+
+  AVER(rootReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(rank == RankAMBIG);
+  AVERT(RootMode, mode);
+  AVER((mode & RootModePROTECTABLE) == 0);
+  AVER(cold != NULL);
+  AVER(AddrIsAligned(cold, sizeof(Word)));
+  AVER(FUNCHECK(scan_area));
+  /* Can't check anything about closure */
+
+  theUnion.stack.thread = NULL;
+  theUnion.stack.hot = cold;
+  theUnion.stack.cold = cold;
+  theUnion.stack.scan_area = scan_area;
+  theUnion.stack.closure = closure;
+
+  res = rootCreate(&root, arena, rank, mode, RootSTACK, &theUnion);
+  if (res != ResOK)
+    return res;
+  root->summary = RefSetEMPTY;  /* the coroutine hasn't started */
+  *rootReturn = root;
+  return ResOK;
+}
+
 
 /* RootDestroy -- destroy a root */
 
@@ -444,6 +623,16 @@ void RootDestroy(Root root)
   RingRemove(&root->arenaRing);
   RingFinish(&root->arenaRing);
 
+  /* The memory goes back to the client: <code/protsh.c#.unmap>. */
+  if (root->protectable) {
+    if (root->pm != AccessSetEMPTY)
+      ProtSet(root->protBase, root->protLimit, AccessSetEMPTY);
+    ProtShadowForget(root->protBase, root->protLimit);
+  }
+  if (root->cardSummary != NULL)
+    ControlFree(arena, root->cardSummary,
+                root->cards * sizeof root->cardSummary[0]);
+
   root->sig = SigInvalid;
 
   ControlFree(arena, root, sizeof(RootStruct));
@@ -470,6 +659,27 @@ Rank RootRank(Root root)
 }
 
 
+/* RootScanRank -- return the rank at which to scan a root now
+ *
+ * .thread.exact.ambig: A thread that isn't a safepoint thread may
+ * have references in its registers if it was suspended by a signal
+ * (see ThreadStackHot), so an exact root for its stack can only be
+ * scanned exactly by the thread itself.  If another thread scans it,
+ * the stack and registers are scanned ambiguously instead, so the
+ * root must be scanned along with the ambiguous roots.
+ */
+
+Rank RootScanRank(Root root)
+{
+  AVERT(Root, root);
+  if (root->var == RootTHREAD_EXACT
+      && !ThreadIsCurrent(root->the.threadExact.thread)
+      && !ThreadIsSafepoint(root->the.threadExact.thread))
+    return RankAMBIG;
+  return root->rank;
+}
+
+
 /* RootPM -- return the protection mode of a root */
 
 AccessSet RootPM(Root root)
@@ -479,6 +689,25 @@ AccessSet RootPM(Root root)
 }
 
 
+/* RootThread -- return the thread whose stack a root scans, or NULL
+ *
+ * This is the thread of a thread root, or the thread running the
+ * coroutine of a stack root (see .stack).
+ */
+
+Thread RootThread(Root root)
+{
+  AVERT(Root, root);
+  if (root->var == RootTHREAD || root->var == RootTHREAD_TAGGED)
+    return root->the.thread.thread;
+  if (root->var == RootTHREAD_EXACT)
+    return root->the.threadExact.thread;
+  if (root->var == RootSTACK)
+    return root->the.stack.thread;
+  return NULL;
+}
+
+
 /* RootSummary -- return the summary of a root */
 
 RefSet RootSummary(Root root)
@@ -499,11 +728,107 @@ void RootGrey(Root root, Trace trace)
 }
 
 
+/* rootCardBase -- base address of a card <design/root#.card> */
+
+static Addr rootCardBase(Root root, Index i)
+{
+  AVER(i <= root->cards);
+  return AddrAdd(root->protBase, i * ArenaGrainSize(root->arena));
+}
+
+
+/* rootCardPM -- protection mode of a card
+ *
+ * A card is write-protected unless its summary is RefSetUNIV.
+ */
+
+static AccessSet rootCardPM(Root root, Index i)
+{
+  AVER(i < root->cards);
+  if (root->cardSummary[i] == RefSetUNIV)
+    return BS_DIFF(root->pm, AccessWRITE);
+  return root->pm;
+}
+
+
+/* rootProtect -- set the protection of the root's pages
+ *
+ * For a root with cards, neighbouring cards with the same protection
+ * are protected together, to keep the number of system calls down.
+ */
+
+static void rootProtect(Root root)
+{
+  Index i, j;
+  AccessSet mode;
+
+  if (root->cardSummary == NULL) {
+    ProtSet(root->protBase, root->protLimit, root->pm);
+    return;
+  }
+
+  for (i = 0; i < root->cards; i = j) {
+    mode = rootCardPM(root, i);
+    for (j = i + 1; j < root->cards && rootCardPM(root, j) == mode; ++j)
+      NOOP;
+    ProtSet(rootCardBase(root, i), rootCardBase(root, j), mode);
+  }
+}
+
+
+/* RootStackSuspend, RootStackResume -- coroutine switches
+ *
+ * When a coroutine is suspended, its stack extends from hot to the
+ * cold end, and it has run since it was last scanned, so the root is
+ * dirty: its summary is lost.  When it resumes on a thread, the root
+ * is the part of the thread's stack and registers that belongs to the
+ * coroutine, which may change at any time, so it stays dirty until
+ * the coroutine is next suspended.  <design/root#.stack>.
+ */
+
+void RootStackSuspend(Root root, Word *hot)
+{
+  AVERT(Root, root);
+  AVER(root->var == RootSTACK);
+  AVER(hot != NULL);
+  AVER(AddrIsAligned(hot, sizeof(Word)));
+  AVER(hot <= root->the.stack.cold);
+
+  root->the.stack.thread = NULL;
+  root->the.stack.hot = hot;
+  root->summary = RefSetUNIV;
+}
+
+void RootStackResume(Root root, Thread thread)
+{
+  AVERT(Root, root);
+  AVER(root->var == RootSTACK);
+  AVER(root->the.stack.thread == NULL);
+  AVER(ThreadCheckSimple(thread));
+  AVER(ThreadArena(thread) == RootArena(root));
+
+  root->the.stack.thread = thread;
+  root->the.stack.hot = root->the.stack.cold;
+  root->summary = RefSetUNIV;
+}
+
+
 static void rootSetSummary(Root root, RefSet summary)
 {
   AVERT(Root, root);
   /* Can't check summary */
-  if (root->protectable) {
+  if (root->cardSummary != NULL) {
+    /* The summary is the union of the card summaries, and the root is
+       write-protected if any card is. */
+    Index i;
+    root->summary = summary;
+    root->pm &= ~AccessWRITE;
+    for (i = 0; i < root->cards; ++i)
+      if (root->cardSummary[i] != RefSetUNIV) {
+        root->pm |= AccessWRITE;
+        break;
+      }
+  } else if (root->protectable) {
     if (summary == RefSetUNIV) {
       root->summary = summary;
       root->pm &= ~AccessWRITE;
@@ -511,11 +836,192 @@ static void rootSetSummary(Root root, RefSet summary)
       root->pm |= AccessWRITE;
       root->summary = summary;
     }
+  } else if (root->var == RootSTACK) {
+    /* The client tells us when the stack is written <design/root#.stack> */
+    if (root->the.stack.thread == NULL)
+      root->summary = summary;
+    else
+      AVER(root->summary == RefSetUNIV);
   } else
     AVER(root->summary == RefSetUNIV);
 }
 
 
+/* RootDefer -- protect a grey root instead of scanning it at flip
+ *
+ * .defer: An exact root created with RootModeINCREMENTAL whose pages
+ * are all protectable can be left grey at flip, and protected against
+ * reads so that the (now black) mutator can't see its references
+ * until it has been scanned.  Returns TRUE if the root was protected,
+ * FALSE if it must be scanned now.  The root is read-protected until
+ * it is no longer grey (see rootScanned).  <design/trace#.flip.defer>.
+ */
+
+Bool RootDefer(Root root, TraceSet ts)
+{
+  AVERT(Root, root);
+  AVERT(TraceSet, ts);
+
+  if ((root->mode & RootModeINCREMENTAL) == 0
+      || (root->mode & RootModePROTECTABLE_INNER) != 0
+      || !root->protectable
+      || root->rank != RankEXACT
+      || TraceSetInter(root->grey, ts) == TraceSetEMPTY)
+    return FALSE;
+
+  root->pm |= AccessREAD;
+  rootProtect(root);
+  return TRUE;
+}
+
+
+/* RootUndefer -- undo RootDefer after a failed flip
+ *
+ * If the flip fails, the traces ts stay unflipped, so the mutator is
+ * not black for them and may read the root again.  The root stays
+ * grey, to be scanned at the next flip, but loses its read protection
+ * unless it is grey for a trace that has flipped.
+ */
+
+void RootUndefer(Root root, TraceSet ts)
+{
+  AVERT(Root, root);
+  AVERT(TraceSet, ts);
+
+  if (RootDeferred(root, ts)
+      && TraceSetInter(root->grey, root->arena->flippedTraces)
+         == TraceSetEMPTY) {
+    root->pm &= ~AccessREAD;
+    rootProtect(root);
+  }
+}
+
+
+/* RootDeferred -- is a root grey and protected for some of the traces? */
+
+Bool RootDeferred(Root root, TraceSet ts)
+{
+  AVERT(Root, root);
+  AVERT(TraceSet, ts);
+
+  return (root->pm & AccessREAD) != 0
+    && TraceSetInter(root->grey, ts) != TraceSetEMPTY;
+}
+
+
+/* rootScanThread -- scan a thread root */
+
+static Res rootScanThread(ScanState ss, Root root)
+{
+  void *closure;
+
+  if (root->var == RootTHREAD_TAGGED) {
+    closure = &root->the.thread.the.tag;
+  } else {
+    AVER(root->var == RootTHREAD);
+    closure = root->the.thread.the.closure;
+  }
+  return ThreadScan(ss, root->the.thread.thread,
+                    root->the.thread.stackCold,
+                    root->the.thread.scan_area,
+                    closure);
+}
+
+
+/* rootScanCards -- scan the cards of an area root
+ *
+ * Cards whose summaries don't intersect the white set can't contain
+ * references that need fixing, so they are skipped and keep their
+ * summaries (compare traceScanSegRes).  The other cards are scanned
+ * separately, each with its own summary.  On return the scan state
+ * summary is the union of the card summaries.  <design/root#.card>.
+ */
+
+static Res rootScanCards(ScanState ss, Root root, void *closure)
+{
+  Word *base = root->the.area.base, *limit = root->the.area.limit;
+  RefSet white = ScanStateWhite(ss);
+  RefSet summary = RefSetEMPTY;
+  Index i;
+  Res res;
+
+  for (i = 0; i < root->cards; ++i) {
+    Word *cardBase = (Word *)rootCardBase(root, i);
+    Word *cardLimit = (Word *)rootCardBase(root, i + 1);
+
+    if (RefSetInter(root->cardSummary[i], white) == RefSetEMPTY) {
+      summary = RefSetUnion(summary, root->cardSummary[i]);
+      continue;
+    }
+    if (cardBase < base)
+      cardBase = base;
+    if (cardLimit > limit)
+      cardLimit = limit;
+    ScanStateSetSummary(ss, RefSetEMPTY);
+    res = TraceScanArea(ss, cardBase, cardLimit,
+                        root->the.area.scan_area, closure);
+    if (res != ResOK) {
+      /* Some references in the card may have been fixed. */
+      root->cardSummary[i] = RefSetUNIV;
+      root->summary = RefSetUNIV;
+      return res;
+    }
+    root->cardSummary[i] = ScanStateSummary(ss);
+    summary = RefSetUnion(summary, root->cardSummary[i]);
+  }
+
+  ScanStateSetSummary(ss, summary);
+  return ResOK;
+}
+
+
+/* rootScanThreadExact -- scan a thread's stack with the client's scanner
+ *
+ * The current thread's stack is scanned from where it entered the MPS
+ * (or from here, if that wasn't recorded).  <design/ss#.sol.entry-points>.
+ */
+
+static Res rootScanThreadExact(ScanState ss, Root root)
+{
+  Thread thread = root->the.threadExact.thread;
+  void *cold = root->the.threadExact.stackCold;
+  void *hot;
+  Res res;
+
+  if (ThreadIsCurrent(thread)) {
+    hot = ss->arena->stackWarm;
+    if (hot == NULL)
+      StackHot(&hot);
+  } else if (!ThreadIsSafepoint(thread)) {
+    /* The thread may have references in its registers. */
+    AVER(ss->rank == RankAMBIG); /* .thread.exact.ambig */
+    return ThreadScan(ss, thread, cold, mps_scan_area, NULL);
+  } else if (!ThreadStackHot(&hot, thread)) {
+    NOTREACHED; /* native safepoint threads have saved their registers */
+    return ResFAIL;
+  }
+  if (hot == NULL || hot >= cold)
+    return ResOK;  /* thread is dead, or has no frames to scan */
+
+  res = (*root->the.threadExact.scan)(&ss->ss_s, hot, cold,
+                                      root->the.threadExact.closure);
+  ss->scannedSize += AddrOffset(hot, cold);
+  return res;
+}
+
+
+/* rootScanned -- blacken a root after scanning it */
+
+static void rootScanned(ScanState ss, Root root)
+{
+  root->grey = TraceSetDiff(root->grey, ss->traces);
+  if (root->grey == TraceSetEMPTY)
+    root->pm &= ~AccessREAD;    /* .defer */
+  rootSetSummary(root, ScanStateSummary(ss));
+  EVENT3(RootScan, root, ss->traces, ZoneSetFold(ScanStateSummary(ss)));
+}
+
+
 /* RootScan -- scan root */
 
 Res RootScan(ScanState ss, Root root)
@@ -524,7 +1030,7 @@ Res RootScan(ScanState ss, Root root)
 
   AVERT(Root, root);
   AVERT(ScanState, ss);
-  AVER(root->rank == ss->rank);
+  AVER(RootScanRank(root) == ss->rank);
 
   if (TraceSetInter(root->grey, ss->traces) == TraceSetEMPTY)
     return ResOK;
@@ -537,6 +1043,12 @@ Res RootScan(ScanState ss, Root root)
 
   switch(root->var) {
   case RootAREA:
+    if (root->cardSummary != NULL) {
+      res = rootScanCards(ss, root, root->the.area.the.closure);
+      if (res != ResOK)
+        goto failScan;
+      break;
+    }
     res = TraceScanArea(ss,
                         root->the.area.base,
                         root->the.area.limit,
@@ -547,6 +1059,12 @@ Res RootScan(ScanState ss, Root root)
     break;
 
   case RootAREA_TAGGED:
+    if (root->cardSummary != NULL) {
+      res = rootScanCards(ss, root, &root->the.area.the.tag);
+      if (res != ResOK)
+        goto failScan;
+      break;
+    }
     res = TraceScanArea(ss,
                         root->the.area.base,
                         root->the.area.limit,
@@ -565,19 +1083,14 @@ Res RootScan(ScanState ss, Root root)
     break;
 
   case RootTHREAD:
-    res = ThreadScan(ss, root->the.thread.thread,
-                     root->the.thread.stackCold,
-                     root->the.thread.scan_area,
-                     root->the.thread.the.closure);
+  case RootTHREAD_TAGGED:
+    res = rootScanThread(ss, root);
     if (res != ResOK)
       goto failScan;
     break;
 
-  case RootTHREAD_TAGGED:
-    res = ThreadScan(ss, root->the.thread.thread,
-                     root->the.thread.stackCold,
-                     root->the.thread.scan_area,
-                     &root->the.thread.the.tag);
+  case RootTHREAD_EXACT:
+    res = rootScanThreadExact(ss, root);
     if (res != ResOK)
       goto failScan;
     break;
@@ -589,6 +1102,23 @@ Res RootScan(ScanState ss, Root root)
       goto failScan;
     break;
 
+  case RootSTACK:
+    res = ResOK;
+    if (root->the.stack.thread != NULL)
+      res = ThreadScan(ss, root->the.stack.thread,
+                       root->the.stack.cold,
+                       root->the.stack.scan_area,
+                       root->the.stack.closure);
+    else if (root->the.stack.hot < root->the.stack.cold)
+      res = TraceScanArea(ss,
+                          root->the.stack.hot,
+                          root->the.stack.cold,
+                          root->the.stack.scan_area,
+                          root->the.stack.closure);
+    if (res != ResOK)
+      goto failScan;
+    break;
+
   default:
     NOTREACHED;
     res = ResUNIMPL;
@@ -596,19 +1126,63 @@ Res RootScan(ScanState ss, Root root)
   }
 
   AVER(res == ResOK);
-  root->grey = TraceSetDiff(root->grey, ss->traces);
-  rootSetSummary(root, ScanStateSummary(ss));
-  EVENT3(RootScan, root, ss->traces, ScanStateSummary(ss));
+  rootScanned(ss, root);
 
 failScan:
   if (root->pm != AccessSetEMPTY) {
-    ProtSet(root->protBase, root->protLimit, root->pm);
+    rootProtect(root);
   }
 
   return res;
 }
 
 
+/* RootParallelScannable, RootParallelScan, RootParallelScanned --
+ * scan thread roots in worker threads
+ *
+ * .par: During a parallel flip <code/trace.c#.flip.par>, the
+ * ambiguous roots of threads other than the collector's are scanned
+ * by worker threads.  RootParallelScan scans a root like RootScan,
+ * but doesn't change the root or emit events, so that the workers
+ * can scan different roots at the same time.  When the collector has
+ * fixed the references that the worker deferred, it calls
+ * RootParallelScanned to blacken the root.
+ */
+
+Bool RootParallelScannable(Root root, TraceSet ts)
+{
+  AVERT(Root, root);
+  AVERT(TraceSet, ts);
+
+  return (root->var == RootTHREAD || root->var == RootTHREAD_TAGGED)
+    && root->rank == RankAMBIG
+    && root->pm == AccessSetEMPTY
+    && TraceSetInter(root->grey, ts) != TraceSetEMPTY
+    && !ThreadIsCurrent(root->the.thread.thread)
+    && TraceSetInter(ThreadHandshake(root->the.thread.thread), ts)
+       == TraceSetEMPTY;
+}
+
+Res RootParallelScan(ScanState ss, Root root)
+{
+  AVERT(Root, root);
+  AVERT(ScanState, ss);
+  AVER(root->rank == ss->rank);
+  AVER(ScanStateSummary(ss) == RefSetEMPTY);
+
+  return rootScanThread(ss, root);
+}
+
+void RootParallelScanned(ScanState ss, Root root)
+{
+  AVERT(Root, root);
+  AVERT(ScanState, ss);
+  AVER(RootParallelScannable(root, ss->traces));
+
+  rootScanned(ss, root);
+}
+
+
 /* RootOfAddr -- return the root at addr
  *
  * Returns TRUE if the addr is in a root (and returns the root in
@@ -635,16 +1209,45 @@ Bool RootOfAddr(Root *rootReturn, Arena arena, Addr addr)
 }
 
 
-/* RootAccess -- handle barrier hit on root */
+/* RootAccess -- handle barrier hit on root
+ *
+ * A read barrier hit can only be on a deferred root (.defer), which
+ * must be scanned.  As in TraceSegAccess, this comes before handling
+ * the write barrier, because the scan sets the summary.
+ *
+ * A write barrier hit on a root with cards only loses the summary of
+ * the card containing addr, and only that card is unprotected.  The
+ * hit may be on a card that is already unprotected, if another
+ * thread got there first.  <design/root#.card.write>.
+ */
 
-void RootAccess(Root root, AccessSet mode)
+void RootAccess(Root root, Addr addr, AccessSet mode)
 {
   AVERT(Root, root);
+  AVER(root->protBase <= addr);
+  AVER(addr < root->protLimit);
   AVERT(AccessSet, mode);
   AVER((root->pm & mode) != AccessSetEMPTY);
-  AVER(mode == AccessWRITE); /* only write protection supported */
 
-  rootSetSummary(root, RefSetUNIV);
+  if ((mode & AccessREAD) != 0)
+    TraceRootAccess(root->arena, root);
+
+  if (root->cardSummary != NULL) {
+    /* RootScan has already set the protection of all the cards. */
+    AVER((root->pm & AccessREAD) == 0);
+    if ((mode & AccessWRITE) != 0) {
+      Index i = AddrOffset(root->protBase, addr)
+                / ArenaGrainSize(root->arena);
+      root->cardSummary[i] = RefSetUNIV;
+      root->summary = RefSetUNIV;
+      ProtSet(rootCardBase(root, i), rootCardBase(root, i + 1),
+              rootCardPM(root, i));
+    }
+    return;
+  }
+
+  if ((mode & AccessWRITE) != 0)
+    rootSetSummary(root, RefSetUNIV);
 
   /* Access must now be allowed. */
   AVER((root->pm & mode) == AccessSetEMPTY);
@@ -670,6 +1273,234 @@ Res RootsIterate(Globals arena, RootIterateFn f, void *p)
 }
 
 
+/* Pinned objects -- see <design/root#.pin>
+ *
+ * .pin.table: The arena's pin table maps each pinned address to the
+ * number of times it has been pinned.  It is created when the first
+ * object is pinned.  The addresses 0 and 1 are reserved by the table,
+ * and neither can be the address of an object.
+ */
+
+#define pinTableUNUSED  ((TableKey)0)
+#define pinTableDELETED ((TableKey)1)
+#define pinTableLENGTH  ((Count)16)
+
+static void *pinTableAlloc(void *closure, size_t size)
+{
+  Arena arena = closure;
+  void *p;
+  Res res;
+
+  res = ControlAlloc(&p, arena, size);
+  if (res != ResOK)
+    return NULL;
+  return p;
+}
+
+static void pinTableFree(void *closure, void *p, size_t size)
+{
+  Arena arena = closure;
+  ControlFree(arena, p, size);
+}
+
+
+/* ArenaPin -- pin the object at addr */
+
+Res ArenaPin(Arena arena, Addr addr)
+{
+  TableValue value;
+  Seg seg;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVER((TableKey)addr != pinTableUNUSED);
+  AVER((TableKey)addr != pinTableDELETED);
+
+  if (arena->pinTable == NULL) {
+    Table table;
+    res = TableCreate(&table, pinTableLENGTH, pinTableAlloc, pinTableFree,
+                      arena, pinTableUNUSED, pinTableDELETED);
+    if (res != ResOK)
+      return res;
+    arena->pinTable = table;
+  }
+
+  if (TableLookup(&value, arena->pinTable, (TableKey)addr))
+    return TableRedefine(arena->pinTable, (TableKey)addr,
+                         (TableValue)((Word)value + 1));
+  res = TableDefine(arena->pinTable, (TableKey)addr, (TableValue)1);
+  if (res != ResOK)
+    return res;
+
+  /* .pin.seg: Each segment counts the distinct pinned addresses in */
+  /* it, so that the barriers can tell whether it holds a pin. */
+  if (SegOfAddr(&seg, arena, addr)) {
+    if (SegRankSet(seg) != RankSetEMPTY)
+      SegSetSummary(seg, RefSetUNIV);
+    ++seg->pinCount;
+    AVER(seg->pinCount > 0); /* overflow */
+    if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY)
+      arena->pinsGrey = TRUE;
+  }
+  return ResOK;
+}
+
+
+/* ArenaUnpin -- undo one call to ArenaPin for addr */
+
+void ArenaUnpin(Arena arena, Addr addr)
+{
+  TableValue value;
+  Seg seg;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVER(arena->pinTable != NULL);
+
+  if (!TableLookup(&value, arena->pinTable, (TableKey)addr)) {
+    NOTREACHED; /* addr is not pinned */
+    return;
+  }
+  if ((Word)value > 1) {
+    res = TableRedefine(arena->pinTable, (TableKey)addr,
+                        (TableValue)((Word)value - 1));
+  } else {
+    res = TableRemove(arena->pinTable, (TableKey)addr);
+    if (SegOfAddr(&seg, arena, addr)) {
+      AVER(seg->pinCount > 0);
+      --seg->pinCount;
+    }
+  }
+  AVER(res == ResOK);
+}
+
+
+/* ArenaPinCount -- return the number of distinct pinned addresses */
+
+Count ArenaPinCount(Arena arena)
+{
+  AVERT(Arena, arena);
+  if (arena->pinTable == NULL)
+    return 0;
+  return TableCount(arena->pinTable);
+}
+
+
+/* ArenaPinCountRange -- count the pinned addresses in a range */
+
+typedef struct PinCountClosureStruct {
+  Addr base;
+  Addr limit;
+  Count count;
+} PinCountClosureStruct, *PinCountClosure;
+
+static void pinCount(void *closure, TableKey key, TableValue value)
+{
+  PinCountClosure pcc = closure;
+  Addr addr = (Addr)key;
+  UNUSED(value);
+  if (pcc->base <= addr && addr < pcc->limit)
+    ++pcc->count;
+}
+
+Count ArenaPinCountRange(Arena arena, Addr base, Addr limit)
+{
+  PinCountClosureStruct pcc;
+
+  AVERT(Arena, arena);
+  AVER(base < limit);
+
+  if (ArenaPinCount(arena) == 0)
+    return 0;
+  pcc.base = base;
+  pcc.limit = limit;
+  pcc.count = 0;
+  TableMap(arena->pinTable, pinCount, &pcc);
+  return pcc.count;
+}
+
+
+/* ArenaBlackenPins -- scan the grey segments that hold pins
+ *
+ * .pin.barrier: The client program may hand a pinned object to the
+ * operating system, for example as a buffer for read(), and the
+ * operating system can't take a barrier hit on the MPS's behalf.  So
+ * a segment holding a pin is never protected while the mutator is
+ * running.  It has no write barrier, because SegSetSummary keeps its
+ * summary at RefSetUNIV.  When it becomes grey for a flipped trace,
+ * the shield suspends the mutator rather than protecting the segment
+ * <code/shield.c#.queue.pinned>, and arena->pinsGrey is set.  This
+ * function is then called before the mutator resumes, and scans each
+ * such segment as if its read barrier had been hit.  Scanning may
+ * grey other pinned segments, so it repeats until none are left.
+ * See <design/root#.pin.barrier>.
+ */
+
+static void pinBlacken(void *closure, TableKey key, TableValue value)
+{
+  Arena arena = closure;
+  Seg seg;
+  UNUSED(value);
+  if (SegOfAddr(&seg, arena, (Addr)key))
+    TraceSegBlacken(arena, seg);
+}
+
+void ArenaBlackenPins(Arena arena)
+{
+  AVERT(Arena, arena);
+
+  while (arena->pinsGrey) {
+    arena->pinsGrey = FALSE;
+    TableMap(arena->pinTable, pinBlacken, arena);
+  }
+}
+
+
+/* ArenaScanPins -- fix the pinned addresses as ambiguous references
+ *
+ * .pin.scan: The scan state must be of rank ambiguous, so that the
+ * pinned objects are preserved in place.
+ */
+
+typedef struct PinScanClosureStruct {
+  ScanState ss;
+  Res res;
+} PinScanClosureStruct, *PinScanClosure;
+
+static void pinScan(void *closure, TableKey key, TableValue value)
+{
+  PinScanClosure psc = closure;
+  ScanState ss = psc->ss;
+  Ref ref = (Ref)key;
+
+  UNUSED(value);
+  if (psc->res != ResOK)
+    return;
+  TRACE_SCAN_BEGIN(ss) {
+    if (TRACE_FIX1(ss, ref))
+      psc->res = TRACE_FIX2(ss, &ref);
+  } TRACE_SCAN_END(ss);
+  AVER(ref == (Ref)key);
+}
+
+Res ArenaScanPins(ScanState ss)
+{
+  PinScanClosureStruct psc;
+  Arena arena;
+
+  AVERT(ScanState, ss);
+  AVER(ss->rank == RankAMBIG);
+  arena = ss->arena;
+
+  if (ArenaPinCount(arena) == 0)
+    return ResOK;
+  psc.ss = ss;
+  psc.res = ResOK;
+  TableMap(arena->pinTable, pinScan, &psc);
+  return psc.res;
+}
+
+
 /* RootDescribe -- describe a root */
 
 Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
@@ -687,12 +1518,13 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                (WriteFU)root->arena->serial,
                "  rank $U\n", (WriteFU)root->rank,
                "  grey $B\n", (WriteFB)root->grey,
-               "  summary $B\n", (WriteFB)root->summary,
+               "  summary " ZoneSetFORMAT "\n", ZoneSetWriteF(root->summary),
                "  mode",
                root->mode == 0 ? " NONE" : "",
                root->mode & RootModeCONSTANT ? " CONSTANT" : "",
                root->mode & RootModePROTECTABLE ? " PROTECTABLE" : "",
                root->mode & RootModePROTECTABLE_INNER ? " INNER" : "",
+               root->mode & RootModeINCREMENTAL ? " INCREMENTAL" : "",
                "\n",
                "  protectable $S", WriteFYesNo(root->protectable),
                "  protBase $A", (WriteFA)root->protBase,
@@ -701,6 +1533,7 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
                root->pm == AccessSetEMPTY ? " EMPTY" : "",
                root->pm & AccessREAD ? " READ" : "",
                root->pm & AccessWRITE ? " WRITE" : "",
+               "  cards $U\n", (WriteFU)root->cards,
                NULL);
   if (res != ResOK)
     return res;
@@ -762,6 +1595,18 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
       return res;
     break;
 
+  case RootTHREAD_EXACT:
+    res = WriteF(stream, depth + 2,
+                 "thread $P\n", (WriteFP)root->the.threadExact.thread,
+                 "scan $F closure $P\n",
+                 (WriteFF)root->the.threadExact.scan,
+                 (WriteFP)root->the.threadExact.closure,
+                 "stackCold $P\n", (WriteFP)root->the.threadExact.stackCold,
+                 NULL);
+    if (res != ResOK)
+      return res;
+    break;
+
   case RootFMT:
     res = WriteF(stream, depth + 2,
                  "scan function $F\n", (WriteFF)root->the.fmt.scan,
@@ -771,6 +1616,18 @@ Res RootDescribe(Root root, mps_lib_FILE *stream, Count depth)
     if (res != ResOK)
       return res;
     break;
+
+  case RootSTACK:
+    res = WriteF(stream, depth + 2,
+                 "stack thread $P hot $A cold $A scan_area closure $P\n",
+                 (WriteFP)root->the.stack.thread,
+                 (WriteFA)root->the.stack.hot,
+                 (WriteFA)root->the.stack.cold,
+                 (WriteFP)root->the.stack.closure,
+                 NULL);
+    if (res != ResOK)
+      return res;
+    break;
           
   default:
     NOTREACHED;
@@ -43,7 +43,12 @@ static Bool SACCheck(SAC sac)
   CHECKS(SAC, sac);
   esac = ExternalSACOfSAC(sac);
   CHECKU(Pool, sac->pool);
+  CHECKD_NOSIG(Ring, &sac->poolRing);
   CHECKL(sac->classesCount > 0);
+  CHECKL(sac->classesCount <= sacClassLIMIT);
+  CHECKL(BoolCheck(sac->adaptive));
+  CHECKL(!sac->adaptive || sac->cacheSize > 0);
+  CHECKL(!sac->adaptive || sac->adaptPeriod > 0);
   CHECKL(sac->classesCount > sac->middleIndex);
   CHECKL(BoolCheck(esac->_trapped));
   CHECKL(esac->_middle > 0);
@@ -82,51 +87,45 @@ static Bool SACCheck(SAC sac)
 }
 
 
-/* sacSize -- calculate size of a SAC structure */
+/* sacFreelistCount -- number of freelists used by a SAC structure */
 
-static Size sacSize(Index middleIndex, Count classesCount)
+static Count sacFreelistCount(Index middleIndex, Count classesCount)
 {
-  Index indexMax; /* max index for the freelist */
-  SACStruct dummy;
-
   if (middleIndex + 1 < classesCount - middleIndex)
-    indexMax = 2 * (classesCount - middleIndex - 1);
+    return 2 * (classesCount - middleIndex - 1) + 1;
   else
-    indexMax = 1 + 2 * middleIndex;
-  return PointerOffset(&dummy, &dummy.esac_s._freelists[indexMax+1]);
+    return 2 * middleIndex + 2;
 }
 
 
-/* SACCreate -- create an SAC object */
+/* sacSize -- calculate size of a SAC structure
+ *
+ * An adaptive SAC may change its classes, so it is always allocated
+ * with room for the largest number of freelists.
+ */
 
-Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
-              SACClasses classes)
+static Size sacSize(Index middleIndex, Count classesCount)
 {
-  void *p;
-  SAC sac;
-  Res res;
-  Index i, j;
-  Index middleIndex;  /* index of the size in the middle */
-  Size prevSize;
-  unsigned totalFreq = 0;
-  mps_sac_t esac;
+  SACStruct dummy;
+  Count count = sacFreelistCount(middleIndex, classesCount);
+  return PointerOffset(&dummy, &dummy.esac_s._freelists[count]);
+}
 
-  AVER(sacReturn != NULL);
-  AVERT(Pool, pool);
-  AVER(classesCount > 0);
-  /* In this cache type, there is no upper limit on classesCount. */
-  prevSize = sizeof(Addr) - 1; /* must large enough for freelist link */
-  /* @@@@ It would be better to dynamically adjust the smallest class */
-  /* to be large enough, but that gets complicated, if you have to */
-  /* merge classes because of the adjustment. */
-  for (i = 0; i < classesCount; ++i) {
-    AVER(classes[i].mps_block_size > 0);
-    AVER(SizeIsAligned(classes[i].mps_block_size, PoolAlignment(pool)));
-    AVER(prevSize < classes[i].mps_block_size);
-    prevSize = classes[i].mps_block_size;
-    /* no restrictions on count */
-    /* no restrictions on frequency */
-  }
+#define sacStructSize(sac) \
+  ((sac)->adaptive ? sizeof(SACStruct) \
+   : sacSize((sac)->middleIndex, (sac)->classesCount))
+
+
+/* sacMiddle -- find the middle class
+ *
+ * The fast path searches outward from the middle class, so put it
+ * where half of the requests are larger and half smaller.
+ */
+
+static Index sacMiddle(Count classesCount, SACClasses classes)
+{
+  Index i;
+  unsigned totalFreq = 0;
 
   /* Calculate frequency scale */
   for (i = 0; i < classesCount; ++i) {
@@ -144,17 +143,20 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
     totalFreq -= classes[i].mps_frequency;
   }
   if (totalFreq <= classes[i].mps_frequency / 2)
-    middleIndex = i;
+    return i;
   else
-    middleIndex = i + 1; /* there must exist another class at i+1 */
+    return i + 1; /* there must exist another class at i+1 */
+}
 
-  /* Allocate SAC */
-  res = ControlAlloc(&p, PoolArena(pool), sacSize(middleIndex, classesCount));
-  if(res != ResOK)
-    goto failSACAlloc;
-  sac = p;
 
-  /* Move classes in place */
+/* sacLayout -- move classes in place, emptying the statistics */
+
+static void sacLayout(SAC sac, Index middleIndex, Count classesCount,
+                      SACClasses classes)
+{
+  Index i, j;
+  mps_sac_t esac;
+
   /* It's important this matches SACFind. */
   esac = ExternalSACOfSAC(sac);
   for (j = middleIndex + 1, i = 0; j < classesCount; ++j, i += 2) {
@@ -178,14 +180,96 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
   esac->_freelists[i]._count_max = classes[j].mps_cached_count;
   esac->_freelists[i]._blocks = NULL;
 
-  /* finish init */
-  esac->_trapped = FALSE;
+  for (i = 0; i < sacFreelistCount(middleIndex, classesCount); ++i) {
+    sac->hits[i] = 0;
+    sac->seen[i] = 0;
+    sac->misses[i] = 0;
+  }
   esac->_middle = classes[middleIndex].mps_block_size;
-  sac->pool = pool;
   sac->classesCount = classesCount;
   sac->middleIndex = middleIndex;
+}
+
+
+/* sacClassIndex -- find the freelist and block size of a class */
+
+static void sacClassIndex(Index *iReturn, Size *blockSizeReturn,
+                          SAC sac, Index j)
+{
+  mps_sac_t esac = ExternalSACOfSAC(sac);
+
+  AVER(j < sac->classesCount);
+  if (j > sac->middleIndex) {
+    *iReturn = 2 * (j - sac->middleIndex - 1);
+    *blockSizeReturn = esac->_freelists[*iReturn]._size;
+  } else {
+    *iReturn = 2 * (sac->middleIndex - j) + 1;
+    if (j == sac->middleIndex)
+      *blockSizeReturn = esac->_middle;
+    else
+      *blockSizeReturn = esac->_freelists[*iReturn - 2]._size;
+  }
+}
+
+
+/* sacInit -- initialize a SAC and attach it to its pool */
+
+static void sacInit(SAC sac, Pool pool, Index middleIndex,
+                    Count classesCount, SACClasses classes)
+{
+  sacLayout(sac, middleIndex, classesCount, classes);
+  ExternalSACOfSAC(sac)->_trapped = FALSE;
+  sac->pool = pool;
+  RingInit(&sac->poolRing);
   sac->sig = SACSig;
   AVERT(SAC, sac);
+  RingAppend(&pool->sacRing, &sac->poolRing);
+}
+
+
+/* SACCreate -- create an SAC object */
+
+Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
+              SACClasses classes)
+{
+  void *p;
+  SAC sac;
+  Res res;
+  Index i;
+  Index middleIndex;  /* index of the size in the middle */
+  Size prevSize;
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(classesCount > 0);
+  /* The statistics and the external structure have room for this many. */
+  if (classesCount > sacClassLIMIT)
+    return ResLIMIT;
+  prevSize = sizeof(Addr) - 1; /* must large enough for freelist link */
+  /* @@@@ It would be better to dynamically adjust the smallest class */
+  /* to be large enough, but that gets complicated, if you have to */
+  /* merge classes because of the adjustment. */
+  for (i = 0; i < classesCount; ++i) {
+    AVER(classes[i].mps_block_size > 0);
+    AVER(SizeIsAligned(classes[i].mps_block_size, PoolAlignment(pool)));
+    AVER(prevSize < classes[i].mps_block_size);
+    prevSize = classes[i].mps_block_size;
+    /* no restrictions on count */
+    /* no restrictions on frequency */
+  }
+
+  middleIndex = sacMiddle(classesCount, classes);
+
+  /* Allocate SAC */
+  res = ControlAlloc(&p, PoolArena(pool), sacSize(middleIndex, classesCount));
+  if(res != ResOK)
+    goto failSACAlloc;
+  sac = p;
+
+  sac->adaptive = FALSE;
+  sac->cacheSize = 0;
+  sac->adaptPeriod = 0;
+  sacInit(sac, pool, middleIndex, classesCount, classes);
   *sacReturn = sac;
   return ResOK;
 
@@ -194,15 +278,294 @@ failSACAlloc:
 }
 
 
+/* Adaptive SACs
+ *
+ * .adaptive: An adaptive SAC chooses its own classes.  It samples the
+ * sizes that reach the slow path, adds in the hits of the classes it
+ * has, and every adaptPeriod allocations it flushes itself and caches
+ * the most frequent sizes instead, dividing cacheSize between them in
+ * proportion to their frequency.  It starts with no cached classes.
+ *
+ * .adaptive.rung: The size of a block can't depend on the classes of
+ * the moment, because a block may be freed after they have changed.
+ * So an adaptive SAC rounds every request up to a rung of a fixed
+ * ladder of sizes (see sacRung), and its classes are rungs.  A cached
+ * class must only receive requests that round to it, so it's preceded
+ * by the rung below it, as an uncached class if need be.  Requests in
+ * uncached classes are passed to the pool at their rung size.
+ *
+ * .adaptive.slow: Adapting frees the cached blocks to the pool, which
+ * needs the arena lock, so the fast path declines when adaptation is
+ * due.
+ */
+
+#define sacRungLINEAR ((Size)8)  /* rungs are grains up to this many */
+
+static Size sacRungMin(Pool pool)
+{
+  return SizeAlignUp(sizeof(Addr), PoolAlignment(pool));
+}
+
+
+/* sacRung -- round up to multiple of the grain, or 1/4 power of 2 */
+
+static Size sacRung(Pool pool, Size size)
+{
+  Size grain = PoolAlignment(pool);
+  Size rung = SizeAlignUp(size, grain);
+
+  if (rung < sacRungMin(pool))
+    return sacRungMin(pool);
+  if (rung > sacRungLINEAR * grain)
+    rung = SizeAlignUp(rung, (Size)1 << (SizeFloorLog2(rung - 1) - 2));
+  return rung;
+}
+
+
+/* sacRungBelow -- the rung below another rung */
+
+static Size sacRungBelow(Pool pool, Size rung)
+{
+  Size grain = PoolAlignment(pool);
+
+  AVER(rung > sacRungMin(pool));
+  AVER(sacRung(pool, rung) == rung);
+  if (rung <= sacRungLINEAR * grain)
+    return rung - grain;
+  return rung - ((Size)1 << (SizeFloorLog2(rung - 1) - 2));
+}
+
+
+/* sacSample -- count allocations of a size
+ *
+ * When the sample is full, a new size replaces the least frequent one
+ * and inherits its count, so that a frequent size can't be starved
+ * out of the sample by a stream of rare ones.
+ */
+
+static void sacSample(SAC sac, Size size, Count count)
+{
+  Index i, min = 0;
+
+  for (i = 0; i < sacSampleLIMIT; ++i) {
+    if (sac->sample[i].size == size) {
+      sac->sample[i].count += count;
+      return;
+    }
+    if (sac->sample[i].count < sac->sample[min].count)
+      min = i;
+  }
+  sac->sample[min].size = size;
+  sac->sample[min].count += count;
+}
+
+
+/* sacCountHits -- estimate the allocations served from the cache
+ *
+ * .hits: Hits never reach the slow path, and counting them in
+ * MPS_SAC_ALLOC_FAST would cost a store on every hit and a field in
+ * the public structure.  Instead, each visit to the slow path credits
+ * each class with the blocks taken from its freelist since the slow
+ * path last left it.  Blocks freed back to the cache in between cancel
+ * out blocks taken, so this is an underestimate.
+ */
+
+static void sacCountHits(SAC sac)
+{
+  Index i;
+  mps_sac_t esac = ExternalSACOfSAC(sac);
+
+  for (i = 0; i < sacFreelistCount(sac->middleIndex, sac->classesCount); ++i) {
+    Count count = esac->_freelists[i]._count;
+    if (sac->seen[i] > count)
+      sac->hits[i] += sac->seen[i] - count;
+    sac->seen[i] = count;
+  }
+}
+
+
+/* sacAdaptDue -- has an adaptive SAC made enough allocations? */
+
+static Bool sacAdaptDue(SAC sac)
+{
+  Index i;
+  Count allocs = 0;
+
+  if (!sac->adaptive)
+    return FALSE;
+  for (i = 0; i < sacFreelistCount(sac->middleIndex, sac->classesCount); ++i)
+    allocs += sac->hits[i] + sac->misses[i];
+  return allocs >= sac->adaptPeriod;
+}
+
+
+/* sacAdaptClasses -- make classes for cached rungs
+ *
+ * rungs is an array of rungCount cached rungs, sorted by decreasing
+ * count.  Returns the number of classes, which may exceed
+ * sacClassLIMIT, in which case the classes are incomplete.
+ */
+
+static Count sacAdaptClasses(mps_sac_classes_s classes[sacClassLIMIT],
+                             SAC sac, SACSampleStruct *rungs,
+                             Count rungCount)
+{
+  Pool pool = sac->pool;
+  Count classesCount = 0, k, total = 0;
+  Index i, j;
+  double weight = 0.0;
+
+  for (k = 0; k < rungCount; ++k) {
+    total += rungs[k].count;
+    weight += (double)rungs[k].count * (double)rungs[k].size;
+  }
+
+  /* Insert each rung, and the rung below it unless it's already there. */
+  for (k = 0; k < 2 * rungCount; ++k) {
+    Size size;
+    Bool cached = k % 2 == 0;
+    Count count = 0;
+    unsigned freq = 1;
+    if (cached) {
+      size = rungs[k / 2].size;
+      count = (Count)((double)sac->cacheSize * (double)rungs[k / 2].count
+                      / weight);
+      freq = (unsigned)(1024.0 * (double)rungs[k / 2].count
+                        / (double)total) + 1;
+    } else if (rungs[k / 2].size > sacRungMin(pool))
+      size = sacRungBelow(pool, rungs[k / 2].size);
+    else
+      continue;
+    for (i = 0; i < classesCount && classes[i].mps_block_size < size; ++i)
+      NOOP;
+    if (i < classesCount && classes[i].mps_block_size == size) {
+      if (cached) {
+        classes[i].mps_cached_count = count;
+        classes[i].mps_frequency = freq;
+      }
+      continue;
+    }
+    if (classesCount == sacClassLIMIT)
+      return classesCount + 1;
+    for (j = classesCount; j > i; --j)
+      classes[j] = classes[j - 1];
+    classes[i].mps_block_size = size;
+    classes[i].mps_cached_count = count;
+    classes[i].mps_frequency = freq;
+    ++classesCount;
+  }
+  return classesCount;
+}
+
+
+/* sacAdapt -- flush an adaptive SAC and choose new classes */
+
+static void sacAdapt(SAC sac)
+{
+  mps_sac_classes_s classes[sacClassLIMIT], tryClasses[sacClassLIMIT];
+  SACSampleStruct rungs[sacClassLIMIT];
+  Count classesCount, rungCount = 0, total = 0;
+  Index i, j, k;
+
+  AVERT(SAC, sac);
+  AVER(sac->adaptive);
+
+  SACFlush(sac);
+
+  /* Hits never reach the slow path, so add them in now (see .hits). */
+  for (j = 0; j < sac->classesCount; ++j) {
+    Size size;
+    sacClassIndex(&i, &size, sac, j);
+    if (sac->hits[i] > 0)
+      sacSample(sac, size, sac->hits[i]);
+  }
+
+  /* Sort the sample by decreasing count. */
+  for (i = 1; i < sacSampleLIMIT; ++i) {
+    SACSampleStruct sample = sac->sample[i];
+    for (j = i; j > 0 && sac->sample[j - 1].count < sample.count; --j)
+      sac->sample[j] = sac->sample[j - 1];
+    sac->sample[j] = sample;
+  }
+  for (i = 0; i < sacSampleLIMIT; ++i)
+    total += sac->sample[i].count;
+
+  /* Cache the most frequent rungs for which there's room. */
+  classes[0].mps_block_size = sacRungMin(sac->pool);
+  classes[0].mps_cached_count = 0;
+  classes[0].mps_frequency = 1;
+  classesCount = 1;
+  for (k = 0; k < sacSampleLIMIT && rungCount < sacClassLIMIT; ++k) {
+    Count tryCount;
+    if (sac->sample[k].count == 0
+        || sac->sample[k].count < total / SAC_ADAPT_SHARE)
+      break;
+    rungs[rungCount] = sac->sample[k];
+    tryCount = sacAdaptClasses(tryClasses, sac, rungs, rungCount + 1);
+    if (tryCount <= sacClassLIMIT) {
+      ++rungCount;
+      classesCount = tryCount;
+      for (j = 0; j < classesCount; ++j)
+        classes[j] = tryClasses[j];
+    }
+  }
+
+  sacLayout(sac, sacMiddle(classesCount, classes), classesCount, classes);
+  for (i = 0; i < sacSampleLIMIT; ++i) {
+    sac->sample[i].size = 0;
+    sac->sample[i].count = 0;
+  }
+  if (sac->adaptPeriod < SAC_ADAPT_PERIOD_MAX)
+    sac->adaptPeriod *= 2;
+  AVERT(SAC, sac);
+}
+
+
+/* SACCreateAdaptive -- create an SAC object that chooses its classes */
+
+Res SACCreateAdaptive(SAC *sacReturn, Pool pool, Size cacheSize)
+{
+  void *p;
+  SAC sac;
+  Res res;
+  Index i;
+  mps_sac_classes_s class;
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+  AVER(cacheSize > 0);
+
+  res = ControlAlloc(&p, PoolArena(pool), sizeof(SACStruct));
+  if (res != ResOK)
+    return res;
+  sac = p;
+
+  sac->adaptive = TRUE;
+  sac->cacheSize = cacheSize;
+  sac->adaptPeriod = SAC_ADAPT_PERIOD_MIN;
+  for (i = 0; i < sacSampleLIMIT; ++i) {
+    sac->sample[i].size = 0;
+    sac->sample[i].count = 0;
+  }
+  class.mps_block_size = sacRungMin(pool);
+  class.mps_cached_count = 0;
+  class.mps_frequency = 1;
+  sacInit(sac, pool, 0, 1, &class);
+  *sacReturn = sac;
+  return ResOK;
+}
+
+
 /* SACDestroy -- destroy an SAC object */
 
 void SACDestroy(SAC sac)
 {
   AVERT(SAC, sac);
   SACFlush(sac);
+  RingRemove(&sac->poolRing);
+  RingFinish(&sac->poolRing);
   sac->sig = SigInvalid;
-  ControlFree(PoolArena(sac->pool), sac,
-              sacSize(sac->middleIndex, sac->classesCount));
+  ControlFree(PoolArena(sac->pool), sac, sacStructSize(sac));
 }
 
 
@@ -242,9 +605,14 @@ static void sacFind(Index *iReturn, Size *blockSizeReturn,
 }
 
 
-/* SACFill -- alloc an object, and perhaps fill the cache */
+/* sacFill -- alloc an object, and perhaps fill the cache
+ *
+ * If fast is TRUE, the blocks are allocated by PoolAllocFast, and the
+ * caller must hold the pool lock but not the arena lock.  In that case
+ * ResFAIL means that not even one block could be allocated.
+ */
 
-Res SACFill(Addr *p_o, SAC sac, Size size)
+static Res sacFill(Addr *p_o, SAC sac, Size size, Bool fast)
 {
   Index i;
   Count blockCount, j;
@@ -256,23 +624,43 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
   AVER(p_o != NULL);
   AVERT(SAC, sac);
   AVER(size != 0);
+  AVERT(Bool, fast);
   esac = ExternalSACOfSAC(sac);
 
+  sacCountHits(sac);
+  if (sacAdaptDue(sac)) {
+    if (fast)
+      return ResFAIL; /* see .adaptive.slow */
+    sacAdapt(sac);
+  }
+
   sacFind(&i, &blockSize, sac, size);
   /* Check it's empty (in the future, there will be other cases). */
   AVER(esac->_freelists[i]._count == 0);
 
   /* Fill 1/3 of the cache for this class. */
   blockCount = esac->_freelists[i]._count_max / 3;
-  /* Adjust size for the overlarge class. */
-  if (blockSize == SizeMAX)
+  if (sac->adaptive) {
+    /* see .adaptive.rung */
+    Size rung = sacRung(sac->pool, size);
+    AVER(esac->_freelists[i]._count_max == 0 || blockSize == rung);
+    blockSize = rung;
+  } else if (blockSize == SizeMAX)
+    /* Adjust size for the overlarge class. */
     /* .align: align 'cause some classes don't accept unaligned. */
     blockSize = SizeAlignUp(size, PoolAlignment(sac->pool));
   for (j = 0, fl = esac->_freelists[i]._blocks;
        j <= blockCount; ++j) {
-    res = PoolAlloc(&p, sac->pool, blockSize);
-    if (res != ResOK)
-      break;
+    if (fast) {
+      if (!PoolAllocFast(&p, sac->pool, blockSize)) {
+        res = ResFAIL;
+        break;
+      }
+    } else {
+      res = PoolAlloc(&p, sac->pool, blockSize);
+      if (res != ResOK)
+        break;
+    }
     /* @@@@ ignoring shields for now */
     *ADDR_PTR(Addr, p) = fl; fl = p;
   }
@@ -281,9 +669,13 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
     AVER(res != ResOK);
     return res;
   }
+  ++sac->misses[i];
+  if (sac->adaptive)
+    sacSample(sac, blockSize, 1);
 
   /* Take the last one off, and return it. */
   esac->_freelists[i]._count = j - 1;
+  sac->seen[i] = j - 1;
   *p_o = fl;
   /* @@@@ ignoring shields for now */
   esac->_freelists[i]._blocks = *ADDR_PTR(Addr, fl);
@@ -291,13 +683,50 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
 }
 
 
+/* SACFill -- alloc an object, and perhaps fill the cache */
+
+Res SACFill(Addr *p_o, SAC sac, Size size)
+{
+  return sacFill(p_o, sac, size, FALSE);
+}
+
+
+/* SACFillFast -- fill the cache without entering the arena
+ *
+ * .fast: If the pool has a pool lock (see <code/pool.c#.lock>), a
+ * thread refilling or emptying its cache can move the whole batch of
+ * blocks while holding only the pool lock, so that the cache behaves
+ * like a per-thread magazine in front of the pool.  Returns FALSE if
+ * not even one block could be moved that way, in which case the caller
+ * must enter the arena and call SACFill.
+ */
+
+Bool SACFillFast(Addr *p_o, SAC sac, Size size)
+{
+  Pool pool;
+  Res res;
+
+  AVER(p_o != NULL);
+  AVERT(SAC, sac);
+  pool = sac->pool;
+  AVER(pool->lock != NULL);
+
+  PoolClaim(pool);
+  res = sacFill(p_o, sac, size, TRUE);
+  PoolRelease(pool);
+  return res == ResOK;
+}
+
+
 /* sacClassFlush -- discard elements from the cache for a given class
  *
- * blockCount says how many elements to discard.
+ * blockCount says how many elements to discard.  If fast is TRUE, the
+ * blocks are freed by PoolFreeFast (see .fast), and this may stop
+ * early.  Returns the number of elements discarded.
  */
 
-static void sacClassFlush(SAC sac, Index i, Size blockSize,
-                          Count blockCount)
+static Count sacClassFlush(SAC sac, Index i, Size blockSize,
+                           Count blockCount, Bool fast)
 {
   Addr cb, fl;
   Count j;
@@ -307,17 +736,31 @@ static void sacClassFlush(SAC sac, Index i, Size blockSize,
   for (j = 0, fl = esac->_freelists[i]._blocks;
        j < blockCount; ++j) {
     /* @@@@ ignoring shields for now */
-    cb = fl; fl = *ADDR_PTR(Addr, cb);
-    PoolFree(sac->pool, cb, blockSize);
+    cb = fl;
+    if (fast) {
+      Addr next = *ADDR_PTR(Addr, cb);
+      if (!PoolFreeFast(sac->pool, cb, blockSize))
+        break;
+      fl = next;
+    } else {
+      fl = *ADDR_PTR(Addr, cb);
+      PoolFree(sac->pool, cb, blockSize);
+    }
   }
-  esac->_freelists[i]._count -= blockCount;
+  esac->_freelists[i]._count -= j;
   esac->_freelists[i]._blocks = fl;
+  sac->seen[i] = esac->_freelists[i]._count;
+  return j;
 }
 
 
-/* SACEmpty -- free an object, and perhaps empty the cache */
+/* sacEmpty -- free an object, and perhaps empty the cache
+ *
+ * If fast is TRUE, the caller must hold the pool lock but not the
+ * arena lock, and this returns FALSE if it couldn't free anything.
+ */
 
-void SACEmpty(SAC sac, Addr p, Size size)
+static Bool sacEmpty(SAC sac, Addr p, Size size, Bool fast)
 {
   Index i;
   Size blockSize;
@@ -325,17 +768,39 @@ void SACEmpty(SAC sac, Addr p, Size size)
   
   AVERT(SAC, sac);
   AVER(p != NULL);
-  AVER(PoolHasAddr(sac->pool, p));
+  /* Can't check PoolHasAddr without the arena lock. */
+  AVER(fast || PoolHasAddr(sac->pool, p));
   AVER(size > 0);
+  AVERT(Bool, fast);
   esac = ExternalSACOfSAC(sac);
 
+  sacCountHits(sac);
+  if (sacAdaptDue(sac)) {
+    if (fast)
+      return FALSE; /* see .adaptive.slow */
+    sacAdapt(sac);
+  }
+
   sacFind(&i, &blockSize, sac, size);
+  if (esac->_freelists[i]._count < esac->_freelists[i]._count_max) {
+    /* Adapting emptied the cache, so there's room now. */
+    AVER(sac->adaptive);
+    esac->_freelists[i]._count += 1;
+    /* @@@@ ignoring shields for now */
+    *ADDR_PTR(Addr, p) = esac->_freelists[i]._blocks;
+    esac->_freelists[i]._blocks = p;
+    sac->seen[i] = esac->_freelists[i]._count;
+    return TRUE;
+  }
   /* Check it's full (in the future, there will be other cases). */
   AVER(esac->_freelists[i]._count
        == esac->_freelists[i]._count_max);
 
-  /* Adjust size for the overlarge class. */
-  if (blockSize == SizeMAX)
+  if (sac->adaptive)
+    /* see .adaptive.rung */
+    blockSize = sacRung(sac->pool, size);
+  else if (blockSize == SizeMAX)
+    /* Adjust size for the overlarge class. */
     /* see .align */
     blockSize = SizeAlignUp(size, PoolAlignment(sac->pool));
   if (esac->_freelists[i]._count_max > 0) {
@@ -345,16 +810,54 @@ void SACEmpty(SAC sac, Addr p, Size size)
     /* Computed as count - count/3, so that the rounding works out right. */
     blockCount = esac->_freelists[i]._count;
     blockCount -= esac->_freelists[i]._count / 3;
-    sacClassFlush(sac, i, blockSize, (blockCount > 0) ? blockCount : 1);
+    if (sacClassFlush(sac, i, blockSize, (blockCount > 0) ? blockCount : 1,
+                      fast) == 0)
+      return FALSE;
     /* Leave the current one in the cache. */
     esac->_freelists[i]._count += 1;
     /* @@@@ ignoring shields for now */
     *ADDR_PTR(Addr, p) = esac->_freelists[i]._blocks;
     esac->_freelists[i]._blocks = p;
+    sac->seen[i] = esac->_freelists[i]._count;
+  } else if (fast) {
+    /* Free even the current one. */
+    return PoolFreeFast(sac->pool, p, blockSize);
   } else {
     /* Free even the current one. */
     PoolFree(sac->pool, p, blockSize);
   }
+  return TRUE;
+}
+
+
+/* SACEmpty -- free an object, and perhaps empty the cache */
+
+void SACEmpty(SAC sac, Addr p, Size size)
+{
+  Bool b = sacEmpty(sac, p, size, FALSE);
+  AVER(b);
+}
+
+
+/* SACEmptyFast -- empty the cache without entering the arena
+ *
+ * Returns FALSE if nothing could be freed that way, in which case the
+ * caller must enter the arena and call SACEmpty.  See .fast.
+ */
+
+Bool SACEmptyFast(SAC sac, Addr p, Size size)
+{
+  Pool pool;
+  Bool b;
+
+  AVERT(SAC, sac);
+  pool = sac->pool;
+  AVER(pool->lock != NULL);
+
+  PoolClaim(pool);
+  b = sacEmpty(sac, p, size, TRUE);
+  PoolRelease(pool);
+  return b;
 }
 
 
@@ -368,26 +871,113 @@ void SACFlush(SAC sac)
 
   AVERT(SAC, sac);
 
+  sacCountHits(sac);
   esac = ExternalSACOfSAC(sac);
   for (j = sac->middleIndex + 1, i = 0;
        j < sac->classesCount; ++j, i += 2) {
-    sacClassFlush(sac, i, esac->_freelists[i]._size,
-                  esac->_freelists[i]._count);
+    (void)sacClassFlush(sac, i, esac->_freelists[i]._size,
+                        esac->_freelists[i]._count, FALSE);
     AVER(esac->_freelists[i]._blocks == NULL);
   }
   /* no need to flush overlarge, there's nothing there */
   prevSize = esac->_middle;
   for (j = sac->middleIndex, i = 1; j > 0; --j, i += 2) {
-    sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count);
+    (void)sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count, FALSE);
     AVER(esac->_freelists[i]._blocks == NULL);
     prevSize = esac->_freelists[i]._size;
   }
   /* flush smallest class */
-  sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count);
+  (void)sacClassFlush(sac, i, prevSize, esac->_freelists[i]._count, FALSE);
   AVER(esac->_freelists[i]._blocks == NULL);
 }
 
 
+/* SACStatsGet -- get statistics for the classes of a cache
+ *
+ * Fills in at most count elements of stats, in order of increasing
+ * block size, and returns the number of classes.
+ */
+
+Count SACStatsGet(SAC sac, Count count, SACStats stats)
+{
+  Index i, j;
+  mps_sac_t esac;
+
+  AVERT(SAC, sac);
+  AVER(count == 0 || stats != NULL);
+
+  sacCountHits(sac);
+  esac = ExternalSACOfSAC(sac);
+  for (j = 0; j < count && j < sac->classesCount; ++j) {
+    Size size;
+    sacClassIndex(&i, &size, sac, j);
+    stats[j].mps_block_size = size;
+    stats[j].mps_cached_count = esac->_freelists[i]._count_max;
+    stats[j].mps_cached_size = esac->_freelists[i]._count * size;
+    stats[j].mps_hits = sac->hits[i];
+    stats[j].mps_misses = sac->misses[i];
+  }
+  return sac->classesCount;
+}
+
+
+/* sacCachedSize -- total size of the blocks held in a cache
+ *
+ * The counts belong to the thread that owns the cache and may change
+ * under our feet, so the result is only a snapshot.
+ */
+
+static Size sacCachedSize(SAC sac)
+{
+  Index i, j;
+  Size prevSize, size = 0;
+  mps_sac_t esac;
+
+  AVERT(SAC, sac);
+
+  esac = ExternalSACOfSAC(sac);
+  for (j = sac->middleIndex + 1, i = 0;
+       j < sac->classesCount; ++j, i += 2)
+    size += esac->_freelists[i]._count * esac->_freelists[i]._size;
+  /* nothing in overlarge */
+  prevSize = esac->_middle;
+  for (j = sac->middleIndex, i = 1; j > 0; --j, i += 2) {
+    size += esac->_freelists[i]._count * prevSize;
+    prevSize = esac->_freelists[i]._size;
+  }
+  size += esac->_freelists[i]._count * prevSize;
+  return size;
+}
+
+
+/* SACPoolCachedSize -- total size of blocks cached in a pool's SACs
+ *
+ * Blocks in a cache are allocated as far as the pool is concerned,
+ * but not in use by the client program, so mps_pool_free_size counts
+ * them as free.
+ *
+ * .cached.approx: The caches are updated by the client's threads
+ * without any lock (see MPS_SAC_ALLOC_FAST), so if other threads are
+ * using them the counts read here may be stale, or even a mixture of
+ * counts from before and after an allocation. The result is only
+ * approximate in that case.
+ */
+
+Size SACPoolCachedSize(Pool pool)
+{
+  Ring node, nextNode;
+  Size size = 0;
+
+  AVERT(Pool, pool);
+
+  RING_FOR(node, &pool->sacRing, nextNode) {
+    SAC sac = RING_ELT(SAC, poolRing, node);
+    size += sacCachedSize(sac);
+  }
+  return size;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
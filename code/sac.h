@@ -20,11 +20,26 @@
 
 typedef struct SACStruct *SAC;
 
+#define sacSampleLIMIT ((Count)32)
+
+typedef struct SACSampleStruct { /* allocation size and its count */
+  Size size;
+  Count count;
+} SACSampleStruct;
+
 typedef struct SACStruct {
   Sig sig;
   Pool pool;
+  RingStruct poolRing; /* link in the pool's ring of SACs */
   Count classesCount;  /* number of classes */
   Index middleIndex;   /* index of the middle */
+  Bool adaptive;       /* learns its classes from traffic? */
+  Size cacheSize;      /* adaptive: memory to spend on cached blocks */
+  Count adaptPeriod;   /* adaptive: allocations between adaptations */
+  Count misses[2 * sacClassLIMIT]; /* allocations passed to the pool */
+  Count hits[2 * sacClassLIMIT]; /* estimated allocations from the cache */
+  Count seen[2 * sacClassLIMIT]; /* freelist counts left by slow path */
+  SACSampleStruct sample[sacSampleLIMIT]; /* adaptive: frequent sizes */
   _mps_sac_s esac_s;   /* variable length, must be last */
 } SACStruct;
 
@@ -41,12 +56,23 @@ typedef struct SACStruct {
 typedef struct mps_sac_classes_s *SACClasses;
 
 
+/* SACStats -- structure for reporting statistics for classes */
+/* .sacs: This structure must match <code/mps.h#sacs>. */
+
+typedef struct mps_sac_stats_s *SACStats;
+
+
 extern Res SACCreate(SAC *sac_o, Pool pool, Count classesCount,
                      SACClasses classes);
+extern Res SACCreateAdaptive(SAC *sac_o, Pool pool, Size cacheSize);
 extern void SACDestroy(SAC sac);
 extern Res SACFill(Addr *p_o, SAC sac, Size size);
 extern void SACEmpty(SAC sac, Addr p, Size size);
+extern Bool SACFillFast(Addr *p_o, SAC sac, Size size);
+extern Bool SACEmptyFast(SAC sac, Addr p, Size size);
 extern void SACFlush(SAC sac);
+extern Count SACStatsGet(SAC sac, Count count, SACStats stats);
+extern Size SACPoolCachedSize(Pool pool);
 
 
 #endif /* sac_h */
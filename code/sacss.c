@@ -38,12 +38,19 @@ static mps_res_t make(mps_addr_t *p, mps_sac_t sac, size_t size)
 }
 
 
-/* stress -- create a pool of the requested type and allocate in it */
+static size_t fixedSize(size_t i);
+
+
+/* stress -- create a pool of the requested type and allocate in it
+ *
+ * If cache_size is not zero, allocate through an adaptive cache of
+ * that size instead of a cache with fixed classes.
+ */
 
 static mps_res_t stress(mps_arena_t arena, mps_align_t align,
                         size_t (*size)(size_t i),
                         const char *name, mps_pool_class_t pool_class,
-                        mps_arg_s *args)
+                        mps_arg_s *args, size_t cache_size)
 {
   mps_res_t res;
   mps_pool_t pool;
@@ -68,8 +75,12 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
   if (res != MPS_RES_OK)
     return res;
 
-  die(mps_sac_create(&sac, pool, classes_count, classes),
-      "SACCreate");
+  if (cache_size > 0)
+    die(mps_sac_create_adaptive(&sac, pool, cache_size),
+        "SACCreateAdaptive");
+  else
+    die(mps_sac_create(&sac, pool, classes_count, classes),
+        "SACCreate");
 
   /* allocate a load of objects */
   for (i = 0; i < testSetSIZE; ++i) {
@@ -96,8 +107,16 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
       ps[j] = ps[i]; ss[j] = ss[i];
       ps[i] = tp; ss[i] = ts;
     }
-    if (k == (testLOOPS / 2))
+    if (k == (testLOOPS / 2)) {
+      /* Blocks in the cache count as free, so flushing the cache
+         doesn't change the amount of memory in use. */
+      size_t inUse = mps_pool_total_size(pool) - mps_pool_free_size(pool);
       mps_sac_flush(sac);
+      if (pool_class != mps_class_mvff_debug()) {
+        Insist(mps_pool_total_size(pool) - mps_pool_free_size(pool)
+               == inUse);
+      }
+    }
     /* free half of the objects */
     /* upper half, as when allocating them again we want smaller objects */
     /* see randomSize() */
@@ -128,7 +147,26 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
       ps[i] = obj;
     }
   }
-   
+
+  {
+    mps_sac_stats_s stats[MPS_SAC_CLASS_LIMIT];
+    size_t hits = 0, misses = 0;
+    size_t count = mps_sac_stats(sac, MPS_SAC_CLASS_LIMIT, stats);
+    Insist(count <= MPS_SAC_CLASS_LIMIT);
+    for (i = 0; i < count; ++i) {
+      Insist(i == 0 || stats[i - 1].mps_block_size < stats[i].mps_block_size);
+      Insist(stats[i].mps_cached_size
+             <= stats[i].mps_cached_count * stats[i].mps_block_size);
+      hits += stats[i].mps_hits;
+      misses += stats[i].mps_misses;
+    }
+    Insist(hits + misses <= testSetSIZE + testLOOPS * testSetSIZE / 2);
+    /* An adaptive cache learns to cache a size used all the time. */
+    if (cache_size > 0 && size == fixedSize) {
+      Insist(hits > 0);
+    }
+  }
+
   mps_sac_destroy(sac);
   mps_pool_destroy(pool);
 
@@ -184,7 +222,7 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args)
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_ARENA_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_SLOT_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
-    die(stress(arena, align, randomSize, "MVFF", mps_class_mvff(), args),
+    die(stress(arena, align, randomSize, "MVFF", mps_class_mvff(), args, 0),
         "stress MVFF");
   } MPS_ARGS_END(args);
 
@@ -196,17 +234,35 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args)
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_POOL_DEBUG_OPTIONS, &debugOptions);
     die(stress(arena, align, randomSize, "MVFF debug",
-               mps_class_mvff_debug(), args),
+               mps_class_mvff_debug(), args, 0),
         "stress MVFF debug");
   } MPS_ARGS_END(args);
 
   MPS_ARGS_BEGIN(args) {
     fixedSizeSize = MPS_PF_ALIGN * (1 + rnd() % 100);
     MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, fixedSizeSize);
-    die(stress(arena, fixedSizeSize, fixedSize, "MFS", mps_class_mfs(), args),
+    die(stress(arena, fixedSizeSize, fixedSize, "MFS", mps_class_mfs(), args,
+               0),
       "stress MFS");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(stress(arena, align, randomSize, "MVFF adaptive", mps_class_mvff(),
+               args, 1 << 16),
+        "stress MVFF adaptive");
+  } MPS_ARGS_END(args);
+
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    fixedSizeSize = 1 + rnd() % 1000;
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(stress(arena, align, fixedSize, "MVFF adaptive fixed",
+               mps_class_mvff(), args, 1 << 16),
+        "stress MVFF adaptive fixed");
+  } MPS_ARGS_END(args);
+
   mps_arena_destroy(arena);
 }
 
@@ -37,6 +37,7 @@ Res SegAlloc(Seg *segReturn, SegClass klass, LocusPref pref,
   Arena arena;
   Seg seg;
   Addr base;
+  Bool zeroed;
   void *p;
 
   AVER(segReturn != NULL);
@@ -53,6 +54,7 @@ Res SegAlloc(Seg *segReturn, SegClass klass, LocusPref pref,
   res = ArenaAlloc(&base, pref, size, pool);
   if (res != ResOK)
     goto failArena;
+  zeroed = ArenaZeroed(arena, base, AddrAdd(base, size));
 
   /* allocate the segment object from the control pool */
   res = ControlAlloc(&p, arena, klass->size);
@@ -63,6 +65,8 @@ Res SegAlloc(Seg *segReturn, SegClass klass, LocusPref pref,
   res = SegInit(seg, klass, pool, base, size, args);
   if (res != ResOK)
     goto failInit;
+  /* See BufferFill, which is the only consumer of this. */
+  SegSetZeroed(seg, zeroed);
 
   EVENT5(SegAlloc, arena, seg, SegBase(seg), size, pool);
   *segReturn = seg;
@@ -130,8 +134,11 @@ static Res segAbsInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   seg->pm = AccessSetEMPTY;
   seg->sm = AccessSetEMPTY;
   seg->defer = WB_DEFER_INIT;
+  seg->eager = 0;
   seg->depth = 0;
   seg->queued = FALSE;
+  seg->zeroed = FALSE;
+  seg->pinCount = 0;
   seg->firstTract = NULL;
   RingInit(SegPoolRing(seg));
 
@@ -199,6 +206,9 @@ static void segAbsFinish(Inst inst)
 
   seg->rankSet = RankSetEMPTY;
 
+  /* Objects must be unpinned before they are freed. */
+  AVER(seg->pinCount == 0);
+
   /* See <code/shield.c#shield.flush> */
   AVER(seg->depth == 0);
   if (seg->queued)
@@ -310,6 +320,11 @@ void SegSetSummary(Seg seg, RefSet summary)
   summary = RefSetUNIV;
 #endif
 
+  /* A segment holding pinned objects has no write barrier, so there
+     are writes we don't know about. <code/root.c#.pin.barrier> */
+  if (SegPinned(seg) && SegRankSet(seg) != RankSetEMPTY)
+    summary = RefSetUNIV;
+
   if (summary != SegSummary(seg))
     Method(Seg, seg, setSummary)(seg, summary);
 }
@@ -328,6 +343,10 @@ void SegSetRankAndSummary(Seg seg, RankSet rankSet, RefSet summary)
   }
 #endif
 
+  /* <code/root.c#.pin.barrier> */
+  if (SegPinned(seg) && rankSet != RankSetEMPTY)
+    summary = RefSetUNIV;
+
   Method(Seg, seg, setRankSummary)(seg, rankSet, summary);
 }
 
@@ -1117,6 +1136,8 @@ static Res segTrivMerge(Seg seg, Seg segHi,
   /* no need to update fields which match. See .similar */
 
   seg->limit = limit;
+  seg->zeroed = seg->zeroed && segHi->zeroed;
+  seg->pinCount += segHi->pinCount;
   TRACT_FOR(tract, addr, arena, mid, limit) {
     AVERT(Tract, tract);
     AVER(segHi == TractSeg(tract));
@@ -1161,6 +1182,7 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   SegClass klass;
   Tract tract;
   Addr addr;
+  Count pinCountHi;
 
   AVER(segHi != NULL);  /* can't check fully, it's not initialized */
   AVER(AddrIsArenaGrain(base, arena));
@@ -1176,8 +1198,15 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   AVER(seg->depth == 0);
   AVER(!seg->queued);
 
+  /* The pins are shared out by address <code/root.c#.pin.seg>. */
+  pinCountHi = 0;
+  if (seg->pinCount > 0)
+    pinCountHi = ArenaPinCountRange(arena, mid, limit);
+  AVER(pinCountHi <= seg->pinCount);
+
   /* Full initialization for segHi. Just modify seg. */
   seg->limit = mid;
+  seg->pinCount -= pinCountHi;
   AVERT(Seg, seg);
 
   InstInit(CouldBeA(Inst, segHi));
@@ -1190,6 +1219,8 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   segHi->sm = seg->sm;
   segHi->depth = seg->depth;
   segHi->queued = seg->queued;
+  segHi->zeroed = seg->zeroed;
+  segHi->pinCount = pinCountHi;
   segHi->firstTract = NULL;
   RingInit(SegPoolRing(segHi));
 
@@ -1495,7 +1526,7 @@ static void gcSegFinish(Inst inst)
   }
 
   EVENT5(SegSetSummary, PoolArena(SegPool(seg)), seg, SegSize(seg),
-         gcseg->summary, RefSetEMPTY);
+         ZoneSetFold(gcseg->summary), ZoneSetFold(RefSetEMPTY));
 
   gcseg->summary = RefSetEMPTY;
 
@@ -1610,8 +1641,11 @@ static void mutatorSegSetGrey(Seg seg, TraceSet grey)
   arena = PoolArena(SegPool(seg));
   flippedTraces = arena->flippedTraces;
   if (TraceSetInter(oldGrey, flippedTraces) == TraceSetEMPTY) {
-    if (TraceSetInter(grey, flippedTraces) != TraceSetEMPTY)
+    if (TraceSetInter(grey, flippedTraces) != TraceSetEMPTY) {
       ShieldRaise(arena, seg, AccessREAD);
+      if (SegPinned(seg))
+        arena->pinsGrey = TRUE; /* <code/root.c#.pin.barrier> */
+    }
   } else {
     if (TraceSetInter(grey, flippedTraces) == TraceSetEMPTY)
       ShieldLower(arena, seg, AccessREAD);
@@ -1635,6 +1669,8 @@ static void mutatorSegFlip(Seg seg, Trace trace)
      currently flipped trace. */
   if (TraceSetInter(SegGrey(seg), flippedTraces) == TraceSetEMPTY) {
     ShieldRaise(arena, seg, AccessREAD);
+    if (SegPinned(seg))
+      arena->pinsGrey = TRUE; /* <code/root.c#.pin.barrier> */
   } else {
     /* If the segment is grey for some currently flipped trace then
        the read barrier must already have been raised, either in this
@@ -1748,7 +1784,7 @@ static void gcSegSetSummary(Seg seg, RefSet summary)
   AVER_CRITICAL(&gcseg->segStruct == seg);
 
   EVENT5(SegSetSummary, PoolArena(SegPool(seg)), seg, SegSize(seg),
-         gcseg->summary, summary);
+         ZoneSetFold(gcseg->summary), ZoneSetFold(summary));
 
   gcseg->summary = summary;
 
@@ -1788,7 +1824,7 @@ static void gcSegSetRankSummary(Seg seg, RankSet rankSet, RefSet summary)
 
   seg->rankSet = BS_BITFIELD(Rank, rankSet);
   EVENT5(SegSetSummary, PoolArena(SegPool(seg)), seg, SegSize(seg),
-         gcseg->summary, summary);
+         ZoneSetFold(gcseg->summary), ZoneSetFold(summary));
   gcseg->summary = summary;
 }
 
@@ -2051,7 +2087,7 @@ static Res gcSegDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
     return res;
 
   res = WriteF(stream, depth + 2,
-               "summary $W\n", (WriteFW)gcseg->summary,
+               "summary " ZoneSetFORMAT "\n", ZoneSetWriteF(gcseg->summary),
                NULL);
   if (res != ResOK)
     return res;
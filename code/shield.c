@@ -487,6 +487,14 @@ static void shieldQueue(Arena arena, Seg seg)
     }
   }
 
+  /* .queue.pinned: A segment holding pinned objects must not be
+     protected while the mutator is running, because the mutator may
+     have handed them to the operating system.  Suspend the mutator
+     instead, so that the segment can be scanned before the mutator
+     resumes.  <code/root.c#.pin.barrier> */
+  if (SegPinned(seg))
+    shieldSuspend(arena);
+
   /* Queue unavailable, so synchronize now.  Or if the mutator is not
      yet suspended and the code raises the shield on a covered
      segment, protect it now, because that's probably better than
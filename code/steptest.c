@@ -20,6 +20,7 @@
 #include <stdio.h> /* fflush, printf, putchar, stdout */
 
 #define testArenaSIZE     ((size_t)((size_t)64 << 20))
+#define testPrefaultSIZE  ((size_t)((size_t)4 << 20))
 #define avLEN             3
 #define exactRootsCOUNT   200
 #define ambigRootsCOUNT   50
@@ -472,8 +473,15 @@ int main(int argc, char *argv[])
     prepare_clock();
     testlib_init(argc, argv);
     set_clock_timing();
-    die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
-        "arena_create");
+    MPS_ARGS_BEGIN(args) {
+        MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+        /* Exercise keeping spare memory hot in idle steps. */
+        MPS_ARGS_ADD(args, MPS_KEY_ARENA_PREFAULT, rnd() % 2);
+        MPS_ARGS_ADD(args, MPS_KEY_ARENA_PREFAULT_SIZE,
+                     rnd() % 2 ? testPrefaultSIZE : 0);
+        die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+            "arena_create");
+    } MPS_ARGS_END(args);
     mps_arena_clamp(arena);
     test(arena, (unsigned long)pow(10, rnd() % 10));
     mps_arena_destroy(arena);
@@ -225,12 +225,21 @@ static unsigned sizelog2(size_t size)
   return (unsigned)(log((double)size) / log(2.0));
 }
 
+/* testZoneSHIFT is log2 of the number of zones; see ZoneSHIFT in
+ * <code/mpmtypes.h>. */
+
+#if defined(CONFIG_ZONES_128)
+#define testZoneSHIFT (MPS_WORD_SHIFT + 1)
+#else
+#define testZoneSHIFT MPS_WORD_SHIFT
+#endif
+
 size_t rnd_grain(size_t arena_size)
 {
   /* The grain size must be small enough to allow for a complete set
      of zones in the initial chunk, but bigger than one word. */
-  Insist(arena_size >> MPS_WORD_SHIFT >= sizeof(void *));
-  return rnd_align(sizeof(void *), (size_t)1 << sizelog2(arena_size >> MPS_WORD_SHIFT));
+  Insist(arena_size >> testZoneSHIFT >= sizeof(void *));
+  return rnd_align(sizeof(void *), (size_t)1 << sizelog2(arena_size >> testZoneSHIFT));
 }
 
 size_t rnd_align(size_t min, size_t max)
@@ -38,9 +38,13 @@ extern Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth);
  *  for deregistration.
  *
  *  Threads must not be multiply registered in the same arena.
+ *
+ *  If args contains MPS_KEY_THREAD_SAFEPOINT with value TRUE, the
+ *  thread is stopped by a handshake at safepoints rather than by
+ *  suspending it.  See <design/thread-manager#.if.safepoint>.
  */
 
-extern Res ThreadRegister(Thread *threadReturn, Arena arena);
+extern Res ThreadRegister(Thread *threadReturn, Arena arena, ArgList args);
 
 extern void ThreadDeregister(Thread thread, Arena arena);
 
@@ -72,9 +76,115 @@ extern Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
                       mps_area_scan_t scan_area,
                       void *closure);
 
+
+/*  ThreadStackHot
+ *
+ *  If another thread is stopped with all its registers saved on its
+ *  stack, so that its stack can be scanned exactly, sets *hotReturn
+ *  to the hot end of its stack and returns TRUE.  If the thread is
+ *  dead, sets *hotReturn to NULL and returns TRUE.  Otherwise returns
+ *  FALSE.  Must not be called for the current thread.
+ */
+
+extern Bool ThreadStackHot(void **hotReturn, Thread thread);
+
 extern void ThreadSetup(void);
 
 
+/*  ThreadIsCurrent
+ *
+ *  Return TRUE if the thread is the calling thread.
+ */
+
+extern Bool ThreadIsCurrent(Thread thread);
+
+
+/*  Safepoints
+ *
+ *  A thread registered with MPS_KEY_THREAD_SAFEPOINT must call
+ *  ThreadSafepointRequested from time to time, and if it returns
+ *  TRUE, pass through a native region.  While a thread is in a native
+ *  region (between THREAD_NATIVE_BEGIN and THREAD_NATIVE_END) the
+ *  collector treats it as stopped, so it must not touch memory
+ *  managed by the MPS.  THREAD_NATIVE_END waits until the collector
+ *  has finished with the thread.  For other threads these do
+ *  nothing.  ThreadIsSafepoint returns TRUE if the thread was
+ *  registered with MPS_KEY_THREAD_SAFEPOINT on a platform that
+ *  supports it.  ThreadSafepointCurrent returns the calling thread's
+ *  registration with MPS_KEY_THREAD_SAFEPOINT, if any: a thread can
+ *  have only one, so that it can be made native wherever it may
+ *  block in the MPS.  The registers are saved on the stack so that
+ *  they are scanned with it: see <code/ss.h#STACK_CONTEXT_BEGIN>.
+ */
+
+extern Bool ThreadIsSafepoint(Thread thread);
+extern Thread ThreadSafepointCurrent(void);
+extern Bool ThreadSafepointRequested(Thread thread);
+extern void ThreadEnterNative(Thread thread);
+extern void ThreadLeaveNative(Thread thread);
+
+#define THREAD_NATIVE_BEGIN(thread) \
+  BEGIN \
+    StackContextStruct _nc; \
+    STACK_CONTEXT_SAVE(&_nc); \
+    ThreadEnterNative(thread); \
+    BEGIN
+
+#define THREAD_NATIVE_END(thread) \
+    END; \
+    ThreadLeaveNative(thread); \
+  END
+
+
+/*  Handshakes
+ *
+ *  ThreadCanHandshake returns TRUE if the thread is a native safepoint
+ *  thread other than the calling thread, whose stack therefore can't
+ *  change until it leaves its native region.  The flip may then leave
+ *  the thread's roots unscanned, and record the trace in the thread's
+ *  handshake set, until the thread or the collector scans them.  The
+ *  handshake set is protected by the arena lock.  See
+ *  <code/trace.c#.flip.handshake>.
+ */
+
+extern Bool ThreadCanHandshake(Thread thread);
+extern TraceSet ThreadHandshake(Thread thread);
+extern void ThreadSetHandshake(Thread thread, TraceSet ts);
+
+
+/*  Worker threads
+ *
+ *  A ThreadWorkers is a set of threads that help the calling thread
+ *  to run a function for each of a range of indexes, in parallel.
+ *  They aren't registered with the arena, and the function must not
+ *  claim any locks, emit events, or touch memory managed by the MPS.
+ *  ThreadWorkersCreate returns ResUNIMPL on platforms where worker
+ *  threads aren't implemented.
+ */
+
+extern Res ThreadWorkersCreate(ThreadWorkers *workersReturn, Arena arena,
+                               Count count);
+extern void ThreadWorkersDestroy(ThreadWorkers workers);
+extern void ThreadWorkersRun(ThreadWorkers workers, Count n,
+                             ThreadWorkersFunction f, void *closure);
+
+
+/*  Thread-local storage
+ *
+ *  A ThreadLocal is a slot that holds a pointer for each thread,
+ *  initially NULL for all threads.  ThreadLocalGet and ThreadLocalSet
+ *  get and set the calling thread's pointer, and may be called
+ *  without the arena lock.  The storage for a ThreadLocal is
+ *  ThreadLocalSize bytes, allocated by the caller.
+ */
+
+extern Size ThreadLocalSize(void);
+extern Res ThreadLocalInit(ThreadLocal local);
+extern void ThreadLocalFinish(ThreadLocal local);
+extern void *ThreadLocalGet(ThreadLocal local);
+extern Res ThreadLocalSet(ThreadLocal local, void *value);
+
+
 #endif /* th_h */
 
 
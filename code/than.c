@@ -38,7 +38,7 @@ Bool ThreadCheckSimple(Thread thread)
 }
 
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, ArgList args)
 {
   Res res;
   Thread thread;
@@ -46,6 +46,8 @@ Res ThreadRegister(Thread *threadReturn, Arena arena)
   void *p;
 
   AVER(threadReturn != NULL);
+  AVERT(ArgList, args);
+  /* MPS_KEY_THREAD_SAFEPOINT makes no difference: .safepoint. */
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if (res != ResOK)
@@ -125,6 +127,22 @@ Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
 }
 
 
+/* ThreadStackHot -- hot end of the stack of a stopped thread
+ *
+ * There's only one thread on the ANSI platform, and it's current.
+ */
+
+Bool ThreadStackHot(void **hotReturn, Thread thread)
+{
+  AVER(hotReturn != NULL);
+  AVERT(Thread, thread);
+  UNUSED(hotReturn);
+  UNUSED(thread);
+  NOTREACHED;
+  return FALSE;
+}
+
+
 Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
 {
   Res res;
@@ -148,6 +166,150 @@ void ThreadSetup(void)
 }
 
 
+/* ThreadIsCurrent -- is this the calling thread?
+ *
+ * There's only one thread on the ANSI platform.
+ */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return TRUE;
+}
+
+
+/* ThreadIsSafepoint -- was the thread registered for safepoints? */
+
+Bool ThreadIsSafepoint(Thread thread)
+{
+  AVERT(Thread, thread);
+  return FALSE;
+}
+
+
+/* ThreadSafepointCurrent -- the calling thread's safepoint registration */
+
+Thread ThreadSafepointCurrent(void)
+{
+  return NULL;
+}
+
+
+/* ThreadSafepointRequested, ThreadEnterNative, ThreadLeaveNative
+ *
+ * .safepoint: Threads are never suspended (.impl.an.suspend), so
+ * there is never a request, and native regions need no bookkeeping.
+ */
+
+Bool ThreadSafepointRequested(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return FALSE;
+}
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+
+/* ThreadCanHandshake, ThreadHandshake, ThreadSetHandshake
+ *
+ * Threads are never suspended (.impl.an.suspend), so the flip never
+ * leaves a thread to be handshaked.
+ */
+
+Bool ThreadCanHandshake(Thread thread)
+{
+  AVERT(Thread, thread);
+  return FALSE;
+}
+
+TraceSet ThreadHandshake(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return TraceSetEMPTY;
+}
+
+void ThreadSetHandshake(Thread thread, TraceSet ts)
+{
+  AVERT(Thread, thread);
+  AVER(ts == TraceSetEMPTY);
+}
+
+
+/* Thread-local storage, which is just a variable */
+
+typedef struct ThreadLocalStruct {
+  void *value;
+} ThreadLocalStruct;
+
+Size ThreadLocalSize(void)
+{
+  return sizeof(ThreadLocalStruct);
+}
+
+Res ThreadLocalInit(ThreadLocal local)
+{
+  AVER(local != NULL);
+  local->value = NULL;
+  return ResOK;
+}
+
+void ThreadLocalFinish(ThreadLocal local)
+{
+  AVER(local != NULL);
+  local->value = NULL;
+}
+
+void *ThreadLocalGet(ThreadLocal local)
+{
+  AVER(local != NULL);
+  return local->value;
+}
+
+Res ThreadLocalSet(ThreadLocal local, void *value)
+{
+  AVER(local != NULL);
+  local->value = value;
+  return ResOK;
+}
+
+
+/* Worker threads, which aren't implemented on this platform, so that
+ * the MPS does the work in the calling thread instead. */
+
+Res ThreadWorkersCreate(ThreadWorkers *workersReturn, Arena arena,
+                        Count count)
+{
+  AVER(workersReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(count > 0);
+  return ResUNIMPL;
+}
+
+void ThreadWorkersDestroy(ThreadWorkers workers)
+{
+  UNUSED(workers);
+  NOTREACHED;
+}
+
+void ThreadWorkersRun(ThreadWorkers workers, Count n,
+                      ThreadWorkersFunction f, void *closure)
+{
+  UNUSED(workers);
+  UNUSED(n);
+  UNUSED(f);
+  UNUSED(closure);
+  NOTREACHED;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
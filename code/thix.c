@@ -30,6 +30,20 @@
  * .stack.align: assume roots on the stack are always word-aligned,
  * but don't assume that the stack pointer is necessarily
  * word-aligned at the time of reading the context of another thread.
+ *
+ * .safepoint: A thread registered with MPS_KEY_THREAD_SAFEPOINT is
+ * stopped by a handshake instead of a signal, so that it isn't
+ * interrupted in a system call.  ThreadRingSuspend first sets the
+ * request flag of every such thread, then waits for each one to
+ * become "native": that is, to enter a native region (see <code/th.h>),
+ * which it does when it polls a safepoint, when it calls native code
+ * through mps_thread_call_native, and while it waits for the arena
+ * lock or the arena ring lock.  Only then does it suspend the other
+ * threads.  So the safepoint threads stop in parallel, and the time
+ * each one took is reported by the ThreadHandshake event.  A native
+ * thread has saved its registers on its stack and recorded the hot
+ * end of its stack, so it can be scanned while it runs, and it won't
+ * leave the native region until ThreadRingResume clears the request.
  */
 
 #include "mpm.h"
@@ -41,7 +55,11 @@
 #include "prmcix.h"
 #include "pthrdext.h"
 
+#include <errno.h> /* ESRCH */
 #include <pthread.h>
+#include <signal.h> /* sigfillset */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* getpid */
 
 SRCID(thix, "$Id$");
 
@@ -57,9 +75,27 @@ typedef struct mps_thr_s {       /* PThreads thread structure */
   PThreadextStruct thrextStruct; /* PThreads extension */
   pthread_t id;                  /* Pthread object of thread */
   MutatorContext context;        /* Context if suspended, NULL if not */
+  Bool safepoint;                /* stopped at safepoints? .safepoint */
+  pthread_mutex_t spMutex;       /* protects the fields below */
+  pthread_cond_t spCond;         /* broadcast when they change */
+  Bool spRequest;                /* collector wants the thread stopped */
+  Count spNative;                /* depth of native regions */
+  void *spHot;                   /* hot end of stack, if native */
+  Clock spRequestClock;          /* when spRequest was set */
+  Clock spLatencyMax;            /* longest handshake so far */
+  TraceSet handshake;            /* traces awaiting handshake */
 } ThreadStruct;
 
 
+/* threadSafepointKey -- the calling thread's safepoint registration
+ *
+ * Created by ThreadSetup.  See ThreadSafepointCurrent.
+ */
+
+static pthread_key_t threadSafepointKey;
+static Bool threadSafepointKeyValid = FALSE;
+
+
 /* ThreadCheck -- check a thread */
 
 Bool ThreadCheck(Thread thread)
@@ -70,6 +106,10 @@ Bool ThreadCheck(Thread thread)
   CHECKD_NOSIG(Ring, &thread->arenaRing);
   CHECKL(BoolCheck(thread->alive));
   CHECKD(PThreadext, &thread->thrextStruct);
+  CHECKL(BoolCheck(thread->safepoint));
+  CHECKL(TraceSetCheck(thread->handshake));
+  CHECKL(thread->safepoint || thread->handshake == TraceSetEMPTY);
+  /* The sp fields can't be checked without spMutex. */
   return TRUE;
 }
 
@@ -82,20 +122,44 @@ Bool ThreadCheckSimple(Thread thread)
 
 /* ThreadRegister -- register a thread with an arena */
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, ArgList args)
 {
   Res res;
   Thread thread;
+  Bool safepoint = FALSE;
+  ArgStruct arg;
   void *p;
 
   AVER(threadReturn != NULL);
   AVERT(Arena, arena);
+  AVERT(ArgList, args);
+
+  if (ArgPick(&arg, args, MPS_KEY_THREAD_SAFEPOINT))
+    safepoint = arg.val.b;
+  if (safepoint && ThreadSafepointCurrent() != NULL)
+    return ResFAIL; /* already registered with safepoints, in any arena */
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if(res != ResOK)
     return res;
   thread = (Thread)p;
 
+  if (safepoint) {
+    if (pthread_setspecific(threadSafepointKey, thread) != 0) {
+      ControlFree(arena, p, sizeof(ThreadStruct));
+      return ResMEMORY;
+    }
+    (void)pthread_mutex_init(&thread->spMutex, NULL);
+    (void)pthread_cond_init(&thread->spCond, NULL);
+  }
+  thread->safepoint = safepoint;
+  thread->spRequest = FALSE;
+  thread->spNative = 0;
+  thread->spHot = NULL;
+  thread->spRequestClock = 0;
+  thread->spLatencyMax = 0;
+  thread->handshake = TraceSetEMPTY;
+
   thread->id = pthread_self();
 
   RingInit(&thread->arenaRing);
@@ -125,6 +189,15 @@ void ThreadDeregister(Thread thread, Arena arena)
   AVERT(Thread, thread);
   AVERT(Arena, arena);
 
+  if (thread->safepoint) {
+    /* Only the thread itself can clear its thread-local slot. */
+    AVER(ThreadIsCurrent(thread));
+    AVER(thread->spNative == 0);
+    (void)pthread_setspecific(threadSafepointKey, NULL);
+    (void)pthread_cond_destroy(&thread->spCond);
+    (void)pthread_mutex_destroy(&thread->spMutex);
+  }
+
   RingRemove(&thread->arenaRing);
 
   thread->sig = SigInvalid;
@@ -168,8 +241,71 @@ static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
 
 /* ThreadRingSuspend -- suspend all threads on a ring, except the
  * current one.
+ *
+ * Safepoint threads are all asked to stop before waiting for any of
+ * them, so that they reach their safepoints in parallel.  They must
+ * all have stopped before the other threads are suspended, because a
+ * thread may be registered both ways, and a thread that is suspended
+ * by a signal can't reach a safepoint.  See .safepoint.
  */
 
+static Bool threadRequest(Thread thread)
+{
+  if (!thread->safepoint || pthread_equal(pthread_self(), thread->id))
+    return TRUE;
+
+  (void)pthread_mutex_lock(&thread->spMutex);
+  AVER(!thread->spRequest);
+  thread->spRequest = TRUE;
+  thread->spRequestClock = ClockNow();
+  (void)pthread_mutex_unlock(&thread->spMutex);
+  return TRUE;
+}
+
+/* threadHandshake -- wait for a safepoint thread to become native
+ *
+ * The wait is timed so that a thread that has exited without
+ * deregistering can be detected, and moved to the dead ring, like a
+ * thread that can't be suspended.
+ */
+
+static Bool threadHandshake(Thread thread)
+{
+  Clock latency;
+  Bool alive = TRUE;
+
+  if (!thread->safepoint || pthread_equal(pthread_self(), thread->id))
+    return TRUE;
+
+  (void)pthread_mutex_lock(&thread->spMutex);
+  AVER(thread->spRequest);
+  while (thread->spNative == 0) {
+    struct timespec deadline;
+    (void)clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += THREAD_SAFEPOINT_POLL_NS;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_nsec -= 1000000000L;
+      ++deadline.tv_sec;
+    }
+    if (pthread_cond_timedwait(&thread->spCond, &thread->spMutex,
+                               &deadline) == ETIMEDOUT
+        && pthread_kill(thread->id, 0) == ESRCH)
+    {
+      thread->spRequest = FALSE;
+      alive = FALSE;
+      break;
+    }
+  }
+  latency = ClockNow() - thread->spRequestClock;
+  if (latency > thread->spLatencyMax)
+    thread->spLatencyMax = latency;
+  (void)pthread_mutex_unlock(&thread->spMutex);
+
+  EVENT3(ThreadHandshake, thread->arena, thread, latency);
+  /* design.thread-manager.sol.thread.term.attempt */
+  return alive;
+}
+
 static Bool threadSuspend(Thread thread)
 {
   Res res;
@@ -178,6 +314,9 @@ static Bool threadSuspend(Thread thread)
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
+  if (thread->safepoint)
+    return TRUE; /* stopped by threadHandshake */
+
   /* .error.suspend: if PThreadextSuspend fails, we assume the thread
    * has been terminated. */
   AVER(thread->context == NULL);
@@ -192,6 +331,8 @@ static Bool threadSuspend(Thread thread)
 
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
+  mapThreadRing(threadRing, deadRing, threadRequest);
+  mapThreadRing(threadRing, deadRing, threadHandshake);
   mapThreadRing(threadRing, deadRing, threadSuspend);
 }
 
@@ -207,6 +348,9 @@ static Bool threadResume(Thread thread)
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
+  if (thread->safepoint)
+    return TRUE; /* released by threadRelease */
+
   /* .error.resume: If PThreadextResume fails, we assume the thread
    * has been terminated. */
   AVER(thread->context != NULL);
@@ -217,9 +361,30 @@ static Bool threadResume(Thread thread)
   return res == ResOK;
 }
 
+/* threadRelease -- let a safepoint thread leave its native region
+ *
+ * This is done after the other threads have been resumed, because a
+ * thread that is suspended by a signal might hold the mutex.
+ */
+
+static Bool threadRelease(Thread thread)
+{
+  if (!thread->safepoint || pthread_equal(pthread_self(), thread->id))
+    return TRUE;
+
+  (void)pthread_mutex_lock(&thread->spMutex);
+  AVER(thread->spRequest);
+  AVER(thread->spNative > 0);
+  thread->spRequest = FALSE;
+  (void)pthread_cond_broadcast(&thread->spCond);
+  (void)pthread_mutex_unlock(&thread->spMutex);
+  return TRUE;
+}
+
 void ThreadRingResume(Ring threadRing, Ring deadRing)
 {
   mapThreadRing(threadRing, deadRing, threadResume);
+  mapThreadRing(threadRing, deadRing, threadRelease);
 }
 
 
@@ -264,6 +429,20 @@ Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
     res = StackScan(ss, stackCold, scan_area, closure);
     if(res != ResOK)
       return res;
+  } else if (thread->alive && thread->safepoint) {
+    Word *stackBase, *stackLimit;
+
+    /* The thread is native, and its registers are on its stack: see
+     * .safepoint.  It may be running, so the stack above spHot may be
+     * changing, but that's just more conservatism. */
+    AVER(thread->spNative > 0);
+    stackBase = (Word *)AddrAlignUp((Addr)thread->spHot, sizeof(Word));
+    stackLimit = stackCold;
+    if (stackBase >= stackLimit)
+      return ResOK;    /* .stack.below-bottom */
+    res = TraceScanArea(ss, stackBase, stackLimit, scan_area, closure);
+    if(res != ResOK)
+      return res;
   } else if (thread->alive) {
     MutatorContext context;
     Word *stackBase, *stackLimit;
@@ -297,6 +476,31 @@ Res ThreadScan(ScanState ss, Thread thread, void *stackCold,
 }
 
 
+/* ThreadStackHot -- hot end of the stack of a stopped thread
+ *
+ * Only a native safepoint thread has saved its registers on its
+ * stack (see .safepoint).  A thread suspended by a signal may have
+ * references in its registers.
+ */
+
+Bool ThreadStackHot(void **hotReturn, Thread thread)
+{
+  AVER(hotReturn != NULL);
+  AVERT(Thread, thread);
+  AVER(!pthread_equal(pthread_self(), thread->id));
+
+  if (!thread->alive) {
+    *hotReturn = NULL;
+    return TRUE;
+  }
+  if (!thread->safepoint)
+    return FALSE;
+  AVER(thread->spNative > 0);
+  *hotReturn = thread->spHot;
+  return TRUE;
+}
+
+
 /* ThreadDescribe -- describe a thread */
 
 Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
@@ -309,6 +513,9 @@ Res ThreadDescribe(Thread thread, mps_lib_FILE *stream, Count depth)
                (WriteFP)thread->arena, (WriteFU)thread->arena->serial,
                "  alive $S\n", WriteFYesNo(thread->alive),
                "  id $U\n",          (WriteFU)thread->id,
+               "  safepoint $S\n", WriteFYesNo(thread->safepoint),
+               "  spLatencyMax $W\n", (WriteFW)thread->spLatencyMax,
+               "  handshake $B\n", (WriteFB)thread->handshake,
                "} Thread $P ($U)\n", (WriteFP)thread, (WriteFU)thread->serial,
                NULL);
   if(res != ResOK)
@@ -342,6 +549,397 @@ static void threadAtForkChild(void)
 void ThreadSetup(void)
 {
   pthread_atfork(NULL, NULL, threadAtForkChild);
+  if (pthread_key_create(&threadSafepointKey, NULL) == 0)
+    threadSafepointKeyValid = TRUE;
+}
+
+
+/* ThreadIsCurrent -- is this the calling thread? */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return pthread_equal(pthread_self(), thread->id) /* .thread.id */;
+}
+
+
+/* ThreadIsSafepoint -- was the thread registered for safepoints? */
+
+Bool ThreadIsSafepoint(Thread thread)
+{
+  AVERT(Thread, thread);
+  return thread->safepoint;
+}
+
+
+/* ThreadSafepointCurrent -- the calling thread's safepoint registration
+ *
+ * Returns NULL if the calling thread isn't registered with
+ * MPS_KEY_THREAD_SAFEPOINT, including before ThreadSetup.
+ */
+
+Thread ThreadSafepointCurrent(void)
+{
+  if (!threadSafepointKeyValid)
+    return NULL;
+  return pthread_getspecific(threadSafepointKey);
+}
+
+
+/* ThreadSafepointRequested -- does the collector want the thread to stop?
+ *
+ * Called by the thread itself without any lock, so it may see the
+ * request late, but the collector waits for it.  See .safepoint.
+ */
+
+Bool ThreadSafepointRequested(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return thread->spRequest;
+}
+
+
+/* ThreadEnterNative, ThreadLeaveNative -- native region of a thread
+ *
+ * Called by THREAD_NATIVE_BEGIN and THREAD_NATIVE_END, which save the
+ * registers on the stack.  See .safepoint.  Native regions nest (for
+ * example, native code called through mps_thread_call_native may
+ * enter the MPS), and only the outermost one counts.
+ */
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  if (!thread->safepoint)
+    return;
+  AVER(pthread_equal(pthread_self(), thread->id)); /* .thread.id */
+
+  (void)pthread_mutex_lock(&thread->spMutex);
+  if (thread->spNative == 0) {
+    StackHot(&thread->spHot);
+    (void)pthread_cond_broadcast(&thread->spCond);
+  }
+  ++thread->spNative;
+  (void)pthread_mutex_unlock(&thread->spMutex);
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  if (!thread->safepoint)
+    return;
+
+  (void)pthread_mutex_lock(&thread->spMutex);
+  AVER(thread->spNative > 0);
+  if (thread->spNative == 1) {
+    while (thread->spRequest)
+      (void)pthread_cond_wait(&thread->spCond, &thread->spMutex);
+    thread->spHot = NULL;
+  }
+  --thread->spNative;
+  (void)pthread_mutex_unlock(&thread->spMutex);
+}
+
+
+/* ThreadCanHandshake, ThreadHandshake, ThreadSetHandshake -- per-thread
+ * flip
+ *
+ * A native safepoint thread's stack above spHot can't change until it
+ * leaves its native region, so the flip can leave it to be scanned
+ * later.  See <code/trace.c#.flip.handshake>.
+ */
+
+Bool ThreadCanHandshake(Thread thread)
+{
+  Bool native;
+
+  AVERT(Thread, thread);
+  if (!thread->safepoint || !thread->alive || ThreadIsCurrent(thread))
+    return FALSE;
+  (void)pthread_mutex_lock(&thread->spMutex);
+  native = thread->spNative > 0;
+  (void)pthread_mutex_unlock(&thread->spMutex);
+  return native;
+}
+
+TraceSet ThreadHandshake(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return thread->handshake;
+}
+
+void ThreadSetHandshake(Thread thread, TraceSet ts)
+{
+  AVERT(Thread, thread);
+  AVERT(TraceSet, ts);
+  AVER(thread->safepoint || ts == TraceSetEMPTY);
+  thread->handshake = ts;
+}
+
+
+/* Thread-local storage, using a pthreads key */
+
+typedef struct ThreadLocalStruct {
+  pthread_key_t key;
+} ThreadLocalStruct;
+
+Size ThreadLocalSize(void)
+{
+  return sizeof(ThreadLocalStruct);
+}
+
+Res ThreadLocalInit(ThreadLocal local)
+{
+  AVER(local != NULL);
+  if (pthread_key_create(&local->key, NULL) != 0)
+    return ResRESOURCE;
+  return ResOK;
+}
+
+void ThreadLocalFinish(ThreadLocal local)
+{
+  int res;
+
+  AVER(local != NULL);
+  res = pthread_key_delete(local->key);
+  AVER(res == 0);
+}
+
+void *ThreadLocalGet(ThreadLocal local)
+{
+  AVER(local != NULL);
+  return pthread_getspecific(local->key);
+}
+
+Res ThreadLocalSet(ThreadLocal local, void *value)
+{
+  AVER(local != NULL);
+  if (pthread_setspecific(local->key, value) != 0)
+    return ResMEMORY;
+  return ResOK;
+}
+
+
+/* Worker threads
+ *
+ * .workers: The workers wait on workCond until ThreadWorkersRun sets
+ * up a batch of work, then claim indexes from the batch one at a time
+ * under the mutex, along with the calling thread.  The batches are
+ * coarse (for example, one thread stack each), so the mutex isn't
+ * contended.  The workers block all signals, so that they don't
+ * receive the client program's signals, and they aren't registered
+ * with any arena.
+ *
+ * .workers.fork: The worker threads don't exist in a child process
+ * after fork, so there the calling thread does all the work.
+ */
+
+#define ThreadWorkersSig ((Sig)0x519ED0E5) /* SIGnature WORKErS */
+
+typedef struct ThreadWorkersStruct {
+  Sig sig;                      /* <design/sig> */
+  Arena arena;                  /* arena that owns the workers */
+  Count count;                  /* number of worker threads */
+  pthread_t *ids;               /* their ids */
+  pid_t pid;                    /* process that created them */
+  pthread_mutex_t mutex;        /* protects the fields below */
+  pthread_cond_t workCond;      /* broadcast when there's work */
+  pthread_cond_t doneCond;      /* signalled when the batch is done */
+  ThreadWorkersFunction f;      /* function to run for each index */
+  void *closure;                /* its closure */
+  Count n;                      /* number of indexes in the batch */
+  Index next;                   /* next index to claim */
+  Count done;                   /* number of indexes completed */
+  Bool exiting;                 /* workers must exit */
+} ThreadWorkersStruct;
+
+ATTRIBUTE_UNUSED
+static Bool ThreadWorkersCheck(ThreadWorkers workers)
+{
+  CHECKS(ThreadWorkers, workers);
+  CHECKU(Arena, workers->arena);
+  CHECKL(workers->count > 0);
+  CHECKL(workers->ids != NULL);
+  /* The other fields can't be checked without the mutex. */
+  return TRUE;
+}
+
+
+/* threadWorkersClaim -- claim and run indexes until there are none
+ *
+ * Called with the mutex held, and returns with it held.
+ */
+
+static void threadWorkersClaim(ThreadWorkers workers)
+{
+  while (workers->next < workers->n) {
+    ThreadWorkersFunction f = workers->f;
+    void *closure = workers->closure;
+    Index i = workers->next;
+    ++workers->next;
+    (void)pthread_mutex_unlock(&workers->mutex);
+    (*f)(closure, i);
+    (void)pthread_mutex_lock(&workers->mutex);
+    ++workers->done;
+    if (workers->done == workers->n)
+      (void)pthread_cond_signal(&workers->doneCond);
+  }
+}
+
+/* threadWorkersStop -- make the worker threads exit, and wait for them */
+
+static void threadWorkersStop(ThreadWorkers workers)
+{
+  Index i;
+
+  (void)pthread_mutex_lock(&workers->mutex);
+  workers->exiting = TRUE;
+  (void)pthread_cond_broadcast(&workers->workCond);
+  (void)pthread_mutex_unlock(&workers->mutex);
+  for (i = 0; i < workers->count; ++i)
+    (void)pthread_join(workers->ids[i], NULL);
+}
+
+static void *threadWorkersMain(void *p)
+{
+  ThreadWorkers workers = p;
+
+  (void)pthread_mutex_lock(&workers->mutex);
+  for (;;) {
+    while (!workers->exiting && workers->next >= workers->n)
+      (void)pthread_cond_wait(&workers->workCond, &workers->mutex);
+    if (workers->exiting)
+      break;
+    threadWorkersClaim(workers);
+  }
+  (void)pthread_mutex_unlock(&workers->mutex);
+  return NULL;
+}
+
+
+/* ThreadWorkersCreate -- start worker threads */
+
+Res ThreadWorkersCreate(ThreadWorkers *workersReturn, Arena arena,
+                        Count count)
+{
+  ThreadWorkers workers;
+  sigset_t all, old;
+  Index i;
+  void *p;
+  Res res;
+
+  AVER(workersReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(count > 0);
+
+  res = ControlAlloc(&p, arena, sizeof(ThreadWorkersStruct));
+  if (res != ResOK)
+    goto failAlloc;
+  workers = p;
+  res = ControlAlloc(&p, arena, count * sizeof(pthread_t));
+  if (res != ResOK)
+    goto failIdsAlloc;
+  workers->ids = p;
+
+  workers->arena = arena;
+  workers->pid = getpid();
+  workers->f = NULL;
+  workers->closure = NULL;
+  workers->n = 0;
+  workers->next = 0;
+  workers->done = 0;
+  workers->exiting = FALSE;
+  (void)pthread_mutex_init(&workers->mutex, NULL);
+  (void)pthread_cond_init(&workers->workCond, NULL);
+  (void)pthread_cond_init(&workers->doneCond, NULL);
+
+  /* .workers: the workers inherit the signal mask. */
+  (void)sigfillset(&all);
+  (void)pthread_sigmask(SIG_SETMASK, &all, &old);
+  for (i = 0; i < count; ++i)
+    if (pthread_create(&workers->ids[i], NULL, threadWorkersMain,
+                       workers) != 0)
+      break;
+  (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+  workers->count = i;
+  if (i < count) {
+    res = ResRESOURCE;
+    goto failCreate;
+  }
+
+  workers->sig = ThreadWorkersSig;
+  AVERT(ThreadWorkers, workers);
+  *workersReturn = workers;
+  return ResOK;
+
+failCreate:
+  threadWorkersStop(workers);
+  (void)pthread_cond_destroy(&workers->doneCond);
+  (void)pthread_cond_destroy(&workers->workCond);
+  (void)pthread_mutex_destroy(&workers->mutex);
+  ControlFree(arena, workers->ids, count * sizeof(pthread_t));
+failIdsAlloc:
+  ControlFree(arena, workers, sizeof(ThreadWorkersStruct));
+failAlloc:
+  return res;
+}
+
+
+/* ThreadWorkersDestroy -- stop worker threads */
+
+void ThreadWorkersDestroy(ThreadWorkers workers)
+{
+  Arena arena;
+
+  AVERT(ThreadWorkers, workers);
+  arena = workers->arena;
+
+  if (workers->pid == getpid()) /* .workers.fork */
+    threadWorkersStop(workers);
+
+  (void)pthread_cond_destroy(&workers->doneCond);
+  (void)pthread_cond_destroy(&workers->workCond);
+  (void)pthread_mutex_destroy(&workers->mutex);
+  workers->sig = SigInvalid;
+  ControlFree(arena, workers->ids, workers->count * sizeof(pthread_t));
+  ControlFree(arena, workers, sizeof(ThreadWorkersStruct));
+}
+
+
+/* ThreadWorkersRun -- run a function for each index in parallel
+ *
+ * Calls f(closure, i) for each i from 0 to n - 1, in the worker
+ * threads and the calling thread, and returns when all the calls
+ * have returned.
+ */
+
+void ThreadWorkersRun(ThreadWorkers workers, Count n,
+                      ThreadWorkersFunction f, void *closure)
+{
+  Index i;
+
+  AVERT(ThreadWorkers, workers);
+  AVER(FUNCHECK(f));
+  /* closure can't be checked */
+
+  if (workers->pid != getpid()) { /* .workers.fork */
+    for (i = 0; i < n; ++i)
+      (*f)(closure, i);
+    return;
+  }
+
+  (void)pthread_mutex_lock(&workers->mutex);
+  AVER(workers->next >= workers->n); /* no batch in progress */
+  workers->f = f;
+  workers->closure = closure;
+  workers->n = n;
+  workers->next = 0;
+  workers->done = 0;
+  (void)pthread_cond_broadcast(&workers->workCond);
+  threadWorkersClaim(workers);
+  while (workers->done < n)
+    (void)pthread_cond_wait(&workers->doneCond, &workers->mutex);
+  (void)pthread_mutex_unlock(&workers->mutex);
 }
 
 
@@ -93,16 +93,21 @@ Bool ThreadCheckSimple(Thread thread)
 }
 
 
-Res ThreadRegister(Thread *threadReturn, Arena arena)
+Res ThreadRegister(Thread *threadReturn, Arena arena, ArgList args)
 {
   Res res;
   Thread thread;
   HANDLE procHandle;
   BOOL b;
+  ArgStruct arg;
   void *p;
 
   AVER(threadReturn != NULL);
   AVERT(Arena, arena);
+  AVERT(ArgList, args);
+
+  if (ArgPick(&arg, args, MPS_KEY_THREAD_SAFEPOINT) && arg.val.b)
+    return ResUNIMPL;
 
   res = ControlAlloc(&p, arena, sizeof(ThreadStruct));
   if(res != ResOK)
@@ -312,12 +317,179 @@ Res ThreadScan(ScanState ss, Thread thread, Word *stackCold,
 }
 
 
+/* ThreadStackHot -- hot end of the stack of a stopped thread
+ *
+ * Safepoint threads aren't supported on this platform, so a
+ * suspended thread may have references in its registers.
+ */
+
+Bool ThreadStackHot(void **hotReturn, Thread thread)
+{
+  AVER(hotReturn != NULL);
+  AVERT(Thread, thread);
+  AVER(!ThreadIsCurrent(thread));
+
+  if (!thread->alive) {
+    *hotReturn = NULL;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+
 void ThreadSetup(void)
 {
   /* Nothing to do as MPS does not support fork() on Windows. */
 }
 
 
+/* ThreadIsCurrent -- is this the calling thread? */
+
+Bool ThreadIsCurrent(Thread thread)
+{
+  AVERT(Thread, thread);
+  return thread->id == GetCurrentThreadId();
+}
+
+
+/* ThreadIsSafepoint -- was the thread registered for safepoints? */
+
+Bool ThreadIsSafepoint(Thread thread)
+{
+  AVERT(Thread, thread);
+  return FALSE;
+}
+
+
+/* ThreadSafepointCurrent -- the calling thread's safepoint registration */
+
+Thread ThreadSafepointCurrent(void)
+{
+  return NULL;
+}
+
+
+/* ThreadSafepointRequested, ThreadEnterNative, ThreadLeaveNative
+ *
+ * Safepoint threads aren't supported on this platform (ThreadRegister
+ * refuses them), so there is never a request and native regions need
+ * no bookkeeping.
+ */
+
+Bool ThreadSafepointRequested(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return FALSE;
+}
+
+void ThreadEnterNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+void ThreadLeaveNative(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+}
+
+
+/* ThreadCanHandshake, ThreadHandshake, ThreadSetHandshake
+ *
+ * There are no safepoint threads, so no thread can be handshaked.
+ */
+
+Bool ThreadCanHandshake(Thread thread)
+{
+  AVERT(Thread, thread);
+  return FALSE;
+}
+
+TraceSet ThreadHandshake(Thread thread)
+{
+  AVER(TESTT(Thread, thread));
+  return TraceSetEMPTY;
+}
+
+void ThreadSetHandshake(Thread thread, TraceSet ts)
+{
+  AVERT(Thread, thread);
+  AVER(ts == TraceSetEMPTY);
+}
+
+
+/* Thread-local storage, using a TLS index */
+
+typedef struct ThreadLocalStruct {
+  DWORD index;
+} ThreadLocalStruct;
+
+Size ThreadLocalSize(void)
+{
+  return sizeof(ThreadLocalStruct);
+}
+
+Res ThreadLocalInit(ThreadLocal local)
+{
+  AVER(local != NULL);
+  local->index = TlsAlloc();
+  if (local->index == TLS_OUT_OF_INDEXES)
+    return ResRESOURCE;
+  return ResOK;
+}
+
+void ThreadLocalFinish(ThreadLocal local)
+{
+  BOOL b;
+
+  AVER(local != NULL);
+  b = TlsFree(local->index);
+  AVER(b);
+}
+
+void *ThreadLocalGet(ThreadLocal local)
+{
+  AVER(local != NULL);
+  return TlsGetValue(local->index);
+}
+
+Res ThreadLocalSet(ThreadLocal local, void *value)
+{
+  AVER(local != NULL);
+  if (!TlsSetValue(local->index, value))
+    return ResMEMORY;
+  return ResOK;
+}
+
+
+/* Worker threads, which aren't implemented on this platform, so that
+ * the MPS does the work in the calling thread instead. */
+
+Res ThreadWorkersCreate(ThreadWorkers *workersReturn, Arena arena,
+                        Count count)
+{
+  AVER(workersReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(count > 0);
+  return ResUNIMPL;
+}
+
+void ThreadWorkersDestroy(ThreadWorkers workers)
+{
+  UNUSED(workers);
+  NOTREACHED;
+}
+
+void ThreadWorkersRun(ThreadWorkers workers, Count n,
+                      ThreadWorkersFunction f, void *closure)
+{
+  UNUSED(workers);
+  UNUSED(n);
+  UNUSED(f);
+  UNUSED(closure);
+  NOTREACHED;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
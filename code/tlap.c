@@ -0,0 +1,272 @@
+/* tlap.c: THREAD-LOCAL ALLOCATION POINTS
+ *
+ * $Id$
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .purpose: A thread-local allocation point is an allocation point
+ * that the MPS creates on demand, one for each thread and pool, so
+ * that the client program doesn't have to keep track of which
+ * allocation point belongs to which thread.
+ *
+ * .impl: Each thread has a list of TLAP structures, one for each pool
+ * in which it has allocated, held in the arena's thread-local storage
+ * slot (arena->threadLocal, see <code/th.h>).  Only the owning thread
+ * adds or removes list elements, so TLAPLookup walks the list without
+ * the arena lock, and then the allocation point's own protocol makes
+ * allocation lock-free.
+ *
+ * .pool: A TLAP is also on its pool's tlapRing.  When the pool is
+ * destroyed (by any thread), TLAPPoolFinish destroys the buffer and
+ * sets the TLAP's pool to NULL, but leaves it on its owner's list,
+ * because another thread mustn't change the list.  The owner frees
+ * such TLAPs the next time it changes its list.
+ *
+ * .thread: When a thread deregisters itself, TLAPThreadFinish destroys
+ * its thread-local allocation points in that arena.  A thread that is
+ * deregistered by another thread, or that was never registered, keeps
+ * its thread-local allocation points until their pools are destroyed.
+ */
+
+#include "mpm.h"
+
+SRCID(tlap, "$Id$");
+
+
+#define TLAPSig ((Sig)0x51972A9F) /* SIGnature TLAP */
+
+typedef struct TLAPStruct *TLAP;
+
+typedef struct TLAPStruct {
+  Sig sig;                      /* <design/sig> */
+  TLAP next;                    /* next in the owning thread's list */
+  Pool pool;                    /* pool, or NULL if destroyed */
+  Buffer buffer;                /* buffer, or NULL if pool destroyed */
+  RingStruct poolRing;          /* link in pool's tlapRing */
+} TLAPStruct;
+
+
+/* TLAPCheck -- check a thread-local allocation point */
+
+ATTRIBUTE_UNUSED
+static Bool TLAPCheck(TLAP tlap)
+{
+  CHECKS(TLAP, tlap);
+  CHECKD_NOSIG(Ring, &tlap->poolRing);
+  CHECKL((tlap->pool == NULL) == (tlap->buffer == NULL));
+  CHECKL((tlap->pool == NULL) == RingIsSingle(&tlap->poolRing));
+  if (tlap->pool != NULL) {
+    CHECKU(Pool, tlap->pool);
+    CHECKD(Buffer, tlap->buffer);
+    CHECKL(BufferPool(tlap->buffer) == tlap->pool);
+  }
+  return TRUE;
+}
+
+
+/* TLAPLookup -- find the calling thread's buffer for a pool
+ *
+ * Returns NULL if the calling thread has no thread-local allocation
+ * point for the pool.  Doesn't need the arena lock: see .impl.
+ */
+
+Buffer TLAPLookup(Pool pool)
+{
+  TLAP tlap;
+
+  AVER(TESTT(Pool, pool));
+
+  tlap = ThreadLocalGet(PoolArena(pool)->threadLocal);
+  for (; tlap != NULL; tlap = tlap->next)
+    if (tlap->pool == pool)
+      return tlap->buffer;
+  return NULL;
+}
+
+
+/* tlapDestroy -- free a TLAP whose pool has gone */
+
+static void tlapDestroy(Arena arena, TLAP tlap)
+{
+  AVERT(TLAP, tlap);
+  AVER(tlap->pool == NULL);
+  RingFinish(&tlap->poolRing);
+  tlap->sig = SigInvalid;
+  ControlFree(arena, tlap, sizeof(TLAPStruct));
+}
+
+
+/* tlapSweep -- free the TLAPs of the calling thread whose pools have
+ * gone, and return the new head of its list.  See .pool.
+ */
+
+static TLAP tlapSweep(Arena arena, TLAP head)
+{
+  TLAP *link = &head;
+
+  while (*link != NULL) {
+    TLAP tlap = *link;
+    if (tlap->pool == NULL) {
+      *link = tlap->next;
+      tlapDestroy(arena, tlap);
+    } else {
+      link = &tlap->next;
+    }
+  }
+  return head;
+}
+
+
+/* TLAPCreate -- create a buffer for the calling thread in a pool
+ *
+ * The buffer is of the pool's default class, with default keyword
+ * arguments, like an allocation point created by mps_ap_create_k
+ * with mps_args_none.  Must be called with the arena lock held.
+ */
+
+Res TLAPCreate(Buffer *bufferReturn, Pool pool)
+{
+  Arena arena;
+  TLAP head, tlap;
+  Buffer buffer;
+  void *p;
+  Res res;
+
+  AVER(bufferReturn != NULL);
+  AVERT(Pool, pool);
+  arena = PoolArena(pool);
+  AVER(TLAPLookup(pool) == NULL);
+
+  res = ControlAlloc(&p, arena, sizeof(TLAPStruct));
+  if (res != ResOK)
+    goto failAlloc;
+  tlap = p;
+
+  res = BufferCreate(&buffer, PoolDefaultBufferClass(pool), pool, TRUE,
+                     argsNone);
+  if (res != ResOK)
+    goto failBuffer;
+
+  head = tlapSweep(arena, ThreadLocalGet(arena->threadLocal));
+  tlap->next = head;
+  tlap->pool = pool;
+  tlap->buffer = buffer;
+  RingInit(&tlap->poolRing);
+  RingAppend(&pool->tlapRing, &tlap->poolRing);
+  tlap->sig = TLAPSig;
+  AVERT(TLAP, tlap);
+
+  res = ThreadLocalSet(arena->threadLocal, tlap);
+  if (res != ResOK)
+    goto failSet;
+
+  *bufferReturn = buffer;
+  return ResOK;
+
+failSet:
+  (void)ThreadLocalSet(arena->threadLocal, head);
+  tlap->sig = SigInvalid;
+  RingRemove(&tlap->poolRing);
+  RingFinish(&tlap->poolRing);
+  BufferDestroy(buffer);
+failBuffer:
+  ControlFree(arena, tlap, sizeof(TLAPStruct));
+failAlloc:
+  return res;
+}
+
+
+/* TLAPPoolFinish -- destroy the thread-local buffers of a pool
+ *
+ * Called by PoolDestroy, with the arena lock held.  See .pool.
+ */
+
+void TLAPPoolFinish(Pool pool)
+{
+  Ring node, next;
+
+  AVERT(Pool, pool);
+
+  RING_FOR(node, &pool->tlapRing, next) {
+    TLAP tlap = RING_ELT(TLAP, poolRing, node);
+    Buffer buffer = tlap->buffer;
+    AVERT(TLAP, tlap);
+    RingRemove(&tlap->poolRing);
+    tlap->buffer = NULL;
+    tlap->pool = NULL;
+    BufferDestroy(buffer);
+  }
+}
+
+
+/* TLAPThreadFinish -- destroy the thread-local allocation points of a
+ * thread that is deregistering itself
+ *
+ * Called by mps_thread_dereg, with the arena lock held.  See .thread.
+ */
+
+void TLAPThreadFinish(Thread thread)
+{
+  Arena arena;
+  TLAP tlap, next;
+
+  AVERT(Thread, thread);
+  arena = ThreadArena(thread);
+
+  if (!ThreadIsCurrent(thread))
+    return;
+
+  for (tlap = ThreadLocalGet(arena->threadLocal); tlap != NULL; tlap = next) {
+    AVERT(TLAP, tlap);
+    next = tlap->next;
+    if (tlap->pool != NULL) {
+      RingRemove(&tlap->poolRing);
+      BufferDestroy(tlap->buffer);
+      tlap->buffer = NULL;
+      tlap->pool = NULL;
+    }
+    tlapDestroy(arena, tlap);
+  }
+  (void)ThreadLocalSet(arena->threadLocal, NULL);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
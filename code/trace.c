@@ -56,6 +56,24 @@ Bool ScanStateCheck(ScanState ss)
 }
 
 
+/* traceSetHandshaking -- are any of the traces awaiting handshakes?
+ *
+ * See .flip.handshake.move.
+ */
+
+static Bool traceSetHandshaking(TraceSet ts, Arena arena)
+{
+  TraceId ti;
+  Trace trace;
+
+  TRACE_SET_ITER(ti, trace, ts, arena) {
+    if (trace->handshakes > 0)
+      return TRUE;
+  } TRACE_SET_ITER_END(ti, trace, ts, arena);
+  return FALSE;
+}
+
+
 /* ScanStateInit -- Initialize a ScanState object */
 
 void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
@@ -87,8 +105,11 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   AVER(ss->fix != NULL);
 
   /* If the fix method is the normal GC fix, then we optimise the test for
-     whether it's an emergency or not by updating the dispatch here, once. */
-  if (ss->fix == SegFix && ArenaEmergency(arena))
+     whether it's an emergency or not by updating the dispatch here, once.
+     The emergency fix method is also used while handshakes are pending,
+     because it doesn't move objects: see .flip.handshake.move. */
+  if (ss->fix == SegFix
+      && (ArenaEmergency(arena) || traceSetHandshaking(ts, arena)))
         ss->fix = SegFixEmergency;
 
   ss->rank = rank;
@@ -154,10 +175,12 @@ Bool TraceCheck(Trace trace)
   CHECKL(TraceSetIsMember(trace->arena->busyTraces, trace));
   CHECKL(ZoneSetSub(trace->mayMove, trace->white));
   CHECKD_NOSIG(Ring, &trace->genRing);
+  CHECKL(BoolCheck(trace->rootsDeferred));
   /* Use trace->state to check more invariants. */
   switch(trace->state) {
     case TraceINIT:
       CHECKL(!TraceSetIsMember(trace->arena->flippedTraces, trace));
+      CHECKL(trace->handshakes == 0);
       /* @@@@ What can be checked here? */
       break;
 
@@ -177,11 +200,14 @@ Bool TraceCheck(Trace trace)
     case TraceRECLAIM:
       CHECKL(!RingIsSingle(&trace->genRing));
       CHECKL(TraceSetIsMember(trace->arena->flippedTraces, trace));
+      CHECKL(trace->handshakes == 0);
+      CHECKL(!trace->rootsDeferred);
       /* @@@@ Assert that grey set is empty for trace. */
       break;
 
     case TraceFINISHED:
       CHECKL(TraceSetIsMember(trace->arena->flippedTraces, trace));
+      CHECKL(trace->handshakes == 0);
       /* @@@@ Assert that grey and white sets is empty for trace. */
       break;
 
@@ -465,21 +491,22 @@ failBegin:
 }
 
 
-/* traceFlipBuffers -- flip all buffers in the arena */
+/* traceFlipBuffers -- flip all buffers in the arena
+ *
+ * Only the buffers on the arena's bufferRing can need flipping: see
+ * <code/buffer.c#.flip.ring>.
+ */
 
 static void traceFlipBuffers(Globals arena)
 {
-  Ring nodep, nextp;
-
-  RING_FOR(nodep, &arena->poolRing, nextp) {
-    Pool pool = RING_ELT(Pool, arenaRing, nodep);
-    Ring nodeb, nextb;
+  Ring node, next;
 
-    AVERT(Pool, pool);
-    RING_FOR(nodeb, &pool->bufferRing, nextb) {
-      BufferFlip(RING_ELT(Buffer, poolRing, nodeb));
-    }
+  RING_FOR(node, &arena->bufferRing, next) {
+    Buffer buffer = RING_ELT(Buffer, flipRing, node);
+    AVERT(Buffer, buffer);
+    BufferFlip(buffer);
   }
+  AVER(RingIsSingle(&arena->bufferRing));
 }
 
 
@@ -525,12 +552,418 @@ static Res traceScanRoot(TraceSet ts, Rank rank, Arena arena, Root root)
 }
 
 
+/* traceScanPins -- fix the pinned objects at flip
+ *
+ * .pin: Objects pinned by mps_pin are fixed as ambiguous references,
+ * so that they are preserved in place.  See <design/root#.pin>.
+ */
+
+static Res traceScanPinsRes(Trace trace)
+{
+  Arena arena = trace->arena;
+  TraceSet ts = TraceSetSingle(trace);
+  ScanStateStruct ss;
+  Res res;
+
+  ScanStateInit(&ss, ts, arena, RankAMBIG, traceSetWhiteUnion(ts, arena));
+  res = ArenaScanPins(&ss);
+  traceSetUpdateCounts(ts, arena, &ss, traceAccountingPhaseRootScan);
+  ScanStateFinish(&ss);
+  return res;
+}
+
+static Res traceScanPins(Trace trace)
+{
+  Res res;
+
+  if (ArenaPinCount(trace->arena) == 0)
+    return ResOK;
+
+  res = traceScanPinsRes(trace);
+  if (ResIsAllocFailure(res)) {
+    ArenaSetEmergency(trace->arena, TRUE);
+    res = traceScanPinsRes(trace);
+    /* Should be OK in emergency mode */
+    AVER(!ResIsAllocFailure(res));
+  }
+  if (res == ResOK)
+    STATISTIC(trace->pinCount += ArenaPinCount(trace->arena));
+
+  return res;
+}
+
+
+/* traceScanDeferredRoot -- scan one root left grey at flip
+ *
+ * .flip.defer.scan: Scans one root that traceFlip protected instead of
+ * scanning (see .flip.defer), and returns TRUE, or returns FALSE if
+ * there are none left.  The mutator threads are stopped while the
+ * root is scanned, because RootScan removes the protection.
+ */
+
+typedef struct traceDeferredClosureStruct {
+  TraceSet ts;
+  Arena arena;
+  Bool found;
+} traceDeferredClosureStruct;
+
+static Res traceDeferredRoot(Root root, void *p)
+{
+  traceDeferredClosureStruct *dc = p;
+  Res res;
+
+  if (dc->found || !RootDeferred(root, dc->ts))
+    return ResOK;
+  dc->found = TRUE;
+
+  ShieldHold(dc->arena);
+  res = traceScanRoot(dc->ts, RootRank(root), dc->arena, root);
+  ShieldRelease(dc->arena);
+  return res;
+}
+
+static Bool traceScanDeferredRoot(Trace trace)
+{
+  traceDeferredClosureStruct dc;
+  Res res;
+
+  AVERT(Trace, trace);
+
+  if (!trace->rootsDeferred)
+    return FALSE;
+
+  dc.ts = TraceSetSingle(trace);
+  dc.arena = trace->arena;
+  dc.found = FALSE;
+  res = RootsIterate(ArenaGlobals(trace->arena), traceDeferredRoot, &dc);
+  /* Allocation failures should be handled by emergency mode. */
+  AVER(res == ResOK);
+  if (!dc.found)
+    trace->rootsDeferred = FALSE;
+  return dc.found;
+}
+
+
+/* traceFlipPar -- scan thread roots in parallel at flip time
+ *
+ * .flip.par: If the arena has worker threads (see
+ * MPS_KEY_ARENA_SCAN_WORKERS), traceFlip scans the ambiguous roots of
+ * the threads other than the current one in parallel, before the
+ * other roots.  Each root gets its own scan state, whose fix method,
+ * traceFixDefer, just records the references that _mps_fix2 finds to
+ * point to white segments, because the pool fix methods aren't
+ * thread-safe.  Then the collector fixes the recorded references one
+ * root at a time, and accounts for the work as if it had scanned the
+ * root itself.  Because the roots are ambiguous, the references
+ * don't need to be fixed in place.  A root that defers more than
+ * TraceFlipDeferREFS references, or whose references can't be fixed,
+ * stays grey and is scanned again by the usual sequential pass.  See
+ * <code/root.c#.par>.
+ *
+ * .flip.par.event: Scan states used by worker threads mustn't emit
+ * events, because the event buffers are protected by the arena lock.
+ */
+
+typedef struct FlipScanStruct *FlipScan;
+
+typedef struct FlipScanStruct {
+  Root root;                    /* root to scan */
+  ScanStateStruct ssStruct;     /* scan state for the worker */
+  SegFixMethod fix;             /* fix method for the collector */
+  Res res;                      /* result of the worker's scan */
+  Count count;                  /* number of deferred references */
+  Ref *refs;                    /* deferred references */
+} FlipScanStruct;
+
+static Res traceFixDefer(Seg seg, ScanState ss, Ref *refIO)
+{
+  FlipScan fs = ss->fixClosure;
+
+  UNUSED(seg);
+  if (fs->count == TraceFlipDeferREFS)
+    return ResLIMIT;
+  fs->refs[fs->count] = *refIO;
+  ++fs->count;
+  return ResOK;
+}
+
+#define ScanStateEvents(ss) ((ss)->fix != traceFixDefer)
+
+typedef struct traceFlipParClosureStruct {
+  TraceSet ts;
+  Count count;
+  FlipScan fss;
+  Ref *refs;
+} traceFlipParClosureStruct;
+
+static Res traceFlipParCount(Root root, void *p)
+{
+  traceFlipParClosureStruct *pc = p;
+  if (RootParallelScannable(root, pc->ts))
+    ++pc->count;
+  return ResOK;
+}
+
+static Res traceFlipParAdd(Root root, void *p)
+{
+  traceFlipParClosureStruct *pc = p;
+  if (RootParallelScannable(root, pc->ts)) {
+    FlipScan fs = &pc->fss[pc->count];
+    fs->root = root;
+    fs->refs = &pc->refs[pc->count * TraceFlipDeferREFS];
+    ++pc->count;
+  }
+  return ResOK;
+}
+
+static void traceFlipParScan(void *closure, Index i)
+{
+  FlipScan fs = &((FlipScan)closure)[i];
+  fs->res = RootParallelScan(&fs->ssStruct, fs->root);
+}
+
+static Res traceFlipParFix(FlipScan fs)
+{
+  ScanState ss = &fs->ssStruct;
+  Index i;
+  Res res;
+
+  /* Each deferred reference has already been counted once. */
+  STATISTIC(ss->fixRefCount -= fs->count);
+  STATISTIC(ss->segRefCount -= fs->count);
+  STATISTIC(ss->whiteSegRefCount -= fs->count);
+  ss->fix = fs->fix;
+  ss->fixClosure = NULL;
+  for (i = 0; i < fs->count; ++i) {
+    mps_addr_t ref = fs->refs[i];
+    res = _mps_fix2(&ss->ss_s, &ref);
+    if (res != ResOK)
+      return res;
+    AVER(ref == fs->refs[i]); /* ambiguous references don't move */
+  }
+  return ResOK;
+}
+
+static void traceFlipPar(Trace trace)
+{
+  Arena arena = trace->arena;
+  traceFlipParClosureStruct pcStruct;
+  ZoneSet white;
+  Count count;
+  Index i;
+  void *p;
+  Res res;
+
+  if (arena->scanWorkers == NULL)
+    return;
+
+  pcStruct.ts = TraceSetSingle(trace);
+  pcStruct.count = 0;
+  (void)RootsIterate(ArenaGlobals(arena), traceFlipParCount, &pcStruct);
+  count = pcStruct.count;
+  if (count < 2)
+    return;
+
+  res = ControlAlloc(&p, arena, count * sizeof(FlipScanStruct));
+  if (res != ResOK)
+    goto failScansAlloc;
+  pcStruct.fss = p;
+  res = ControlAlloc(&p, arena, count * TraceFlipDeferREFS * sizeof(Ref));
+  if (res != ResOK)
+    goto failRefsAlloc;
+  pcStruct.refs = p;
+
+  pcStruct.count = 0;
+  (void)RootsIterate(ArenaGlobals(arena), traceFlipParAdd, &pcStruct);
+  AVER(pcStruct.count == count);
+
+  white = traceSetWhiteUnion(pcStruct.ts, arena);
+  for (i = 0; i < count; ++i) {
+    FlipScan fs = &pcStruct.fss[i];
+    ScanStateInit(&fs->ssStruct, pcStruct.ts, arena, RankAMBIG, white);
+    fs->fix = fs->ssStruct.fix;
+    fs->ssStruct.fix = traceFixDefer;
+    fs->ssStruct.fixClosure = fs;
+    fs->count = 0;
+    fs->res = ResOK;
+  }
+
+  ThreadWorkersRun(arena->scanWorkers, count, traceFlipParScan,
+                   pcStruct.fss);
+
+  for (i = 0; i < count; ++i) {
+    FlipScan fs = &pcStruct.fss[i];
+    res = fs->res;
+    if (res == ResOK)
+      res = traceFlipParFix(fs);
+    if (res == ResOK)
+      RootParallelScanned(&fs->ssStruct, fs->root);
+    else
+      fs->ssStruct.fix = fs->fix;
+    traceSetUpdateCounts(pcStruct.ts, arena, &fs->ssStruct,
+                         traceAccountingPhaseRootScan);
+    ScanStateFinish(&fs->ssStruct);
+  }
+
+  ControlFree(arena, pcStruct.refs, count * TraceFlipDeferREFS * sizeof(Ref));
+failRefsAlloc:
+  ControlFree(arena, pcStruct.fss, count * sizeof(FlipScanStruct));
+failScansAlloc:
+  NOOP; /* fall back to sequential scanning */
+}
+
+
+/* Handshakes
+ *
+ * .flip.handshake: If the arena was created with
+ * MPS_KEY_ARENA_HANDSHAKE, the flip doesn't scan the roots of
+ * safepoint threads that are native (other than the current thread),
+ * because their stacks above the hot end can't change until they
+ * leave their native regions (see <code/th.h>).  Instead it adds the
+ * trace to each such thread's handshake set, leaving its roots grey.
+ * So the flip doesn't pause for the size of their stacks, and they
+ * don't wait for each other.
+ *
+ * .flip.handshake.self: A thread with a pending handshake scans its
+ * own roots (TraceHandshake) before it can touch managed memory:
+ * ArenaEnterLock does this once it has the arena lock, and
+ * mps_thread_safepoint and mps_thread_call_native enter the arena to
+ * do it when the thread leaves its native region.  So each thread
+ * pauses only for its own stack.
+ *
+ * .flip.handshake.collector: If the trace runs out of grey segments
+ * while handshakes are pending, traceHandshakeAll stops the threads
+ * and scans the pending roots itself.
+ *
+ * .flip.handshake.move: Until a thread's roots are scanned, an object
+ * referenced only from its stack hasn't been fixed, and a copy would
+ * leave the thread with a reference to the old one.  So while
+ * handshakes are pending for a trace, ScanStateInit chooses the
+ * emergency fix method, which preserves objects in place, and the
+ * trace can't finish.
+ */
+
+static void traceFlipHandshakes(Trace trace)
+{
+  Ring node, nextNode;
+
+  RING_FOR(node, ArenaThreadRing(trace->arena), nextNode) {
+    Thread thread = ThreadRingThread(node);
+    if (ThreadCanHandshake(thread)) {
+      AVER(!TraceSetIsMember(ThreadHandshake(thread), trace));
+      ThreadSetHandshake(thread, TraceSetAdd(ThreadHandshake(thread), trace));
+      ++trace->handshakes;
+    }
+  }
+}
+
+static Bool rootHandshakePending(Root root, TraceSet ts)
+{
+  Thread thread = RootThread(root);
+  return thread != NULL
+    && TraceSetInter(ThreadHandshake(thread), ts) != TraceSetEMPTY;
+}
+
+typedef struct traceHandshakeClosureStruct {
+  Thread thread;
+  TraceSet ts;
+} traceHandshakeClosureStruct;
+
+static Res traceHandshakeRoot(Root root, void *p)
+{
+  traceHandshakeClosureStruct *hc = p;
+
+  if (RootThread(root) != hc->thread)
+    return ResOK;
+  return traceScanRoot(hc->ts, RootRank(root), RootArena(root), root);
+}
+
+static void traceHandshakeDone(Thread thread, TraceSet ts)
+{
+  Arena arena = ThreadArena(thread);
+  TraceId ti;
+  Trace trace;
+
+  TRACE_SET_ITER(ti, trace, ts, arena) {
+    AVER(trace->handshakes > 0);
+    --trace->handshakes;
+  } TRACE_SET_ITER_END(ti, trace, ts, arena);
+  ThreadSetHandshake(thread, TraceSetDiff(ThreadHandshake(thread), ts));
+}
+
+
+/* TraceHandshake -- scan the roots that the flip left for a thread
+ *
+ * Must be called with the arena lock held, either by the thread
+ * itself (.flip.handshake.self) or while the thread is stopped
+ * (.flip.handshake.collector).
+ */
+
+void TraceHandshake(Thread thread)
+{
+  traceHandshakeClosureStruct hcStruct;
+  Res res;
+
+  AVERT(Thread, thread);
+  hcStruct.thread = thread;
+  hcStruct.ts = ThreadHandshake(thread);
+  AVER(TraceSetSub(hcStruct.ts, ThreadArena(thread)->flippedTraces));
+
+  res = RootsIterate(ArenaGlobals(ThreadArena(thread)), traceHandshakeRoot,
+                     &hcStruct);
+  AVER(res == ResOK); /* traceScanRoot handles allocation failure */
+  traceHandshakeDone(thread, hcStruct.ts);
+}
+
+
+/* TraceHandshakeCancel -- forget a thread's pending handshakes
+ *
+ * Called when the thread is deregistered by another thread, by which
+ * time the client must have destroyed its roots.
+ */
+
+void TraceHandshakeCancel(Thread thread)
+{
+  AVERT(Thread, thread);
+  traceHandshakeDone(thread, ThreadHandshake(thread));
+}
+
+
+/* traceHandshakeAll -- scan the roots of all threads awaiting a
+ * handshake for a trace
+ *
+ * See .flip.handshake.collector.  The threads that died are on the
+ * dead ring, and have nothing to scan.
+ */
+
+static void traceHandshakeAll(Trace trace)
+{
+  Arena arena = trace->arena;
+  Ring node, nextNode;
+
+  ShieldHold(arena);
+  RING_FOR(node, ArenaThreadRing(arena), nextNode) {
+    Thread thread = ThreadRingThread(node);
+    if (TraceSetIsMember(ThreadHandshake(thread), trace))
+      TraceHandshake(thread);
+  }
+  RING_FOR(node, ArenaDeadRing(arena), nextNode) {
+    Thread thread = ThreadRingThread(node);
+    if (TraceSetIsMember(ThreadHandshake(thread), trace))
+      traceHandshakeDone(thread, TraceSetSingle(trace));
+  }
+  ShieldRelease(arena);
+  AVER(trace->handshakes == 0);
+}
+
+
 /* traceFlip -- blacken the mutator */
 
 struct rootFlipClosureStruct {
   TraceSet ts;
   Arena arena;
   Rank rank;
+  Bool deferred;                /* some root left grey? .flip.defer */
 };
 
 static Res rootFlip(Root root, void *p)
@@ -546,7 +979,12 @@ static Res rootFlip(Root root, void *p)
 
   AVER(RootRank(root) <= RankEXACT); /* see .root.rank */
 
-  if(RootRank(root) == rf->rank) {
+  if(!rootHandshakePending(root, rf->ts)
+     && RootScanRank(root) == rf->rank) {
+    if (RootDefer(root, rf->ts)) {
+      rf->deferred = TRUE;
+      return ResOK;
+    }
     res = traceScanRoot(rf->ts, rf->rank, rf->arena, root);
     if (res != ResOK)
       return res;
@@ -556,6 +994,54 @@ static Res rootFlip(Root root, void *p)
 }
 
 
+/* rootUndefer -- undo rootFlip's protection of a root after failure */
+
+static Res rootUndefer(Root root, void *p)
+{
+  TraceSet *tsp = p;
+
+  AVERT(Root, root);
+  AVER(p != NULL);
+
+  RootUndefer(root, *tsp);
+  return ResOK;
+}
+
+
+/* traceFlipEager -- scan segments that the mutator is likely to hit
+ *
+ * .flip.eager: A segment whose read barrier was hit recently (see
+ * TraceSegReadHit) is scanned now rather than protected, to save the
+ * cost of the fault.  This must happen after the trace is added to
+ * the flipped traces, because pool scan methods may require it, and so
+ * that any segment the scan greys gets its read barrier from
+ * SegSetGrey.  <design/trace#.flip.eager>.
+ */
+
+static Res traceScanSeg(TraceSet ts, Rank rank, Arena arena, Seg seg);
+
+static void traceFlipEager(Trace trace)
+{
+  Arena arena = trace->arena;
+  Ring node, nextNode;
+
+  RING_FOR(node, ArenaGreyRing(arena, RankEXACT), nextNode) {
+    Seg seg = SegOfGreyRing(node);
+
+    if (seg->eager > 0
+        && TraceSetIsMember(SegGrey(seg), trace)
+        && SegRankSet(seg) == RankSetSingle(RankEXACT))
+    {
+      --seg->eager;
+      if (traceScanSeg(TraceSetSingle(trace), RankEXACT, arena, seg) == ResOK) {
+        EVENT2(TraceFlipEager, trace, seg);
+        ++arena->accessAvoided;
+      }
+    }
+  }
+}
+
+
 /* traceFlip -- flip the mutator from grey to black w.r.t. a trace
  *
  * The main job of traceFlip is to scan references which can't be protected
@@ -595,6 +1081,7 @@ static Res traceFlip(Trace trace)
 
   arena = trace->arena;
   rfc.arena = arena;
+  rfc.deferred = FALSE;
   ShieldHold(arena);
 
   AVER(trace->state == TraceUNFLIPPED);
@@ -611,8 +1098,17 @@ static Res traceFlip(Trace trace)
     LDAge(arena, trace->mayMove);
   }
 
-  /* .root.rank: At the moment we must scan all roots, because we don't have */
-  /* a mechanism for shielding them.  There can't be any weak or final roots */
+  /* .flip.handshake: Leave native safepoint threads until later. */
+  if (arena->handshake)
+    traceFlipHandshakes(trace);
+
+  /* .flip.par: Scan thread stacks in parallel, if possible.  Any */
+  /* roots this leaves grey are scanned below. */
+  traceFlipPar(trace);
+
+  /* .root.rank: At the moment we must scan all roots, except for the */
+  /* incremental ones (.flip.defer), because we don't have a mechanism */
+  /* for shielding them.  There can't be any weak or final roots */
   /* either, since we must protect these in order to avoid scanning them too */
   /* early, before the pool contents.  @@@@ This isn't correct if there are */
   /* higher ranking roots than data in pools. */
@@ -622,7 +1118,13 @@ static Res traceFlip(Trace trace)
     res = RootsIterate(ArenaGlobals(arena), rootFlip, (void *)&rfc);
     if (res != ResOK)
       goto failRootFlip;
+    if (rank == RankAMBIG) {
+      res = traceScanPins(trace);  /* .pin */
+      if (res != ResOK)
+        goto failRootFlip;
+    }
   }
+  trace->rootsDeferred = rfc.deferred;
 
   /* .flip.alloc: Allocation needs to become black now. While we flip */
   /* at the start, we can get away with always allocating black. This */
@@ -650,12 +1152,27 @@ static Res traceFlip(Trace trace)
   trace->state = TraceFLIPPED;
   arena->flippedTraces = TraceSetAdd(arena->flippedTraces, trace);
 
+  traceFlipEager(trace);
+
+  /* Segments holding pins mustn't keep the read barrier that SegFlip */
+  /* gave them.  <code/root.c#.pin.barrier> */
+  ArenaBlackenPins(arena);
+
   EVENT2(TraceFlipEnd, trace, arena);
 
   ShieldRelease(arena);
   return ResOK;
 
 failRootFlip:
+  /* Roots deferred by rootFlip must not stay read-protected, as the */
+  /* mutator isn't black.  <design/trace#.flip.defer>. */
+  if (rfc.deferred)
+    (void)RootsIterate(ArenaGlobals(arena), rootUndefer, (void *)&rfc.ts);
+  RING_FOR(node, ArenaThreadRing(arena), nextNode) {
+    Thread thread = ThreadRingThread(node);
+    if (TraceSetIsMember(ThreadHandshake(thread), trace))
+      traceHandshakeDone(thread, TraceSetSingle(trace));
+  }
   ShieldRelease(arena);
   return res;
 }
@@ -682,7 +1199,8 @@ static void traceCreatePoolGen(GenDesc gen)
   Ring n, nn;
   RING_FOR(n, &gen->locusRing, nn) {
     PoolGen pgen = RING_ELT(PoolGen, genRing, n);
-    EVENT11(TraceCreatePoolGen, gen, gen->capacity, gen->mortality, gen->zones,
+    EVENT11(TraceCreatePoolGen, gen, gen->capacity, gen->mortality,
+            ZoneSetFold(gen->zones),
             pgen->pool, pgen->totalSize, pgen->freeSize, pgen->newSize,
             pgen->oldSize, pgen->newDeferredSize, pgen->oldDeferredSize);
   }
@@ -721,6 +1239,8 @@ found:
   trace->notCondemned = (Size)0;
   trace->foundation = (Size)0;  /* nothing grey yet */
   trace->quantumWork = (Work)0; /* computed in TraceStart */
+  trace->handshakes = (Count)0;
+  trace->rootsDeferred = FALSE;
   STATISTIC(trace->greySegCount = (Count)0);
   STATISTIC(trace->greySegMax = (Count)0);
   STATISTIC(trace->rootScanCount = (Count)0);
@@ -736,6 +1256,7 @@ found:
   STATISTIC(trace->segRefCount = (Count)0);
   STATISTIC(trace->whiteSegRefCount = (Count)0);
   STATISTIC(trace->nailCount = (Count)0);
+  STATISTIC(trace->pinCount = (Count)0);
   STATISTIC(trace->snapCount = (Count)0);
   STATISTIC(trace->readBarrierHitCount = (Count)0);
   STATISTIC(trace->pointlessScanCount = (Count)0);
@@ -841,15 +1362,18 @@ void TraceDestroyFinished(Trace trace)
                     trace->singleCopiedSize,
                     trace->readBarrierHitCount, trace->greySegMax,
                     trace->pointlessScanCount));
-  STATISTIC(EVENT11(TraceStatFix, trace, trace->arena,
+  STATISTIC(EVENT12(TraceStatFix, trace, trace->arena,
                     trace->fixRefCount, trace->segRefCount,
                     trace->whiteSegRefCount,
                     trace->nailCount, trace->snapCount,
                     trace->forwardedCount, trace->forwardedSize,
                     trace->preservedInPlaceCount,
-                    trace->preservedInPlaceSize));
+                    trace->preservedInPlaceSize,
+                    trace->pinCount));
   STATISTIC(EVENT4(TraceStatReclaim, trace, trace->arena,
                    trace->reclaimCount, trace->reclaimSize));
+  STATISTIC(trace->arena->fixRefCount += trace->fixRefCount);
+  STATISTIC(trace->arena->whiteSegRefCount += trace->whiteSegRefCount);
 
   traceDestroyCommon(trace);
 }
@@ -917,6 +1441,11 @@ static void traceReclaim(Trace trace)
  * .scan.conservative: It's safe to scan at EXACT unless the band is
  * WEAK and in that case the segment should be weak.
  *
+ * If the trace band is AMBIG then the trace has just flipped, and
+ * traceFindGrey hasn't yet advanced it to the EXACT band, so we scan
+ * EXACT as for that band.  This happens when a segment that holds pins
+ * is scanned at flip <code/root.c#.pin.barrier>.
+ *
  * If the trace band is EXACT then we scan EXACT. This might prevent
  * finalisation messages and may preserve objects pointed to only by weak
  * references but tough luck -- the mutator wants to look.
@@ -956,8 +1485,6 @@ Rank TraceRankForAccess(Arena arena, Seg seg)
   rankSet = SegRankSet(seg);
   switch(band) {
   case RankAMBIG:
-    NOTREACHED;
-    break;
   case RankEXACT:
     return RankEXACT;
   case RankFINAL:
@@ -1232,6 +1759,91 @@ static Res traceScanSeg(TraceSet ts, Rank rank, Arena arena, Seg seg)
 }
 
 
+/* TraceSegReadHit -- note a read barrier hit on a segment
+ *
+ * Each hit makes the segment be scanned at the next RB_EAGER_HIT
+ * flips for which it is grey, up to the width of the bitfield.
+ * <design/trace#.flip.eager>.
+ */
+
+void TraceSegReadHit(Seg seg)
+{
+  unsigned eager;
+
+  AVERT(Seg, seg);
+
+  eager = (unsigned)seg->eager + RB_EAGER_HIT;
+  if (eager < (1u << RB_EAGER_BITS))
+    seg->eager = eager;
+  else
+    seg->eager = (1u << RB_EAGER_BITS) - 1;
+}
+
+
+/* TraceRootAccess -- handle read barrier hit on a root
+ *
+ * The root was left grey and protected at flip (.flip.defer), so
+ * scan it now, with the other mutator threads stopped.
+ */
+
+void TraceRootAccess(Arena arena, Root root)
+{
+  TraceSet traces;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVERT(Root, root);
+
+  traces = arena->flippedTraces;
+  AVER(RootDeferred(root, traces));
+
+  ShieldHold(arena);
+  res = traceScanRoot(traces, RootRank(root), arena, root);
+  ShieldRelease(arena);
+
+  /* Allocation failures should be handled by emergency mode, and we
+     don't expect any other kind of failure. */
+  AVER(res == ResOK);
+  AVER(!RootDeferred(root, traces));
+
+  STATISTIC({
+    Trace trace;
+    TraceId ti;
+    TRACE_SET_ITER(ti, trace, traces, arena)
+      ++trace->readBarrierHitCount;
+    TRACE_SET_ITER_END(ti, trace, traces, arena);
+  });
+}
+
+
+/* TraceSegBlacken -- scan a segment so the mutator may read it
+ *
+ * If the segment is grey for any flipped trace, scan it as if its read
+ * barrier had been hit, but without waiting for the hit.  Used for
+ * segments that must not be protected <code/root.c#.pin.barrier>.
+ */
+
+void TraceSegBlacken(Arena arena, Seg seg)
+{
+  TraceSet traces;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+
+  traces = arena->flippedTraces;
+  if (TraceSetInter(SegGrey(seg), traces) == TraceSetEMPTY)
+    return;
+
+  res = traceScanSeg(traces, TraceRankForAccess(arena, seg), arena, seg);
+
+  /* As for a read barrier hit, allocation failures should be handled */
+  /* by emergency mode.  See TraceSegAccess. */
+  AVER(res == ResOK);
+  AVER(TraceSetInter(SegGrey(seg), traces) == TraceSetEMPTY);
+}
+
+
 /* TraceSegAccess -- handle barrier hit on a segment */
 
 void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
@@ -1270,6 +1882,8 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
 
     AVER(SegRankSet(seg) != RankSetEMPTY);
 
+    TraceSegReadHit(seg);
+
     /* Pick set of traces to scan for: */
     traces = arena->flippedTraces;
     rank = TraceRankForAccess(arena, seg);
@@ -1340,7 +1954,8 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
                 ZoneSetEMPTY);
 
   STATISTIC(++ss->fixRefCount);
-  EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref, ss->rank);
+  if (ScanStateEvents(ss)) /* .flip.par.event */
+    EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref, ss->rank);
 
   /* This sequence of tests is equivalent to calling TractOfAddr(),
    * but inlined so that we can distinguish between "not pointing to
@@ -1378,14 +1993,16 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
      * active traces. <design/trace#.fix.tractofaddr> */
     STATISTIC({
       ++ss->segRefCount;
-      EVENT_CRITICAL1(TraceFixSeg, seg);
+      if (ScanStateEvents(ss))
+        EVENT_CRITICAL1(TraceFixSeg, seg);
     });
     goto done;
   }
 
   STATISTIC(++ss->segRefCount);
   STATISTIC(++ss->whiteSegRefCount);
-  EVENT_CRITICAL1(TraceFixSeg, seg);
+  if (ScanStateEvents(ss))
+    EVENT_CRITICAL1(TraceFixSeg, seg);
   res = (*ss->fix)(seg, ss, &ref);
   if (res != ResOK) {
     /* SegFixEmergency must not fail. */
@@ -1473,6 +2090,71 @@ void TraceScanSingleRef(TraceSet ts, Rank rank, Arena arena,
 }
 
 
+/* traceScanPartRes -- scan part of a segment, with result code */
+
+static Res traceScanPartRes(TraceSet ts, Rank rank, Arena arena,
+                            Seg seg, Addr base, Addr limit)
+{
+  ZoneSet white;
+  Res res;
+  ScanStateStruct ss;
+
+  EVENT5(TraceScanPart, ts, rank, seg, base, limit);
+
+  white = traceSetWhiteUnion(ts, arena);
+  if (ZoneSetInter(SegSummary(seg), white) == ZoneSetEMPTY)
+    return ResOK;
+
+  ScanStateInit(&ss, ts, arena, rank, white);
+  ShieldExpose(arena, seg);
+
+  res = FormatScan(SegPool(seg)->format, &ss, base, limit);
+
+  /* .verify.segsummary applies to part of a segment too. */
+  AVER(RefSetSub(ScanStateUnfixedSummary(&ss), SegSummary(seg)));
+  SegSetSummary(seg, RefSetUnion(SegSummary(seg), ScanStateSummary(&ss)));
+  ShieldCover(arena, seg);
+
+  traceSetUpdateCounts(ts, arena, &ss, traceAccountingPhaseSingleScan);
+  ScanStateFinish(&ss);
+
+  return res;
+}
+
+
+/* TraceScanPart -- scan some of the formatted objects in a segment
+ *
+ * Scans the objects from base to limit (client pointers to the first
+ * object and to the end of the last), on behalf of a pool that handles
+ * a read barrier hit without scanning the whole segment.  The segment
+ * stays grey, and its summary can only grow.  See
+ * <design/poolamc#.access.part>.
+ *
+ * This one can't fail.  It may put the traces into emergency mode in
+ * order to achieve this.  */
+
+void TraceScanPart(TraceSet ts, Rank rank, Arena arena,
+                   Seg seg, Addr base, Addr limit)
+{
+  Res res;
+
+  AVERT(TraceSet, ts);
+  AVERT(Rank, rank);
+  AVERT(Arena, arena);
+  AVERT(Seg, seg);
+  AVER(TraceSetSub(ts, SegGrey(seg)));
+  AVER(base < limit);
+
+  res = traceScanPartRes(ts, rank, arena, seg, base, limit);
+  if (res != ResOK) {
+    ArenaSetEmergency(arena, TRUE);
+    res = traceScanPartRes(ts, rank, arena, seg, base, limit);
+    /* Ought to be OK in emergency mode now. */
+  }
+  AVER(ResOK == res);
+}
+
+
 /* TraceScanArea -- scan an area of memory for references
  *
  * This is a wrapper for area scanning functions, which should not
@@ -1492,7 +2174,8 @@ Res TraceScanArea(ScanState ss, Word *base, Word *limit,
   AVER(limit != NULL);
   AVER(base < limit);
 
-  EVENT3(TraceScanArea, ss, base, limit);
+  if (ScanStateEvents(ss)) /* .flip.par.event */
+    EVENT3(TraceScanArea, ss, base, limit);
 
   /* scannedSize is accumulated whether or not scan_area succeeds, so
      it's safe to accumulate now so that we can tail-call
@@ -1659,12 +2342,16 @@ void TraceAdvance(Trace trace)
     Seg seg;
     Rank rank;
 
-    if (traceFindGrey(&seg, &rank, arena, trace->ti)) {
+    if (traceScanDeferredRoot(trace)) {
+      /* .flip.defer.scan: roots first, so the band stays at exact. */
+    } else if (traceFindGrey(&seg, &rank, arena, trace->ti)) {
       Res res;
       res = traceScanSeg(TraceSetSingle(trace), rank, arena, seg);
       /* Allocation failures should be handled by emergency mode, and we
        * don't expect any other error in a normal GC trace. */
       AVER(res == ResOK);
+    } else if (trace->handshakes > 0) {
+      traceHandshakeAll(trace);
     } else {
       trace->state = TraceRECLAIM;
     }
@@ -1746,6 +2433,125 @@ failCondemn:
 }
 
 
+/* traceCondemnEvacuating -- condemn a generation's segments in
+ * evacuating chunks
+ *
+ * Condemn the segments of moving pools in the generation that are in
+ * chunks being evacuated, adding the generation to the trace if any
+ * are found. Add the predicted casualties to *casualtyIO.
+ */
+
+static Res traceCondemnEvacuating(Size *casualtyIO, Trace trace, GenDesc gen)
+{
+  Size condemnedBefore;
+  Ring segNode, segNext;
+  Res res;
+
+  AVER(casualtyIO != NULL);
+  AVERT(Trace, trace);
+  AVERT(GenDesc, gen);
+
+  condemnedBefore = trace->condemned;
+  RING_FOR(segNode, &gen->segRing, segNext) {
+    GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
+    Seg seg = &gcseg->segStruct;
+    Chunk chunk;
+    Bool b;
+
+    AVERC(GCSeg, gcseg);
+    b = ChunkOfAddr(&chunk, trace->arena, SegBase(seg));
+    AVER(b);
+    if (chunk->evacuating && PoolHasAttr(SegPool(seg), AttrMOVINGGC)) {
+      if (!TraceSetIsMember(gen->activeTraces, trace))
+        GenDescStartTrace(gen, trace);
+      res = TraceAddWhite(trace, seg);
+      if (res != ResOK)
+        return res;
+    }
+  }
+  AVER(trace->condemned >= condemnedBefore);
+  *casualtyIO += (Size)((trace->condemned - condemnedBefore) * gen->mortality);
+  return ResOK;
+}
+
+
+/* TraceStartCompact -- start a trace that evacuates sparse chunks
+ *
+ * Withhold the chunks chosen by PolicyEvacuateChunks from allocation,
+ * and condemn the segments of moving pools in them, so that survivors
+ * are forwarded to other chunks. When the trace finishes, ArenaCompact
+ * gives the chunks back to the arena class, which destroys those that
+ * were emptied.
+ *
+ * Return ResFAIL if there was nothing to evacuate.
+ */
+
+Res TraceStartCompact(Trace *traceReturn, Arena arena, TraceStartWhy why)
+{
+  Trace trace = NULL;
+  Res res;
+  Count chunks;
+  Size casualtySize = 0;
+  double mortality, finishingTime;
+  Ring node, next;
+
+  AVER(traceReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(arena->busyTraces == TraceSetEMPTY);
+
+  chunks = PolicyEvacuateChunks(arena);
+  if (chunks == 0)
+    return ResFAIL;
+
+  res = TraceCreate(&trace, arena, why);
+  AVER(res == ResOK); /* succeeds because no other trace is busy */
+  EVENT3(TraceCompact, arena, trace, chunks);
+
+  /* See TraceCondemnEnd for why the mutator is suspended. */
+  TraceCondemnStart(trace);
+  ShieldHold(arena);
+  RING_FOR(node, &arena->chainRing, next) {
+    size_t i;
+    Chain chain = RING_ELT(Chain, chainRing, node);
+    AVERT(Chain, chain);
+    for (i = 0; i < chain->genCount; ++i) {
+      res = traceCondemnEvacuating(&casualtySize, trace, &chain->gens[i]);
+      if (res != ResOK)
+        goto failCondemn;
+    }
+  }
+  res = traceCondemnEvacuating(&casualtySize, trace, &arena->topGen);
+  if (res != ResOK)
+    goto failCondemn;
+  ShieldRelease(arena);
+
+  /* Destroying the trace gives the evacuating chunks back to the
+     arena class, which destroys any that were already empty. */
+  if (TraceIsEmpty(trace)) {
+    res = ResFAIL;
+    goto nothingCondemned;
+  }
+
+  mortality = (double)casualtySize / trace->condemned;
+  finishingTime = ArenaAvail(arena) - trace->condemned * (1.0 - mortality);
+  if (finishingTime < 0)
+    finishingTime = 0.0;
+  res = TraceStart(trace, mortality, finishingTime);
+  /* We don't expect normal GC traces to fail to start. */
+  AVER(res == ResOK);
+  *traceReturn = trace;
+  return ResOK;
+
+failCondemn:
+  /* See TraceCondemnEnd. */
+  AVER(TraceIsEmpty(trace));
+  ShieldRelease(arena);
+nothingCondemned:
+  TraceDestroyInit(trace);
+  return res;
+}
+
+
 /* TracePoll -- Check if there's any tracing work to be done
  *
  * Consider starting a trace if none is running; advance the running
@@ -1822,8 +2628,8 @@ Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth)
                "  why \"$S\"\n", (WriteFS)TraceStartWhyToString(trace->why),
                "  state $S\n", (WriteFS)state,
                "  band $U\n", (WriteFU)trace->band,
-               "  white   $B\n", (WriteFB)trace->white,
-               "  mayMove $B\n", (WriteFB)trace->mayMove,
+               "  white   " ZoneSetFORMAT "\n", ZoneSetWriteF(trace->white),
+               "  mayMove " ZoneSetFORMAT "\n", ZoneSetWriteF(trace->mayMove),
                "  condemned $U\n", (WriteFU)trace->condemned,
                "  notCondemned $U\n", (WriteFU)trace->notCondemned,
                "  foundation $U\n", (WriteFU)trace->foundation,
@@ -667,6 +667,41 @@ Res ArenaCollect(Globals globals, TraceStartWhy why)
 }
 
 
+/* ArenaEvacuate -- evacuate sparse chunks and release them; leave
+ * parked
+ *
+ * Update *reclaimedReturn with the amount of address space returned to
+ * the operating system by the compaction.
+ */
+
+Res ArenaEvacuate(Size *reclaimedReturn, Globals globals, TraceStartWhy why)
+{
+  Arena arena;
+  Res res;
+  Trace trace;
+  Size reserved;
+
+  AVER(reclaimedReturn != NULL);
+  AVERT(Globals, globals);
+  arena = GlobalsArena(globals);
+
+  ArenaPark(globals);
+  reserved = ArenaReserved(arena);
+  res = TraceStartCompact(&trace, arena, why);
+  if (res == ResOK)
+    ArenaPark(globals);
+  else if (res != ResFAIL) /* ResFAIL means there was nothing to do */
+    return res;
+
+  /* Survivors may have been forwarded into new chunks. */
+  if (ArenaReserved(arena) < reserved)
+    *reclaimedReturn = reserved - ArenaReserved(arena);
+  else
+    *reclaimedReturn = 0;
+  return ResOK;
+}
+
+
 
 /* --------  ExposeRemember and RestoreProtection  -------- */
 
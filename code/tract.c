@@ -142,8 +142,14 @@ Bool ChunkCheck(Chunk chunk)
   CHECKL(AddrAdd((Addr)chunk->allocTable, BTSize(chunk->pages))
          <= PageIndexBase(chunk, chunk->allocBase));
 
+  CHECKD_NOSIG(BT, chunk->zeroTable);
+  CHECKL(AddrAdd((Addr)chunk->zeroTable, BTSize(chunk->pages))
+         <= PageIndexBase(chunk, chunk->allocBase));
+
   /* check they don't overlap (knowing the order) */
   CHECKL(AddrAdd((Addr)chunk->allocTable, BTSize(chunk->pages))
+         <= (Addr)chunk->zeroTable);
+  CHECKL(AddrAdd((Addr)chunk->zeroTable, BTSize(chunk->pages))
          <= (Addr)chunk->pageTable);
 
   CHECKL(chunk->pageTable != NULL);
@@ -154,6 +160,7 @@ Bool ChunkCheck(Chunk chunk)
   /* check there's enough space in the page table */
   CHECKL(INDEX_OF_ADDR(chunk, AddrSub(chunk->limit, 1)) < chunk->pages);
   CHECKL(chunk->pageTablePages < chunk->pages);
+  CHECKL(BoolCheck(chunk->evacuating));
 
   /* Could check the consistency of the tables, but not O(1). */
   return TRUE;
@@ -190,6 +197,7 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   chunk->base = base;
   chunk->limit = limit;
   chunk->reserved = reserved;
+  chunk->evacuating = FALSE;
   size = ChunkSize(chunk);
 
   /* .overhead.pages: Chunk overhead for the page allocation table. */
@@ -199,6 +207,12 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
     goto failAllocTable;
   chunk->allocTable = p;
 
+  /* .overhead.zero: Chunk overhead for the known-zero page table. */
+  res = BootAlloc(&p, boot, (size_t)BTSize(pages), MPS_PF_ALIGN);
+  if (res != ResOK)
+    goto failZeroTable;
+  chunk->zeroTable = p;
+
   pageTableSize = SizeAlignUp(pages * sizeof(PageUnion), chunk->pageSize);
   chunk->pageTablePages = pageTableSize >> pageShift;
 
@@ -213,8 +227,11 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   AVER(AddrIsAligned(BootAllocated(boot), chunk->pageSize));
   chunk->allocBase = (Index)(BootAllocated(boot) >> pageShift);
 
-  /* Init allocTable after class init, because it might be mapped there. */
+  /* Init allocTable and zeroTable after class init, because they
+     might be mapped there.  The arena class sets zeroTable bits when
+     it maps fresh pages: see ArenaZeroed. */
   BTResRange(chunk->allocTable, 0, pages);
+  BTResRange(chunk->zeroTable, 0, pages);
 
   /* Check that there is some usable address space remaining in the chunk. */
   allocBase = PageIndexBase(chunk, chunk->allocBase);
@@ -242,6 +259,7 @@ failLandInsert:
   /* .no-clean: No clean-ups needed past this point for boot, as we will
      discard the chunk. */
 failClassInit:
+failZeroTable:
 failAllocTable:
   return res;
 }
@@ -256,6 +274,7 @@ void ChunkFinish(Chunk chunk)
   AVERT(Chunk, chunk);
 
   AVER(BTIsResRange(chunk->allocTable, 0, chunk->pages));
+  AVER(!chunk->evacuating);
   arena = ChunkArena(chunk);
 
   if (arena->hasFreeLand)
@@ -139,11 +139,13 @@ typedef struct ChunkStruct {
   Index allocBase;      /* index of first page allocatable to clients */
   Index pages;          /* index of the page after the last allocatable page */
   BT allocTable;        /* page allocation table */
+  BT zeroTable;         /* pages known to contain only zeroes */
   Page pageTable;       /* the page table */
   Count pageTablePages; /* number of pages occupied by page table */
   Size reserved;        /* reserved address space for chunk (including overhead
                            such as losses due to alignment): must not change
                            (or arena reserved calculation will break) */
+  Bool evacuating;      /* free pages withheld from the free land? */
 } ChunkStruct;
 
 
@@ -26,6 +26,7 @@ Bool VMCheck(VM vm)
   CHECKL(vm->block != NULL);
   CHECKL((Addr)vm->block <= vm->base);
   CHECKL(vm->mapped <= vm->reserved);
+  CHECKL(BoolCheck(vm->prefault));
   return TRUE;
 }
 
@@ -80,6 +81,31 @@ Size (VMMapped)(VM vm)
 }
 
 
+/* VMTouch -- fault in each operating system page in a mapped range
+ *
+ * Reading and writing back one word of each page forces the operating
+ * system to commit the page now rather than at first use, without
+ * changing its contents (zero on a fresh mapping).
+ */
+
+void VMTouch(VM vm, Addr base, Addr limit)
+{
+  Addr addr;
+
+  AVERT(VM, vm);
+  AVER(base < limit);
+  AVER(base >= VMBase(vm));
+  AVER(limit <= VMLimit(vm));
+  AVER(AddrIsAligned(base, vm->pageSize));
+  AVER(AddrIsAligned(limit, vm->pageSize));
+
+  for (addr = base; addr < limit; addr = AddrAdd(addr, vm->pageSize)) {
+    volatile Word *p = (volatile Word *)addr;
+    *p = *p;
+  }
+}
+
+
 /* VMCopy -- copy VM descriptor */
 
 void VMCopy(VM dest, VM src)
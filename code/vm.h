@@ -26,6 +26,7 @@ typedef struct VMStruct {
   Addr base, limit;             /* aligned boundaries of reserved space */
   Size reserved;                /* total reserved address space */
   Size mapped;                  /* total mapped memory */
+  Bool prefault;                /* populate memory when mapping it? */
 } VMStruct;
 
 
@@ -45,6 +46,7 @@ extern Addr (VMBase)(VM vm);
 extern Addr (VMLimit)(VM vm);
 extern Res VMMap(VM vm, Addr base, Addr limit);
 extern void VMUnmap(VM vm, Addr base, Addr limit);
+extern void VMTouch(VM vm, Addr base, Addr limit);
 extern Size (VMReserved)(VM vm);
 extern Size (VMMapped)(VM vm);
 extern void VMCopy(VM dest, VM src);
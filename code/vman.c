@@ -71,6 +71,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit < AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = (Size)0;
+  vm->prefault = FALSE; /* VMMap writes every byte anyway */
  
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -33,6 +33,13 @@
  * get from mmap.  The others are either caused by invalid params
  * or features we don't use.  See mmap(2) for details.
  *
+ * .prefault: If MPS_KEY_ARENA_PREFAULT is set, mapped memory is
+ * populated at once rather than on first access.  Where the platform
+ * defines MAP_POPULATE (Linux) the kernel does this during mmap;
+ * elsewhere the pages are touched after mapping (see VMTouch).
+ * madvise(MADV_WILLNEED) is not used as it does not populate
+ * anonymous memory that has never been touched.
+ *
  * .remap: Possibly this should use mremap to reduce the number of
  * distinct mappings.  According to our current testing, it doesn't
  * seem to be a problem.
@@ -70,11 +77,28 @@ Size PageSize(void)
 }
 
 
+/* VMParamsStruct -- platform-specific VM parameters */
+
+typedef struct VMParamsStruct {
+  Bool prefault;
+} VMParamsStruct, *VMParams;
+
+static const VMParamsStruct vmParamsDefaults = {
+  /* .prefault = */ FALSE,
+};
+
 Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
 {
+  VMParams vmParams;
+  ArgStruct arg;
   AVER(params != NULL);
   AVERT(ArgList, args);
+  AVER(paramSize >= sizeof(VMParamsStruct));
   UNUSED(paramSize);
+  vmParams = (VMParams)params;
+  (void)mps_lib_memcpy(vmParams, &vmParamsDefaults, sizeof(VMParamsStruct));
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_PREFAULT))
+    vmParams->prefault = arg.val.b;
   return ResOK;
 }
 
@@ -85,6 +109,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
 {
   Size pageSize, reserved;
   void *vbase;
+  VMParams vmParams = params;
 
   AVER(vm != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -125,6 +150,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->prefault = vmParams->prefault;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -161,6 +187,7 @@ void VMFinish(VM vm)
 Res VMMap(VM vm, Addr base, Addr limit)
 {
   Size size;
+  int flags = MAP_ANON | MAP_PRIVATE | MAP_FIXED;
 
   AVERT(VM, vm);
   AVER(sizeof(void *) == sizeof(Addr));
@@ -172,15 +199,25 @@ Res VMMap(VM vm, Addr base, Addr limit)
 
   size = AddrOffset(base, limit);
 
+#if defined(MAP_POPULATE)
+  if (vm->prefault)
+    flags |= MAP_POPULATE; /* .prefault */
+#endif
+
   if(mmap((void *)base, (size_t)size,
           PROT_READ | PROT_WRITE | PROT_EXEC,
-          MAP_ANON | MAP_PRIVATE | MAP_FIXED,
+          flags,
           -1, 0)
      == MAP_FAILED) {
     AVER(errno == ENOMEM); /* .assume.mmap.err */
     return ResMEMORY;
   }
 
+#if !defined(MAP_POPULATE)
+  if (vm->prefault)
+    VMTouch(vm, base, limit); /* .prefault */
+#endif
+
   vm->mapped += size;
   AVER(VMMapped(vm) <= VMReserved(vm));
 
@@ -206,6 +243,8 @@ void VMUnmap(VM vm, Addr base, Addr limit)
   size = AddrOffset(base, limit);
   AVER(size <= VMMapped(vm));
 
+  ProtShadowForget(base, limit);    /* <code/protsh.c#.unmap> */
+
   /* see <design/vmo1#.fun.unmap.offset> */
   addr = mmap((void *)base, (size_t)size,
               PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_FIXED,
@@ -68,10 +68,12 @@ Size PageSize(void)
 
 typedef struct VMParamsStruct {
   Bool topDown;
+  Bool prefault;
 } VMParamsStruct, *VMParams;
 
 static const VMParamsStruct vmParamsDefaults = {
   /* .topDown = */ FALSE,
+  /* .prefault = */ FALSE,
 };
 
 Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
@@ -86,6 +88,8 @@ Res VMParamFromArgs(void *params, size_t paramSize, ArgList args)
   memcpy(vmParams, &vmParamsDefaults, sizeof(VMParamsStruct));
   if (ArgPick(&arg, args, MPS_KEY_VMW3_TOP_DOWN))
     vmParams->topDown = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_PREFAULT))
+    vmParams->prefault = arg.val.b;
   return ResOK;
 }
 
@@ -139,6 +143,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->prefault = vmParams->prefault;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -192,6 +197,10 @@ Res VMMap(VM vm, Addr base, Addr limit)
     return ResMEMORY;
   AVER((Addr)b == base);        /* base should've been aligned */
 
+  /* Windows has no equivalent of MAP_POPULATE, so touch the pages. */
+  if (vm->prefault)
+    VMTouch(vm, base, limit);
+
   vm->mapped += AddrOffset(base, limit);
   AVER(VMMapped(vm) <= VMReserved(vm));
 
@@ -217,6 +226,8 @@ void VMUnmap(VM vm, Addr base, Addr limit)
   size = AddrOffset(base, limit);
   AVER(size <= VMMapped(vm));
 
+  ProtShadowForget(base, limit);    /* <code/protsh.c#.unmap> */
+
   /* .improve.query-unmap: Could check that the pages we are about */
   /* to unmap are mapped, using VirtualQuery. */
   b = VirtualFree((LPVOID)base, (SIZE_T)size, MEM_DECOMMIT);
@@ -254,7 +254,7 @@ static Res rootWalk(Root root, void *p)
 
   AVERT(ScanState, ss);
 
-  if (RootRank(root) == ss->rank) {
+  if (RootScanRank(root) == ss->rank) {
     /* set the root for the benefit of the fix method */
     ScanState2rootsStepClosure(ss)->root = root;
     /* Scan it */